@@ -0,0 +1,74 @@
+# Automatically generated by configure - DO NOT EDIT!
+CONFIGURE_ARGS = --cc=/tmp/ccw --disable-libav --disable-dvbscan --disable-hdhomerun_client
+ROOTDIR  ?= /root/repo
+BUILDDIR ?= /root/repo/build.linux
+PLATFORM ?= linux
+OSENV    ?= posix
+ARCH     ?= x86_64
+CPU      ?= generic
+COMPILER ?= gcc
+ifeq ($(origin CC),default)
+CC        = /tmp/ccw
+endif
+PYTHON   ?= python
+CFLAGS   += 
+LDFLAGS  += 
+prefix    = /usr/local
+bindir    = ${prefix}/bin
+mandir    = ${datadir}/man
+datadir   = ${prefix}/share
+libdir    = ${prefix}/lib
+LDFLAGS += -lssl -lcrypto 
+CFLAGS  += 
+LDFLAGS += -lz 
+CFLAGS  += 
+CONFIG_CWC = yes
+CONFIG_CAPMT = yes
+CONFIG_CONSTCW = yes
+CONFIG_LINUXDVB = yes
+CONFIG_SATIP_SERVER = yes
+CONFIG_SATIP_CLIENT = yes
+CONFIG_HDHOMERUN_CLIENT = no
+CONFIG_HDHOMERUN_STATIC = no
+CONFIG_IPTV = yes
+CONFIG_TSFILE = yes
+CONFIG_DVBSCAN = no
+CONFIG_TIMESHIFT = yes
+CONFIG_TRACE = yes
+CONFIG_IMAGECACHE = yes
+CONFIG_AVAHI = no
+CONFIG_ZLIB = yes
+CONFIG_LIBAV = no
+CONFIG_LIBFFMPEG_STATIC = no
+CONFIG_LIBFFMPEG_STATIC_X264 = yes
+CONFIG_INOTIFY = yes
+CONFIG_EPOLL = yes
+CONFIG_URIPARSER = no
+CONFIG_CCACHE = no
+CONFIG_TVHCSA = yes
+CONFIG_BUNDLE = no
+CONFIG_DVBCSA = no
+CONFIG_DVBEN50221 = no
+CONFIG_KQUEUE = no
+CONFIG_DBUS_1 = no
+CONFIG_ANDROID = no
+CONFIG_TSDEBUG = no
+CONFIG_GTIMER_CHECK = no
+CONFIG_DVR_INDEX_CHECK = no
+CONFIG_EXECINFO = yes
+CONFIG_MMX = yes
+CONFIG_SSE2 = yes
+CONFIG_GETLOADAVG = yes
+CONFIG_ATOMIC64 = yes
+CONFIG_LOCKOWNER = yes
+CONFIG_QSORT_R = yes
+CONFIG_RECVMMSG = yes
+CONFIG_SENDMMSG = yes
+CONFIG_PY_GZIP = yes
+CONFIG_BIN_BZIP2 = yes
+CONFIG_SSL = yes
+CONFIG_LINUXDVBAPI = yes
+CONFIG_UPNP = yes
+CONFIG_INOTIFY_H = yes
+CONFIG_MPEGTS = yes
+CONFIG_MPEGTS_DVB = yes
@@ -0,0 +1,85 @@
+#define PLATFORM_LINUX 1
+#define ENABLE_CWC 1
+#define CONFIG_CWC 1
+#define ENABLE_CAPMT 1
+#define CONFIG_CAPMT 1
+#define ENABLE_CONSTCW 1
+#define CONFIG_CONSTCW 1
+#define ENABLE_LINUXDVB 1
+#define CONFIG_LINUXDVB 1
+#define ENABLE_SATIP_SERVER 1
+#define CONFIG_SATIP_SERVER 1
+#define ENABLE_SATIP_CLIENT 1
+#define CONFIG_SATIP_CLIENT 1
+#define ENABLE_HDHOMERUN_CLIENT 0
+#define ENABLE_HDHOMERUN_STATIC 0
+#define ENABLE_IPTV 1
+#define CONFIG_IPTV 1
+#define ENABLE_TSFILE 1
+#define CONFIG_TSFILE 1
+#define ENABLE_DVBSCAN 0
+#define ENABLE_TIMESHIFT 1
+#define CONFIG_TIMESHIFT 1
+#define ENABLE_TRACE 1
+#define CONFIG_TRACE 1
+#define ENABLE_IMAGECACHE 1
+#define CONFIG_IMAGECACHE 1
+#define ENABLE_AVAHI 0
+#define ENABLE_ZLIB 1
+#define CONFIG_ZLIB 1
+#define ENABLE_LIBAV 0
+#define ENABLE_LIBFFMPEG_STATIC 0
+#define ENABLE_LIBFFMPEG_STATIC_X264 1
+#define CONFIG_LIBFFMPEG_STATIC_X264 1
+#define ENABLE_INOTIFY 1
+#define CONFIG_INOTIFY 1
+#define ENABLE_EPOLL 1
+#define CONFIG_EPOLL 1
+#define ENABLE_URIPARSER 0
+#define ENABLE_CCACHE 0
+#define ENABLE_TVHCSA 1
+#define CONFIG_TVHCSA 1
+#define ENABLE_BUNDLE 0
+#define ENABLE_DVBCSA 0
+#define ENABLE_DVBEN50221 0
+#define ENABLE_KQUEUE 0
+#define ENABLE_DBUS_1 0
+#define ENABLE_ANDROID 0
+#define ENABLE_TSDEBUG 0
+#define ENABLE_GTIMER_CHECK 0
+#define ENABLE_DVR_INDEX_CHECK 0
+#define ENABLE_EXECINFO 1
+#define CONFIG_EXECINFO 1
+#define ENABLE_MMX 1
+#define CONFIG_MMX 1
+#define ENABLE_SSE2 1
+#define CONFIG_SSE2 1
+#define ENABLE_GETLOADAVG 1
+#define CONFIG_GETLOADAVG 1
+#define ENABLE_ATOMIC64 1
+#define CONFIG_ATOMIC64 1
+#define ENABLE_LOCKOWNER 1
+#define CONFIG_LOCKOWNER 1
+#define ENABLE_QSORT_R 1
+#define CONFIG_QSORT_R 1
+#define ENABLE_RECVMMSG 1
+#define CONFIG_RECVMMSG 1
+#define ENABLE_SENDMMSG 1
+#define CONFIG_SENDMMSG 1
+#define ENABLE_PY_GZIP 1
+#define CONFIG_PY_GZIP 1
+#define ENABLE_BIN_BZIP2 1
+#define CONFIG_BIN_BZIP2 1
+#define ENABLE_SSL 1
+#define CONFIG_SSL 1
+#define ENABLE_LINUXDVBAPI 1
+#define CONFIG_LINUXDVBAPI 1
+#define ENABLE_UPNP 1
+#define CONFIG_UPNP 1
+#define ENABLE_INOTIFY_H 1
+#define CONFIG_INOTIFY_H 1
+#define ENABLE_MPEGTS 1
+#define CONFIG_MPEGTS 1
+#define ENABLE_MPEGTS_DVB 1
+#define CONFIG_MPEGTS_DVB 1
+#define TVHEADEND_DATADIR "/usr/local/share/tvheadend"
@@ -60,17 +60,12 @@ api_register_all ( const api_hook_t *hooks )
   }
 }
 
-int
-api_exec ( access_t *perm, const char *subsystem,
-           htsmsg_t *args, htsmsg_t **resp )
+static int
+api_find ( access_t *perm, const char *subsystem, htsmsg_t *args,
+           const api_hook_t **hook, const char **op )
 {
   api_hook_t h;
   api_link_t *ah, skel;
-  const char *op;
-
-  /* Args and response must be set */
-  if (!args || !resp || !subsystem)
-    return EINVAL;
 
   // Note: there is no locking while checking the hook tree, its assumed
   //       this is all setup during init (if this changes the code will
@@ -88,13 +83,79 @@ api_exec ( access_t *perm, const char *subsystem,
     return EPERM;
 
   /* Extract method */
-  op = htsmsg_get_str(args, "method");
-  if (!op)
-    op = htsmsg_get_str(args, "op");
+  *op = htsmsg_get_str(args, "method");
+  if (!*op)
+    *op = htsmsg_get_str(args, "op");
   // Note: this is not required (so no final validation)
 
+  *hook = ah->hook;
+  return 0;
+}
+
+int
+api_exec ( access_t *perm, const char *subsystem,
+           htsmsg_t *args, htsmsg_t **resp )
+{
+  const api_hook_t *hook;
+  const char *op;
+  htsbuf_queue_t hq;
+  char *str;
+  int r;
+
+  /* Args and response must be set */
+  if (!args || !resp || !subsystem)
+    return EINVAL;
+
+  if ((r = api_find(perm, subsystem, args, &hook, &op)) != 0)
+    return r;
+
   /* Execute */
-  return ah->hook->ah_callback(perm, ah->hook->ah_opaque, op, args, resp);
+  if (hook->ah_callback)
+    return hook->ah_callback(perm, hook->ah_opaque, op, args, resp);
+
+  /* Streaming only handler */
+  htsbuf_queue_init(&hq, 0);
+  r = hook->ah_json_callback(perm, hook->ah_opaque, op, args, &hq);
+  if (!r) {
+    str = htsbuf_to_string(&hq);
+    if ((*resp = htsmsg_json_deserialize(str)) == NULL)
+      r = EINVAL;
+    free(str);
+  }
+  htsbuf_queue_flush(&hq);
+  return r;
+}
+
+int
+api_exec_json ( access_t *perm, const char *subsystem,
+                htsmsg_t *args, htsbuf_queue_t *hq )
+{
+  const api_hook_t *hook;
+  const char *op;
+  htsmsg_t *resp = NULL;
+  int r;
+
+  /* Args and output must be set */
+  if (!args || !hq || !subsystem)
+    return EINVAL;
+
+  if ((r = api_find(perm, subsystem, args, &hook, &op)) != 0)
+    return r;
+
+  /* Execute */
+  if (hook->ah_json_callback)
+    return hook->ah_json_callback(perm, hook->ah_opaque, op, args, hq);
+
+  r = hook->ah_callback(perm, hook->ah_opaque, op, args, &resp);
+  if (!r) {
+    if (resp)
+      htsmsg_json_serialize(resp, hq, 0);
+    else
+      htsbuf_append(hq, "{}", 2);
+  }
+  if (resp)
+    htsmsg_destroy(resp);
+  return r;
 }
 
 static int
@@ -21,6 +21,7 @@
 #define __TVH_API_H__
 
 #include "htsmsg.h"
+#include "htsmsg_json.h"
 #include "idnode.h"
 #include "redblack.h"
 #include "access.h"
@@ -35,12 +36,21 @@ typedef int (*api_callback_t)
   ( access_t *perm, void *opaque, const char *op,
     htsmsg_t *args, htsmsg_t **resp );
 
+/*
+ * Alternative for the large replies, the JSON output is written directly
+ * to the queue (nothing should be written when an error is returned)
+ */
+typedef int (*api_json_callback_t)
+  ( access_t *perm, void *opaque, const char *op,
+    htsmsg_t *args, htsbuf_queue_t *hq );
+
 typedef struct api_hook
 {
   const char         *ah_subsystem;
   int                 ah_access;
   api_callback_t      ah_callback;
   void               *ah_opaque;
+  api_json_callback_t ah_json_callback;
 } api_hook_t;
 
 /*
@@ -54,6 +64,8 @@ void api_register_all ( const api_hook_t *hooks );
  */
 int  api_exec ( access_t *perm, const char *subsystem,
                 htsmsg_t *args, htsmsg_t **resp );
+int  api_exec_json ( access_t *perm, const char *subsystem,
+                     htsmsg_t *args, htsbuf_queue_t *hq );
 
 /*
  * Initialise
@@ -94,7 +106,8 @@ typedef idnode_set_t *(*api_idnode_tree_callback_t)
   (access_t *perm);
 
 int api_idnode_grid
-  ( access_t *perm, void *opaque, const char *op, htsmsg_t *args, htsmsg_t **resp );
+  ( access_t *perm, void *opaque, const char *op, htsmsg_t *args,
+    htsbuf_queue_t *hq );
 
 int api_idnode_class
   ( access_t *perm, void *opaque, const char *op, htsmsg_t *args, htsmsg_t **resp );
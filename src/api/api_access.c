@@ -53,7 +53,7 @@ void api_access_init ( void )
 {
   static api_hook_t ah[] = {
     { "access/entry/class",  ACCESS_ADMIN, api_idnode_class, (void*)&access_entry_class },
-    { "access/entry/grid",   ACCESS_ADMIN, api_idnode_grid,  api_access_entry_grid },
+    { "access/entry/grid",   ACCESS_ADMIN, NULL,  api_access_entry_grid, api_idnode_grid },
     { "access/entry/create", ACCESS_ADMIN, api_access_entry_create, NULL },
 
     { NULL },
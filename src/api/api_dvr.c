@@ -366,25 +366,25 @@ void api_dvr_init ( void )
     { "dvr/config/class",          ACCESS_OR|ACCESS_ADMIN|ACCESS_RECORDER,
                                      api_idnode_class, (void*)&dvr_config_class },
     { "dvr/config/grid",           ACCESS_OR|ACCESS_ADMIN|ACCESS_RECORDER,
-                                     api_idnode_grid, api_dvr_config_grid },
+                                     NULL, api_dvr_config_grid, api_idnode_grid },
     { "dvr/config/create",         ACCESS_ADMIN, api_dvr_config_create, NULL },
 
     { "dvr/entry/class",           ACCESS_RECORDER, api_idnode_class, (void*)&dvr_entry_class },
-    { "dvr/entry/grid",            ACCESS_RECORDER, api_idnode_grid, api_dvr_entry_grid },
-    { "dvr/entry/grid_upcoming",   ACCESS_RECORDER, api_idnode_grid, api_dvr_entry_grid_upcoming },
-    { "dvr/entry/grid_finished",   ACCESS_RECORDER, api_idnode_grid, api_dvr_entry_grid_finished },
-    { "dvr/entry/grid_failed",     ACCESS_RECORDER, api_idnode_grid, api_dvr_entry_grid_failed },
+    { "dvr/entry/grid",            ACCESS_RECORDER, NULL, api_dvr_entry_grid, api_idnode_grid },
+    { "dvr/entry/grid_upcoming",   ACCESS_RECORDER, NULL, api_dvr_entry_grid_upcoming, api_idnode_grid },
+    { "dvr/entry/grid_finished",   ACCESS_RECORDER, NULL, api_dvr_entry_grid_finished, api_idnode_grid },
+    { "dvr/entry/grid_failed",     ACCESS_RECORDER, NULL, api_dvr_entry_grid_failed, api_idnode_grid },
     { "dvr/entry/create",          ACCESS_RECORDER, api_dvr_entry_create, NULL },
     { "dvr/entry/create_by_event", ACCESS_RECORDER, api_dvr_entry_create_by_event, NULL },
     { "dvr/entry/cancel",          ACCESS_RECORDER, api_dvr_entry_cancel, NULL },
 
     { "dvr/autorec/class",         ACCESS_RECORDER, api_idnode_class, (void*)&dvr_autorec_entry_class },
-    { "dvr/autorec/grid",          ACCESS_RECORDER, api_idnode_grid,  api_dvr_autorec_grid },
+    { "dvr/autorec/grid",          ACCESS_RECORDER, NULL,  api_dvr_autorec_grid, api_idnode_grid },
     { "dvr/autorec/create",        ACCESS_RECORDER, api_dvr_autorec_create, NULL },
     { "dvr/autorec/create_by_series", ACCESS_RECORDER, api_dvr_autorec_create_by_series, NULL },
 
     { "dvr/timerec/class",         ACCESS_RECORDER, api_idnode_class, (void*)&dvr_timerec_entry_class },
-    { "dvr/timerec/grid",          ACCESS_RECORDER, api_idnode_grid,  api_dvr_timerec_grid },
+    { "dvr/timerec/grid",          ACCESS_RECORDER, NULL,  api_dvr_timerec_grid, api_idnode_grid },
     { "dvr/timerec/create",        ACCESS_RECORDER, api_dvr_timerec_create, NULL },
 
     { NULL },
@@ -49,13 +49,13 @@ api_epg_get_list ( const char *s )
 }
 
 static void
-api_epg_add_channel ( htsmsg_t *m, channel_t *ch )
+api_epg_add_channel ( htsmsg_json_writer_t *w, channel_t *ch )
 {
   int64_t chnum;
   char buf[32];
   const char *s;
-  htsmsg_add_str(m, "channelName", channel_get_name(ch));
-  htsmsg_add_str(m, "channelUuid", channel_get_uuid(ch));
+  htsmsg_json_writer_str(w, "channelName", channel_get_name(ch));
+  htsmsg_json_writer_str(w, "channelUuid", channel_get_uuid(ch));
   if ((chnum = channel_get_number(ch)) >= 0) {
     uint32_t maj = chnum / CHANNEL_SPLIT;
     uint32_t min = chnum % CHANNEL_SPLIT;
@@ -63,57 +63,58 @@ api_epg_add_channel ( htsmsg_t *m, channel_t *ch )
       snprintf(buf, sizeof(buf), "%u.%u", maj, min);
     else
       snprintf(buf, sizeof(buf), "%u", maj);
-    htsmsg_add_str(m, "channelNumber", buf);
+    htsmsg_json_writer_str(w, "channelNumber", buf);
   }
   if ((s = channel_get_icon(ch)) != NULL)
-    htsmsg_add_str(m, "channelIcon", s);
+    htsmsg_json_writer_str(w, "channelIcon", s);
 }
 
-static htsmsg_t *
-api_epg_entry ( epg_broadcast_t *eb, const char *lang, access_t *perm )
+static int
+api_epg_entry
+  ( htsmsg_json_writer_t *w, epg_broadcast_t *eb,
+    const char *lang, access_t *perm )
 {
   const char *s;
   char buf[64];
   epg_episode_t *ee = eb->episode;
   channel_t     *ch = eb->channel;
-  htsmsg_t *m, *m2;
   epg_episode_num_t epnum;
   epg_genre_t *eg;
   dvr_entry_t *de;
 
-  if (!ee || !ch) return NULL;
+  if (!ee || !ch) return -1;
 
-  m = htsmsg_create_map();
+  htsmsg_json_writer_map(w, NULL);
 
   /* EPG IDs */
-  htsmsg_add_u32(m, "eventId", eb->id);
+  htsmsg_json_writer_u32(w, "eventId", eb->id);
   if (ee) {
-    htsmsg_add_u32(m, "episodeId", ee->id);
+    htsmsg_json_writer_u32(w, "episodeId", ee->id);
     if (ee->uri && strncasecmp(ee->uri, "tvh://", 6))
-      htsmsg_add_str(m, "episodeUri", ee->uri);
+      htsmsg_json_writer_str(w, "episodeUri", ee->uri);
   }
   if (eb->serieslink) {
-    htsmsg_add_u32(m, "serieslinkId", eb->serieslink->id);
+    htsmsg_json_writer_u32(w, "serieslinkId", eb->serieslink->id);
     if (eb->serieslink->uri)
-      htsmsg_add_str(m, "serieslinkUri", eb->serieslink->uri);
+      htsmsg_json_writer_str(w, "serieslinkUri", eb->serieslink->uri);
   }
   
   /* Channel Info */
-  api_epg_add_channel(m, ch);
+  api_epg_add_channel(w, ch);
   
   /* Time */
-  htsmsg_add_s64(m, "start", eb->start);
-  htsmsg_add_s64(m, "stop", eb->stop);
+  htsmsg_json_writer_s64(w, "start", eb->start);
+  htsmsg_json_writer_s64(w, "stop", eb->stop);
 
   /* Title/description */
   if ((s = epg_broadcast_get_title(eb, lang)))
-    htsmsg_add_str(m, "title", s);
+    htsmsg_json_writer_str(w, "title", s);
   if ((s = epg_broadcast_get_subtitle(eb, lang)))
-    htsmsg_add_str(m, "subtitle", s);
+    htsmsg_json_writer_str(w, "subtitle", s);
   if ((s = epg_broadcast_get_summary(eb, lang)))
-    htsmsg_add_str(m, "summary", s);
+    htsmsg_json_writer_str(w, "summary", s);
   if ((s = epg_broadcast_get_description(eb, lang)))
-    htsmsg_add_str(m, "description", s);
+    htsmsg_json_writer_str(w, "description", s);
 
   /* Episode info */
   if (ee) {
@@ -121,45 +122,43 @@ api_epg_entry ( epg_broadcast_t *eb, const char *lang, access_t *perm )
     /* Number */
     epg_episode_get_epnum(ee, &epnum);
     if (epnum.s_num) {
-      htsmsg_add_u32(m, "seasonNumber", epnum.s_num);
+      htsmsg_json_writer_u32(w, "seasonNumber", epnum.s_num);
       if (epnum.s_cnt)
-        htsmsg_add_u32(m, "seasonCount", epnum.s_cnt);
+        htsmsg_json_writer_u32(w, "seasonCount", epnum.s_cnt);
     }
     if (epnum.e_num) {
-      htsmsg_add_u32(m, "episodeNumber", epnum.e_num);
+      htsmsg_json_writer_u32(w, "episodeNumber", epnum.e_num);
       if (epnum.s_cnt)
-        htsmsg_add_u32(m, "episodeCount", epnum.e_cnt);
+        htsmsg_json_writer_u32(w, "episodeCount", epnum.e_cnt);
     }
     if (epnum.p_num) {
-      htsmsg_add_u32(m, "partNumber", epnum.p_num);
+      htsmsg_json_writer_u32(w, "partNumber", epnum.p_num);
       if (epnum.p_cnt)
-        htsmsg_add_u32(m, "partCount", epnum.p_cnt);
+        htsmsg_json_writer_u32(w, "partCount", epnum.p_cnt);
     }
     if (epnum.text)
-      htsmsg_add_str(m, "episodeOnscreen", epnum.text);
+      htsmsg_json_writer_str(w, "episodeOnscreen", epnum.text);
     else if (epg_episode_number_format(ee, buf, sizeof(buf), NULL,
                                        "s%02d", ".", "e%02d", ""))
-      htsmsg_add_str(m, "episodeOnscreen", buf);
+      htsmsg_json_writer_str(w, "episodeOnscreen", buf);
 
     /* Image */
     if (ee->image)
-      htsmsg_add_str(m, "image", ee->image);
+      htsmsg_json_writer_str(w, "image", ee->image);
 
     /* Rating */
     if (ee->star_rating)
-      htsmsg_add_u32(m, "starRating", ee->star_rating);
+      htsmsg_json_writer_u32(w, "starRating", ee->star_rating);
     if (ee->age_rating)
-      htsmsg_add_u32(m, "ageRating", ee->age_rating);
+      htsmsg_json_writer_u32(w, "ageRating", ee->age_rating);
 
     /* Content Type */
-    m2 = NULL;
-    LIST_FOREACH(eg, &ee->genre, link) {
-      if (m2 == NULL)
-        m2 = htsmsg_create_list();
-      htsmsg_add_u32(m2, NULL, eg->code);
+    if (LIST_FIRST(&ee->genre)) {
+      htsmsg_json_writer_list(w, "genre");
+      LIST_FOREACH(eg, &ee->genre, link)
+        htsmsg_json_writer_u32(w, NULL, eg->code);
+      htsmsg_json_writer_end(w);
     }
-    if (m2)
-      htsmsg_add_msg(m, "genre", m2);
   }
 
   /* Recording */
@@ -167,15 +166,16 @@ api_epg_entry ( epg_broadcast_t *eb, const char *lang, access_t *perm )
       (de = dvr_entry_find_by_event(eb)) &&
       !access_verify_list(perm->aa_dvrcfgs,
                           idnode_uuid_as_str(&de->de_config->dvr_id))) {
-    htsmsg_add_str(m, "dvrUuid", idnode_uuid_as_str(&de->de_id));
-    htsmsg_add_str(m, "dvrState", dvr_entry_schedstatus(de));
+    htsmsg_json_writer_str(w, "dvrUuid", idnode_uuid_as_str(&de->de_id));
+    htsmsg_json_writer_str(w, "dvrState", dvr_entry_schedstatus(de));
   }
 
   /* Next event */
   if ((eb = epg_broadcast_get_next(eb)))
-    htsmsg_add_u32(m, "nextEventId", eb->id);
-  
-  return m;
+    htsmsg_json_writer_u32(w, "nextEventId", eb->id);
+
+  htsmsg_json_writer_end(w);
+  return 0;
 }
 
 static void
@@ -276,7 +276,8 @@ api_epg_decode_channel_num ( const char *s )
 
 static int
 api_epg_grid
-  ( access_t *perm, void *opaque, const char *op, htsmsg_t *args, htsmsg_t **resp )
+  ( access_t *perm, void *opaque, const char *op, htsmsg_t *args,
+    htsbuf_queue_t *hq )
 {
   int i;
   epg_query_t eq;
@@ -284,7 +285,8 @@ api_epg_grid
   uint32_t start, limit, end, genre;
   int64_t duration_min, duration_max;
   htsmsg_field_t *f, *f2;
-  htsmsg_t *l = NULL, *e, *filter;
+  htsmsg_t *e, *filter;
+  htsmsg_json_writer_t w;
 
   memset(&eq, 0, sizeof(eq));
 
@@ -426,50 +428,47 @@ api_epg_grid
   epg_query(&eq, perm);
 
   /* Build response */
+  htsmsg_json_writer_init(&w, hq);
+  htsmsg_json_writer_map(&w, NULL);
+  htsmsg_json_writer_u32(&w, "totalCount", eq.entries);
+  htsmsg_json_writer_list(&w, "entries");
   start = MIN(eq.entries, start);
   end   = MIN(eq.entries, start + limit);
-  l     = htsmsg_create_list();
-  for (i = start; i < end; i++) {
-    if (!(e = api_epg_entry(eq.result[i], lang, perm))) continue;
-    htsmsg_add_msg(l, NULL, e);
-  }
+  for (i = start; i < end; i++)
+    api_epg_entry(&w, eq.result[i], lang, perm);
   pthread_mutex_unlock(&global_lock);
+  htsmsg_json_writer_end(&w);
+  htsmsg_json_writer_end(&w);
 
   epg_query_free(&eq);
 
-  /* Build response */
-  *resp = htsmsg_create_map();
-  htsmsg_add_u32(*resp, "totalCount", eq.entries);
-  htsmsg_add_msg(*resp, "entries", l);
-
   return 0;
 }
 
 static void
 api_epg_episode_broadcasts
-  ( access_t *perm, htsmsg_t *l, const char *lang, epg_episode_t *ep,
-    uint32_t *entries, epg_broadcast_t *ebc_skip )
+  ( access_t *perm, htsmsg_json_writer_t *w, const char *lang,
+    epg_episode_t *ep, uint32_t *entries, epg_broadcast_t *ebc_skip )
 {
   epg_broadcast_t *ebc;
   channel_t *ch;
-  htsmsg_t *m;
 
   LIST_FOREACH(ebc, &ep->broadcasts, ep_link) {
     ch = ebc->channel;
     if (ch == NULL) continue;
     if (ebc == ebc_skip) continue;
-    m = api_epg_entry(ebc, lang, perm);
-    htsmsg_add_msg(l, NULL, m);
+    if (api_epg_entry(w, ebc, lang, perm)) continue;
     (*entries)++;
   }
 }
 
 static int
 api_epg_alternative
-  ( access_t *perm, void *opaque, const char *op, htsmsg_t *args, htsmsg_t **resp )
+  ( access_t *perm, void *opaque, const char *op, htsmsg_t *args,
+    htsbuf_queue_t *hq )
 {
   uint32_t id, entries = 0;
-  htsmsg_t *l = htsmsg_create_list();
+  htsmsg_json_writer_t w;
   epg_broadcast_t *e;
   const char *lang = htsmsg_get_str(args, "lang");
 
@@ -477,26 +476,28 @@ api_epg_alternative
     return -EINVAL;
 
   /* Main Job */
+  htsmsg_json_writer_init(&w, hq);
+  htsmsg_json_writer_map(&w, NULL);
+  htsmsg_json_writer_list(&w, "entries");
   pthread_mutex_lock(&global_lock);
   e = epg_broadcast_find_by_id(id);
   if (e && e->episode)
-    api_epg_episode_broadcasts(perm, l, lang, e->episode, &entries, e);
+    api_epg_episode_broadcasts(perm, &w, lang, e->episode, &entries, e);
   pthread_mutex_unlock(&global_lock);
-
-  /* Build response */
-  *resp = htsmsg_create_map();
-  htsmsg_add_u32(*resp, "totalCount", entries);
-  htsmsg_add_msg(*resp, "entries", l);
+  htsmsg_json_writer_end(&w);
+  htsmsg_json_writer_u32(&w, "totalCount", entries);
+  htsmsg_json_writer_end(&w);
 
   return 0;
 }
 
 static int
 api_epg_related
-  ( access_t *perm, void *opaque, const char *op, htsmsg_t *args, htsmsg_t **resp )
+  ( access_t *perm, void *opaque, const char *op, htsmsg_t *args,
+    htsbuf_queue_t *hq )
 {
   uint32_t id, entries = 0;
-  htsmsg_t *l = htsmsg_create_list();
+  htsmsg_json_writer_t w;
   epg_broadcast_t *e;
   epg_episode_t *ep, *ep2;
   const char *lang = htsmsg_get_str(args, "lang");
@@ -505,6 +506,9 @@ api_epg_related
     return -EINVAL;
 
   /* Main Job */
+  htsmsg_json_writer_init(&w, hq);
+  htsmsg_json_writer_map(&w, NULL);
+  htsmsg_json_writer_list(&w, "entries");
   pthread_mutex_lock(&global_lock);
   e = epg_broadcast_find_by_id(id);
   ep = e ? e->episode : NULL;
@@ -512,32 +516,32 @@ api_epg_related
     LIST_FOREACH(ep2, &ep->brand->episodes, blink) {
       if (ep2 == ep) continue;
       if (!ep2->title) continue;
-      api_epg_episode_broadcasts(perm, l, lang, ep2, &entries, e);
+      api_epg_episode_broadcasts(perm, &w, lang, ep2, &entries, e);
       entries++;
     }
   } else if (ep && ep->season) {
     LIST_FOREACH(ep2, &ep->season->episodes, slink) {
       if (ep2 == ep) continue;
       if (!ep2->title) continue;
-      api_epg_episode_broadcasts(perm, l, lang, ep2, &entries, e);
+      api_epg_episode_broadcasts(perm, &w, lang, ep2, &entries, e);
     }
   }
   pthread_mutex_unlock(&global_lock);
-
-  /* Build response */
-  *resp = htsmsg_create_map();
-  htsmsg_add_u32(*resp, "totalCount", entries);
-  htsmsg_add_msg(*resp, "entries", l);
+  htsmsg_json_writer_end(&w);
+  htsmsg_json_writer_u32(&w, "totalCount", entries);
+  htsmsg_json_writer_end(&w);
 
   return 0;
 }
 
 static int
 api_epg_load
-  ( access_t *perm, void *opaque, const char *op, htsmsg_t *args, htsmsg_t **resp )
+  ( access_t *perm, void *opaque, const char *op, htsmsg_t *args,
+    htsbuf_queue_t *hq )
 {
   uint32_t id = 0, entries = 0;
-  htsmsg_t *l = htsmsg_create_list(), *ids = NULL, *m;
+  htsmsg_t *ids = NULL;
+  htsmsg_json_writer_t w;
   htsmsg_field_t *f;
   epg_broadcast_t *e;
   const char *lang = htsmsg_get_str(args, "lang");
@@ -549,29 +553,27 @@ api_epg_load
       return -EINVAL;
 
   /* Main Job */
+  htsmsg_json_writer_init(&w, hq);
+  htsmsg_json_writer_map(&w, NULL);
+  htsmsg_json_writer_list(&w, "entries");
   pthread_mutex_lock(&global_lock);
   if (ids) {
     HTSMSG_FOREACH(f, ids) {
       if (htsmsg_field_get_u32(f, &id)) continue;
       e = epg_broadcast_find_by_id(id);
       if (e == NULL) continue;
-      if ((m = api_epg_entry(e, lang, perm)) == NULL) continue;
-      htsmsg_add_msg(l, NULL, m);
+      if (api_epg_entry(&w, e, lang, perm)) continue;
       entries++;
     }
   } else {
     e = epg_broadcast_find_by_id(id);
-    if (e != NULL && (m = api_epg_entry(e, lang, perm)) != NULL) {
-      htsmsg_add_msg(l, NULL, m);
+    if (e != NULL && !api_epg_entry(&w, e, lang, perm))
       entries++;
-    }
   }
   pthread_mutex_unlock(&global_lock);
-
-  /* Build response */
-  *resp = htsmsg_create_map();
-  htsmsg_add_u32(*resp, "totalCount", entries);
-  htsmsg_add_msg(*resp, "entries", l);
+  htsmsg_json_writer_end(&w);
+  htsmsg_json_writer_u32(&w, "totalCount", entries);
+  htsmsg_json_writer_end(&w);
 
   return 0;
 }
@@ -608,10 +610,10 @@ api_epg_content_type_list(access_t *perm, void *opaque, const char *op,
 void api_epg_init ( void )
 {
   static api_hook_t ah[] = {
-    { "epg/events/grid",        ACCESS_ANONYMOUS, api_epg_grid, NULL },
-    { "epg/events/alternative", ACCESS_ANONYMOUS, api_epg_alternative, NULL },
-    { "epg/events/related",     ACCESS_ANONYMOUS, api_epg_related, NULL },
-    { "epg/events/load",        ACCESS_ANONYMOUS, api_epg_load, NULL },
+    { "epg/events/grid",        ACCESS_ANONYMOUS, NULL, NULL, api_epg_grid },
+    { "epg/events/alternative", ACCESS_ANONYMOUS, NULL, NULL, api_epg_alternative },
+    { "epg/events/related",     ACCESS_ANONYMOUS, NULL, NULL, api_epg_related },
+    { "epg/events/load",        ACCESS_ANONYMOUS, NULL, NULL, api_epg_load },
     { "epg/brand/list",         ACCESS_ANONYMOUS, api_epg_brand_list, NULL },
     { "epg/content_type/list",  ACCESS_ANONYMOUS, api_epg_content_type_list, NULL },
 
@@ -71,27 +71,27 @@ void api_esfilter_init ( void )
 {
   static api_hook_t ah[] = {
     { "esfilter/video/class",    ACCESS_ANONYMOUS, api_idnode_class, (void*)&esfilter_class_video },
-    { "esfilter/video/grid",     ACCESS_ANONYMOUS, api_idnode_grid,  api_esfilter_grid_video },
+    { "esfilter/video/grid",     ACCESS_ANONYMOUS, NULL,  api_esfilter_grid_video, api_idnode_grid },
     { "esfilter/video/create",   ACCESS_ADMIN,     api_esfilter_create_video, NULL },
 
     { "esfilter/audio/class",    ACCESS_ANONYMOUS, api_idnode_class, (void*)&esfilter_class_audio },
-    { "esfilter/audio/grid",     ACCESS_ANONYMOUS, api_idnode_grid,  api_esfilter_grid_audio },
+    { "esfilter/audio/grid",     ACCESS_ANONYMOUS, NULL,  api_esfilter_grid_audio, api_idnode_grid },
     { "esfilter/audio/create",   ACCESS_ADMIN,     api_esfilter_create_audio, NULL },
 
     { "esfilter/teletext/class", ACCESS_ANONYMOUS, api_idnode_class, (void*)&esfilter_class_teletext },
-    { "esfilter/teletext/grid",  ACCESS_ANONYMOUS, api_idnode_grid,  api_esfilter_grid_teletext },
+    { "esfilter/teletext/grid",  ACCESS_ANONYMOUS, NULL,  api_esfilter_grid_teletext, api_idnode_grid },
     { "esfilter/teletext/create",ACCESS_ADMIN,     api_esfilter_create_teletext, NULL },
 
     { "esfilter/subtit/class",   ACCESS_ANONYMOUS, api_idnode_class, (void*)&esfilter_class_subtit },
-    { "esfilter/subtit/grid",    ACCESS_ANONYMOUS, api_idnode_grid,  api_esfilter_grid_subtit },
+    { "esfilter/subtit/grid",    ACCESS_ANONYMOUS, NULL,  api_esfilter_grid_subtit, api_idnode_grid },
     { "esfilter/subtit/create",  ACCESS_ADMIN,     api_esfilter_create_subtit, NULL },
 
     { "esfilter/ca/class",       ACCESS_ANONYMOUS, api_idnode_class, (void*)&esfilter_class_ca },
-    { "esfilter/ca/grid",        ACCESS_ANONYMOUS, api_idnode_grid,  api_esfilter_grid_ca },
+    { "esfilter/ca/grid",        ACCESS_ANONYMOUS, NULL,  api_esfilter_grid_ca, api_idnode_grid },
     { "esfilter/ca/create",      ACCESS_ADMIN,     api_esfilter_create_ca, NULL },
 
     { "esfilter/other/class",    ACCESS_ANONYMOUS, api_idnode_class, (void*)&esfilter_class_other },
-    { "esfilter/other/grid",     ACCESS_ANONYMOUS, api_idnode_grid,  api_esfilter_grid_other },
+    { "esfilter/other/grid",     ACCESS_ANONYMOUS, NULL,  api_esfilter_grid_other, api_idnode_grid },
     { "esfilter/other/create",   ACCESS_ADMIN,     api_esfilter_create_other, NULL },
 
     { NULL },
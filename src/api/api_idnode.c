@@ -116,10 +116,12 @@ api_idnode_grid_conf
 
 int
 api_idnode_grid
-  ( access_t *perm, void *opaque, const char *op, htsmsg_t *args, htsmsg_t **resp )
+  ( access_t *perm, void *opaque, const char *op, htsmsg_t *args,
+    htsbuf_queue_t *hq )
 {
   int i;
-  htsmsg_t *list, *e;
+  htsmsg_t *e;
+  htsmsg_json_writer_t w;
   htsmsg_t *flist = api_idnode_flist_conf(args, "list");
   api_idnode_grid_conf_t conf = { 0 };
   idnode_set_t ins = { 0 };
@@ -132,26 +134,29 @@ api_idnode_grid
   pthread_mutex_lock(&global_lock);
   cb(perm, &ins, &conf, args);
 
-  /* Sort */
+  /* Sort (only the requested page must be in order) */
   if (conf.sort.key)
-    idnode_set_sort(&ins, &conf.sort);
+    idnode_set_sort_partial(&ins, &conf.sort, (size_t)conf.start + conf.limit);
 
-  /* Paginate */
-  list  = htsmsg_create_list();
+  /* Paginate, the rows are written out one by one */
+  htsmsg_json_writer_init(&w, hq);
+  htsmsg_json_writer_map(&w, NULL);
+  htsmsg_json_writer_list(&w, "entries");
   for (i = conf.start; i < ins.is_count && conf.limit != 0; i++) {
     e = htsmsg_create_map();
     htsmsg_add_str(e, "uuid", idnode_uuid_as_str(ins.is_array[i]));
     idnode_read0(ins.is_array[i], e, flist, 0);
-    htsmsg_add_msg(list, NULL, e);
+    htsmsg_json_writer_msg(&w, NULL, e);
+    htsmsg_destroy(e);
     if (conf.limit > 0) conf.limit--;
   }
 
   pthread_mutex_unlock(&global_lock);
 
   /* Output */
-  *resp = htsmsg_create_map();
-  htsmsg_add_msg(*resp, "entries", list);
-  htsmsg_add_u32(*resp, "total",   ins.is_count);
+  htsmsg_json_writer_end(&w);
+  htsmsg_json_writer_u32(&w, "total", ins.is_count);
+  htsmsg_json_writer_end(&w);
 
   /* Cleanup */
   free(ins.is_array);
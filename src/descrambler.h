@@ -76,8 +76,21 @@ typedef struct th_descrambler_runtime {
   tvhlog_limit_t dr_loglimit_key;
   uint8_t  dr_key_even[16];
   uint8_t  dr_key_odd[16];
+  time_t   dr_key_cached;     /* cached keys are used until this time */
 } th_descrambler_runtime_t;
 
+/**
+ * Last keys of a stopped service, reused on a quick restart (zap back)
+ * until the CA client answers the first ECM
+ */
+typedef struct th_descrambler_keys {
+  int      dk_type;
+  uint8_t  dk_valid;
+  time_t   dk_timestamp[2];
+  uint8_t  dk_even[16];
+  uint8_t  dk_odd[16];
+} th_descrambler_keys_t;
+
 typedef void (*descrambler_section_callback_t)
   (void *opaque, int pid, const uint8_t *section, int section_len, int emm);
 
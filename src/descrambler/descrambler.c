@@ -96,6 +96,66 @@ descrambler_done ( void )
   caclient_done();
 }
 
+/*
+ * Cached keys (see th_descrambler_keys_t)
+ *
+ * The ECM carries the current and the next key, so a key received
+ * less than one crypto period ago is still valid for the stream.
+ */
+#define DESCRAMBLER_KEY_CACHE 10 /* seconds, the shortest crypto period */
+
+static time_t
+descrambler_keys_time ( th_descrambler_keys_t *dk )
+{
+  return MAX(dk->dk_timestamp[0], dk->dk_timestamp[1]);
+}
+
+static void
+descrambler_keys_save ( service_t *t, th_descrambler_runtime_t *dr )
+{
+  th_descrambler_keys_t *dk;
+
+  if (dr->dr_key_valid == 0 || dr->dr_csa.csa_type == DESCRAMBLER_NONE) {
+    free(t->s_descramble_keys);
+    t->s_descramble_keys = NULL;
+    return;
+  }
+  if ((dk = t->s_descramble_keys) == NULL)
+    dk = t->s_descramble_keys = calloc(1, sizeof(*dk));
+  dk->dk_type = dr->dr_csa.csa_type;
+  dk->dk_valid = dr->dr_key_valid;
+  dk->dk_timestamp[0] = dr->dr_key_timestamp[0];
+  dk->dk_timestamp[1] = dr->dr_key_timestamp[1];
+  memcpy(dk->dk_even, dr->dr_key_even, sizeof(dk->dk_even));
+  memcpy(dk->dk_odd, dr->dr_key_odd, sizeof(dk->dk_odd));
+}
+
+static void
+descrambler_keys_load ( service_t *t, th_descrambler_runtime_t *dr )
+{
+  th_descrambler_keys_t *dk = t->s_descramble_keys;
+  time_t last;
+
+  if (dk == NULL)
+    return;
+  last = descrambler_keys_time(dk);
+  if (last + DESCRAMBLER_KEY_CACHE < dispatch_clock ||
+      tvhcsa_set_type(&dr->dr_csa, dk->dk_type) < 0)
+    return;
+  memcpy(dr->dr_key_even, dk->dk_even, sizeof(dr->dr_key_even));
+  memcpy(dr->dr_key_odd, dk->dk_odd, sizeof(dr->dr_key_odd));
+  dr->dr_key_valid = dk->dk_valid;
+  dr->dr_key_changed = ((dk->dk_valid & 0x40) ? 1 : 0) |
+                       ((dk->dk_valid & 0x80) ? 2 : 0);
+  dr->dr_key_timestamp[0] = dk->dk_timestamp[0];
+  dr->dr_key_timestamp[1] = dk->dk_timestamp[1];
+  dr->dr_ecm_key_time = last;
+  /* the next key from the ECM is valid for one more period */
+  dr->dr_key_cached = last + 2 * DESCRAMBLER_KEY_CACHE;
+  tvhdebug("descrambler", "Using cached keys (%lds old) for service \"%s\"",
+           (long)(dispatch_clock - last), ((mpegts_service_t *)t)->s_dvb_svcname);
+}
+
 /*
  * This routine is called from two places
  * a) start a new service
@@ -125,6 +185,7 @@ descrambler_service_start ( service_t *t )
     sbuf_init(&dr->dr_buf);
     dr->dr_key_index = 0xff;
     tvhcsa_init(&dr->dr_csa);
+    descrambler_keys_load(t, dr);
   }
   caclient_start(t);
 
@@ -147,6 +208,7 @@ descrambler_service_stop ( service_t *t )
     td->td_stop(td);
   t->s_descramble = NULL;
   if (dr) {
+    descrambler_keys_save(t, dr);
     tvhcsa_destroy(&dr->dr_csa);
     sbuf_free(&dr->dr_buf);
     free(dr);
@@ -338,6 +400,19 @@ key_update( th_descrambler_runtime_t *dr, uint8_t key )
     dr->dr_key_start = dispatch_clock - 60;
 }
 
+/*
+ * Cached keys: the key timestamps are from the previous tuning, the
+ * stream key in use is not a key change and can't be late
+ */
+static inline void
+key_initial( service_t *t, th_descrambler_runtime_t *dr, uint8_t ki )
+{
+  tvhtrace("descrambler", "initial stream key set to %s for service \"%s\" (cached keys)",
+                          (ki & 0x40) ? "odd" : "even",
+                          ((mpegts_service_t *)t)->s_dvb_svcname);
+  key_update(dr, ki);
+}
+
 static inline int
 key_valid ( th_descrambler_runtime_t *dr, uint8_t ki )
 {
@@ -414,7 +489,18 @@ descrambler_descramble ( service_t *t,
     }
   }
 
-  if (resolved) {
+  if (dr->dr_key_cached) {
+    if (resolved) {
+      dr->dr_key_cached = 0;
+    } else if (dr->dr_key_cached < dispatch_clock) {
+      tvhdebug("descrambler", "Cached keys expired for service \"%s\"",
+               ((mpegts_service_t *)t)->s_dvb_svcname);
+      dr->dr_key_cached = 0;
+      dr->dr_key_valid = 0;
+    }
+  }
+
+  if (resolved || dr->dr_key_cached) {
 
     /* update the keys */
     if (dr->dr_key_changed) {
@@ -437,6 +523,8 @@ descrambler_descramble ( service_t *t,
             flush_data = 1;
             goto next;
           }
+          if (dr->dr_key_start == 0 && dr->dr_key_cached)
+            key_initial(t, dr, ki);
           if (dr->dr_key_index != (ki & 0x40) &&
               dr->dr_key_start + 2 < dispatch_clock) {
             tvhtrace("descrambler", "stream key changed to %s for service \"%s\"",
@@ -471,6 +559,8 @@ descrambler_descramble ( service_t *t,
                                  "even stream key is not valid");
         goto next;
       }
+      if (dr->dr_key_start == 0 && dr->dr_key_cached)
+        key_initial(t, dr, ki);
       if (dr->dr_key_index != (ki & 0x40) &&
           dr->dr_key_start + 2 < dispatch_clock) {
         tvhtrace("descrambler", "stream key changed to %s for service \"%s\"",
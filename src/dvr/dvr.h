@@ -119,6 +119,18 @@ typedef enum {
   DVR_RS_ERROR,
 } dvr_rs_state_t;
   
+/*
+ * Duplicate detection index keys (one per autorec record mode)
+ */
+typedef enum {
+  DVR_DUP_EPISODE,
+  DVR_DUP_SUBTITLE,
+  DVR_DUP_DESCRIPTION,
+  DVR_DUP_WEEK,
+  DVR_DUP_DAY,
+  DVR_DUP_KEYS
+} dvr_dup_key_t;
+
 
 typedef struct dvr_entry {
 
@@ -133,6 +145,15 @@ typedef struct dvr_entry {
    */
 
   LIST_ENTRY(dvr_entry) de_global_link;
+  uint32_t de_seq;                        /* dvrentries insertion order */
+
+  /**
+   * Lookup indexes (see dvr_db.c)
+   */
+  LIST_ENTRY(dvr_entry) de_id_link;       /* short id */
+  LIST_ENTRY(dvr_entry) de_bcast_link;    /* de_bcast */
+  LIST_ENTRY(dvr_entry) de_dup_link[DVR_DUP_KEYS];
+  uint32_t de_dup_key[DVR_DUP_KEYS];
   
   channel_t *de_channel;
   LIST_ENTRY(dvr_entry) de_channel_link;
@@ -199,6 +220,12 @@ typedef struct dvr_entry {
    */
   uint32_t de_data_errors;
 
+  /**
+   * Write-behind statistics (average latency in ms, queued kB)
+   */
+  uint32_t de_write_latency;
+  uint32_t de_write_queue;
+
   /**
    * Last error, see SM_CODE_ defines
    */
@@ -658,6 +685,21 @@ typedef TAILQ_HEAD(,dvr_cutpoint) dvr_cutpoint_list_t;
 dvr_cutpoint_list_t *dvr_get_cutpoint_list (dvr_entry_t *de);
 void dvr_cutpoint_list_destroy (dvr_cutpoint_list_t *list);
 
+/**
+ * Write-behind file I/O
+ */
+typedef struct dvr_io dvr_io_t;
+struct iovec;
+
+dvr_io_t *dvr_io_create ( struct muxer *m, int fd, const char *name );
+void dvr_io_set_stop ( dvr_io_t *io, time_t stop );
+int dvr_io_write ( dvr_io_t *io, off_t off, const void *data, size_t len );
+int dvr_io_writev ( dvr_io_t *io, off_t off, const struct iovec *iov, int iovcnt );
+void dvr_io_stats ( dvr_io_t *io, uint32_t *latency, uint32_t *queue );
+int dvr_io_close ( dvr_io_t *io );
+void dvr_io_init ( void );
+void dvr_io_done ( void );
+
 /**
  *
  */
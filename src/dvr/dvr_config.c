@@ -449,7 +449,8 @@ dvr_config_class_cache_list(void *o)
     { "System",             MC_CACHE_SYSTEM },
     { "Do not keep",        MC_CACHE_DONTKEEP },
     { "Sync",               MC_CACHE_SYNC },
-    { "Sync + Do not keep", MC_CACHE_SYNCDONTKEEP }
+    { "Sync + Do not keep", MC_CACHE_SYNCDONTKEEP },
+    { "Direct I/O",         MC_CACHE_DIRECT }
   };
   return strtab2htsmsg(tab);
 }
@@ -807,6 +808,7 @@ dvr_config_init(void)
 void
 dvr_init(void)
 {
+  dvr_io_init();
 #if ENABLE_INOTIFY
   dvr_inotify_init();
 #endif
@@ -835,4 +837,5 @@ dvr_done(void)
   pthread_mutex_unlock(&global_lock);
   dvr_autorec_done();
   dvr_timerec_done();
+  dvr_io_done();
 }
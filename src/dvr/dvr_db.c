@@ -47,6 +47,124 @@ static void dvr_timer_stop_recording(void *aux);
 static int dvr_entry_class_disp_title_set(void *o, const void *v);
 static int dvr_entry_class_disp_subtitle_set(void *o, const void *v);
 
+/*
+ * Lookup indexes
+ *
+ * Entries linked to dvrentries are also hashed by short id, by broadcast
+ * and, for the autorec duplicate detection, by title combined with the
+ * field each record mode compares. The hash lists are unordered, de_seq
+ * keeps the dvrentries order for the lookups which must return the first
+ * match of the list.
+ */
+#define DVR_ENTRY_HASH_SIZE 1024
+#define DVR_ENTRY_HASH(k)   ((k) & (DVR_ENTRY_HASH_SIZE - 1))
+
+static uint32_t dvr_entry_seq;
+static LIST_HEAD(, dvr_entry) dvr_id_hash[DVR_ENTRY_HASH_SIZE];
+static LIST_HEAD(, dvr_entry) dvr_bcast_hash[DVR_ENTRY_HASH_SIZE];
+static LIST_HEAD(, dvr_entry) dvr_dup_hash[DVR_DUP_KEYS][DVR_ENTRY_HASH_SIZE];
+
+static inline int
+dvr_entry_indexed(dvr_entry_t *de)
+{
+  return de->de_id_link.le_prev != NULL;
+}
+
+static uint32_t
+dvr_dup_hash_str(uint32_t h, const char *s)
+{
+  if (s)
+    for ( ; *s; s++)
+      h = (h ^ (uint8_t)*s) * 16777619u;
+  return (h ^ 0xff) * 16777619u;
+}
+
+/* lang_str_compare() equal strings hold the same set of texts */
+static uint32_t
+dvr_dup_hash_lang(uint32_t h, lang_str_t *ls)
+{
+  lang_str_ele_t *e;
+  const char *s = NULL;
+
+  if (ls)
+    RB_FOREACH(e, ls, link)
+      if (e->str && (s == NULL || strcmp(e->str, s) < 0))
+        s = e->str;
+  return dvr_dup_hash_str(h, s);
+}
+
+static int
+dvr_dup_day(time_t start, int week)
+{
+  struct tm tm;
+
+  localtime_r(&start, &tm);
+  if (week) {
+    tm.tm_mday -= (tm.tm_wday + 6) % 7; // week = mon-sun
+    mktime(&tm); // adjusts tm
+  }
+  return tm.tm_year * 366 + tm.tm_yday;
+}
+
+static uint32_t
+dvr_dup_key(dvr_entry_t *de, int k, uint32_t title)
+{
+  switch (k) {
+  case DVR_DUP_EPISODE:
+    return dvr_dup_hash_str(title, de->de_episode);
+  case DVR_DUP_SUBTITLE:
+    return dvr_dup_hash_lang(title, de->de_subtitle);
+  case DVR_DUP_DESCRIPTION:
+    return dvr_dup_hash_lang(title, de->de_desc);
+  default:
+    return (title ^ dvr_dup_day(de->de_start, k == DVR_DUP_WEEK)) * 16777619u;
+  }
+}
+
+/* Called whenever title, subtitle, description, episode or start change */
+static void
+dvr_entry_index_dup(dvr_entry_t *de)
+{
+  uint32_t title, key;
+  int k;
+
+  if (!dvr_entry_indexed(de))
+    return;
+  title = dvr_dup_hash_lang(2166136261u, de->de_title);
+  for (k = 0; k < DVR_DUP_KEYS; k++) {
+    key = dvr_dup_key(de, k, title);
+    if (key == de->de_dup_key[k] && de->de_dup_link[k].le_prev)
+      continue;
+    LIST_SAFE_REMOVE(de, de_dup_link[k]);
+    de->de_dup_key[k] = key;
+    LIST_INSERT_HEAD(&dvr_dup_hash[k][DVR_ENTRY_HASH(key)], de, de_dup_link[k]);
+  }
+}
+
+static void
+dvr_entry_index_add(dvr_entry_t *de)
+{
+  uint32_t id = idnode_get_short_uuid(&de->de_id);
+
+  de->de_seq = ++dvr_entry_seq;
+  LIST_INSERT_HEAD(&dvr_id_hash[DVR_ENTRY_HASH(id)], de, de_id_link);
+  if (de->de_bcast)
+    LIST_INSERT_HEAD(&dvr_bcast_hash[DVR_ENTRY_HASH(de->de_bcast->id)],
+                     de, de_bcast_link);
+  dvr_entry_index_dup(de);
+}
+
+static void
+dvr_entry_index_remove(dvr_entry_t *de)
+{
+  int k;
+
+  LIST_SAFE_REMOVE(de, de_id_link);
+  LIST_SAFE_REMOVE(de, de_bcast_link);
+  for (k = 0; k < DVR_DUP_KEYS; k++)
+    LIST_SAFE_REMOVE(de, de_dup_link[k]);
+}
+
 /*
  *
  */
@@ -79,10 +197,14 @@ dvr_entry_assign_broadcast(dvr_entry_t *de, epg_broadcast_t *bcast)
       de->de_bcast->putref((epg_object_t*)de->de_bcast);
       notify_delayed(id, "epg", "dvr_delete");
       de->de_bcast = NULL;
+      LIST_SAFE_REMOVE(de, de_bcast_link);
     }
     if (bcast) {
       bcast->getref((epg_object_t*)bcast);
       de->de_bcast = bcast;
+      if (dvr_entry_indexed(de))
+        LIST_INSERT_HEAD(&dvr_bcast_hash[DVR_ENTRY_HASH(bcast->id)],
+                         de, de_bcast_link);
       snprintf(id, sizeof(id), "%u", bcast->id);
       notify_delayed(id, "epg", "dvr_update");
     }
@@ -482,6 +604,7 @@ dvr_entry_create(const char *uuid, htsmsg_t *conf)
   de->de_refcnt = 1;
 
   LIST_INSERT_HEAD(&dvrentries, de, de_global_link);
+  dvr_entry_index_add(de);
 
   if (de->de_channel) {
     LIST_FOREACH(de2, &de->de_channel->ch_dvrs, de_channel_link)
@@ -656,6 +779,104 @@ dvr_entry_create_by_event(const char *config_uuid,
 /**
  *
  */
+/* de2 is an earlier recording of de for the autorec record mode */
+static int
+_dvr_duplicate_match(dvr_entry_t *de, dvr_entry_t *de2, int record,
+                     struct tm *de_start)
+{
+  // only earlier recordings qualify as master
+  if (de2->de_start > de->de_start)
+    return 0;
+
+  // only successful earlier recordings qualify as master
+  if (de2->de_sched_state == DVR_MISSED_TIME || (de2->de_sched_state == DVR_COMPLETED && de2->de_last_error != SM_CODE_OK))
+    return 0;
+
+  // if titles are not defined or do not match, don't dedup
+  if (lang_str_compare(de->de_title, de2->de_title))
+    return 0;
+
+  switch (record) {
+    case DVR_AUTOREC_RECORD_DIFFERENT_EPISODE_NUMBER:
+      return de2->de_episode && !strcmp(de->de_episode, de2->de_episode);
+    case DVR_AUTOREC_RECORD_DIFFERENT_SUBTITLE:
+      return !lang_str_compare(de->de_subtitle, de2->de_subtitle);
+    case DVR_AUTOREC_RECORD_DIFFERENT_DESCRIPTION:
+      return !lang_str_compare(de->de_desc, de2->de_desc);
+    case DVR_AUTOREC_RECORD_ONCE_PER_WEEK: {
+      struct tm de2_start;
+      localtime_r(&de2->de_start, &de2_start);
+      de2_start.tm_mday -= (de2_start.tm_wday + 6) % 7; // week = mon-sun
+      mktime(&de2_start); // adjusts de2_start
+      return de_start->tm_year == de2_start.tm_year && de_start->tm_yday == de2_start.tm_yday;
+    }
+    case DVR_AUTOREC_RECORD_ONCE_PER_DAY: {
+      struct tm de2_start;
+      localtime_r(&de2->de_start, &de2_start);
+      return de_start->tm_year == de2_start.tm_year && de_start->tm_yday == de2_start.tm_yday;
+    }
+  }
+  return 0;
+}
+
+#if ENABLE_DVR_INDEX_CHECK
+/*
+ * Index consistency (debug builds): the indexed lookups must return
+ * what the linear scans of dvrentries return
+ */
+static void
+dvr_entry_index_check(void)
+{
+  dvr_entry_t *de, *de2;
+  uint32_t title, seq = UINT32_MAX, id;
+  int k;
+
+  LIST_FOREACH(de, &dvrentries, de_global_link) {
+    assert(dvr_entry_indexed(de));
+    /* dvrentries is in reverse insertion order */
+    assert(de->de_seq < seq);
+    seq = de->de_seq;
+    id = idnode_get_short_uuid(&de->de_id);
+    LIST_FOREACH(de2, &dvr_id_hash[DVR_ENTRY_HASH(id)], de_id_link)
+      if (de2 == de)
+        break;
+    assert(de2 == de);
+    if (de->de_bcast) {
+      LIST_FOREACH(de2, &dvr_bcast_hash[DVR_ENTRY_HASH(de->de_bcast->id)], de_bcast_link)
+        if (de2 == de)
+          break;
+      assert(de2 == de);
+    }
+    /* a missing dvr_entry_index_dup() call leaves a stale key */
+    title = dvr_dup_hash_lang(2166136261u, de->de_title);
+    for (k = 0; k < DVR_DUP_KEYS; k++) {
+      if (de->de_dup_key[k] != dvr_dup_key(de, k, title))
+        tvherror("dvr", "index check: stale key %d for %s", k,
+                 idnode_uuid_as_str(&de->de_id));
+      assert(de->de_dup_key[k] == dvr_dup_key(de, k, title));
+    }
+  }
+}
+
+static void
+dvr_entry_index_check_dup
+  (dvr_entry_t *de, int record, struct tm *de_start, dvr_entry_t *ret)
+{
+  dvr_entry_t *de2;
+
+  dvr_entry_index_check();
+  LIST_FOREACH(de2, &dvrentries, de_global_link)
+    if (de2 != de && _dvr_duplicate_match(de, de2, record, de_start))
+      break;
+  if (de2 != ret)
+    tvherror("dvr", "index check: duplicate of %s is %s, scan found %s",
+             idnode_uuid_as_str(&de->de_id),
+             ret ? idnode_uuid_as_str(&ret->de_id) : "none",
+             de2 ? idnode_uuid_as_str(&de2->de_id) : "none");
+  assert(de2 == ret);
+}
+#endif
+
 static dvr_entry_t* _dvr_duplicate_event(dvr_entry_t* de)
 {
   if (!de->de_autorec)
@@ -691,56 +912,36 @@ static dvr_entry_t* _dvr_duplicate_event(dvr_entry_t* de)
   if (lang_str_empty(de->de_title))
     return NULL;
 
-  dvr_entry_t *de2;
-
-  LIST_FOREACH(de2, &dvrentries, de_global_link) {
-    if (de == de2)
-      continue;
-
-    // only earlier recordings qualify as master
-    if (de2->de_start > de->de_start)
-      continue;
+  int k;
+  uint32_t key;
+  dvr_entry_t *de2, *ret = NULL;
 
-    // only successful earlier recordings qualify as master
-    if (de2->de_sched_state == DVR_MISSED_TIME || (de2->de_sched_state == DVR_COMPLETED && de2->de_last_error != SM_CODE_OK))
+  switch (record) {
+    case DVR_AUTOREC_RECORD_DIFFERENT_EPISODE_NUMBER: k = DVR_DUP_EPISODE;     break;
+    case DVR_AUTOREC_RECORD_DIFFERENT_SUBTITLE:       k = DVR_DUP_SUBTITLE;    break;
+    case DVR_AUTOREC_RECORD_DIFFERENT_DESCRIPTION:    k = DVR_DUP_DESCRIPTION; break;
+    case DVR_AUTOREC_RECORD_ONCE_PER_WEEK:            k = DVR_DUP_WEEK;        break;
+    case DVR_AUTOREC_RECORD_ONCE_PER_DAY:             k = DVR_DUP_DAY;         break;
+    default: return NULL;
+  }
+  key = dvr_dup_key(de, k, dvr_dup_hash_lang(2166136261u, de->de_title));
+
+  // only the entries sharing the key can match, the first one in
+  // dvrentries order (highest de_seq) is returned
+  LIST_FOREACH(de2, &dvr_dup_hash[k][DVR_ENTRY_HASH(key)], de_dup_link[k]) {
+    if (de == de2 || de2->de_dup_key[k] != key)
       continue;
 
-    // if titles are not defined or do not match, don't dedup
-    if (lang_str_compare(de->de_title, de2->de_title))
+    if (ret && ret->de_seq > de2->de_seq)
       continue;
 
-    switch (record) {
-      case DVR_AUTOREC_RECORD_DIFFERENT_EPISODE_NUMBER:
-        if (!strcmp(de->de_episode, de2->de_episode))
-          return de2;
-        break;
-      case DVR_AUTOREC_RECORD_DIFFERENT_SUBTITLE:
-        if (!lang_str_compare(de->de_subtitle, de2->de_subtitle))
-          return de2;
-        break;
-      case DVR_AUTOREC_RECORD_DIFFERENT_DESCRIPTION:
-        if (!lang_str_compare(de->de_desc, de2->de_desc))
-          return de2;
-        break;
-      case DVR_AUTOREC_RECORD_ONCE_PER_WEEK: {
-        struct tm de2_start;
-        localtime_r(&de2->de_start, &de2_start);
-        de2_start.tm_mday -= (de2_start.tm_wday + 6) % 7; // week = mon-sun
-        mktime(&de2_start); // adjusts de2_start
-        if (de_start.tm_year == de2_start.tm_year && de_start.tm_yday == de2_start.tm_yday)
-          return de2;
-        break;
-      }
-      case DVR_AUTOREC_RECORD_ONCE_PER_DAY: {
-        struct tm de2_start;
-        localtime_r(&de2->de_start, &de2_start);
-        if (de_start.tm_year == de2_start.tm_year && de_start.tm_yday == de2_start.tm_yday)
-          return de2;
-        break;
-      }
-    }
+    if (_dvr_duplicate_match(de, de2, record, &de_start))
+      ret = de2;
   }
-  return NULL;
+#if ENABLE_DVR_INDEX_CHECK
+  dvr_entry_index_check_dup(de, record, &de_start, ret);
+#endif
+  return ret;
 }
 
 /**
@@ -753,11 +954,35 @@ dvr_entry_create_by_autorec(epg_broadcast_t *e, dvr_autorec_entry_t *dae)
 
   /* Identical duplicate detection
      NOTE: Semantic duplicate detection is deferred to the start time of recording and then done using _dvr_duplicate_event by dvr_timer_start_recording. */
-  dvr_entry_t* de;
-  LIST_FOREACH(de, &dvrentries, de_global_link) {
-    if (de->de_bcast == e || (de->de_bcast && de->de_bcast->episode == e->episode))
-      return;
+  dvr_entry_t* de = NULL;
+  epg_broadcast_t *e2;
+  if (e->episode) {
+    /* e is one of the episode broadcasts */
+    LIST_FOREACH(e2, &e->episode->broadcasts, ep_link) {
+      LIST_FOREACH(de, &dvr_bcast_hash[DVR_ENTRY_HASH(e2->id)], de_bcast_link)
+        if (de->de_bcast == e2)
+          break;
+      if (de)
+        break;
+    }
+  } else {
+    LIST_FOREACH(de, &dvrentries, de_global_link) {
+      if (de->de_bcast == e || (de->de_bcast && de->de_bcast->episode == e->episode))
+        break;
+    }
   }
+#if ENABLE_DVR_INDEX_CHECK
+  {
+    dvr_entry_t *de2;
+    dvr_entry_index_check();
+    LIST_FOREACH(de2, &dvrentries, de_global_link)
+      if (de2->de_bcast == e || (de2->de_bcast && de2->de_bcast->episode == e->episode))
+        break;
+    assert(!de == !de2);
+  }
+#endif
+  if (de)
+    return;
 
   snprintf(buf, sizeof(buf), "Auto recording%s%s",
            dae->dae_creator ? " by: " : "",
@@ -832,6 +1057,7 @@ dvr_entry_destroy(dvr_entry_t *de, int delconf)
   if (de->de_channel)
     LIST_REMOVE(de, de_channel_link);
   LIST_REMOVE(de, de_global_link);
+  dvr_entry_index_remove(de);
   de->de_channel = NULL;
 
   dvr_entry_dec_ref(de);
@@ -992,6 +1218,7 @@ static dvr_entry_t *_dvr_entry_update
 
   /* Save changes */
 dosave:
+  dvr_entry_index_dup(de);
   if (save) {
     idnode_changed(&de->de_id);
     htsp_dvr_entry_update(de);
@@ -1181,9 +1408,18 @@ dvr_entry_t *
 dvr_entry_find_by_id(int id)
 {
   dvr_entry_t *de;
-  LIST_FOREACH(de, &dvrentries, de_global_link)
+  LIST_FOREACH(de, &dvr_id_hash[DVR_ENTRY_HASH((uint32_t)id)], de_id_link)
     if(idnode_get_short_uuid(&de->de_id) == id)
       break;
+#if ENABLE_DVR_INDEX_CHECK
+  {
+    dvr_entry_t *de2;
+    LIST_FOREACH(de2, &dvrentries, de_global_link)
+      if(idnode_get_short_uuid(&de2->de_id) == id)
+        break;
+    assert(de == de2);
+  }
+#endif
   return de;  
 }
 
@@ -1241,6 +1477,7 @@ static void
 dvr_entry_class_save(idnode_t *self)
 {
   dvr_entry_t *de = (dvr_entry_t *)self;
+  dvr_entry_index_dup(de);
   dvr_entry_save(de);
   if (dvr_entry_is_valid(de))
     dvr_entry_set_timer(de);
@@ -2089,6 +2326,20 @@ const idclass_t dvr_entry_class = {
       .off      = offsetof(dvr_entry_t, de_data_errors),
       .opts     = PO_RDONLY,
     },
+    {
+      .type     = PT_U32,
+      .id       = "write_latency",
+      .name     = "Write Latency (ms)",
+      .off      = offsetof(dvr_entry_t, de_write_latency),
+      .opts     = PO_RDONLY | PO_NOSAVE,
+    },
+    {
+      .type     = PT_U32,
+      .id       = "write_queue",
+      .name     = "Write Queue (kB)",
+      .off      = offsetof(dvr_entry_t, de_write_queue),
+      .opts     = PO_RDONLY | PO_NOSAVE,
+    },
     {
       .type     = PT_U16,
       .id       = "dvb_eid",
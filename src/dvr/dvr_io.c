@@ -0,0 +1,621 @@
+/*
+ *  Digital Video Recorder - write-behind file I/O
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tvheadend.h"
+
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/uio.h>
+
+#include "muxer.h"
+#include "dvr/dvr.h"
+
+#define DVR_IO_THREADS  2                /* shared writer threads */
+#define DVR_IO_BUFSIZE  (2*1024*1024)    /* write size */
+#define DVR_IO_ALIGN    4096             /* buffer and file offset alignment */
+#define DVR_IO_MAXBUFS  16               /* per recording queue limit */
+#define DVR_IO_FREEBUFS 8                /* spare buffers kept around */
+#define DVR_IO_FLUSH    2                /* seconds, pass on partial buffers */
+#define DVR_IO_IDLE     1                /* seconds, writer wakeup for stale buffers */
+#define DVR_IO_PREALLOC (16*1024*1024)   /* bytes written before fallocate */
+#define DVR_IO_PREALLOC_TIME 10          /* ... and seconds recorded */
+
+typedef struct dvr_io_buf {
+  TAILQ_ENTRY(dvr_io_buf) iob_link;
+  off_t    iob_off;
+  size_t   iob_len;
+  size_t   iob_size;
+  uint8_t *iob_data;
+} dvr_io_buf_t;
+
+struct dvr_io {
+  TAILQ_ENTRY(dvr_io)      io_link;      /* in dvr_io_queue */
+  LIST_ENTRY(dvr_io)       io_all_link;  /* in dvr_io_all */
+  muxer_t                 *io_muxer;     /* cache scheme */
+  char                    *io_name;
+  int                      io_fd;
+  int                      io_direct;    /* O_DIRECT is set */
+
+  /* Protected by io_cur_lock, writers only try to take it */
+  pthread_mutex_t          io_cur_lock;
+  dvr_io_buf_t            *io_cur;       /* being filled */
+  time_t                   io_cur_time;
+  off_t                    io_pos;       /* append position */
+  off_t                    io_end;       /* file size */
+  time_t                   io_start;
+  time_t                   io_stop;      /* expected end of the recording */
+
+  /* Protected by dvr_io_lock */
+  TAILQ_HEAD(,dvr_io_buf)  io_bufs;      /* waiting for the writer */
+  int                      io_nbufs;
+  size_t                   io_pending;   /* bytes */
+  int                      io_queued;
+  int                      io_busy;
+  int                      io_error;
+  int                      io_prealloc;  /* 0 = not yet, 1 = done */
+  uint64_t                 io_bytes;
+  uint32_t                 io_writes;
+  int64_t                  io_lat_avg;   /* us, moving average */
+  int64_t                  io_lat_max;   /* us */
+};
+
+static pthread_mutex_t         dvr_io_lock;
+static pthread_cond_t          dvr_io_cond;      /* work for the writers */
+static pthread_cond_t          dvr_io_done_cond; /* buffer written */
+static TAILQ_HEAD(,dvr_io)     dvr_io_queue;
+static LIST_HEAD(,dvr_io)      dvr_io_all;
+static TAILQ_HEAD(,dvr_io_buf) dvr_io_free;
+static int                     dvr_io_nfree;
+static int                     dvr_io_running;
+static pthread_t               dvr_io_tid[DVR_IO_THREADS];
+
+#if defined(PLATFORM_DARWIN)
+#define fdatasync(fd)       fcntl(fd, F_FULLFSYNC)
+#elif defined(PLATFORM_FREEBSD)
+#define fdatasync(fd)       fsync(fd)
+#endif
+
+/*
+ * Buffers (dvr_io_lock held)
+ */
+static dvr_io_buf_t *
+dvr_io_buf_alloc ( off_t off )
+{
+  dvr_io_buf_t *b;
+  void *p;
+
+  if ((b = TAILQ_FIRST(&dvr_io_free)) != NULL) {
+    TAILQ_REMOVE(&dvr_io_free, b, iob_link);
+    dvr_io_nfree--;
+  } else {
+    if (posix_memalign(&p, DVR_IO_ALIGN, DVR_IO_BUFSIZE))
+      return NULL;
+    b = calloc(1, sizeof(*b));
+    b->iob_data = p;
+  }
+  /* Keep the end of full buffers aligned */
+  b->iob_off  = off;
+  b->iob_len  = 0;
+  b->iob_size = DVR_IO_BUFSIZE - (off & (DVR_IO_ALIGN - 1));
+  return b;
+}
+
+static void
+dvr_io_buf_free ( dvr_io_buf_t *b )
+{
+  if (dvr_io_nfree < DVR_IO_FREEBUFS) {
+    TAILQ_INSERT_HEAD(&dvr_io_free, b, iob_link);
+    dvr_io_nfree++;
+  } else {
+    free(b->iob_data);
+    free(b);
+  }
+}
+
+/*
+ * O_DIRECT is only used for aligned writes
+ */
+static void
+dvr_io_set_direct ( dvr_io_t *io, int on )
+{
+#ifdef O_DIRECT
+  int fl;
+
+  if (io->io_direct == on)
+    return;
+  if ((fl = fcntl(io->io_fd, F_GETFL)) < 0)
+    return;
+  fl = on ? (fl | O_DIRECT) : (fl & ~O_DIRECT);
+  if (fcntl(io->io_fd, F_SETFL, fl) == 0) {
+    io->io_direct = on;
+  } else if (on) {
+    /* Not supported by the filesystem, stop trying */
+    tvhtrace("dvr", "%s: direct I/O not available -- %s",
+             io->io_name, strerror(errno));
+    io->io_muxer->m_config.m_cache = MC_CACHE_SYSTEM;
+  }
+#endif
+}
+
+static int
+dvr_io_pwrite ( int fd, const uint8_t *data, size_t len, off_t off )
+{
+  ssize_t r;
+
+  while (len) {
+    r = pwrite(fd, data, len, off);
+    if (r < 0) {
+      if (ERRNO_AGAIN(errno))
+        continue;
+      return errno;
+    }
+    data += r;
+    len  -= r;
+    off  += r;
+  }
+  return 0;
+}
+
+/*
+ * Write one buffer (writer thread, dvr_io_lock not held)
+ */
+static int
+dvr_io_buf_write ( dvr_io_t *io, dvr_io_buf_t *b )
+{
+  int err;
+
+  if (io->io_muxer->m_config.m_cache == MC_CACHE_DIRECT)
+    dvr_io_set_direct(io, (b->iob_off & (DVR_IO_ALIGN - 1)) == 0 &&
+                          (b->iob_len & (DVR_IO_ALIGN - 1)) == 0);
+  err = dvr_io_pwrite(io->io_fd, b->iob_data, b->iob_len, b->iob_off);
+  if (!err)
+    muxer_cache_update(io->io_muxer, io->io_fd, b->iob_off, b->iob_len);
+  return err;
+}
+
+/*
+ * Reserve the space for the rest of the recording once the
+ * bitrate is known
+ */
+static void
+dvr_io_preallocate ( dvr_io_t *io, off_t pos )
+{
+#if defined(PLATFORM_LINUX) && defined(FALLOC_FL_KEEP_SIZE)
+  time_t now = dispatch_clock;
+  int64_t size;
+
+  if (io->io_stop <= now || now <= io->io_start)
+    return;
+  size  = pos / (now - io->io_start) * (io->io_stop - now);
+  size += size / 10;
+  if (size <= 0)
+    return;
+  if (fallocate(io->io_fd, FALLOC_FL_KEEP_SIZE, pos, size))
+    tvhtrace("dvr", "%s: fallocate failed -- %s", io->io_name, strerror(errno));
+  else
+    tvhtrace("dvr", "%s: preallocated %"PRId64" bytes", io->io_name, size);
+#endif
+}
+
+/*
+ * Hand the current buffer (or its aligned part) to the writers
+ * (io_cur_lock and dvr_io_lock held)
+ */
+static int
+dvr_io_queue_cur ( dvr_io_t *io, int all )
+{
+  dvr_io_buf_t *b = io->io_cur, *n = NULL;
+  size_t len;
+  int err;
+
+  if (b == NULL || b->iob_len == 0)
+    return 0;
+
+  if (!all) {
+    len = ((b->iob_off + b->iob_len) & ~(off_t)(DVR_IO_ALIGN - 1)) - b->iob_off;
+    if ((ssize_t)len <= 0)
+      return 0;
+    if (len < b->iob_len) {
+      if ((n = dvr_io_buf_alloc(b->iob_off + len)) == NULL)
+        return 0;
+      n->iob_len = b->iob_len - len;
+      memcpy(n->iob_data, b->iob_data + len, n->iob_len);
+      b->iob_len = len;
+    }
+  }
+  while (io->io_nbufs >= DVR_IO_MAXBUFS && !io->io_error)
+    pthread_cond_wait(&dvr_io_done_cond, &dvr_io_lock);
+  if (!io->io_error && !dvr_io_running) {
+    /* Writers are gone (shutdown), write it here */
+    if ((err = dvr_io_buf_write(io, b)) != 0) {
+      io->io_error = err;
+      tvhlog(LOG_ERR, "dvr", "%s: Write failed -- %s", io->io_name, strerror(err));
+    }
+    io->io_bytes += b->iob_len;
+    io->io_writes++;
+  }
+  if (io->io_error || !dvr_io_running) {
+    dvr_io_buf_free(b);
+    if (n && io->io_error)
+      dvr_io_buf_free(n);
+    io->io_cur = io->io_error ? NULL : n;
+    io->io_cur_time = dispatch_clock;
+    return io->io_error;
+  }
+  TAILQ_INSERT_TAIL(&io->io_bufs, b, iob_link);
+  io->io_nbufs++;
+  io->io_pending += b->iob_len;
+  if (!io->io_queued && !io->io_busy) {
+    TAILQ_INSERT_TAIL(&dvr_io_queue, io, io_link);
+    io->io_queued = 1;
+    pthread_cond_signal(&dvr_io_cond);
+  }
+  io->io_cur      = n;
+  io->io_cur_time = dispatch_clock;
+  return 0;
+}
+
+/*
+ * Pass on partial buffers of stalled recordings (writer thread,
+ * dvr_io_lock held)
+ */
+static void
+dvr_io_flush_stale ( void )
+{
+  dvr_io_t *io;
+
+  LIST_FOREACH(io, &dvr_io_all, io_all_link) {
+    if (io->io_nbufs || io->io_busy || io->io_error)
+      continue;
+    /* The recording thread is busy with it, it will do that itself */
+    if (pthread_mutex_trylock(&io->io_cur_lock))
+      continue;
+    if (io->io_cur && io->io_cur->iob_len &&
+        io->io_cur_time + DVR_IO_FLUSH <= dispatch_clock) {
+      tvhtrace("dvr", "%s: flushing %zu stale bytes",
+               io->io_name, io->io_cur->iob_len);
+      dvr_io_queue_cur(io, 1);
+    }
+    pthread_mutex_unlock(&io->io_cur_lock);
+  }
+}
+
+static void *
+dvr_io_thread ( void *aux )
+{
+  dvr_io_t *io;
+  dvr_io_buf_t *b;
+  int64_t t, lat;
+  int err, prealloc;
+  struct timespec ts;
+
+  pthread_mutex_lock(&dvr_io_lock);
+  while (1) {
+
+    /* Everything queued is written before exit */
+    if ((io = TAILQ_FIRST(&dvr_io_queue)) == NULL) {
+      if (!dvr_io_running)
+        break;
+      dvr_io_flush_stale();
+      if (TAILQ_FIRST(&dvr_io_queue))
+        continue;
+      clock_gettime(CLOCK_REALTIME, &ts);
+      ts.tv_sec += DVR_IO_IDLE;
+      pthread_cond_timedwait(&dvr_io_cond, &dvr_io_lock, &ts);
+      continue;
+    }
+    TAILQ_REMOVE(&dvr_io_queue, io, io_link);
+    io->io_queued = 0;
+    b = TAILQ_FIRST(&io->io_bufs);
+    if (b == NULL)
+      continue;
+    io->io_busy = 1;
+    prealloc = !io->io_prealloc && io->io_stop &&
+               io->io_bytes >= DVR_IO_PREALLOC &&
+               io->io_start + DVR_IO_PREALLOC_TIME <= dispatch_clock;
+    if (prealloc)
+      io->io_prealloc = 1;
+    pthread_mutex_unlock(&dvr_io_lock);
+
+    if (prealloc)
+      dvr_io_preallocate(io, b->iob_off);
+    t   = getmonoclock();
+    err = dvr_io_buf_write(io, b);
+    lat = getmonoclock() - t;
+
+    pthread_mutex_lock(&dvr_io_lock);
+    TAILQ_REMOVE(&io->io_bufs, b, iob_link);
+    io->io_nbufs--;
+    io->io_pending -= b->iob_len;
+    if (err && !io->io_error) {
+      io->io_error = err;
+      tvhlog(LOG_ERR, "dvr", "%s: Write failed -- %s", io->io_name, strerror(err));
+    }
+    io->io_bytes   += b->iob_len;
+    io->io_writes++;
+    io->io_lat_avg  = io->io_writes == 1 ? lat : (io->io_lat_avg * 7 + lat) / 8;
+    if (lat > io->io_lat_max)
+      io->io_lat_max = lat;
+    dvr_io_buf_free(b);
+    io->io_busy = 0;
+    if (io->io_error) {
+      /* Drop the rest */
+      while ((b = TAILQ_FIRST(&io->io_bufs)) != NULL) {
+        TAILQ_REMOVE(&io->io_bufs, b, iob_link);
+        dvr_io_buf_free(b);
+      }
+      io->io_nbufs   = 0;
+      io->io_pending = 0;
+    } else if (TAILQ_FIRST(&io->io_bufs)) {
+      TAILQ_INSERT_TAIL(&dvr_io_queue, io, io_link);
+      io->io_queued = 1;
+    }
+    pthread_cond_broadcast(&dvr_io_done_cond);
+  }
+  pthread_mutex_unlock(&dvr_io_lock);
+  return NULL;
+}
+
+/*
+ * Queue the current buffer (io_cur_lock held)
+ */
+static int
+dvr_io_submit ( dvr_io_t *io, int all )
+{
+  int err;
+
+  pthread_mutex_lock(&dvr_io_lock);
+  err = dvr_io_queue_cur(io, all);
+  pthread_mutex_unlock(&dvr_io_lock);
+  return err;
+}
+
+/*
+ * Wait until everything is on the disk (io_cur_lock held)
+ */
+static int
+dvr_io_wait ( dvr_io_t *io )
+{
+  int err;
+
+  if ((err = dvr_io_submit(io, 1)) != 0)
+    return err;
+  pthread_mutex_lock(&dvr_io_lock);
+  while (io->io_nbufs || io->io_busy)
+    pthread_cond_wait(&dvr_io_done_cond, &dvr_io_lock);
+  err = io->io_error;
+  pthread_mutex_unlock(&dvr_io_lock);
+  return err;
+}
+
+/*
+ * Final truncate / sync / close, buffers must be written
+ */
+static int
+dvr_io_close_fd ( dvr_io_t *io, int err )
+{
+  if (io->io_fd < 0)
+    return err;
+  dvr_io_set_direct(io, 0);
+  if (io->io_prealloc && ftruncate(io->io_fd, io->io_end) && !err)
+    err = errno;
+  if (!err && (io->io_muxer->m_config.m_cache == MC_CACHE_SYNC ||
+               io->io_muxer->m_config.m_cache == MC_CACHE_SYNCDONTKEEP))
+    fdatasync(io->io_fd);
+  if (close(io->io_fd) && !err)
+    err = errno;
+  io->io_fd = -1;
+  return err;
+}
+
+/*
+ * Public interface
+ */
+dvr_io_t *
+dvr_io_create ( muxer_t *m, int fd, const char *name )
+{
+  dvr_io_t *io = calloc(1, sizeof(*io));
+
+  io->io_muxer = m;
+  io->io_fd    = fd;
+  io->io_name  = strdup(name);
+  io->io_start = dispatch_clock;
+  TAILQ_INIT(&io->io_bufs);
+  pthread_mutex_init(&io->io_cur_lock, NULL);
+  pthread_mutex_lock(&dvr_io_lock);
+  LIST_INSERT_HEAD(&dvr_io_all, io, io_all_link);
+  pthread_mutex_unlock(&dvr_io_lock);
+  return io;
+}
+
+void
+dvr_io_set_stop ( dvr_io_t *io, time_t stop )
+{
+  if (io)
+    io->io_stop = stop;
+}
+
+static int
+dvr_io_writev0 ( dvr_io_t *io, off_t off, const struct iovec *iov, int iovcnt )
+{
+  dvr_io_buf_t *b;
+  const uint8_t *data;
+  size_t len, l;
+  int i, err;
+
+  /* Closed by dvr_io_done() */
+  if (io->io_fd < 0)
+    return EBADF;
+
+  /* Rewrite of an earlier part of the file, do it in place */
+  if (off != io->io_pos) {
+    if ((err = dvr_io_wait(io)) != 0)
+      return err;
+    dvr_io_set_direct(io, 0);
+    for (i = 0; i < iovcnt; i++) {
+      if ((err = dvr_io_pwrite(io->io_fd, iov[i].iov_base, iov[i].iov_len, off)))
+        return err;
+      off += iov[i].iov_len;
+    }
+    if (off > io->io_pos)
+      io->io_pos = off;
+    if (io->io_pos > io->io_end)
+      io->io_end = io->io_pos;
+    return 0;
+  }
+
+  for (i = 0; i < iovcnt; i++) {
+    data = iov[i].iov_base;
+    len  = iov[i].iov_len;
+    while (len) {
+      if ((b = io->io_cur) == NULL) {
+        pthread_mutex_lock(&dvr_io_lock);
+        b = io->io_cur = dvr_io_buf_alloc(io->io_pos);
+        err = io->io_error;
+        pthread_mutex_unlock(&dvr_io_lock);
+        if (err)
+          return err;
+        if (b == NULL)
+          return ENOMEM;
+        io->io_cur_time = dispatch_clock;
+      }
+      l = MIN(len, b->iob_size - b->iob_len);
+      memcpy(b->iob_data + b->iob_len, data, l);
+      b->iob_len += l;
+      io->io_pos += l;
+      data += l;
+      len  -= l;
+      if (b->iob_len == b->iob_size && (err = dvr_io_submit(io, 1)))
+        return err;
+    }
+  }
+  if (io->io_pos > io->io_end)
+    io->io_end = io->io_pos;
+
+  /* Do not keep slow streams in memory for too long */
+  if (io->io_cur && io->io_cur_time + DVR_IO_FLUSH <= dispatch_clock)
+    return dvr_io_submit(io, 0);
+  return 0;
+}
+
+int
+dvr_io_writev ( dvr_io_t *io, off_t off, const struct iovec *iov, int iovcnt )
+{
+  int err;
+
+  pthread_mutex_lock(&io->io_cur_lock);
+  err = dvr_io_writev0(io, off, iov, iovcnt);
+  pthread_mutex_unlock(&io->io_cur_lock);
+  return err;
+}
+
+int
+dvr_io_write ( dvr_io_t *io, off_t off, const void *data, size_t len )
+{
+  struct iovec iov = { .iov_base = (void *)data, .iov_len = len };
+  return dvr_io_writev(io, off, &iov, 1);
+}
+
+void
+dvr_io_stats ( dvr_io_t *io, uint32_t *latency, uint32_t *queue )
+{
+  if (io == NULL)
+    return;
+  pthread_mutex_lock(&dvr_io_lock);
+  *latency = io->io_lat_avg / 1000;
+  *queue   = (io->io_pending + (io->io_cur ? io->io_cur->iob_len : 0)) / 1024;
+  pthread_mutex_unlock(&dvr_io_lock);
+}
+
+int
+dvr_io_close ( dvr_io_t *io )
+{
+  int err;
+
+  pthread_mutex_lock(&dvr_io_lock);
+  LIST_REMOVE(io, io_all_link);
+  pthread_mutex_unlock(&dvr_io_lock);
+
+  pthread_mutex_lock(&io->io_cur_lock);
+  err = dvr_io_close_fd(io, dvr_io_wait(io));
+  pthread_mutex_unlock(&io->io_cur_lock);
+  tvhdebug("dvr", "%s: %"PRIu64" bytes in %u writes, latency avg %"PRId64"ms "
+           "max %"PRId64"ms", io->io_name, io->io_bytes, io->io_writes,
+           io->io_lat_avg / 1000, io->io_lat_max / 1000);
+  pthread_mutex_destroy(&io->io_cur_lock);
+  free(io->io_name);
+  free(io);
+  return err;
+}
+
+/*
+ * Init / done
+ */
+void
+dvr_io_init ( void )
+{
+  int i;
+
+  pthread_mutex_init(&dvr_io_lock, NULL);
+  pthread_cond_init(&dvr_io_cond, NULL);
+  pthread_cond_init(&dvr_io_done_cond, NULL);
+  TAILQ_INIT(&dvr_io_queue);
+  TAILQ_INIT(&dvr_io_free);
+  LIST_INIT(&dvr_io_all);
+  dvr_io_running = 1;
+  for (i = 0; i < DVR_IO_THREADS; i++)
+    tvhthread_create(&dvr_io_tid[i], NULL, dvr_io_thread, NULL);
+}
+
+void
+dvr_io_done ( void )
+{
+  dvr_io_t *io;
+  dvr_io_buf_t *b;
+  int i, err;
+
+  /* The writers drain the queue before they exit */
+  pthread_mutex_lock(&dvr_io_lock);
+  dvr_io_running = 0;
+  pthread_cond_broadcast(&dvr_io_cond);
+  pthread_mutex_unlock(&dvr_io_lock);
+  for (i = 0; i < DVR_IO_THREADS; i++)
+    pthread_join(dvr_io_tid[i], NULL);
+
+  /* Write out and close what the recordings left open, later
+   * writes fail, dvr_io_close() only frees */
+  pthread_mutex_lock(&dvr_io_lock);
+  LIST_FOREACH(io, &dvr_io_all, io_all_link) {
+    if (pthread_mutex_trylock(&io->io_cur_lock))
+      continue;
+    err = dvr_io_queue_cur(io, 1);
+    if ((err = dvr_io_close_fd(io, err)) != 0)
+      tvhlog(LOG_ERR, "dvr", "%s: Unable to close file -- %s",
+             io->io_name, strerror(err));
+    else
+      tvhdebug("dvr", "%s: closed on shutdown", io->io_name);
+    pthread_mutex_unlock(&io->io_cur_lock);
+  }
+  while ((b = TAILQ_FIRST(&dvr_io_free)) != NULL) {
+    TAILQ_REMOVE(&dvr_io_free, b, iob_link);
+    dvr_io_nfree--;
+    free(b->iob_data);
+    free(b);
+  }
+  pthread_mutex_unlock(&dvr_io_lock);
+}
@@ -316,6 +316,9 @@ static void
 dvr_notify(dvr_entry_t *de, int now)
 {
   if (now || de->de_last_notify + 5 < dispatch_clock) {
+    if (de->de_chain && de->de_chain->prch_muxer)
+      dvr_io_stats(de->de_chain->prch_muxer->m_io,
+                   &de->de_write_latency, &de->de_write_queue);
     idnode_notify_changed(&de->de_id);
     de->de_last_notify = dispatch_clock;
     htsp_dvr_entry_update(de);
@@ -388,6 +391,7 @@ dvr_rec_start(dvr_entry_t *de, const streaming_start_t *ss)
     dvr_rec_fatal_error(de, "Unable to open file");
     return -1;
   }
+  dvr_io_set_stop(muxer->m_io, dvr_entry_get_stop_time(de));
 
   if(muxer_init(muxer, ss, lang_str_get(de->de_title, NULL))) {
     dvr_rec_fatal_error(de, "Unable to init file");
@@ -743,6 +747,7 @@ dvr_thread_epilog(dvr_entry_t *de)
   muxer_close(prch->prch_muxer);
   muxer_destroy(prch->prch_muxer);
   prch->prch_muxer = NULL;
+  de->de_write_queue = 0;
   dvr_notify(de, 1);
 
   dvr_config_t *cfg = de->de_config;
@@ -54,6 +54,7 @@ epg_object_list_t epg_object_unref;
 epg_object_list_t epg_object_updated;
 
 int epg_in_load;
+uint32_t epg_generation;
 
 /* Global counter */
 static uint32_t _epg_object_idx    = 0;
@@ -1549,6 +1550,7 @@ static epg_broadcast_t *_epg_channel_add_broadcast
 void epg_channel_unlink ( channel_t *ch )
 {
   epg_broadcast_t *ebc;
+  epg_generation++;
   while ( (ebc = RB_FIRST(&ch->ch_epg_schedule)) ) {
     _epg_channel_rem_broadcast(ch, ebc, NULL);
   }
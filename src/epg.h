@@ -55,6 +55,7 @@ typedef struct epg_broadcast       epg_broadcast_t;
 typedef struct epg_serieslink      epg_serieslink_t;
 
 extern int epg_in_load;
+extern uint32_t epg_generation; ///< bumped when EPG data is cleared or reloaded
 
 /* ************************************************************************
  * Genres
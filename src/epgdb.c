@@ -155,6 +155,10 @@ void epg_init ( void )
   epggrab_stats_t stats;
   int ver = EPG_DB_VERSION;
   char *sect = NULL;
+  htsmsg_arena_t *arena;
+
+  /* Grabber caches refer to the old data */
+  epg_generation++;
 
   /* Find the right file (and version) */
   while (fd < 0 && ver > 0) {
@@ -187,6 +191,7 @@ void epg_init ( void )
 
   /* Process */
   memset(&stats, 0, sizeof(stats));
+  arena = htsmsg_arena_create();
   while ( remain > 4 ) {
 
     /* Get message length */
@@ -201,7 +206,8 @@ void epg_init ( void )
     }
     
     /* Extract message */
-    htsmsg_t *m = htsmsg_binary_deserialize(rp, msglen, NULL);
+    htsmsg_arena_reset(arena);
+    htsmsg_t *m = htsmsg_binary_deserialize_arena(arena, rp, msglen, NULL);
 
     /* Next */
     rp     += msglen;
@@ -223,6 +229,7 @@ void epg_init ( void )
     htsmsg_destroy(m);
   }
 
+  htsmsg_arena_destroy(arena);
   free(sect);
 
   if (!stats.config.total) {
@@ -154,6 +154,9 @@ struct epggrab_module
   /* Free */
   void      (*done)    ( void *m );
 
+  /* Status (statistics for the module list) */
+  void      (*status)  ( void *m, htsmsg_t *e );
+
   /* Channel listings */
   void      (*ch_add)  ( void *m, struct channel *ch );
   void      (*ch_rem)  ( void *m, struct channel *ch );
@@ -208,6 +211,8 @@ struct epggrab_ota_mux
   uint8_t                            om_complete;     ///< Has completed a scan
   uint8_t                            om_requeue;      ///< Requeue when stolen
   uint8_t                            om_save;         ///< something changed
+  time_t                             om_start;        ///< Grab start
+  uint32_t                           om_grab_time;    ///< Learnt grab duration (s)
   gtimer_t                           om_timer;        ///< Per mux active timer
   gtimer_t                           om_data_timer;   ///< Any EPG data seen?
 
@@ -70,6 +70,8 @@ htsmsg_t *epggrab_module_list ( void )
       epggrab_module_ext_t *ext = (epggrab_module_ext_t*)m;
       htsmsg_add_str(e, "path", ext->path);
     }
+    if (m->status)
+      m->status(m, e);
     htsmsg_add_msg(a, NULL, e);
   }
   return a;
@@ -517,6 +519,7 @@ epggrab_module_ota_t *epggrab_module_ota_create
   skel->start  = ops->start;
   skel->done   = ops->done;
   skel->tune   = ops->tune;
+  skel->status = ops->status;
   //TAILQ_INIT(&skel->muxes);
 
   return skel;
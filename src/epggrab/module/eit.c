@@ -54,6 +54,31 @@ typedef struct eit_event
 
 } eit_event_t;
 
+/*
+ * Section cache - the schedule repeats the same sections every few
+ * seconds on all the muxes carrying it, skip the unchanged ones
+ */
+#define EIT_CACHE_SIZE     8192   /* power of 2 */
+#define EIT_CACHE_LIFETIME 3600   /* seconds */
+
+typedef struct eit_cache_entry
+{
+  uint64_t          key;      ///< onid, tsid, sid, tableid, section
+  uint32_t          crc;
+  uint32_t          channels; ///< the channels mapped at the time
+  time_t            updated;
+} eit_cache_entry_t;
+
+typedef struct eit_module
+{
+  epggrab_module_ota_t  ;     ///< Base struct
+
+  eit_cache_entry_t    *cache;
+  uint32_t              cache_generation; ///< epg_generation of the entries
+  uint64_t              cache_hits;
+  uint64_t              cache_misses;
+} eit_module_t;
+
 /* ************************************************************************
  * Diagnostics
  * ***********************************************************************/
@@ -569,6 +594,62 @@ static int _eit_process_event
 }
 
 
+/*
+ * Section cache lookup, returns the entry to fill in after
+ * processing or NULL when the section was processed already
+ */
+static eit_cache_entry_t *
+_eit_cache_find
+  ( eit_module_t *mod, mpegts_service_t *svc, int tableid, int sect,
+    const uint8_t *ptr, int len )
+{
+  channel_service_mapping_t *csm;
+  eit_cache_entry_t *ce;
+  uint64_t key;
+  uint32_t crc, channels = 0, h;
+
+  if (len < 4)
+    return NULL;
+  if (!mod->cache)
+    mod->cache = calloc(EIT_CACHE_SIZE, sizeof(eit_cache_entry_t));
+  /* the EPG was cleared or reloaded, the events must be created again */
+  if (mod->cache_generation != epg_generation) {
+    memset(mod->cache, 0, EIT_CACHE_SIZE * sizeof(eit_cache_entry_t));
+    mod->cache_generation = epg_generation;
+  }
+
+  key = ((uint64_t)ptr[7] << 56) | ((uint64_t)ptr[8] << 48) | /* onid */
+        ((uint64_t)ptr[5] << 40) | ((uint64_t)ptr[6] << 32) | /* tsid */
+        ((uint64_t)ptr[0] << 24) | ((uint64_t)ptr[1] << 16) | /* sid */
+        (tableid << 8) | sect;
+  crc = (ptr[len-4] << 24) | (ptr[len-3] << 16) | (ptr[len-2] << 8) | ptr[len-1];
+  LIST_FOREACH(csm, &svc->s_channels, csm_svc_link)
+    channels = channels * 31 + channel_get_id(csm->csm_chn);
+
+  h  = (uint32_t)(key ^ (key >> 29)) * 2654435761u;
+  ce = &mod->cache[(h >> 16) & (EIT_CACHE_SIZE - 1)];
+  if (ce->key == key && ce->crc == crc && ce->channels == channels &&
+      ce->updated + EIT_CACHE_LIFETIME > dispatch_clock) {
+    mod->cache_hits++;
+    return NULL;
+  }
+  mod->cache_misses++;
+  ce->key      = key;
+  ce->crc      = crc;
+  ce->channels = channels;
+  ce->updated  = 0;
+  return ce;
+}
+
+static void
+_eit_status ( void *m, htsmsg_t *e )
+{
+  eit_module_t *mod = m;
+
+  htsmsg_add_s64(e, "cache_hits", mod->cache_hits);
+  htsmsg_add_s64(e, "cache_misses", mod->cache_misses);
+}
+
 static int
 _eit_callback
   (mpegts_table_t *mt, const uint8_t *ptr, int len, int tableid)
@@ -584,6 +665,7 @@ _eit_callback
   epggrab_module_t     *mod = (epggrab_module_t *)map->om_module;
   epggrab_ota_mux_t    *ota = NULL;
   mpegts_psi_table_state_t *st;
+  eit_cache_entry_t    *ce;
 
   /* Validate */
   if(tableid < 0x4e || tableid > 0x6f || len < 11)
@@ -657,6 +739,10 @@ _eit_callback
   if (svc->s_dvb_ignore_eit)
     goto done;
 
+  /* Unchanged since processed */
+  if (!(ce = _eit_cache_find((eit_module_t *)mod, svc, tableid, sect, ptr, len)))
+    goto done;
+
   /* Process events */
   save = resched = 0;
   len -= 11;
@@ -674,6 +760,7 @@ _eit_callback
   /* Update EPG */
   if (resched) epggrab_resched();
   if (save)    epg_updated();
+  ce->updated = dispatch_clock;
   
 done:
   r = dvb_table_end((mpegts_psi_table_t *)mt, st, sect);
@@ -687,6 +774,14 @@ done:
  * Module Setup
  * ***********************************************************************/
 
+static void _eit_done ( void *m )
+{
+  eit_module_t *mod = m;
+
+  free(mod->cache);
+  mod->cache = NULL;
+}
+
 static int _eit_start
   ( epggrab_ota_map_t *map, mpegts_mux_t *dm )
 {
@@ -761,14 +856,20 @@ static int _eit_tune
 void eit_init ( void )
 {
   static epggrab_ota_module_ops_t ops = {
-    .start = _eit_start,
-    .tune  = _eit_tune,
+    .start  = _eit_start,
+    .tune   = _eit_tune,
+    .done   = _eit_done,
+    .status = _eit_status,
   };
 
-  epggrab_module_ota_create(NULL, "eit", "EIT: DVB Grabber", 1, &ops, NULL);
-  epggrab_module_ota_create(NULL, "uk_freesat", "UK: Freesat", 5, &ops, NULL);
-  epggrab_module_ota_create(NULL, "uk_freeview", "UK: Freeview", 5, &ops, NULL);
-  epggrab_module_ota_create(NULL, "viasat_baltic", "VIASAT: Baltic", 5, &ops, NULL);
+  epggrab_module_ota_create(calloc(1, sizeof(eit_module_t)),
+                            "eit", "EIT: DVB Grabber", 1, &ops, NULL);
+  epggrab_module_ota_create(calloc(1, sizeof(eit_module_t)),
+                            "uk_freesat", "UK: Freesat", 5, &ops, NULL);
+  epggrab_module_ota_create(calloc(1, sizeof(eit_module_t)),
+                            "uk_freeview", "UK: Freeview", 5, &ops, NULL);
+  epggrab_module_ota_create(calloc(1, sizeof(eit_module_t)),
+                            "viasat_baltic", "VIASAT: Baltic", 5, &ops, NULL);
 }
 
 void eit_done ( void )
@@ -56,6 +56,10 @@ gtimer_t                     epggrab_ota_start_timer;
 
 int                          epggrab_ota_pending_flag;
 
+time_t                       epggrab_ota_sweep_start;
+int                          epggrab_ota_sweep_muxes;
+int64_t                      epggrab_ota_sweep_tuner;
+
 pthread_mutex_t              epggrab_ota_mutex;
 
 SKEL_DECLARE(epggrab_ota_mux_skel, epggrab_ota_mux_t);
@@ -102,18 +106,72 @@ epggrab_ota_timeout_get ( void )
   return timeout;
 }
 
+/*
+ * Give up well before the global timeout on muxes which have always
+ * completed quickly
+ */
+static int
+epggrab_ota_mux_timeout ( epggrab_ota_mux_t *om )
+{
+  int timeout = epggrab_ota_timeout_get();
+
+  if (om->om_grab_time && om->om_grab_time * 2 + 60 < timeout)
+    timeout = om->om_grab_time * 2 + 60;
+  return timeout;
+}
+
+/*
+ * Longest grabs first, so the parallel tuners finish at about the
+ * same time (unknown muxes are the longest ones)
+ */
 static int
 epggrab_ota_queue_one( epggrab_ota_mux_t *om )
 {
+  epggrab_ota_mux_t *om2;
+  uint32_t t = om->om_grab_time ?: UINT32_MAX;
+
   om->om_done = 0;
   om->om_requeue = 1;
   if (om->om_q_type != EPGGRAB_OTA_MUX_IDLE)
     return 0;
-  TAILQ_INSERT_TAIL(&epggrab_ota_pending, om, om_q_link);
+  TAILQ_FOREACH(om2, &epggrab_ota_pending, om_q_link)
+    if ((om2->om_grab_time ?: UINT32_MAX) < t)
+      break;
+  if (om2)
+    TAILQ_INSERT_BEFORE(om2, om, om_q_link);
+  else
+    TAILQ_INSERT_TAIL(&epggrab_ota_pending, om, om_q_link);
   om->om_q_type = EPGGRAB_OTA_MUX_PENDING;
   return 1;
 }
 
+/*
+ * Sweep statistics, the sweep ends when no mux is waiting or grabbed
+ */
+static void
+epggrab_ota_sweep_check ( void )
+{
+  time_t t;
+
+  if (!TAILQ_EMPTY(&epggrab_ota_pending)) {
+    if (!epggrab_ota_sweep_start)
+      epggrab_ota_sweep_start = dispatch_clock;
+    return;
+  }
+  if (!TAILQ_EMPTY(&epggrab_ota_active) || !epggrab_ota_sweep_start)
+    return;
+  t = dispatch_clock - epggrab_ota_sweep_start;
+  if (epggrab_ota_sweep_muxes) {
+    tvhinfo("epggrab", "ota sweep finished, %d muxes in %lds, tuner time %.2fh",
+            epggrab_ota_sweep_muxes, (long)t,
+            epggrab_ota_sweep_tuner / 3600.0);
+    dbus_emit_signal_s64("/epggrab/ota", "sweep", t);
+  }
+  epggrab_ota_sweep_start = 0;
+  epggrab_ota_sweep_muxes = 0;
+  epggrab_ota_sweep_tuner = 0;
+}
+
 void
 epggrab_ota_queue_mux( mpegts_mux_t *mm )
 {
@@ -158,6 +216,8 @@ epggrab_ota_kick ( int delay )
     epggrab_ota_requeue();
   }
 
+  epggrab_ota_sweep_check();
+
   if (TAILQ_EMPTY(&epggrab_ota_pending))
     return;
 
@@ -176,13 +236,32 @@ epggrab_ota_done ( epggrab_ota_mux_t *om, int reason )
   char name[256];
   mpegts_mux_t *mm;
   epggrab_ota_map_t *map;
+  time_t t = dispatch_clock - om->om_start;
+
+  /* Learn how long the complete grab takes */
+  if (reason == EPGGRAB_OTA_DONE_COMPLETE) {
+    om->om_grab_time = om->om_grab_time ?
+                         (om->om_grab_time * 3 + MAX(t, 1) + 3) / 4 :
+                         MAX(t, 1);
+    om->om_save = 1;
+  } else if (reason == EPGGRAB_OTA_DONE_TIMEOUT && om->om_grab_time) {
+    /* The learnt time was too short, next grab gets the full timeout */
+    om->om_grab_time = 0;
+    om->om_save = 1;
+  }
+  if (epggrab_ota_sweep_start) {
+    if (reason != EPGGRAB_OTA_DONE_STOLEN)
+      epggrab_ota_sweep_muxes++;
+    epggrab_ota_sweep_tuner += t;
+  }
 
   if (om->om_save)
     epggrab_ota_save(om);
 
   mm = mpegts_mux_find(om->om_mux_uuid);
   mpegts_mux_nice_name(mm, name, sizeof(name));
-  tvhdebug("epggrab", "grab done for %s (%s)", name, reasons[reason]);
+  tvhdebug("epggrab", "grab done for %s (%s) in %lds", name, reasons[reason],
+           (long)t);
 
   gtimer_disarm(&om->om_timer);
   gtimer_disarm(&om->om_data_timer);
@@ -242,9 +321,10 @@ epggrab_ota_start ( epggrab_ota_mux_t *om, mpegts_mux_t *mm )
 
   TAILQ_INSERT_TAIL(&epggrab_ota_active, om, om_q_link);
   om->om_q_type = EPGGRAB_OTA_MUX_ACTIVE;
+  om->om_start  = dispatch_clock;
   grace = mpegts_input_grace(mmi->mmi_input, mm);
   gtimer_arm(&om->om_timer, epggrab_ota_timeout_cb, om,
-             epggrab_ota_timeout_get() + grace);
+             epggrab_ota_mux_timeout(om) + grace);
   gtimer_arm(&om->om_data_timer, epggrab_ota_data_timeout_cb, om,
              30 + grace); /* 30 seconds to receive any EPG info */
   if (modname) {
@@ -451,11 +531,8 @@ epggrab_ota_kick_cb ( void *p )
   epggrab_ota_mux_t *om = TAILQ_FIRST(&epggrab_ota_pending);
   epggrab_ota_mux_t *first = NULL;
   mpegts_mux_t *mm;
-  struct {
-    mpegts_network_t *net;
-    int failed;
-  } networks[64], *net;	/* more than 64 networks? - you're a king */
-  int i, r, networks_count = 0, epg_flag, kick = 1;
+  mpegts_input_t *busy[64];
+  int i, r, nbusy = 0, epg_flag, kick = 1;
   const char *modname;
   static const char *modnames[] = {
     [MM_EPG_DISABLE]                 = NULL,
@@ -489,22 +566,13 @@ next_one:
   TAILQ_REMOVE(&epggrab_ota_pending, om, om_q_link);
   om->om_q_type = EPGGRAB_OTA_MUX_IDLE;
 
-  /* Check if this network failed before */
-  for (i = 0, net = NULL; i < networks_count; i++) {
-    net = &networks[i];
-    if (net->net == mm->mm_network) {
-      if (net->failed) {
-        TAILQ_INSERT_TAIL(&epggrab_ota_pending, om, om_q_link);
-        om->om_q_type = EPGGRAB_OTA_MUX_PENDING;
-        goto done;
-      }
-      break;
-    }
-  }
-  if (i >= networks_count) {
-    net = &networks[networks_count++];
-    net->net = mm->mm_network;
-    net->failed = 0;
+  /* All inputs able to tune this mux are taken, try the others */
+  if (nbusy && mpegts_mux_inputs_busy(mm, SUBSCRIPTION_EPG, busy, nbusy)) {
+    TAILQ_INSERT_TAIL(&epggrab_ota_pending, om, om_q_link);
+    om->om_q_type = EPGGRAB_OTA_MUX_PENDING;
+    if (first == NULL)
+      first = om;
+    goto done;
   }
 
   epg_flag = MM_EPG_DISABLE;
@@ -554,7 +622,7 @@ next_one:
     TAILQ_INSERT_TAIL(&epggrab_ota_pending, om, om_q_link);
     om->om_q_type = EPGGRAB_OTA_MUX_PENDING;
     if (r == SM_CODE_NO_FREE_ADAPTER)
-      net->failed = 1;
+      nbusy = mpegts_mux_inputs_add_busy(mm, busy, nbusy, ARRAY_SIZE(busy));
     if (first == NULL)
       first = om;
   } else {
@@ -567,7 +635,7 @@ next_one:
 
 done:
   om = TAILQ_FIRST(&epggrab_ota_pending);
-  if (networks_count < ARRAY_SIZE(networks) && om && first != om)
+  if (om && first != om)
     goto next_one;
   if (kick)
     epggrab_ota_kick(64); /* a random number? */
@@ -705,6 +773,8 @@ epggrab_ota_save ( epggrab_ota_mux_t *ota )
 
   ota->om_save = 0;
   htsmsg_add_u32(c, "complete", ota->om_complete);
+  if (ota->om_grab_time)
+    htsmsg_add_u32(c, "grab_time", ota->om_grab_time);
   l = htsmsg_create_list();
   LIST_FOREACH(map, &ota->om_modules, om_link) {
     e = htsmsg_create_map();
@@ -756,6 +826,7 @@ epggrab_ota_load_one
     return;
   }
   ota->om_complete = htsmsg_get_u32_or_default(c, "complete", 0) != 0;
+  ota->om_grab_time = htsmsg_get_u32_or_default(c, "grab_time", 0);
   
   if (!(l = htsmsg_get_list(c, "modules"))) return;
   HTSMSG_FOREACH(f, l) {
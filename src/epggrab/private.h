@@ -96,6 +96,7 @@ typedef struct epggrab_ota_module_ops {
     void (*done)   (void *m);
     int  (*tune)   (epggrab_ota_map_t *map, epggrab_ota_mux_t *om,
                     struct mpegts_mux *mm);
+    void (*status) (void *m, htsmsg_t *e);
 } epggrab_ota_module_ops_t;
 
 epggrab_module_ota_t *epggrab_module_ota_create
@@ -27,6 +27,7 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include "tvheadend.h"
+#include "atomic.h"
 #include "channels.h"
 #include "input/mpegts/dvb.h"
 #include "service.h"
@@ -5757,15 +5758,64 @@ unsigned fsat_index_2[] = {
 		3160  /* 128 */
 };
 
+/*
+ * Per context lookup by the next 8 bits: 0x8000 | bits << 8 | next,
+ * zero when a longer code may match (linear search in the table)
+ */
+static uint16_t fsat_lookup[2][128][256];
+static volatile int fsat_lookup_ready;
+static pthread_mutex_t fsat_lookup_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void
+freesat_lookup_build
+  ( uint16_t lookup[128][256], struct fsattab *table, unsigned int *index )
+{
+  unsigned int indx, j, v, mask;
+  uint16_t *l;
+
+  for (indx = 0; indx < 128; indx++) {
+    l = lookup[indx];
+    for (v = 0; v < 256; v++) {
+      for (j = index[indx]; j < index[indx + 1]; j++) {
+        if (table[j].bits > 8) {
+          if ((table[j].value >> 24) == v)
+            break;
+          continue;
+        }
+        mask = 0xff00 >> table[j].bits;
+        if ((v & mask) == ((table[j].value >> 24) & mask)) {
+          l[v] = 0x8000 | (table[j].bits << 8) | (uint8_t)table[j].next;
+          break;
+        }
+      }
+    }
+  }
+}
+
+static void
+freesat_lookup_init ( void )
+{
+  if (atomic_add(&fsat_lookup_ready, 0))
+    return;
+  pthread_mutex_lock(&fsat_lookup_lock);
+  if (!fsat_lookup_ready) {
+    freesat_lookup_build(fsat_lookup[0], fsat_table_1, fsat_index_1);
+    freesat_lookup_build(fsat_lookup[1], fsat_table_2, fsat_index_2);
+    atomic_exchange(&fsat_lookup_ready, 1);
+  }
+  pthread_mutex_unlock(&fsat_lookup_lock);
+}
+
 size_t freesat_huffman_decode
   (char *dst, size_t* dstlen, const uint8_t *src, size_t srclen)
 {
 	struct fsattab *fsat_table;
 	unsigned int *fsat_index;
+	uint16_t (*lookup)[256];
   size_t p;
 	unsigned int value;
-	unsigned int byte;
-	unsigned int bit;
+	uint64_t w;
+	size_t pos, byte, i;
 	char lastch;
 	int found;
 	unsigned int bitShift;
@@ -5773,31 +5823,34 @@ size_t freesat_huffman_decode
 	unsigned int indx;
 	unsigned int j;
 	unsigned int mask;
-	unsigned int maskbit;
-	unsigned short kk;
-	unsigned int b;
+	uint16_t l;
 
   if (src[0] != 0x1f) return -1;
 
 	p = 0;
 	if (src[1] == 1 || src[1] == 2) {
+		freesat_lookup_init();
 		if (src[1] == 1) {
 			fsat_table = fsat_table_1;
 			fsat_index = fsat_index_1;
+			lookup     = fsat_lookup[0];
 		} else {
 			fsat_table = fsat_table_2;
 			fsat_index = fsat_index_2;
+			lookup     = fsat_lookup[1];
 		}
-		value = 0;
-		byte = 2;
-		bit = 0;
-		while (byte < 6 && byte < srclen) {
-			value |= src[byte] << ((5 - byte) * 8);
-			byte++;
-		}
+		// value is the 32 bit window at bit pos (zero past the end),
+		// byte the position the bit by bit refill would be at
+		pos = 16;
+		byte = MIN(MAX(srclen, 2), 6);
 		lastch = START;
 
 		do {
+			w = 0;
+			for (i = pos >> 3; i < (pos >> 3) + 5; i++)
+				w = (w << 8) | (i < srclen ? src[i] : 0);
+			value = (uint32_t)((w << (pos & 7)) >> 8);
+
 			found = 0;
 			bitShift = 0;
 			nextCh = STOP;
@@ -5813,22 +5866,24 @@ size_t freesat_huffman_decode
 					lastch = nextCh;
 				}
 			} else {
-				indx = (unsigned int) lastch;
-				//if (src[1] == 2)
-				//    indx |= 0x80;
-				for (j = fsat_index[indx]; j < fsat_index[indx + 1]; j++) {
-					mask = 0;
-					maskbit = 0x80000000;
-					for (kk = 0; kk < fsat_table[j].bits; kk++) {
-						mask |= maskbit;
-						maskbit >>= 1;
-					}
-					if ((value & mask) == fsat_table[j].value) {
-						nextCh = fsat_table[j].next;
-						bitShift = fsat_table[j].bits;
-						found = 1;
-						lastch = nextCh;
-						break;
+				indx = (unsigned int) lastch & 0x7f;
+				if ((l = lookup[indx][value >> 24]) != 0) {
+					nextCh = l & 0xff;
+					bitShift = (l >> 8) & 0x7f;
+					found = 1;
+					lastch = nextCh;
+				} else {
+					for (j = fsat_index[indx]; j < fsat_index[indx + 1]; j++) {
+						// a shift by 32 is undefined
+						mask = fsat_table[j].bits ?
+						       0xffffffffU << (32 - fsat_table[j].bits) : 0;
+						if ((value & mask) == fsat_table[j].value) {
+							nextCh = fsat_table[j].next;
+							bitShift = fsat_table[j].bits;
+							found = 1;
+							lastch = nextCh;
+							break;
+						}
 					}
 				}
 			}
@@ -5837,21 +5892,11 @@ size_t freesat_huffman_decode
 					if (p >= *dstlen) return 0;
 					dst[p++] = nextCh;
 				}
-				// Shift up by the number of bits.
-				for (b = 0; b < bitShift; b++) {
-					value = (value << 1) & 0xfffffffe;
-					if (byte < srclen)
-						value |= (src[byte] >> (7 - bit)) & 1;
-					if (bit == 7) {
-						bit = 0;
-						byte++;
-					} else
-						bit++;
-				}
+				pos += bitShift;
 			} else {
         return -1;
 			}
-		} while (lastch != STOP && byte < srclen + 4);
+		} while (lastch != STOP && byte + ((pos - 16) >> 3) < srclen + 4);
 
 		dst[p] = '\0';
     *dstlen = p;
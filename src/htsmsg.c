@@ -23,6 +23,7 @@
 #include <stdlib.h>
 #include <stdarg.h>
 #include <string.h>
+#include <stddef.h>
 #include "htsmsg.h"
 #include "misc/dbl.h"
 #include "htsmsg_json.h"
@@ -30,6 +31,260 @@
 static void htsmsg_clear(htsmsg_t *msg);
 static htsmsg_t *
 htsmsg_field_get_msg ( htsmsg_field_t *f, int islist );
+static void htsmsg_copy_i(htsmsg_t *src, htsmsg_t *dst);
+
+/*
+ * Arena
+ *
+ * Chunks are only ever appended, reset keeps the first one around so a
+ * loop deserializing one message per iteration runs without touching
+ * malloc once the tree fits.
+ */
+
+#define HTSMSG_ARENA_CHUNK 16384
+#define HTSMSG_ARENA_ALIGN 8
+
+typedef struct htsmsg_arena_chunk {
+  struct htsmsg_arena_chunk *hac_next;
+  size_t hac_size;
+  size_t hac_used;
+  char hac_data[0] __attribute__((aligned(HTSMSG_ARENA_ALIGN)));
+} htsmsg_arena_chunk_t;
+
+struct htsmsg_arena {
+  htsmsg_arena_chunk_t *ha_chunks;
+};
+
+/* Arena fields are prefixed by their arena (see htsmsg_field_get_msg) */
+typedef struct htsmsg_arena_field {
+  htsmsg_arena_t *haf_arena;
+  htsmsg_field_t haf_field;
+} htsmsg_arena_field_t;
+
+static htsmsg_arena_chunk_t *
+htsmsg_arena_chunk_alloc(size_t size)
+{
+  htsmsg_arena_chunk_t *hac = malloc(sizeof(*hac) + size);
+  if (hac == NULL)
+    abort();
+  hac->hac_next = NULL;
+  hac->hac_size = size;
+  hac->hac_used = 0;
+  return hac;
+}
+
+htsmsg_arena_t *
+htsmsg_arena_create(void)
+{
+  htsmsg_arena_t *ha = malloc(sizeof(*ha));
+  ha->ha_chunks = htsmsg_arena_chunk_alloc(HTSMSG_ARENA_CHUNK);
+  return ha;
+}
+
+void
+htsmsg_arena_reset(htsmsg_arena_t *ha)
+{
+  htsmsg_arena_chunk_t *hac, *next;
+
+  /* the oldest chunk is the last one and always regular sized */
+  for (hac = ha->ha_chunks; hac->hac_next; hac = next) {
+    next = hac->hac_next;
+    free(hac);
+  }
+  hac->hac_used = 0;
+  ha->ha_chunks = hac;
+}
+
+void
+htsmsg_arena_destroy(htsmsg_arena_t *ha)
+{
+  htsmsg_arena_chunk_t *hac;
+
+  if (ha == NULL)
+    return;
+  while ((hac = ha->ha_chunks) != NULL) {
+    ha->ha_chunks = hac->hac_next;
+    free(hac);
+  }
+  free(ha);
+}
+
+static void *
+htsmsg_arena_alloc(htsmsg_arena_t *ha, size_t size)
+{
+  htsmsg_arena_chunk_t *hac = ha->ha_chunks;
+  void *r;
+
+  size = (size + HTSMSG_ARENA_ALIGN - 1) & ~(size_t)(HTSMSG_ARENA_ALIGN - 1);
+  if (hac->hac_size - hac->hac_used < size) {
+    if (size > HTSMSG_ARENA_CHUNK / 4) {
+      /* large blocks get their own chunk behind the current one */
+      hac = htsmsg_arena_chunk_alloc(size);
+      hac->hac_next = ha->ha_chunks->hac_next;
+      ha->ha_chunks->hac_next = hac;
+    } else {
+      hac = htsmsg_arena_chunk_alloc(HTSMSG_ARENA_CHUNK);
+      hac->hac_next = ha->ha_chunks;
+      ha->ha_chunks = hac;
+    }
+  }
+  r = hac->hac_data + hac->hac_used;
+  hac->hac_used += size;
+  return r;
+}
+
+void *
+htsmsg_alloc(htsmsg_t *msg, size_t size)
+{
+  return msg->hm_arena ? htsmsg_arena_alloc(msg->hm_arena, size)
+                       : malloc(size);
+}
+
+static char *
+htsmsg_strdup(htsmsg_t *msg, const char *str)
+{
+  size_t l;
+  char *r;
+
+  if (msg->hm_arena == NULL)
+    return strdup(str);
+  l = strlen(str) + 1;
+  r = htsmsg_arena_alloc(msg->hm_arena, l);
+  memcpy(r, str, l);
+  return r;
+}
+
+htsmsg_field_t *
+htsmsg_field_alloc(htsmsg_t *msg)
+{
+  htsmsg_arena_field_t *haf;
+
+  if (msg->hm_arena == NULL)
+    return malloc(sizeof(htsmsg_field_t));
+  haf = htsmsg_arena_alloc(msg->hm_arena, sizeof(*haf));
+  haf->haf_arena = msg->hm_arena;
+  return &haf->haf_field;
+}
+
+static inline htsmsg_arena_t *
+htsmsg_field_arena(htsmsg_field_t *f)
+{
+  if (!(f->hmf_flags & HMF_ARENA))
+    return NULL;
+  return ((htsmsg_arena_field_t *)
+            ((char *)f - offsetof(htsmsg_arena_field_t, haf_field)))->haf_arena;
+}
+
+/*
+ * Name lookup index
+ *
+ * Maps are searched linearly until a lookup has to walk more than
+ * HTSMSG_INDEX_THRESHOLD fields, then an open addressing hash table of
+ * the first field for each name is built and maintained by the add and
+ * destroy paths. The field queue still defines the order of the fields.
+ */
+
+#define HTSMSG_INDEX_THRESHOLD 32
+
+typedef struct htsmsg_index {
+  uint32_t hi_mask;
+  uint32_t hi_used;     /* live + deleted slots */
+  htsmsg_field_t *hi_slots[0];
+} htsmsg_index_t;
+
+static htsmsg_field_t htsmsg_index_deleted;
+
+static inline uint32_t
+htsmsg_index_hash(const char *s)
+{
+  uint32_t h = 2166136261U;
+  while (*s)
+    h = (h ^ (uint8_t)*s++) * 16777619U;
+  return h;
+}
+
+static htsmsg_field_t **
+htsmsg_index_slot(htsmsg_index_t *hi, const char *name, int insert)
+{
+  htsmsg_field_t **slot, **del = NULL;
+  uint32_t i = htsmsg_index_hash(name);
+
+  for (;; i++) {
+    slot = &hi->hi_slots[i & hi->hi_mask];
+    if (*slot == NULL)
+      return insert ? (del ? del : slot) : NULL;
+    if (*slot == &htsmsg_index_deleted) {
+      if (del == NULL)
+        del = slot;
+    } else if (!strcmp((*slot)->hmf_name, name)) {
+      return slot;
+    }
+  }
+}
+
+static void
+htsmsg_index_build(htsmsg_t *msg)
+{
+  htsmsg_index_t *hi;
+  htsmsg_field_t *f, **slot;
+  uint32_t count = 0, size = 64;
+
+  TAILQ_FOREACH(f, &msg->hm_fields, hmf_link)
+    count++;
+  while (size < count * 2)
+    size <<= 1;
+  hi = htsmsg_alloc(msg, sizeof(*hi) + size * sizeof(htsmsg_field_t *));
+  if (hi == NULL)
+    return;
+  memset(hi, 0, sizeof(*hi) + size * sizeof(htsmsg_field_t *));
+  hi->hi_mask = size - 1;
+  TAILQ_FOREACH(f, &msg->hm_fields, hmf_link) {
+    if (f->hmf_name == NULL)
+      continue;
+    slot = htsmsg_index_slot(hi, f->hmf_name, 1);
+    if (*slot == NULL) {
+      *slot = f;
+      hi->hi_used++;
+    }
+  }
+  if (msg->hm_arena == NULL)
+    free(msg->hm_index);
+  msg->hm_index = hi;
+}
+
+static void
+htsmsg_index_add(htsmsg_t *msg, htsmsg_field_t *f)
+{
+  htsmsg_index_t *hi = msg->hm_index;
+  htsmsg_field_t **slot;
+
+  if (f->hmf_name == NULL)
+    return;
+  slot = htsmsg_index_slot(hi, f->hmf_name, 1);
+  if (*slot != NULL && *slot != &htsmsg_index_deleted)
+    return; /* an earlier field with this name wins */
+  if (*slot == NULL)
+    hi->hi_used++;
+  *slot = f;
+  if (hi->hi_used * 4 > hi->hi_mask * 3)
+    htsmsg_index_build(msg);
+}
+
+static void
+htsmsg_index_remove(htsmsg_t *msg, htsmsg_field_t *f)
+{
+  htsmsg_field_t **slot, *n;
+
+  if (f->hmf_name == NULL)
+    return;
+  slot = htsmsg_index_slot(msg->hm_index, f->hmf_name, 0);
+  if (slot == NULL || *slot != f)
+    return;
+  for (n = TAILQ_NEXT(f, hmf_link); n; n = TAILQ_NEXT(n, hmf_link))
+    if (n->hmf_name != NULL && !strcmp(n->hmf_name, f->hmf_name))
+      break;
+  *slot = n ?: &htsmsg_index_deleted;
+}
 
 /**
  *
@@ -37,8 +292,14 @@ htsmsg_field_get_msg ( htsmsg_field_t *f, int islist );
 void
 htsmsg_field_destroy(htsmsg_t *msg, htsmsg_field_t *f)
 {
+  if(msg->hm_index)
+    htsmsg_index_remove(msg, f);
   TAILQ_REMOVE(&msg->hm_fields, f, hmf_link);
 
+  /* everything below the field lives in the arena */
+  if(f->hmf_flags & HMF_ARENA)
+    return;
+
   switch(f->hmf_type) {
   case HMF_MAP:
   case HMF_LIST:
@@ -70,6 +331,13 @@ htsmsg_clear(htsmsg_t *msg)
 {
   htsmsg_field_t *f;
 
+  if(msg->hm_arena) {
+    TAILQ_INIT(&msg->hm_fields);
+    msg->hm_index = NULL;
+    return;
+  }
+  free(msg->hm_index);
+  msg->hm_index = NULL;
   while((f = TAILQ_FIRST(&msg->hm_fields)) != NULL)
     htsmsg_field_destroy(msg, f);
 }
@@ -82,7 +350,7 @@ htsmsg_clear(htsmsg_t *msg)
 htsmsg_field_t *
 htsmsg_field_add(htsmsg_t *msg, const char *name, int type, int flags)
 {
-  htsmsg_field_t *f = malloc(sizeof(htsmsg_field_t));
+  htsmsg_field_t *f = htsmsg_field_alloc(msg);
   
   TAILQ_INSERT_TAIL(&msg->hm_fields, f, hmf_link);
 
@@ -93,12 +361,14 @@ htsmsg_field_add(htsmsg_t *msg, const char *name, int type, int flags)
   }
 
   if(flags & HMF_NAME_ALLOCED)
-    f->hmf_name = name ? strdup(name) : NULL;
+    f->hmf_name = name ? htsmsg_strdup(msg, name) : NULL;
   else
     f->hmf_name = name;
 
   f->hmf_type = type;
-  f->hmf_flags = flags;
+  f->hmf_flags = flags | (msg->hm_arena ? HMF_ARENA : 0);
+  if(msg->hm_index)
+    htsmsg_index_add(msg, f);
   return f;
 }
 
@@ -109,15 +379,23 @@ htsmsg_field_add(htsmsg_t *msg, const char *name, int type, int flags)
 htsmsg_field_t *
 htsmsg_field_find(htsmsg_t *msg, const char *name)
 {
-  htsmsg_field_t *f;
+  htsmsg_field_t *f, **slot;
+  uint32_t count = 0;
 
   if (msg == NULL || name == NULL)
     return NULL;
+  if (msg->hm_index) {
+    slot = htsmsg_index_slot(msg->hm_index, name, 0);
+    return slot ? *slot : NULL;
+  }
   TAILQ_FOREACH(f, &msg->hm_fields, hmf_link) {
     if(f->hmf_name != NULL && !strcmp(f->hmf_name, name))
-      return f;
+      break;
+    count++;
   }
-  return NULL;
+  if (count > HTSMSG_INDEX_THRESHOLD && !msg->hm_islist)
+    htsmsg_index_build(msg);
+  return f;
 }
 
 
@@ -140,31 +418,55 @@ htsmsg_delete_field(htsmsg_t *msg, const char *name)
 /*
  *
  */
-htsmsg_t *
-htsmsg_create_map(void)
+static htsmsg_t *
+htsmsg_create(htsmsg_arena_t *ha, int islist)
 {
   htsmsg_t *msg;
 
-  msg = malloc(sizeof(htsmsg_t));
+  msg = ha ? htsmsg_arena_alloc(ha, sizeof(htsmsg_t))
+           : malloc(sizeof(htsmsg_t));
   TAILQ_INIT(&msg->hm_fields);
+  msg->hm_index = NULL;
+  msg->hm_arena = ha;
   msg->hm_data = NULL;
-  msg->hm_islist = 0;
+  msg->hm_islist = islist;
   return msg;
 }
 
+/*
+ *
+ */
+htsmsg_t *
+htsmsg_create_map(void)
+{
+  return htsmsg_create(NULL, 0);
+}
+
 /*
  *
  */
 htsmsg_t *
 htsmsg_create_list(void)
 {
-  htsmsg_t *msg;
+  return htsmsg_create(NULL, 1);
+}
 
-  msg = malloc(sizeof(htsmsg_t));
-  TAILQ_INIT(&msg->hm_fields);
-  msg->hm_data = NULL;
-  msg->hm_islist = 1;
-  return msg;
+/*
+ *
+ */
+htsmsg_t *
+htsmsg_create_map_arena(htsmsg_arena_t *ha)
+{
+  return htsmsg_create(ha, 0);
+}
+
+/*
+ *
+ */
+htsmsg_t *
+htsmsg_create_list_arena(htsmsg_arena_t *ha)
+{
+  return htsmsg_create(ha, 1);
 }
 
 
@@ -177,8 +479,10 @@ htsmsg_destroy(htsmsg_t *msg)
   if(msg == NULL)
     return;
 
-  htsmsg_clear(msg);
   free((void *)msg->hm_data);
+  if(msg->hm_arena)
+    return;
+  htsmsg_clear(msg);
   free(msg);
 }
 
@@ -238,7 +542,7 @@ htsmsg_add_str(htsmsg_t *msg, const char *name, const char *str)
 {
   htsmsg_field_t *f = htsmsg_field_add(msg, name, HMF_STR, 
 				        HMF_ALLOCED | HMF_NAME_ALLOCED);
-  f->hmf_str = strdup(str);
+  f->hmf_str = htsmsg_strdup(msg, str);
 }
 
 /*
@@ -253,10 +557,10 @@ htsmsg_set_str(htsmsg_t *msg, const char *name, const char *str)
   else {
     if (f->hmf_type != HMF_STR)
       return 1;
-    if(f->hmf_flags & HMF_ALLOCED)
+    if((f->hmf_flags & (HMF_ALLOCED | HMF_ARENA)) == HMF_ALLOCED)
       free((void *)f->hmf_str);
   }
-  f->hmf_str = strdup(str);
+  f->hmf_str = htsmsg_strdup(msg, str);
   return 0;
 }
 
@@ -269,7 +573,7 @@ htsmsg_add_bin(htsmsg_t *msg, const char *name, const void *bin, size_t len)
   htsmsg_field_t *f = htsmsg_field_add(msg, name, HMF_BIN, 
 				       HMF_ALLOCED | HMF_NAME_ALLOCED);
   void *v;
-  f->hmf_bin = v = malloc(len);
+  f->hmf_bin = v = htsmsg_alloc(msg, len);
   f->hmf_binsize = len;
   memcpy(v, bin, len);
 }
@@ -286,6 +590,29 @@ htsmsg_add_binptr(htsmsg_t *msg, const char *name, const void *bin, size_t len)
 }
 
 
+/*
+ * Move the fields of sub to the message embedded in a field, sub is
+ * released. Trees from another allocator are copied.
+ */
+static void
+htsmsg_take_msg(htsmsg_arena_t *ha, htsmsg_t *dst, htsmsg_t *sub)
+{
+  TAILQ_INIT(&dst->hm_fields);
+  dst->hm_index = NULL;
+  dst->hm_arena = ha;
+  dst->hm_data = NULL;
+  dst->hm_islist = sub->hm_islist;
+  if(sub->hm_arena == ha) {
+    TAILQ_MOVE(&dst->hm_fields, &sub->hm_fields, hmf_link);
+    dst->hm_index = sub->hm_index;
+    if(ha == NULL)
+      free(sub);
+  } else {
+    htsmsg_copy_i(sub, dst);
+    htsmsg_destroy(sub);
+  }
+}
+
 /*
  *
  */
@@ -298,9 +625,7 @@ htsmsg_add_msg(htsmsg_t *msg, const char *name, htsmsg_t *sub)
 		       HMF_NAME_ALLOCED);
 
   assert(sub->hm_data == NULL);
-  f->hmf_msg.hm_islist = sub->hm_islist;
-  TAILQ_MOVE(&f->hmf_msg.hm_fields, &sub->hm_fields, hmf_link);
-  free(sub);
+  htsmsg_take_msg(msg->hm_arena, &f->hmf_msg, sub);
 
   if (f->hmf_type == (f->hmf_msg.hm_islist ? HMF_LIST : HMF_MAP))
     return &f->hmf_msg;
@@ -321,9 +646,7 @@ htsmsg_add_msg_extname(htsmsg_t *msg, const char *name, htsmsg_t *sub)
   f = htsmsg_field_add(msg, name, sub->hm_islist ? HMF_LIST : HMF_MAP, 0);
 
   assert(sub->hm_data == NULL);
-  TAILQ_MOVE(&f->hmf_msg.hm_fields, &sub->hm_fields, hmf_link);
-  f->hmf_msg.hm_islist = sub->hm_islist;
-  free(sub);
+  htsmsg_take_msg(msg->hm_arena, &f->hmf_msg, sub);
 }
 
 
@@ -697,16 +1020,19 @@ htsmsg_field_get_list ( htsmsg_field_t *f )
 static htsmsg_t *
 htsmsg_field_get_msg ( htsmsg_field_t *f, int islist )
 {
+  htsmsg_arena_t *ha;
   htsmsg_t *m;
 
   /* Deserialize JSON (will keep either list or map) */
   if (f->hmf_type == HMF_STR) {
-    if ((m = htsmsg_json_deserialize(f->hmf_str))) {
-      free((void*)f->hmf_str);
-      f->hmf_type          = m->hm_islist ? HMF_LIST : HMF_MAP;
-      f->hmf_msg.hm_islist = m->hm_islist;
-      TAILQ_MOVE(&f->hmf_msg.hm_fields, &m->hm_fields, hmf_link);
-      free(m);
+    ha = htsmsg_field_arena(f);
+    m = ha ? htsmsg_json_deserialize_arena(ha, f->hmf_str)
+           : htsmsg_json_deserialize(f->hmf_str);
+    if (m) {
+      if ((f->hmf_flags & (HMF_ALLOCED | HMF_ARENA)) == HMF_ALLOCED)
+        free((void*)f->hmf_str);
+      f->hmf_type = m->hm_islist ? HMF_LIST : HMF_MAP;
+      htsmsg_take_msg(ha, &f->hmf_msg, m);
     }
   }
 
@@ -724,9 +1050,16 @@ htsmsg_detach_submsg(htsmsg_field_t *f)
 {
   htsmsg_t *r = htsmsg_create_map();
 
-  TAILQ_MOVE(&r->hm_fields, &f->hmf_msg.hm_fields, hmf_link);
-  TAILQ_INIT(&f->hmf_msg.hm_fields);
   r->hm_islist = f->hmf_type == HMF_LIST;
+  if (f->hmf_flags & HMF_ARENA) {
+    /* the caller owns the result, it can't stay in the arena */
+    htsmsg_copy_i(&f->hmf_msg, r);
+  } else {
+    TAILQ_MOVE(&r->hm_fields, &f->hmf_msg.hm_fields, hmf_link);
+    r->hm_index = f->hmf_msg.hm_index;
+  }
+  TAILQ_INIT(&f->hmf_msg.hm_fields);
+  f->hmf_msg.hm_index = NULL;
   return r;
 }
 
@@ -811,8 +1144,7 @@ htsmsg_copy_i(htsmsg_t *src, htsmsg_t *dst)
 
     case HMF_MAP:
     case HMF_LIST:
-      sub = f->hmf_type == HMF_LIST ? 
-	htsmsg_create_list() : htsmsg_create_map();
+      sub = htsmsg_create(dst->hm_arena, f->hmf_type == HMF_LIST);
       htsmsg_copy_i(&f->hmf_msg, sub);
       htsmsg_add_msg(dst, f->hmf_name, sub);
       break;
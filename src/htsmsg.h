@@ -26,12 +26,29 @@
 
 TAILQ_HEAD(htsmsg_field_queue, htsmsg_field);
 
+struct htsmsg_index;
+
+/**
+ * Bump allocator for transient message trees, see htsmsg_arena_create()
+ */
+typedef struct htsmsg_arena htsmsg_arena_t;
+
 typedef struct htsmsg {
   /**
    * fields 
    */
   struct htsmsg_field_queue hm_fields;
 
+  /**
+   * Name lookup index, built on demand for large maps
+   */
+  struct htsmsg_index *hm_index;
+
+  /**
+   * Arena all fields are allocated from, NULL for malloc'd messages
+   */
+  htsmsg_arena_t *hm_arena;
+
   /**
    * Set if this message is a list, otherwise it is a map.
    */
@@ -60,6 +77,7 @@ typedef struct htsmsg_field {
 
 #define HMF_ALLOCED 0x1
 #define HMF_NAME_ALLOCED 0x2
+#define HMF_ARENA 0x4
 
   union {
     int64_t  s64;
@@ -98,6 +116,30 @@ htsmsg_t *htsmsg_create_map(void);
  */
 htsmsg_t *htsmsg_create_list(void);
 
+/**
+ * Arena backed messages
+ *
+ * All fields, names and values of the tree are carved from the arena and
+ * htsmsg_destroy() on such a message only releases hm_data. The memory
+ * is reclaimed in one go by htsmsg_arena_reset() or htsmsg_arena_destroy(),
+ * so no message from the arena may be used after that. Messages added
+ * to a tree with a different allocator are copied, htsmsg_copy() always
+ * returns a malloc'd tree.
+ */
+htsmsg_arena_t *htsmsg_arena_create(void);
+
+void htsmsg_arena_reset(htsmsg_arena_t *ha);
+
+void htsmsg_arena_destroy(htsmsg_arena_t *ha);
+
+htsmsg_t *htsmsg_create_map_arena(htsmsg_arena_t *ha);
+
+htsmsg_t *htsmsg_create_list_arena(htsmsg_arena_t *ha);
+
+void *htsmsg_alloc(htsmsg_t *msg, size_t size);
+
+htsmsg_field_t *htsmsg_field_alloc(htsmsg_t *msg);
+
 /**
  * Remove a given field from a msg
  */
@@ -53,11 +53,11 @@ htsmsg_binary_des0(htsmsg_t *msg, const uint8_t *buf, size_t len)
     if(len < namelen + datalen)
       return -1;
 
-    f = malloc(sizeof(htsmsg_field_t));
+    f = htsmsg_field_alloc(msg);
     f->hmf_type  = type;
 
     if(namelen > 0) {
-      n = malloc(namelen + 1);
+      n = htsmsg_alloc(msg, namelen + 1);
       memcpy(n, buf, namelen);
       n[namelen] = 0;
 
@@ -69,12 +69,14 @@ htsmsg_binary_des0(htsmsg_t *msg, const uint8_t *buf, size_t len)
       n = NULL;
       f->hmf_flags = 0;
     }
+    if(msg->hm_arena)
+      f->hmf_flags |= HMF_ARENA;
 
     f->hmf_name  = n;
 
     switch(type) {
     case HMF_STR:
-      f->hmf_str = n = malloc(datalen + 1);
+      f->hmf_str = n = htsmsg_alloc(msg, datalen + 1);
       memcpy(n, buf, datalen);
       n[datalen] = 0;
       f->hmf_flags |= HMF_ALLOCED;
@@ -96,18 +98,16 @@ htsmsg_binary_des0(htsmsg_t *msg, const uint8_t *buf, size_t len)
     case HMF_LIST:
       sub = &f->hmf_msg;
       TAILQ_INIT(&sub->hm_fields);
+      sub->hm_index = NULL;
+      sub->hm_arena = msg->hm_arena;
       sub->hm_data = NULL;
-      if(htsmsg_binary_des0(sub, buf, datalen) < 0) {
-        free(n);
-        free(f);
-        return -1;
-      }
+      sub->hm_islist = type == HMF_LIST;
+      if(htsmsg_binary_des0(sub, buf, datalen) < 0)
+        goto fail;
       break;
 
     default:
-      free(n);
-      free(f);
-      return -1;
+      goto fail;
     }
 
     TAILQ_INSERT_TAIL(&msg->hm_fields, f, hmf_link);
@@ -115,6 +115,13 @@ htsmsg_binary_des0(htsmsg_t *msg, const uint8_t *buf, size_t len)
     len -= datalen;
   }
   return 0;
+
+fail:
+  if(msg->hm_arena == NULL) {
+    free(n);
+    free(f);
+  }
+  return -1;
 }
 
 
@@ -122,10 +129,10 @@ htsmsg_binary_des0(htsmsg_t *msg, const uint8_t *buf, size_t len)
 /*
  *
  */
-htsmsg_t *
-htsmsg_binary_deserialize(const void *data, size_t len, const void *buf)
+static htsmsg_t *
+htsmsg_binary_deserialize0(htsmsg_t *msg, const void *data, size_t len,
+                           const void *buf)
 {
-  htsmsg_t *msg = htsmsg_create_map();
   msg->hm_data = buf;
 
   if(htsmsg_binary_des0(msg, data, len) < 0) {
@@ -135,6 +142,26 @@ htsmsg_binary_deserialize(const void *data, size_t len, const void *buf)
   return msg;
 }
 
+/*
+ *
+ */
+htsmsg_t *
+htsmsg_binary_deserialize(const void *data, size_t len, const void *buf)
+{
+  return htsmsg_binary_deserialize0(htsmsg_create_map(), data, len, buf);
+}
+
+/*
+ *
+ */
+htsmsg_t *
+htsmsg_binary_deserialize_arena(htsmsg_arena_t *ha, const void *data,
+                                size_t len, const void *buf)
+{
+  return htsmsg_binary_deserialize0(htsmsg_create_map_arena(ha),
+                                    data, len, buf);
+}
+
 
 
 /*
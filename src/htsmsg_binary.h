@@ -27,6 +27,10 @@
 htsmsg_t *htsmsg_binary_deserialize(const void *data, size_t len,
 				    const void *buf);
 
+htsmsg_t *htsmsg_binary_deserialize_arena(htsmsg_arena_t *ha,
+                                          const void *data, size_t len,
+                                          const void *buf);
+
 int htsmsg_binary_serialize(htsmsg_t *msg, void **datap, size_t *lenp,
 			    int maxlen);
 
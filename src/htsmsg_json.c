@@ -126,19 +126,117 @@ htsmsg_json_serialize_to_str(htsmsg_t *msg, int pretty)
 }
 
 
+/**
+ * Streaming writer, the output matches htsmsg_json_serialize()
+ * without the pretty printing
+ */
+void
+htsmsg_json_writer_init(htsmsg_json_writer_t *w, htsbuf_queue_t *hq)
+{
+  w->hq    = hq;
+  w->depth = 0;
+  w->next[0] = 0;
+}
+
+static void
+htsmsg_json_writer_key(htsmsg_json_writer_t *w, const char *name)
+{
+  if (w->next[w->depth])
+    htsbuf_append(w->hq, ",", 1);
+  w->next[w->depth] = 1;
+  if (name) {
+    htsbuf_append_and_escape_jsonstr(w->hq, name);
+    htsbuf_append(w->hq, ": ", 2);
+  }
+}
+
+static void
+htsmsg_json_writer_open(htsmsg_json_writer_t *w, const char *name, char c)
+{
+  htsmsg_json_writer_key(w, name);
+  htsbuf_append(w->hq, &c, 1);
+  assert(w->depth + 1 < HTSMSG_JSON_WRITER_DEPTH);
+  w->next[++w->depth] = 0;
+  w->close[w->depth] = c == '{' ? '}' : ']';
+}
+
+void
+htsmsg_json_writer_map(htsmsg_json_writer_t *w, const char *name)
+{
+  htsmsg_json_writer_open(w, name, '{');
+}
+
+void
+htsmsg_json_writer_list(htsmsg_json_writer_t *w, const char *name)
+{
+  htsmsg_json_writer_open(w, name, '[');
+}
+
+void
+htsmsg_json_writer_end(htsmsg_json_writer_t *w)
+{
+  assert(w->depth > 0);
+  htsbuf_append(w->hq, &w->close[w->depth--], 1);
+}
+
+void
+htsmsg_json_writer_str
+  (htsmsg_json_writer_t *w, const char *name, const char *str)
+{
+  htsmsg_json_writer_key(w, name);
+  htsbuf_append_and_escape_jsonstr(w->hq, str);
+}
+
+void
+htsmsg_json_writer_s64
+  (htsmsg_json_writer_t *w, const char *name, int64_t s64)
+{
+  char buf[24], *p = buf + sizeof(buf);
+  uint64_t u = s64 < 0 ? -(uint64_t)s64 : (uint64_t)s64;
+
+  htsmsg_json_writer_key(w, name);
+  do {
+    *--p = '0' + (u % 10);
+    u /= 10;
+  } while (u);
+  if (s64 < 0)
+    *--p = '-';
+  htsbuf_append(w->hq, p, buf + sizeof(buf) - p);
+}
+
+void
+htsmsg_json_writer_bool
+  (htsmsg_json_writer_t *w, const char *name, int b)
+{
+  htsmsg_json_writer_key(w, name);
+  if (b)
+    htsbuf_append(w->hq, "true", 4);
+  else
+    htsbuf_append(w->hq, "false", 5);
+}
+
+void
+htsmsg_json_writer_msg
+  (htsmsg_json_writer_t *w, const char *name, htsmsg_t *msg)
+{
+  htsmsg_json_writer_key(w, name);
+  htsmsg_json_write(msg, w->hq, msg->hm_islist, 2, 0);
+}
+
+
 /**
  *
  */
 static void *
 create_map(void *opaque)
 {
-  return htsmsg_create_map();
+  return opaque ? htsmsg_create_map_arena(opaque) : htsmsg_create_map();
 }
 
 static void *
 create_list(void *opaque)
 {
-  return htsmsg_create_list();
+  return opaque ? htsmsg_create_list_arena(opaque) : htsmsg_create_list();
 }
 
 static void
@@ -207,3 +305,12 @@ htsmsg_json_deserialize(const char *src)
 {
   return json_deserialize(src, &json_to_htsmsg, NULL, NULL, 0);
 }
+
+/**
+ *
+ */
+htsmsg_t *
+htsmsg_json_deserialize_arena(htsmsg_arena_t *ha, const char *src)
+{
+  return json_deserialize(src, &json_to_htsmsg, ha, NULL, 0);
+}
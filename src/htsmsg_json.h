@@ -27,10 +27,49 @@ struct rstr;
  */
 htsmsg_t *htsmsg_json_deserialize(const char *src);
 
+htsmsg_t *htsmsg_json_deserialize_arena(htsmsg_arena_t *ha, const char *src);
+
 void htsmsg_json_serialize(htsmsg_t *msg, htsbuf_queue_t *hq, int pretty);
 
 char *htsmsg_json_serialize_to_str(htsmsg_t *msg, int pretty);
 
 struct rstr *htsmsg_json_serialize_to_rstr(htsmsg_t *msg, const char *prefix);
 
+/**
+ * Streaming writer, values are appended to the queue directly (no
+ * intermediate htsmsg); name is NULL for the list members
+ */
+#define HTSMSG_JSON_WRITER_DEPTH 16
+
+typedef struct htsmsg_json_writer {
+  htsbuf_queue_t *hq;
+  int             depth;
+  uint8_t         next[HTSMSG_JSON_WRITER_DEPTH];
+  char            close[HTSMSG_JSON_WRITER_DEPTH];
+} htsmsg_json_writer_t;
+
+void htsmsg_json_writer_init(htsmsg_json_writer_t *w, htsbuf_queue_t *hq);
+
+void htsmsg_json_writer_map(htsmsg_json_writer_t *w, const char *name);
+
+void htsmsg_json_writer_list(htsmsg_json_writer_t *w, const char *name);
+
+void htsmsg_json_writer_end(htsmsg_json_writer_t *w);
+
+void htsmsg_json_writer_str
+  (htsmsg_json_writer_t *w, const char *name, const char *str);
+
+void htsmsg_json_writer_s64
+  (htsmsg_json_writer_t *w, const char *name, int64_t s64);
+
+static inline void htsmsg_json_writer_u32
+  (htsmsg_json_writer_t *w, const char *name, uint32_t u32)
+  { htsmsg_json_writer_s64(w, name, u32); }
+
+void htsmsg_json_writer_bool
+  (htsmsg_json_writer_t *w, const char *name, int b);
+
+void htsmsg_json_writer_msg
+  (htsmsg_json_writer_t *w, const char *name, htsmsg_t *msg);
+
 #endif /* HTSMSG_JSON_H_ */
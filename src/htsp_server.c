@@ -2542,7 +2542,8 @@ htsp_authenticate(htsp_connection_t *htsp, htsmsg_t *m)
  * timeout is in ms, 0 means infinite timeout
  */
 static int
-htsp_read_message(htsp_connection_t *htsp, htsmsg_t **mp, int timeout)
+htsp_read_message(htsp_connection_t *htsp, htsmsg_arena_t *arena,
+                  htsmsg_t **mp, int timeout)
 {
   int v;
   uint32_t len;
@@ -2573,7 +2574,7 @@ htsp_read_message(htsp_connection_t *htsp, htsmsg_t **mp, int timeout)
    * NB: If the message can not be deserialized buf will be free'd by the
    * function.
    */
-  *mp = htsmsg_binary_deserialize(buf, len, buf);
+  *mp = htsmsg_binary_deserialize_arena(arena, buf, len, buf);
   if(*mp == NULL)
     return EBADMSG;
 
@@ -2599,6 +2600,7 @@ static int
 htsp_read_loop(htsp_connection_t *htsp)
 {
   htsmsg_t *m = NULL, *reply;
+  htsmsg_arena_t *arena;
   int r, i;
   const char *method;
   void *tcp_id = NULL;;
@@ -2624,13 +2626,17 @@ htsp_read_loop(htsp_connection_t *htsp)
 
   tvhlog(LOG_INFO, "htsp", "Got connection from %s", htsp->htsp_logname);
 
+  /* Requests are transient, they are all carved from one arena */
+  arena = htsmsg_arena_create();
+
   /* Session main loop */
 
   while(tvheadend_running) {
 readmsg:
     reply = NULL;
+    htsmsg_arena_reset(arena);
 
-    if((r = htsp_read_message(htsp, &m, 0)) != 0)
+    if((r = htsp_read_message(htsp, arena, &m, 0)) != 0)
       break;
 
     pthread_mutex_lock(&global_lock);
@@ -2640,6 +2646,7 @@ readmsg:
                                      htsp->htsp_granted_access);
       if (tcp_id == NULL) {
         htsmsg_destroy(m);
+        htsmsg_arena_destroy(arena);
         pthread_mutex_unlock(&global_lock);
         return 1;
       }
@@ -2688,6 +2695,8 @@ readmsg:
     htsmsg_destroy(m);
   }
 
+  htsmsg_arena_destroy(arena);
+
   pthread_mutex_lock(&global_lock);
   tcp_connection_land(tcp_id);
   pthread_mutex_unlock(&global_lock);
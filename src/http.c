@@ -36,6 +36,11 @@
 #include "access.h"
 #include "notify.h"
 #include "channels.h"
+#include "config.h"
+
+#if ENABLE_ZLIB
+#include <zlib.h>
+#endif
 
 void *http_server;
 
@@ -185,6 +190,7 @@ http_rc2str(int code)
   case HTTP_STATUS_OK:              return "OK";
   case HTTP_STATUS_PARTIAL_CONTENT: return "Partial Content";
   case HTTP_STATUS_FOUND:           return "Found";
+  case HTTP_STATUS_NOT_MODIFIED:    return "Not Modified";
   case HTTP_STATUS_BAD_REQUEST:     return "Bad Request";
   case HTTP_STATUS_UNAUTHORIZED:    return "Unauthorized";
   case HTTP_STATUS_NOT_FOUND:       return "Not Found";
@@ -312,6 +318,133 @@ http_send_header(http_connection_t *hc, int rc, const char *content,
 
 
 
+#if ENABLE_ZLIB
+
+/**
+ * Compression of the dynamic replies
+ */
+int http_deflate_level     = 6;
+int http_deflate_threshold = 1024;
+
+void
+http_server_config_changed(void)
+{
+  int level = config_get_int("http_deflate_level", 6);
+
+  http_deflate_level     = MIN(MAX(level, 0), 9);
+  http_deflate_threshold = MAX(config_get_int("http_deflate_threshold", 1024), 0);
+}
+
+/*
+ * Check the Accept-Encoding list for a coding not refused with q=0
+ */
+static int
+http_accept_encoding(http_connection_t *hc, const char *coding)
+{
+  const char *s = http_arg_get(&hc->hc_args, "Accept-Encoding");
+  const char *q;
+  size_t l = strlen(coding);
+
+  while (s && *s) {
+    while (*s == ' ' || *s == ',')
+      s++;
+    if (strncasecmp(s, coding, l) == 0 &&
+        (s[l] == '\0' || s[l] == ',' || s[l] == ';' || s[l] == ' ')) {
+      q = s + l;
+      while (*q == ' ')
+        q++;
+      if (*q != ';')
+        return 1;
+      q++;
+      while (*q == ' ')
+        q++;
+      return !(q[0] == 'q' && q[1] == '=' && atof(q + 2) <= 0);
+    }
+    s = strchr(s, ',');
+  }
+  return 0;
+}
+
+/*
+ * Textual replies are compressed, their headers vary on Accept-Encoding
+ */
+static int
+http_deflate_content(const char *content)
+{
+  if (http_deflate_level <= 0 || content == NULL)
+    return 0;
+  return !strncmp(content, "text/", 5) || strstr(content, "json") ||
+         strstr(content, "javascript") || strstr(content, "xml");
+}
+
+/*
+ * Compress the reply queue, the chunks are deflated one by one
+ */
+static const char *
+http_deflate_reply(http_connection_t *hc, const char *content)
+{
+  htsbuf_queue_t out;
+  htsbuf_data_t *hd;
+  z_stream zstr;
+  const char *encoding;
+  uint8_t *buf;
+  int wbits, r = Z_OK;
+  size_t bufsize;
+
+  if (hc->hc_reply.hq_size < http_deflate_threshold ||
+      hc->hc_reply.hq_size == 0)
+    return NULL;
+
+  if (http_accept_encoding(hc, "gzip")) {
+    encoding = "gzip";
+    wbits = 15 + 16;
+  } else if (http_accept_encoding(hc, "deflate")) {
+    encoding = "deflate";
+    wbits = 15;
+  } else
+    return NULL;
+
+  memset(&zstr, 0, sizeof(zstr));
+  if (deflateInit2(&zstr, http_deflate_level, Z_DEFLATED, wbits, 8,
+                   Z_DEFAULT_STRATEGY) != Z_OK)
+    return NULL;
+
+  htsbuf_queue_init(&out, 0);
+  bufsize = MIN(hc->hc_reply.hq_size / 2 + 64, 64 * 1024);
+  buf = malloc(bufsize);
+  hd = TAILQ_FIRST(&hc->hc_reply.hq_q);
+  do {
+    if (hd) {
+      zstr.next_in  = hd->hd_data + hd->hd_data_off;
+      zstr.avail_in = hd->hd_data_len - hd->hd_data_off;
+      hd = TAILQ_NEXT(hd, hd_link);
+    }
+    do {
+      zstr.next_out  = buf;
+      zstr.avail_out = bufsize;
+      r = deflate(&zstr, hd ? Z_NO_FLUSH : Z_FINISH);
+      if (r == Z_STREAM_ERROR)
+        break;
+      htsbuf_append(&out, buf, bufsize - zstr.avail_out);
+    } while (zstr.avail_out == 0);
+  } while (hd && r != Z_STREAM_ERROR);
+  deflateEnd(&zstr);
+  free(buf);
+
+  if (r != Z_STREAM_END) {
+    htsbuf_queue_flush(&out);
+    return NULL;
+  }
+
+  tvhtrace("http", "%s: %s %u -> %u bytes", hc->hc_url, encoding,
+           hc->hc_reply.hq_size, out.hq_size);
+  htsbuf_queue_flush(&hc->hc_reply);
+  htsbuf_appendq(&hc->hc_reply, &out);
+  return encoding;
+}
+
+#endif
+
 /**
  * Transmit a HTTP reply
  */
@@ -319,8 +452,24 @@ static void
 http_send_reply(http_connection_t *hc, int rc, const char *content, 
 		const char *encoding, const char *location, int maxage)
 {
+  http_arg_list_t args;
+  int vary = 0;
+
+#if ENABLE_ZLIB
+  if (rc == HTTP_STATUS_OK && encoding == NULL &&
+      hc->hc_version != RTSP_VERSION_1_0 && http_deflate_content(content)) {
+    vary = 1;
+    if (!hc->hc_no_output)
+      encoding = http_deflate_reply(hc, content);
+  }
+#endif
+
+  http_arg_init(&args);
+  if (vary)
+    http_arg_set(&args, "Vary", "Accept-Encoding");
   http_send_header(hc, rc, content, hc->hc_reply.hq_size,
-		   encoding, location, maxage, 0, NULL, NULL);
+		   encoding, location, maxage, 0, NULL, &args);
+  http_arg_flush(&args);
   
   if(hc->hc_no_output)
     return;
@@ -1104,6 +1253,9 @@ http_server_init(const char *bindaddr)
 void
 http_server_register(void)
 {
+#if ENABLE_ZLIB
+  http_server_config_changed();
+#endif
   tcp_server_register(http_server);
 }
 
@@ -225,6 +225,11 @@ http_path_t *http_path_add(const char *path, void *opaque,
 			   http_callback_t *callback, uint32_t accessmask);
 
 void http_server_init(const char *bindaddr);
+#if ENABLE_ZLIB
+void http_server_config_changed(void);
+#else
+static inline void http_server_config_changed(void) { }
+#endif
 void http_server_register(void);
 void http_server_done(void);
 
@@ -349,6 +354,8 @@ int http_client_send( http_client_t *hc, http_cmd_t cmd,
 void http_client_basic_auth( http_client_t *hc, http_arg_list_t *h,
                              const char *user, const char *pass );
 int http_client_simple( http_client_t *hc, const url_t *url);
+int http_client_simple_args( http_client_t *hc, const url_t *url,
+                             http_arg_list_t *args );
 int http_client_clear_state( http_client_t *hc );
 int http_client_run( http_client_t *hc );
 void http_client_ssl_peer_verify( http_client_t *hc, int verify );
@@ -1158,10 +1158,24 @@ http_client_redirected ( http_client_t *hc )
 
 int
 http_client_simple( http_client_t *hc, const url_t *url )
+{
+  return http_client_simple_args(hc, url, NULL);
+}
+
+/*
+ * Simple GET with extra header lines
+ */
+int
+http_client_simple_args( http_client_t *hc, const url_t *url,
+                         http_arg_list_t *args )
 {
   http_arg_list_t h;
+  http_arg_t *ra;
 
   http_client_basic_args(hc, &h, url, 0);
+  if (args)
+    TAILQ_FOREACH(ra, args, link)
+      http_arg_set(&h, ra->key, ra->val);
   return http_client_send(hc, HTTP_CMD_GET, url->path, url->query,
                           &h, NULL, 0);
 }
@@ -29,9 +29,58 @@ void huffman_tree_destroy ( huffman_node_t *n )
   huffman_tree_destroy(n->b0);
   huffman_tree_destroy(n->b1);
   if (n->data) free(n->data);
+  if (n->table) {
+    free(n->table->pool);
+    free(n->table);
+  }
   free(n);
 }
 
+/*
+ * Compile the lookup table - decode every HUFFMAN_TABLE_BITS bit value
+ * from the root once
+ */
+static huffman_table_t *huffman_table_build ( huffman_node_t *root )
+{
+  huffman_table_t *t = calloc(1, sizeof(huffman_table_t));
+  huffman_entry_t *e;
+  huffman_node_t *node;
+  size_t used = 0, size = 4096, l;
+  uint32_t v;
+  int i;
+
+  t->pool = malloc(size);
+  for (v = 0; v < (1 << HUFFMAN_TABLE_BITS); v++) {
+    e      = &t->entries[v];
+    e->off = used;
+    node   = root;
+    for (i = HUFFMAN_TABLE_BITS - 1; i >= 0; i--) {
+      node = (v >> i) & 1 ? node->b1 : node->b0;
+      if (!node) {
+        e->end = 1;
+        break;
+      }
+      if (node->data) {
+        l = strlen(node->data);
+        if (used + l > size) {
+          size = 2 * (used + l);
+          t->pool = realloc(t->pool, size);
+        }
+        memcpy(t->pool + used, node->data, l);
+        used   += l;
+        e->len += l;
+        e->bits = HUFFMAN_TABLE_BITS - i;
+        node    = root;
+      }
+    }
+    /* code longer than the table */
+    if (!e->end && e->bits == 0)
+      e->node = node;
+    memcpy(e->out, t->pool + e->off, e->len < 8 ? e->len : 8);
+  }
+  return t;
+}
+
 huffman_node_t *huffman_tree_load ( const char *path )
 {
   htsmsg_t *m;
@@ -70,42 +119,102 @@ huffman_node_t *huffman_tree_build ( htsmsg_t *m )
       node->data = strdup(data);
     }
   }
+  root->table = huffman_table_build(root);
   return root; 
 }
 
+/*
+ * Table driven decode from bit pos, stops before codes longer than the
+ * table, output not fitting outb and the last 32 bits (all left to
+ * huffman_decode_bits)
+ */
+static size_t huffman_decode_table
+  ( const huffman_table_t *t, const uint8_t *data, size_t len, size_t pos,
+    char **outb, int *outl, int *end )
+{
+  const huffman_entry_t *e;
+  size_t total = len * 8, i;
+  uint32_t v;
+
+  while (total - pos > 32) {
+    i = pos >> 3;
+    v = ((uint32_t)data[i] << 24) | (data[i+1] << 16) |
+        (data[i+2] << 8) | data[i+3];
+    e = &t->entries[(v << (pos & 7)) >> (32 - HUFFMAN_TABLE_BITS)];
+    if (e->node || e->len >= *outl)
+      break;
+    if (e->len <= 8 && *outl > 8)
+      memcpy(*outb, e->out, 8); /* fixed size copy */
+    else
+      memcpy(*outb, t->pool + e->off, e->len);
+    *outb += e->len;
+    *outl -= e->len;
+    pos   += e->bits;
+    if (e->end) {
+      *end = 1;
+      break;
+    }
+  }
+  return pos;
+}
+
+/*
+ * Decode one symbol bit by bit, returns 0 if more may follow
+ */
+static int huffman_decode_bits
+  ( huffman_node_t *tree, const uint8_t *data, size_t len, size_t *pos,
+    char **outb, int *outl )
+{
+  huffman_node_t *node = tree;
+  size_t total = len * 8;
+  char *t;
+
+  while (*pos < total) {
+    if (data[*pos >> 3] & (0x80 >> (*pos & 7))) {
+      node = node->b1;
+    } else {
+      node = node->b0;
+    }
+    (*pos)++;
+    if (!node) return -1;
+    if (node->data) {
+      t = node->data;
+      while (*t && *outl) {
+        **outb = *t;
+        (*outb)++; t++; (*outl)--;
+      }
+      return *outl ? 0 : -1;
+    }
+  }
+  return -1;
+}
+
 char *huffman_decode 
   ( huffman_node_t *tree, const uint8_t *data, size_t len, uint8_t mask,
     char *outb, int outl )
 {
-  char           *ret  = outb;
-  huffman_node_t *node = tree;
+  char   *ret = outb;
+  size_t  pos = 0;
+  int     end = 0;
   if (!len) return NULL;
 
+  if (!mask)
+    pos = 8;
+  while (mask && !(mask & 0x80)) {
+    mask <<= 1;
+    pos++;
+  }
+
   outl--; // leave space for NULL
-  while (len) {
-    len--;
-    while (mask) {
-      if (*data & mask) {
-        node = node->b1;
-      } else {
-        node = node->b0;
-      }
-      mask >>= 1;
-      if (!node) goto end;
-      if (node->data) {
-        char *t = node->data;
-        while (*t && outl) {
-          *outb = *t;
-          outb++; t++; outl--;
-        }
-        if (!outl) goto end;
-        node = tree;
-      }
+  if (outl > 0) {
+    while (1) {
+      if (tree->table)
+        pos = huffman_decode_table(tree->table, data, len, pos,
+                                   &outb, &outl, &end);
+      if (end || huffman_decode_bits(tree, data, len, &pos, &outb, &outl))
+        break;
     }
-    mask = 0x80;
-    data++;
   }
-end:
   *outb = '\0';
   return ret;
 }
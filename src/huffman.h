@@ -22,11 +22,34 @@
 #include <sys/types.h>
 #include "htsmsg.h"
 
+#define HUFFMAN_TABLE_BITS 12
+
+/*
+ * Lookup of the next HUFFMAN_TABLE_BITS bits from the root: the symbols
+ * completed within them, or the node reached for longer codes
+ */
+typedef struct huffman_entry
+{
+  struct huffman_node *node;  ///< code continues here (no symbol output)
+  char                 out[8];///< output (first 8 chars)
+  uint32_t             off;   ///< output in huffman_table_t.pool
+  uint16_t             len;
+  uint8_t              bits;  ///< bits consumed
+  uint8_t              end;   ///< invalid code follows the output
+} huffman_entry_t;
+
+typedef struct huffman_table
+{
+  huffman_entry_t  entries[1 << HUFFMAN_TABLE_BITS];
+  char            *pool;
+} huffman_table_t;
+
 typedef struct huffman_node
 {
   struct huffman_node *b0;
   struct huffman_node *b1;
   char                *data;
+  huffman_table_t     *table;  ///< root only
 } huffman_node_t;
 
 void huffman_tree_destroy ( huffman_node_t *tree );
@@ -670,109 +670,158 @@ idnode_cmp_title
 
 #define safecmp(a, b) ((a) > (b) ? 1 : ((a) < (b) ? -1 : 0))
 
-static int
-idnode_cmp_sort
-  ( const void *a, const void *b, void *s )
+/*
+ * Sort keys are extracted once per node (the property is resolved
+ * once per class), so the comparison function does not walk the class
+ * hierarchy nor allocate the display strings for each comparison.
+ */
+typedef struct idnode_sort_key {
+  idnode_t   *in;
+  enum {
+    ISK_NONE,
+    ISK_NUM,
+    ISK_DBL,
+    ISK_STR
+  }           type;
+  union {
+    int64_t     num;
+    double      dbl;
+    const char *str;
+  } u;
+  char       *alloc;
+} idnode_sort_key_t;
+
+static void
+idnode_sort_key_init
+  ( idnode_sort_key_t *k, idnode_t *in, const property_t *p )
 {
-  idnode_t      *ina  = *(idnode_t**)a;
-  idnode_t      *inb  = *(idnode_t**)b;
-  idnode_sort_t *sort = s;
-  const property_t *p = idnode_find_prop(ina, sort->key);
-  if (!p) return 0;
+  const void *ptr;
+
+  k->in    = in;
+  k->type  = ISK_NONE;
+  k->alloc = NULL;
+  if (!p) return;
 
   /* Get display string */
   if (p->islist || (p->list && !(p->opts & PO_SORTKEY))) {
-    int r;
-    char *stra = idnode_get_display(ina, p);
-    char *strb = idnode_get_display(inb, p);
-    if (sort->dir == IS_ASC)
-      r = strcmp(stra ?: "", strb ?: "");
-    else
-      r = strcmp(strb ?: "", stra ?: "");
-    free(stra);
-    free(strb);
-    return r;
+    k->type  = ISK_STR;
+    k->alloc = idnode_get_display(in, p);
+    k->u.str = k->alloc ?: "";
+    return;
   }
 
+  if (p->get)
+    ptr = p->get(in);
+  else
+    ptr = ((void*)in) + p->off;
+
   switch (p->type) {
     case PT_STR:
-      {
-        int r;
-        const char *stra = tvh_strdupa(idnode_get_str(ina, sort->key) ?: "");
-        const char *strb = idnode_get_str(inb, sort->key) ?: "";
-        if (sort->dir == IS_ASC)
-          r = strcmp(stra, strb);
-        else
-          r = strcmp(strb, stra);
-        return r;
-      }
+      k->type  = ISK_STR;
+      /* getters may return a shared static buffer */
+      if (p->get && *(const char **)ptr) {
+        k->alloc = strdup(*(const char **)ptr);
+        k->u.str = k->alloc;
+      } else
+        k->u.str = *(const char **)ptr ?: "";
       break;
     case PT_INT:
-    case PT_U16:
     case PT_BOOL:
-    case PT_PERM:
-      {
-        int32_t i32a = 0, i32b = 0;
-        idnode_get_u32(ina, sort->key, (uint32_t *)&i32a);
-        idnode_get_u32(inb, sort->key, (uint32_t *)&i32b);
-        if (sort->dir == IS_ASC)
-          return safecmp(i32a, i32b);
-        else
-          return safecmp(i32b, i32a);
-      }
+      k->type  = ISK_NUM;
+      k->u.num = *(int *)ptr;
+      break;
+    case PT_U16:
+      k->type  = ISK_NUM;
+      k->u.num = *(uint16_t *)ptr;
       break;
     case PT_U32:
-      {
-        uint32_t u32a = 0, u32b = 0;
-        idnode_get_u32(ina, sort->key, &u32a);
-        idnode_get_u32(inb, sort->key, &u32b);
-        if (sort->dir == IS_ASC)
-          return safecmp(u32a, u32b);
-        else
-          return safecmp(u32b, u32a);
-      }
+      k->type  = ISK_NUM;
+      k->u.num = *(uint32_t *)ptr;
       break;
     case PT_S64:
-      {
-        int64_t s64a = 0, s64b = 0;
-        idnode_get_s64(ina, sort->key, &s64a);
-        idnode_get_s64(inb, sort->key, &s64b);
-        if (sort->dir == IS_ASC)
-          return safecmp(s64a, s64b);
-        else
-          return safecmp(s64b, s64a);
-      }
+      k->type  = ISK_NUM;
+      k->u.num = *(int64_t *)ptr;
+      break;
+    case PT_TIME:
+      k->type  = ISK_NUM;
+      k->u.num = *(time_t *)ptr;
       break;
     case PT_DBL:
-      {
-        double dbla = 0, dblb = 0;
-        idnode_get_dbl(ina, sort->key, &dbla);
-        idnode_get_dbl(inb, sort->key, &dblb);
-        if (sort->dir == IS_ASC)
-          return safecmp(dbla, dblb);
-        else
-          return safecmp(dblb, dbla);
-      }
+      k->type  = ISK_DBL;
+      k->u.dbl = *(double *)ptr;
       break;
-    case PT_TIME:
-      {
-        time_t ta = 0, tb = 0;
-        idnode_get_time(ina, sort->key, &ta);
-        idnode_get_time(inb, sort->key, &tb);
-        if (sort->dir == IS_ASC)
-          return safecmp(ta, tb);
-        else
-          return safecmp(tb, ta);
-      }
+    case PT_PERM:
+      k->type  = ISK_NUM;
+      k->u.num = 0;
       break;
     case PT_LANGSTR:
       // TODO?
     case PT_NONE:
       break;
   }
+}
+
+static int
+idnode_cmp_sort_key
+  ( const idnode_sort_key_t *a, const idnode_sort_key_t *b )
+{
+  if (a->type != b->type)
+    return safecmp(a->type, b->type);
+  switch (a->type) {
+    case ISK_NUM:
+      return safecmp(a->u.num, b->u.num);
+    case ISK_DBL:
+      return safecmp(a->u.dbl, b->u.dbl);
+    case ISK_STR:
+      return strcmp(a->u.str, b->u.str);
+    case ISK_NONE:
+      break;
+  }
   return 0;
 }
 
+static int
+idnode_cmp_sort
+  ( const void *a, const void *b, void *s )
+{
+  idnode_sort_t *sort = s;
+  if (sort->dir == IS_ASC)
+    return idnode_cmp_sort_key(a, b);
+  return idnode_cmp_sort_key(b, a);
+}
+
+/*
+ * Move the smallest (nth + 1) keys to the array head (quickselect)
+ */
+static void
+idnode_sort_select
+  ( idnode_sort_key_t *keys, ssize_t count, ssize_t nth, idnode_sort_t *sort )
+{
+  idnode_sort_key_t pivot, tmp;
+  ssize_t l = 0, r = count - 1, i, j;
+
+  while (l < r) {
+    pivot = keys[l + (r - l) / 2];
+    i = l;
+    j = r;
+    while (i <= j) {
+      while (idnode_cmp_sort(&keys[i], &pivot, sort) < 0) i++;
+      while (idnode_cmp_sort(&keys[j], &pivot, sort) > 0) j--;
+      if (i <= j) {
+        tmp = keys[i];
+        keys[i++] = keys[j];
+        keys[j--] = tmp;
+      }
+    }
+    if (nth <= j)
+      r = j;
+    else if (nth >= i)
+      l = i;
+    else
+      break;
+  }
+}
+
 static void
 idnode_filter_init
   ( idnode_t *in, idnode_filter_t *filter )
@@ -1013,11 +1062,46 @@ idnode_set_remove
   return 0;
 }
 
+void
+idnode_set_sort_partial
+  ( idnode_set_t *is, idnode_sort_t *sort, size_t count )
+{
+  idnode_sort_key_t *keys;
+  const idclass_t *idc = NULL;
+  const property_t *p = NULL;
+  size_t i;
+
+  if (is->is_count < 2 || count == 0)
+    return;
+  if (count > is->is_count)
+    count = is->is_count;
+
+  keys = malloc(is->is_count * sizeof(*keys));
+  for (i = 0; i < is->is_count; i++) {
+    idnode_t *in = is->is_array[i];
+    if (in->in_class != idc) {
+      idc = in->in_class;
+      p   = idnode_find_prop(in, sort->key);
+    }
+    idnode_sort_key_init(&keys[i], in, p);
+  }
+
+  if (count < is->is_count)
+    idnode_sort_select(keys, is->is_count, count - 1, sort);
+  tvh_qsort_r(keys, count, sizeof(*keys), idnode_cmp_sort, (void*)sort);
+
+  for (i = 0; i < is->is_count; i++) {
+    is->is_array[i] = keys[i].in;
+    free(keys[i].alloc);
+  }
+  free(keys);
+}
+
 void
 idnode_set_sort
   ( idnode_set_t *is, idnode_sort_t *sort )
 {
-  tvh_qsort_r(is->is_array, is->is_count, sizeof(idnode_t*), idnode_cmp_sort, (void*)sort);
+  idnode_set_sort_partial(is, sort, is->is_count);
 }
 
 void
@@ -208,6 +208,7 @@ ssize_t idnode_set_find_index( idnode_set_t *is, idnode_t *in );
 static inline int idnode_set_exists ( idnode_set_t *is, idnode_t *in )
   { return idnode_set_find_index(is, in) >= 0; }
 void idnode_set_sort ( idnode_set_t *is, idnode_sort_t *s );
+void idnode_set_sort_partial ( idnode_set_t *is, idnode_sort_t *s, size_t count );
 void idnode_set_sort_by_title ( idnode_set_t *is );
 htsmsg_t *idnode_set_as_htsmsg ( idnode_set_t *is );
 void idnode_set_free ( idnode_set_t *is );
@@ -46,6 +46,10 @@ typedef struct imagecache_image
   const char *url;      ///< Upstream URL
   int         failed;   ///< Last update failed
   time_t      updated;  ///< Last time the file was checked
+  char       *etag;     ///< Upstream ETag (revalidation)
+  char       *modified; ///< Upstream Last-Modified (revalidation)
+  off_t       size;     ///< Size of the cached data
+  time_t      accessed; ///< Last time the data was served
   enum {
     IDLE,
     QUEUED,
@@ -53,6 +57,7 @@ typedef struct imagecache_image
   }           state;    ///< fetch status
 
   TAILQ_ENTRY(imagecache_image) q_link;   ///< Fetch Q link
+  TAILQ_ENTRY(imagecache_image) lru_link; ///< LRU link (cached data only)
   RB_ENTRY(imagecache_image)    id_link;  ///< Index by ID
   RB_ENTRY(imagecache_image)    url_link; ///< Index by URL
 } imagecache_image_t;
@@ -60,6 +65,8 @@ typedef struct imagecache_image
 static int                            imagecache_id;
 static RB_HEAD(,imagecache_image)     imagecache_by_id;
 static RB_HEAD(,imagecache_image)     imagecache_by_url;
+static TAILQ_HEAD(, imagecache_image) imagecache_lru;
+static uint64_t                       imagecache_size;
 SKEL_DECLARE(imagecache_skel, imagecache_image_t);
 
 #if ENABLE_IMAGECACHE
@@ -89,11 +96,21 @@ static const property_t  imagecache_props[] = {
     .name   = "Re-try period of failed images",
     .off    = offsetof(struct imagecache_config, fail_period),
   },
+  {
+    .type   = PT_U32,
+    .id     = "max_size",
+    .name   = "Maximum size (MB)",
+    .off    = offsetof(struct imagecache_config, max_size),
+  },
   {}
 };
 
+#define IMAGECACHE_THREADS      4 ///< Fetch pool size
+#define IMAGECACHE_HOST_FETCHES 2 ///< Parallel fetches from one host
+
 static pthread_cond_t                 imagecache_cond;
 static TAILQ_HEAD(, imagecache_image) imagecache_queue;
+static TAILQ_HEAD(, imagecache_image) imagecache_fetching;
 static gtimer_t                       imagecache_timer;
 #endif
 
@@ -116,11 +133,77 @@ imagecache_image_save ( imagecache_image_t *img )
   htsmsg_add_str(m, "url", img->url);
   if (img->updated)
     htsmsg_add_s64(m, "updated", img->updated);
+  if (img->etag)
+    htsmsg_add_str(m, "etag", img->etag);
+  if (img->modified)
+    htsmsg_add_str(m, "modified", img->modified);
   hts_settings_save(m, "imagecache/meta/%d", img->id);
   htsmsg_destroy(m);
 }
 
+/*
+ * Cached data accounting
+ */
+static void
+imagecache_data_set ( imagecache_image_t *img, off_t size )
+{
+  if (img->size)
+    TAILQ_REMOVE(&imagecache_lru, img, lru_link);
+  imagecache_size -= img->size;
+  img->size = size;
+  imagecache_size += size;
+  if (size)
+    TAILQ_INSERT_TAIL(&imagecache_lru, img, lru_link);
+}
+
 #if ENABLE_IMAGECACHE
+static void
+imagecache_data_remove ( imagecache_image_t *img )
+{
+  imagecache_data_set(img, 0);
+  hts_settings_remove("imagecache/data/%d", img->id);
+  free(img->etag);
+  free(img->modified);
+  img->etag = img->modified = NULL;
+}
+
+/*
+ * Drop the least recently served images over the size limit, they
+ * are fetched again on request
+ */
+static void
+imagecache_evict ( void )
+{
+  imagecache_image_t *img, *next;
+  uint64_t max = (uint64_t)imagecache_conf.max_size * 1024 * 1024;
+
+  if (max == 0)
+    return;
+  for (img = TAILQ_FIRST(&imagecache_lru);
+       img && imagecache_size > max; img = next) {
+    next = TAILQ_NEXT(img, lru_link);
+    if (img->state != IDLE)
+      continue;
+    tvhdebug("imagecache", "evict %s", img->url);
+    imagecache_data_remove(img);
+    imagecache_image_save(img);
+  }
+}
+
+static int
+imagecache_host_cmp ( const char *a, const char *b )
+{
+  size_t la, lb;
+
+  if (!(a = strstr(a, "://")) || !(b = strstr(b, "://")))
+    return 1;
+  a += 3;
+  b += 3;
+  la = strcspn(a, "/?#");
+  lb = strcspn(b, "/?#");
+  return la != lb || strncasecmp(a, b, la);
+}
+
 static void
 imagecache_image_add ( imagecache_image_t *img )
 {
@@ -136,13 +219,17 @@ imagecache_image_add ( imagecache_image_t *img )
 static int
 imagecache_image_fetch ( imagecache_image_t *img )
 {
-  int res = 1, r;
+  int res = 1, r, notmod = 0;
   FILE *fp = NULL;
   url_t url;
   char tmp[256] = "", path[256];
+  char *etag = NULL, *modified = NULL;
+  const char *s;
   tvhpoll_event_t ev;
   tvhpoll_t *efd = NULL;
-  http_client_t *hc;
+  http_client_t *hc = NULL;
+  http_arg_list_t args;
+  struct stat st;
 
   lock_assert(&global_lock);
 
@@ -150,6 +237,16 @@ imagecache_image_fetch ( imagecache_image_t *img )
     return res;
 
   memset(&url, 0, sizeof(url));
+  http_arg_init(&args);
+  TAILQ_INSERT_TAIL(&imagecache_fetching, img, q_link);
+
+  /* Revalidate the cached data */
+  if (img->size) {
+    if (img->etag)
+      http_arg_set(&args, "If-None-Match", img->etag);
+    if (img->modified)
+      http_arg_set(&args, "If-Modified-Since", img->modified);
+  }
 
   /* Open file  */
   if (hts_settings_buildpath(path, sizeof(path), "imagecache/data/%d",
@@ -183,7 +280,7 @@ imagecache_image_fetch ( imagecache_image_t *img )
   efd = tvhpoll_create(1);
   hc->hc_efd = efd;
 
-  r = http_client_simple(hc, &url);
+  r = http_client_simple_args(hc, &url, &args);
   if (r < 0)
     goto error_lock;
 
@@ -199,6 +296,13 @@ imagecache_image_fetch ( imagecache_image_t *img )
     if (r == HTTP_CON_DONE) {
       if (hc->hc_code == HTTP_STATUS_OK && hc->hc_data_size > 0) {
         fwrite(hc->hc_data, hc->hc_data_size, 1, fp);
+        if ((s = http_arg_get(&hc->hc_args, "ETag")) != NULL)
+          etag = strdup(s);
+        if ((s = http_arg_get(&hc->hc_args, "Last-Modified")) != NULL)
+          modified = strdup(s);
+        res = 0;
+      } else if (hc->hc_code == HTTP_STATUS_NOT_MODIFIED) {
+        notmod = 1;
         res = 0;
       }
       break;
@@ -213,28 +317,63 @@ error_lock:
 error:
   if (fp)
     fclose(fp);
+  http_arg_flush(&args);
+  http_client_close(hc);
   urlreset(&url);
   tvhpoll_destroy(efd);
+  TAILQ_REMOVE(&imagecache_fetching, img, q_link);
   img->state = IDLE;
   time(&img->updated); // even if failed (possibly request sooner?)
+  if (tmp[0] && (res || notmod))
+    unlink(tmp);
   if (res) {
     img->failed = 1;
-    if (tmp[0])
-      unlink(tmp);
     tvhwarn("imagecache", "failed to download %s", img->url);
+  } else if (notmod) {
+    img->failed = 0;
+    tvhdebug("imagecache", "not modified %s", img->url);
   } else {
     img->failed = 0;
     unlink(path);
     if (rename(tmp, path))
       tvherror("imagecache", "unable to rename file '%s' to '%s'", tmp, path);
+    free(img->etag);
+    free(img->modified);
+    img->etag     = etag;
+    img->modified = modified;
+    etag = modified = NULL;
+    imagecache_data_set(img, stat(path, &st) ? 0 : st.st_size);
     tvhdebug("imagecache", "downloaded %s", img->url);
+    imagecache_evict();
   }
+  free(etag);
+  free(modified);
   imagecache_image_save(img);
   pthread_cond_broadcast(&imagecache_cond);
 
   return res;
 };
 
+/*
+ * Next queued image, honouring the per host limit
+ */
+static imagecache_image_t *
+imagecache_next ( void )
+{
+  imagecache_image_t *img, *f;
+  int n;
+
+  TAILQ_FOREACH(img, &imagecache_queue, q_link) {
+    n = 0;
+    TAILQ_FOREACH(f, &imagecache_fetching, q_link)
+      if (!imagecache_host_cmp(img->url, f->url))
+        n++;
+    if (n < IMAGECACHE_HOST_FETCHES)
+      return img;
+  }
+  return NULL;
+}
+
 static void *
 imagecache_thread ( void *p )
 {
@@ -250,7 +389,7 @@ imagecache_thread ( void *p )
     }
 
     /* Get entry */
-    if (!(img = TAILQ_FIRST(&imagecache_queue))) {
+    if (!(img = imagecache_next())) {
       pthread_cond_wait(&imagecache_cond, &global_lock);
       continue;
     }
@@ -275,6 +414,7 @@ imagecache_timer_cb ( void *p )
   time(&now);
   RB_FOREACH(img, &imagecache_by_url, url_link) {
     if (img->state != IDLE) continue;
+    if (!img->size && !img->failed) continue; /* evicted, fetched on request */
     when = img->failed ? imagecache_conf.fail_period
                        : imagecache_conf.ok_period;
     when = img->updated + (when * 3600);
@@ -289,31 +429,46 @@ imagecache_timer_cb ( void *p )
  * Initialise
  */
 #if ENABLE_IMAGECACHE
-pthread_t imagecache_tid;
+static pthread_t imagecache_tid[IMAGECACHE_THREADS];
 #endif
 
+static int
+imagecache_accessed_cmp ( const void *a, const void *b )
+{
+  time_t ta = (*(imagecache_image_t **)a)->accessed;
+  time_t tb = (*(imagecache_image_t **)b)->accessed;
+  return ta < tb ? -1 : (ta > tb);
+}
+
 void
 imagecache_init ( void )
 {
   htsmsg_t *m, *e;
   htsmsg_field_t *f;
-  imagecache_image_t *img, *i;
-  const char *url;
+  imagecache_image_t *img, *i, **lru = NULL;
+  const char *url, *s;
   uint32_t id;
+  int n, lru_count = 0, lru_size = 0;
+  struct stat st;
+  char path[PATH_MAX];
 
   /* Init vars */
   imagecache_id             = 0;
+  imagecache_size           = 0;
+  TAILQ_INIT(&imagecache_lru);
 #if ENABLE_IMAGECACHE
   imagecache_conf.enabled        = 0;
   imagecache_conf.ok_period      = 24 * 7; // weekly
   imagecache_conf.fail_period    = 24;     // daily
   imagecache_conf.ignore_sslcert = 0;
+  imagecache_conf.max_size       = 0;      // unlimited
 #endif
 
   /* Create threads */
 #if ENABLE_IMAGECACHE
   pthread_cond_init(&imagecache_cond, NULL);
   TAILQ_INIT(&imagecache_queue);
+  TAILQ_INIT(&imagecache_fetching);
 #endif
 
   /* Load settings */
@@ -344,6 +499,22 @@ imagecache_init ( void )
       assert(!i);
       if (id > imagecache_id)
         imagecache_id = id;
+      if ((s = htsmsg_get_str(e, "etag")) != NULL)
+        img->etag = strdup(s);
+      if ((s = htsmsg_get_str(e, "modified")) != NULL)
+        img->modified = strdup(s);
+      /* Cached data, the modification time is the best guess for LRU */
+      if (strncasecmp(url, "file://", 7) &&
+          !hts_settings_buildpath(path, sizeof(path), "imagecache/data/%d", id) &&
+          !stat(path, &st) && st.st_size > 0) {
+        img->size     = st.st_size;
+        img->accessed = st.st_mtime;
+        if (lru_count >= lru_size) {
+          lru_size = lru_size ? lru_size * 2 : 256;
+          lru = realloc(lru, lru_size * sizeof(*lru));
+        }
+        lru[lru_count++] = img;
+      }
 #if ENABLE_IMAGECACHE
       if (!img->updated)
         imagecache_image_add(img);
@@ -352,9 +523,20 @@ imagecache_init ( void )
     htsmsg_destroy(m);
   }
 
+  /* LRU order */
+  if (lru_count)
+    qsort(lru, lru_count, sizeof(*lru), imagecache_accessed_cmp);
+  for (n = 0; n < lru_count; n++) {
+    TAILQ_INSERT_TAIL(&imagecache_lru, lru[n], lru_link);
+    imagecache_size += lru[n]->size;
+  }
+  free(lru);
+
   /* Start threads */
 #if ENABLE_IMAGECACHE
-  tvhthread_create(&imagecache_tid, NULL, imagecache_thread, NULL);
+  imagecache_evict();
+  for (n = 0; n < IMAGECACHE_THREADS; n++)
+    tvhthread_create(&imagecache_tid[n], NULL, imagecache_thread, NULL);
 
   /* Re-try timer */
   // TODO: this could be more efficient by being targetted, however
@@ -375,9 +557,16 @@ imagecache_destroy ( imagecache_image_t *img, int delconf )
     hts_settings_remove("imagecache/meta/%d", img->id);
     hts_settings_remove("imagecache/data/%d", img->id);
   }
+#if ENABLE_IMAGECACHE
+  if (img->state == QUEUED)
+    TAILQ_REMOVE(&imagecache_queue, img, q_link);
+#endif
+  imagecache_data_set(img, 0);
   RB_REMOVE(&imagecache_by_url, img, url_link);
   RB_REMOVE(&imagecache_by_id, img, id_link);
   free((void *)img->url);
+  free(img->etag);
+  free(img->modified);
   free(img);
 }
 
@@ -388,10 +577,14 @@ void
 imagecache_done ( void )
 {
   imagecache_image_t *img;
-
 #if ENABLE_IMAGECACHE
+  int n;
+
+  pthread_mutex_lock(&global_lock);
   pthread_cond_broadcast(&imagecache_cond);
-  pthread_join(imagecache_tid, NULL);
+  pthread_mutex_unlock(&global_lock);
+  for (n = 0; n < IMAGECACHE_THREADS; n++)
+    pthread_join(imagecache_tid[n], NULL);
 #endif
   while ((img = RB_FIRST(&imagecache_by_id)) != NULL)
     imagecache_destroy(img, 0);
@@ -419,8 +612,10 @@ int
 imagecache_set_config ( htsmsg_t *m )
 {
   int save = prop_write_values(&imagecache_conf, imagecache_props, m, 0, NULL);
-  if (save)
+  if (save) {
     pthread_cond_broadcast(&imagecache_cond);
+    imagecache_evict();
+  }
   return save;
 }
 
@@ -562,7 +757,7 @@ imagecache_open ( uint32_t id )
     struct timespec ts;
 
     /* Use existing */
-    if (i->updated) {
+    if (i->size || (i->updated && i->failed)) {
 
     /* Wait */
     } else if (i->state == FETCHING) {
@@ -573,15 +768,21 @@ imagecache_open ( uint32_t id )
       if (e == ETIMEDOUT)
         return -1;
 
-    /* Attempt to fetch */
-    } else if (i->state == QUEUED) {
+    /* Attempt to fetch (also the evicted ones) */
+    } else {
+      if (i->state == QUEUED)
+        TAILQ_REMOVE(&imagecache_queue, i, q_link);
       i->state = FETCHING;
-      TAILQ_REMOVE(&imagecache_queue, i, q_link);
       e = imagecache_image_fetch(i);
       if (e)
         return -1;
     }
     fd = hts_settings_open_file(0, "imagecache/data/%d", i->id);
+    if (fd >= 0 && i->size) {
+      i->accessed = dispatch_clock;
+      TAILQ_REMOVE(&imagecache_lru, i, lru_link);
+      TAILQ_INSERT_TAIL(&imagecache_lru, i, lru_link);
+    }
   }
 #endif
 
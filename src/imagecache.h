@@ -27,6 +27,7 @@ struct imagecache_config {
   int       ignore_sslcert;
   uint32_t  ok_period;
   uint32_t  fail_period;
+  uint32_t  max_size;     // MB, 0 = unlimited
 };
 
 extern struct imagecache_config imagecache_conf;
@@ -85,6 +85,10 @@ tvh_input_instance_clear_stats ( tvh_input_instance_t *tii )
   atomic_exchange(&s->te, 0);
   atomic_exchange(&s->ec_block, 0);
   atomic_exchange(&s->tc_block, 0);
+  atomic_exchange(&s->loss, 0);
+  atomic_exchange(&s->reorder, 0);
+  atomic_exchange(&s->dup, 0);
+  atomic_exchange(&s->fec, 0);
 }
 
 /*
@@ -116,6 +120,10 @@ tvh_input_stream_create_msg
   htsmsg_add_u32(m, "tc_bit", st->stats.tc_bit);
   htsmsg_add_u32(m, "ec_block", st->stats.ec_block);
   htsmsg_add_u32(m, "tc_block", st->stats.tc_block);
+  htsmsg_add_u32(m, "rtp_loss", st->stats.loss);
+  htsmsg_add_u32(m, "rtp_reorder", st->stats.reorder);
+  htsmsg_add_u32(m, "rtp_dup", st->stats.dup);
+  htsmsg_add_u32(m, "rtp_fec", st->stats.fec);
   return m;
 }
 
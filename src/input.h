@@ -62,6 +62,12 @@ struct tvh_input_stream_stats
   /* Note: PER = ec_block / tc_block (0...1) */
   int ec_block;  ///< ERROR_BLOCK_COUNT
   int tc_block;  ///< TOTAL_BLOCK_COUNT
+
+  /* RTP (IPTV) */
+  int loss;      ///< datagrams missing in the sequence
+  int reorder;   ///< datagrams received out of order
+  int dup;       ///< duplicate datagrams
+  int fec;       ///< datagrams recovered by FEC
 };
 
 struct tvh_input_stream {
@@ -150,6 +156,7 @@ void tvh_input_instance_clear_stats ( tvh_input_instance_t *tii );
 #include "input/mpegts.h"
 #include "input/mpegts/mpegts_mux_sched.h"
 #include "input/mpegts/mpegts_network_scan.h"
+#include "input/mpegts/mpegts_warm.h"
 #if ENABLE_MPEGTS_DVB
 #include "input/mpegts/mpegts_dvb.h"
 #endif
@@ -21,7 +21,8 @@
 
 void
 mpegts_init ( int linuxdvb_mask, str_list_t *satip_client,
-              str_list_t *tsfiles, int tstuners )
+              str_list_t *tsfiles, int tstuners, const char *tsspeed,
+              int tsloops, int iptv_threads )
 {
   /* Register classes (avoid API 400 errors due to not yet defined) */
   idclass_register(&mpegts_network_class);
@@ -45,7 +46,7 @@ mpegts_init ( int linuxdvb_mask, str_list_t *satip_client,
 #if ENABLE_TSFILE
   if(tsfiles->num) {
     int i;
-    tsfile_init(tstuners ?: tsfiles->num);
+    tsfile_init(tstuners ?: tsfiles->num, tsspeed, tsloops);
     for (i = 0; i < tsfiles->num; i++)
       tsfile_add_file(tsfiles->str[i]);
   }
@@ -53,7 +54,7 @@ mpegts_init ( int linuxdvb_mask, str_list_t *satip_client,
 
   /* IPTV */
 #if ENABLE_IPTV
-  iptv_init();
+  iptv_init(iptv_threads);
 #endif
 
   /* Linux DVB */
@@ -74,6 +75,7 @@ mpegts_init ( int linuxdvb_mask, str_list_t *satip_client,
   /* Mux schedulers */
 #if ENABLE_MPEGTS
   mpegts_mux_sched_init();
+  mpegts_warm_init();
 #endif
 
 }
@@ -81,6 +83,7 @@ mpegts_init ( int linuxdvb_mask, str_list_t *satip_client,
 void
 mpegts_done ( void )
 {
+  tvhftrace("main", mpegts_warm_done);
   tvhftrace("main", mpegts_network_scan_done);
   tvhftrace("main", mpegts_mux_sched_done);
 #if ENABLE_MPEGTS_DVB
@@ -71,7 +71,8 @@ extern const idclass_t mpegts_input_class;
  * *************************************************************************/
 
 void mpegts_init ( int linuxdvb_mask, str_list_t *satip_client,
-                   str_list_t *tsfiles, int tstuners );
+                   str_list_t *tsfiles, int tstuners, const char *tsspeed,
+                   int tsloops, int iptv_threads );
 void mpegts_done ( void );
 
 /* **************************************************************************
@@ -303,6 +304,10 @@ struct mpegts_network
   mpegts_mux_queue_t mn_scan_pend;    // Pending muxes
   mpegts_mux_queue_t mn_scan_active;  // Active muxes
   gtimer_t           mn_scan_timer;   // Timer for activity
+  int64_t            mn_scan_start;   // Start of the current scan run
+  int                mn_scan_ok;      // Muxes scanned in this run
+  int                mn_scan_fail;    // Muxes failed in this run
+  int                mn_scan_rate;    // Muxes per minute (last run)
 
   /*
    * Functions
@@ -408,6 +413,10 @@ struct mpegts_mux
   gtimer_t                 mm_scan_timeout; ///< Timer to handle timeout
   TAILQ_ENTRY(mpegts_mux)  mm_scan_link;    ///< Link to Queue
   mpegts_mux_scan_state_t  mm_scan_state;   ///< Scanning state
+  int64_t                  mm_scan_start;   ///< Scan start (monotonic)
+  int                      mm_scan_time;    ///< Expected scan time (ms)
+  int64_t                  mm_tune_start;   ///< Tuning start (monotonic)
+  int                      mm_psi_time;     ///< Tables acquired after (ms)
 
 #if 0
   enum {
@@ -626,6 +635,7 @@ struct mpegts_input
 
   int mi_initscan;
   int mi_idlescan;
+  int mi_prewarm;
 
   char *mi_linked;
 
@@ -654,6 +664,7 @@ struct mpegts_input
   pthread_mutex_t                 mi_input_lock;
   pthread_cond_t                  mi_input_cond;
   TAILQ_HEAD(,mpegts_packet)      mi_input_queue;
+  size_t                          mi_input_queue_size; /* bytes */
 
   /* Data processing/output */
   // Note: this lock (mi_output_lock) protects all the remaining
@@ -850,6 +861,12 @@ void mpegts_mux_unsubscribe_by_name(mpegts_mux_t *mm, const char *name);
 void mpegts_mux_unsubscribe_linked(mpegts_input_t *mi);
 
 void mpegts_mux_scan_done ( mpegts_mux_t *mm, const char *buf, int res );
+void mpegts_mux_scan_quick ( mpegts_mux_t *mm );
+void mpegts_mux_psi_acquired ( mpegts_mux_t *mm, const char *buf );
+int mpegts_mux_inputs_busy
+  ( mpegts_mux_t *mm, int flags, mpegts_input_t **busy, int nbusy );
+int mpegts_mux_inputs_add_busy
+  ( mpegts_mux_t *mm, mpegts_input_t **busy, int nbusy, int max );
 
 void mpegts_mux_bouquet_rescan ( const char *src, const char *extra );
 
@@ -877,6 +894,10 @@ void mpegts_input_recv_packets
   (mpegts_input_t *mi, mpegts_mux_instance_t *mmi, sbuf_t *sb,
    int64_t *pcr, uint16_t *pcr_pid);
 
+void mpegts_input_recv_batch
+  (mpegts_input_t *mi, mpegts_mux_instance_t *mmi, mpegts_packet_t **mpp,
+   sbuf_t *sb);
+
 int mpegts_input_get_weight ( mpegts_input_t *mi, mpegts_mux_t *mm, int flags );
 int mpegts_input_get_priority ( mpegts_input_t *mi, mpegts_mux_t *mm, int flags );
 int mpegts_input_get_grace ( mpegts_input_t *mi, mpegts_mux_t *mm );
@@ -174,6 +174,10 @@ int dvb_get_string_with_len
   (char *dst, size_t dstlen, const uint8_t *buf, size_t buflen,
    const char *dvb_charset, dvb_string_conv_t *conv);
 
+int dvb_get_name_with_len
+  (char *dst, size_t dstlen, const uint8_t *buf, size_t buflen,
+   const char *dvb_charset);
+
 /* Conversion */
 
 #define bcdtoint(i) ((((i & 0xf0) >> 4) * 10) + (i & 0x0f))
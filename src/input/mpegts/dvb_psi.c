@@ -386,11 +386,11 @@ dvb_desc_service
   *stype = *ptr++;
 
   /* Provider */
-  if ((r = dvb_get_string_with_len(sprov, sprov_len, ptr, len, charset, NULL)) < 0)
+  if ((r = dvb_get_name_with_len(sprov, sprov_len, ptr, len, charset)) < 0)
     return -1;
 
   /* Name */
-  if (dvb_get_string_with_len(sname, sname_len, ptr+r, len-r, charset, NULL) < 0)
+  if (dvb_get_name_with_len(sname, sname_len, ptr+r, len-r, charset) < 0)
     return -1;
 
   /* Cleanup name */
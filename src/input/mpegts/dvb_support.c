@@ -31,6 +31,7 @@
 #include "dvb_charset_tables.h"
 #include "input.h"
 #include "intlconv.h"
+#include "tvh_endian.h"
 #include "settings.h"
 
 static int convert_iso_8859[16] = {
@@ -99,14 +100,88 @@ static inline size_t conv_UCS2(const uint8_t *src, size_t srclen,char *dst, size
   return 0;
 }
 
+/*
+ * UTF-8 sequences for the upper half of the single byte code pages
+ * (length in the first byte, zero for ignored / unmapped codes)
+ */
+static uint8_t conv_8859_utf8[14][128][4];
+static uint8_t conv_6937_utf8[128][4];
+
+static void conv_utf8_table(uint8_t (*dst)[4], const uint16_t *table)
+{
+  int c, len;
+
+  /* codes 0x80 - 0x9f (control codes) are ignored */
+  for (c = 0xa0; c <= 0xff; c++) {
+    if (table[c-0xa0] == 0)
+      continue;
+    len = encode_utf8(table[c-0xa0], (char *)dst[c-0x80] + 1, 3);
+    dst[c-0x80][0] = len > 0 ? len : 0;
+  }
+}
+
+static void conv_init(void)
+{
+  int i;
+
+  for (i = 0; i < ARRAY_SIZE(conv_8859_utf8); i++)
+    conv_utf8_table(conv_8859_utf8[i], conv_8859_table[i]);
+  conv_utf8_table(conv_6937_utf8, iso6937_single_byte);
+}
+
+/*
+ * Copy the 7-bit characters (identical in utf-8) up to the first 8-bit
+ * one from the next eight, returns the count (zero if there is no room)
+ */
+static inline int conv_ascii8(const uint8_t **src, size_t *srclen,
+                              char **dst, size_t *dstlen)
+{
+  uint64_t w, m;
+  int len;
+
+  if (*srclen < 8 || *dstlen < 8)
+    return 0;
+  memcpy(&w, *src, 8);
+  memcpy(*dst, &w, 8);
+  m = w & 0x8080808080808080ULL;
+  if (m == 0)
+    len = 8;
+#if BYTE_ORDER == LITTLE_ENDIAN
+  else
+    len = __builtin_ctzll(m) >> 3;
+#else
+  else
+    len = __builtin_clzll(m) >> 3;
+#endif
+  *src += len; *srclen -= len;
+  *dst += len; *dstlen -= len;
+  return len;
+}
+
+static inline int conv_put(const uint8_t *utf8, char **dst, size_t *dstlen)
+{
+  size_t len = utf8[0];
+
+  if (*dstlen >= 3) {
+    memcpy(*dst, utf8 + 1, 3);
+  } else if (len > *dstlen) {
+    errno = E2BIG;
+    return -1;
+  } else {
+    memcpy(*dst, utf8 + 1, len);
+  }
+  *dst += len;
+  *dstlen -= len;
+  return 0;
+}
+
 static inline size_t conv_utf8(const uint8_t *src, size_t srclen,
                                char *dst, size_t *dstlen)
 {
-  while (srclen>0 && (*dstlen)>0) {
-    *dst = (char) *src;
-    srclen--; (*dstlen)--;
-    src++; dst++;
-  }
+  size_t len = MIN(srclen, *dstlen);
+
+  memcpy(dst, src, len);
+  srclen -= len; (*dstlen) -= len;
   if (srclen>0) {
     errno = E2BIG;
     return -1;
@@ -118,31 +193,22 @@ static inline size_t conv_8859(int conv,
                               const uint8_t *src, size_t srclen,
                               char *dst, size_t *dstlen)
 {
-  uint16_t *table = conv_8859_table[conv];
+  uint8_t (*table)[4] = conv_8859_utf8[conv];
 
   while (srclen>0 && (*dstlen)>0) {
+    if (conv_ascii8(&src, &srclen, &dst, dstlen) == 8)
+      continue;
     uint8_t c = *src;
     if (c <= 0x7f) {
       // lower half of iso-8859-* is identical to utf-8
       *dst = (char) *src;
       (*dstlen)--;
       dst++;
-    } else if (c <= 0x9f) {
-      // codes 0x80 - 0x9f (control codes) are ignored
     } else {
-      // map according to character table, skipping
-      // unmapped chars (value 0 in the table)
-      uint16_t uc = table[c-0xa0];
-      if (uc != 0) {
-        int len = encode_utf8(uc, dst, *dstlen);
-        if (len == -1) {
-          errno = E2BIG;
-          return -1;
-        } else {
-          (*dstlen) -= len;
-          dst += len;
-        }
-      }
+      // map according to character table, skipping control
+      // codes and unmapped chars
+      if (conv_put(table[c-0x80], &dst, dstlen))
+        return -1;
     }
     srclen--;
     src++;
@@ -158,38 +224,37 @@ static inline size_t conv_6937(const uint8_t *src, size_t srclen,
                               char *dst, size_t *dstlen)
 {
   while (srclen>0 && (*dstlen)>0) {
+    if (conv_ascii8(&src, &srclen, &dst, dstlen) == 8)
+      continue;
     uint8_t c = *src;
     if (c <= 0x7f) {
       // lower half of iso6937 is identical to utf-8
       *dst = (char) *src;
       (*dstlen)--;
       dst++;
-    } else if (c <= 0x9f) {
-      // codes 0x80 - 0x9f (control codes) are ignored
+    } else if (c < 0xc0 || c > 0xcf) {
+      // map according to single character table, skipping
+      // control codes and unmapped chars
+      if (conv_put(conv_6937_utf8[c-0x80], &dst, dstlen))
+        return -1;
     } else {
+      // map two-byte sequence, skipping illegal combinations.
       uint16_t uc;
-      if (c >= 0xc0 && c <= 0xcf) {
-        // map two-byte sequence, skipping illegal combinations.
-        if (srclen<2) {
-          errno = EINVAL;
-          return -1;
-        }
-        srclen--;
-        src++;
-        uint8_t c2 = *src;
-        if (c2 == 0x20) {
-          uc = iso6937_lone_accents[c-0xc0];
-        } else if (c2 >= 0x41 && c2 <= 0x5a) {
-          uc = iso6937_multi_byte[c-0xc0][c2-0x41];
-        } else if (c2 >= 0x61 && c2 <= 0x7a) {
-          uc = iso6937_multi_byte[c-0xc0][c2-0x61+26];
-        } else {
-          uc = 0;
-        }
+      if (srclen<2) {
+        errno = EINVAL;
+        return -1;
+      }
+      srclen--;
+      src++;
+      uint8_t c2 = *src;
+      if (c2 == 0x20) {
+        uc = iso6937_lone_accents[c-0xc0];
+      } else if (c2 >= 0x41 && c2 <= 0x5a) {
+        uc = iso6937_multi_byte[c-0xc0][c2-0x41];
+      } else if (c2 >= 0x61 && c2 <= 0x7a) {
+        uc = iso6937_multi_byte[c-0xc0][c2-0x61+26];
       } else {
-        // map according to single character table, skipping
-        // unmapped chars (value 0 in the table)
-        uc = iso6937_single_byte[c-0xa0];
+        uc = 0;
       }
       if (uc != 0) {
         int len = encode_utf8(uc, dst, *dstlen);
@@ -371,6 +436,70 @@ dvb_get_string_with_len(char *dst, size_t dstlen,
   return l + 1;
 }
 
+/*
+ * Service and provider names come around with every SDT, keep the
+ * recent conversions
+ */
+#define DVB_NAME_CACHE_SIZE 256  /* power of 2 */
+
+typedef struct dvb_name_cache {
+  uint8_t raw[64];     /* length byte + string */
+  char    charset[16];
+  char    out[128];
+} dvb_name_cache_t;
+
+static dvb_name_cache_t dvb_name_cache[DVB_NAME_CACHE_SIZE];
+static pthread_mutex_t  dvb_name_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+int
+dvb_get_name_with_len(char *dst, size_t dstlen,
+                      const uint8_t *buf, size_t buflen, const char *dvb_charset)
+{
+  dvb_name_cache_t *c;
+  uint32_t h = 2166136261u;
+  int i, l = buf[0];
+
+  if(l + 1 > buflen)
+    return -1;
+
+  if (dvb_charset == NULL)
+    dvb_charset = "";
+  /* NUL bytes may end up inside the output, strlen() would not tell
+     the space the conversion needs */
+  if (l + 1 > sizeof(c->raw) || strlen(dvb_charset) >= sizeof(c->charset) ||
+      memchr(buf + 1, 0, l))
+    return dvb_get_string_with_len(dst, dstlen, buf, buflen, dvb_charset, NULL);
+
+  for (i = 0; i <= l; i++)
+    h = (h ^ buf[i]) * 16777619u;
+  for (i = 0; dvb_charset[i]; i++)
+    h = (h ^ (uint8_t)dvb_charset[i]) * 16777619u;
+  c = &dvb_name_cache[h & (DVB_NAME_CACHE_SIZE - 1)];
+
+  pthread_mutex_lock(&dvb_name_cache_lock);
+  /* an output filling dst exactly may fail to convert (E2BIG on the
+     ignored characters after it), leave that to the conversion */
+  if (!memcmp(c->raw, buf, l + 1) && !strcmp(c->charset, dvb_charset) &&
+      strlen(c->out) + 1 < dstlen) {
+    strcpy(dst, c->out);
+    pthread_mutex_unlock(&dvb_name_cache_lock);
+    return l + 1;
+  }
+  pthread_mutex_unlock(&dvb_name_cache_lock);
+
+  if (dvb_get_string(dst, dstlen, buf + 1, l, dvb_charset, NULL))
+    return -1;
+
+  if (strlen(dst) < sizeof(c->out)) {
+    pthread_mutex_lock(&dvb_name_cache_lock);
+    memcpy(c->raw, buf, l + 1);
+    strcpy(c->charset, dvb_charset);
+    strcpy(c->out, dst);
+    pthread_mutex_unlock(&dvb_name_cache_lock);
+  }
+  return l + 1;
+}
+
 
 /**
  *
@@ -926,6 +1055,7 @@ dvb_sat_position_from_str( const char *buf )
  */
 void dvb_init( void )
 {
+  conv_init();
 #if ENABLE_MPEGTS_DVB
   satellites = hts_settings_load("satellites");
 #endif
@@ -39,10 +39,8 @@
  * IPTV state
  * *************************************************************************/
 
-iptv_input_t   *iptv_input;
-tvhpoll_t      *iptv_poll;
-pthread_t       iptv_thread;
-pthread_mutex_t iptv_lock;
+iptv_input_t   *iptv_inputs[IPTV_INPUTS_MAX];
+int             iptv_input_count;
 
 /* **************************************************************************
  * IPTV handlers
@@ -86,7 +84,12 @@ iptv_handler_find ( const char *scheme )
 static const char *
 iptv_input_class_get_title ( idnode_t *self )
 {
-  return "IPTV";
+  static char buf[32];
+  iptv_input_t *ii = (iptv_input_t *)self;
+  if (iptv_input_count < 2)
+    return "IPTV";
+  snprintf(buf, sizeof(buf), "IPTV #%d", ii->ii_index + 1);
+  return buf;
 }
 extern const idclass_t mpegts_input_class;
 const idclass_t iptv_input_class = {
@@ -95,20 +98,70 @@ const idclass_t iptv_input_class = {
   .ic_caption    = "IPTV Input",
   .ic_get_title  = iptv_input_class_get_title,
   .ic_properties = (const property_t[]){
+    {
+      .type     = PT_INT,
+      .id       = "muxes",
+      .name     = "Active Muxes",
+      .off      = offsetof(iptv_input_t, ii_muxes),
+      .opts     = PO_RDONLY | PO_NOSAVE,
+    },
+    {
+      .type     = PT_U32,
+      .id       = "pps",
+      .name     = "Packets/s",
+      .off      = offsetof(iptv_input_t, ii_pps),
+      .opts     = PO_RDONLY | PO_NOSAVE,
+    },
+    {
+      .type     = PT_U32,
+      .id       = "drops",
+      .name     = "Socket Drops",
+      .off      = offsetof(iptv_input_t, ii_drops_total),
+      .opts     = PO_RDONLY | PO_NOSAVE,
+    },
     {}
   }
 };
 
+/*
+ * The shard a mux runs on, or the least loaded one to start it on
+ */
+static iptv_input_t *
+iptv_input_pick ( mpegts_mux_t *mm )
+{
+  iptv_input_t *ii, *r = iptv_inputs[0];
+  int i;
+
+  if (mm->mm_active)
+    return (iptv_input_t *)mm->mm_active->mmi_input;
+  for (i = 1; i < iptv_input_count; i++) {
+    ii = iptv_inputs[i];
+    if (ii->ii_muxes < r->ii_muxes)
+      r = ii;
+  }
+  return r;
+}
+
+static int
+iptv_input_is_enabled ( mpegts_input_t *mi, mpegts_mux_t *mm, int flags )
+{
+  if (!mpegts_input_is_enabled(mi, mm, flags))
+    return 0;
+  /* only one shard offers the mux, the scheduler sees a single input */
+  return iptv_input_pick(mm) == (iptv_input_t *)mi;
+}
+
 static int
 iptv_input_is_free ( mpegts_input_t *mi, mpegts_mux_t *mm )
 {
-  int c = 0;
+  int c = 0, i;
   mpegts_mux_instance_t *mmi;
   iptv_network_t *in = (iptv_network_t *)mm->mm_network;
   
-  LIST_FOREACH(mmi, &mi->mi_mux_active, mmi_active_link)
-    if (mmi->mmi_mux->mm_network == (mpegts_network_t *)in)
-      c++;
+  for (i = 0; i < iptv_input_count; i++)
+    LIST_FOREACH(mmi, &iptv_inputs[i]->mi_mux_active, mmi_active_link)
+      if (mmi->mmi_mux->mm_network == (mpegts_network_t *)in)
+        c++;
   
   /* Limit reached */
   if (in->in_max_streams && c >= in->in_max_streams)
@@ -124,22 +177,26 @@ iptv_input_is_free ( mpegts_input_t *mi, mpegts_mux_t *mm )
 static int
 iptv_input_get_weight ( mpegts_input_t *mi, mpegts_mux_t *mm, int flags )
 {
-  int w = 0;
+  int w = 0, i;
   const th_subscription_t *ths;
   const service_t *s;
   mpegts_mux_instance_t *mmi;
+  mpegts_input_t *mi2;
 
   /* Find the "min" weight */
   if (!iptv_input_is_free(mi, mm)) {
     w = 1000000;
 
     /* Service subs */
-    pthread_mutex_lock(&mi->mi_output_lock);
-    LIST_FOREACH(mmi, &mi->mi_mux_active, mmi_active_link)
-      LIST_FOREACH(s, &mmi->mmi_mux->mm_transports, s_active_link)
-        LIST_FOREACH(ths, &s->s_subscriptions, ths_service_link)
-          w = MIN(w, ths->ths_weight);
-    pthread_mutex_unlock(&mi->mi_output_lock);
+    for (i = 0; i < iptv_input_count; i++) {
+      mi2 = (mpegts_input_t *)iptv_inputs[i];
+      pthread_mutex_lock(&mi2->mi_output_lock);
+      LIST_FOREACH(mmi, &mi2->mi_mux_active, mmi_active_link)
+        LIST_FOREACH(s, &mmi->mmi_mux->mm_transports, s_active_link)
+          LIST_FOREACH(ths, &s->s_subscriptions, ths_service_link)
+            w = MIN(w, ths->ths_weight);
+      pthread_mutex_unlock(&mi2->mi_output_lock);
+    }
   }
 
   return w;
@@ -179,17 +236,21 @@ iptv_input_warm_mux ( mpegts_input_t *mi, mpegts_mux_instance_t *mmi )
 
   /* Do we need to stop something? */
   if (!iptv_input_is_free(mi, mmi->mmi_mux)) {
-    pthread_mutex_lock(&mi->mi_output_lock);
     mpegts_mux_instance_t *m, *s = NULL;
-    int w = 1000000;
-    LIST_FOREACH(m, &mi->mi_mux_active, mmi_active_link) {
-      int t = mpegts_mux_instance_weight(m);
-      if (t < w) {
-        s = m;
-        w = t;
+    mpegts_input_t *mi2;
+    int i, w = 1000000;
+    for (i = 0; i < iptv_input_count; i++) {
+      mi2 = (mpegts_input_t *)iptv_inputs[i];
+      pthread_mutex_lock(&mi2->mi_output_lock);
+      LIST_FOREACH(m, &mi2->mi_mux_active, mmi_active_link) {
+        int t = mpegts_mux_instance_weight(m);
+        if (t < w) {
+          s = m;
+          w = t;
+        }
       }
+      pthread_mutex_unlock(&mi2->mi_output_lock);
     }
-    pthread_mutex_unlock(&mi->mi_output_lock);
   
     /* Stop */
     if (s)
@@ -202,6 +263,7 @@ static int
 iptv_input_start_mux ( mpegts_input_t *mi, mpegts_mux_instance_t *mmi )
 {
   int ret = SM_CODE_TUNING_FAILED;
+  iptv_input_t *ii = (iptv_input_t*)mi;
   iptv_mux_t *im = (iptv_mux_t*)mmi->mmi_mux;
   iptv_handler_t *ih;
   char buf[256];
@@ -238,15 +300,18 @@ iptv_input_start_mux ( mpegts_input_t *mi, mpegts_mux_instance_t *mmi )
   }
 
   /* Start */
-  pthread_mutex_lock(&iptv_lock);
+  pthread_mutex_lock(&ii->ii_lock);
+  im->mm_iptv_input = ii;
+  im->mm_iptv_rxq_drops = 0;
   im->mm_active = mmi; // Note: must set here else mux_started call
                        // will not realise we're ready to accept pid open calls
   ret            = ih->start(im, im->mm_iptv_url, &url);
-  if (!ret)
+  if (!ret) {
     im->im_handler = ih;
-  else
+    ii->ii_muxes++;
+  } else
     im->mm_active  = NULL;
-  pthread_mutex_unlock(&iptv_lock);
+  pthread_mutex_unlock(&ii->ii_lock);
 
   urlreset(&url);
   return ret;
@@ -255,10 +320,11 @@ iptv_input_start_mux ( mpegts_input_t *mi, mpegts_mux_instance_t *mmi )
 static void
 iptv_input_stop_mux ( mpegts_input_t *mi, mpegts_mux_instance_t *mmi )
 {
+  iptv_input_t *ii = (iptv_input_t*)mi;
   iptv_mux_t *im = (iptv_mux_t*)mmi->mmi_mux;
   mpegts_network_link_t *mnl;
 
-  pthread_mutex_lock(&iptv_lock);
+  pthread_mutex_lock(&ii->ii_lock);
 
   /* Stop */
   if (im->im_handler->stop)
@@ -280,32 +346,65 @@ iptv_input_stop_mux ( mpegts_input_t *mi, mpegts_mux_instance_t *mmi )
 
   /* Free memory */
   sbuf_free(&im->mm_iptv_buffer);
+  free(im->mm_iptv_batch);
+  im->mm_iptv_batch = NULL;
+  iptv_rtp_destroy(im->mm_iptv_rtp);
+  im->mm_iptv_rtp = NULL;
 
   /* Clear bw limit */
   LIST_FOREACH(mnl, &mi->mi_networks, mnl_mi_link) {
     iptv_network_t *in = (iptv_network_t*)mnl->mnl_network;
+    pthread_mutex_lock(&in->in_bps_lock);
     in->in_bw_limited = 0;
+    pthread_mutex_unlock(&in->in_bps_lock);
   }
 
-  pthread_mutex_unlock(&iptv_lock);
+  if (ii->ii_muxes > 0)
+    ii->ii_muxes--;
+
+  pthread_mutex_unlock(&ii->ii_lock);
 }
 
 static void
 iptv_input_display_name ( mpegts_input_t *mi, char *buf, size_t len )
 {
-  snprintf(buf, len, "IPTV");
+  snprintf(buf, len, "%s", iptv_input_class_get_title(&mi->ti_id));
+}
+
+static void
+iptv_input_report ( iptv_input_t *ii )
+{
+  time_t now = dispatch_clock;
+  char buf[32];
+
+  if (ii->ii_report == 0)
+    ii->ii_report = now;
+  if (now - ii->ii_report < 10)
+    return;
+  ii->ii_pps = ii->ii_packets / (now - ii->ii_report);
+  ii->ii_drops_total += ii->ii_drops;
+  snprintf(buf, sizeof(buf), "%s", iptv_input_class_get_title(&ii->ti_id));
+  if (ii->ii_drops)
+    tvhwarn("iptv", "%s - %u packets/s, %u datagrams dropped by the socket",
+            buf, ii->ii_pps, ii->ii_drops);
+  else if (ii->ii_packets)
+    tvhtrace("iptv", "%s - %u packets/s", buf, ii->ii_pps);
+  ii->ii_packets = 0;
+  ii->ii_drops   = 0;
+  ii->ii_report  = now;
 }
 
 static void *
 iptv_input_thread ( void *aux )
 {
-  int nfds;
+  iptv_input_t *ii = aux;
+  int i, nfds;
   ssize_t n;
   iptv_mux_t *im;
-  tvhpoll_event_t ev;
+  tvhpoll_event_t ev[8];
 
   while ( tvheadend_running ) {
-    nfds = tvhpoll_wait(iptv_poll, &ev, 1, -1);
+    nfds = tvhpoll_wait(ii->ii_poll, ev, ARRAY_SIZE(ev), 1000);
     if ( nfds < 0 ) {
       if (tvheadend_running && !ERRNO_AGAIN(errno)) {
         tvhlog(LOG_ERR, "iptv", "poll() error %s, sleeping 1 second",
@@ -313,15 +412,17 @@ iptv_input_thread ( void *aux )
         sleep(1);
       }
       continue;
-    } else if ( nfds == 0 ) {
-      continue;
     }
-    im = ev.data.ptr;
 
-    pthread_mutex_lock(&iptv_lock);
+    pthread_mutex_lock(&ii->ii_lock);
+
+    for (i = 0; i < nfds; i++) {
+      im = ev[i].data.ptr;
+
+      /* Only when active */
+      if (im->mm_active == NULL || im->mm_iptv_input != ii)
+        continue;
 
-    /* Only when active */
-    if (im->mm_active) {
       /* Get data */
       if ((n = im->im_handler->read(im)) < 0) {
         tvhlog(LOG_ERR, "iptv", "read() error %s", strerror(errno));
@@ -331,7 +432,9 @@ iptv_input_thread ( void *aux )
       iptv_input_recv_packets(im, n);
     }
 
-    pthread_mutex_unlock(&iptv_lock);
+    iptv_input_report(ii);
+
+    pthread_mutex_unlock(&ii->ii_lock);
   }
   return NULL;
 }
@@ -339,30 +442,50 @@ iptv_input_thread ( void *aux )
 void
 iptv_input_recv_packets ( iptv_mux_t *im, ssize_t len )
 {
-  static time_t t1 = 0, t2;
   iptv_network_t *in = (iptv_network_t*)im->mm_network;
   mpegts_mux_instance_t *mmi;
+  time_t t;
+  int bps;
 
+  /* the network may be served by several shards */
+  time(&t);
+  pthread_mutex_lock(&in->in_bps_lock);
   in->in_bps += len * 8;
-  time(&t2);
-  if (t2 != t1) {
+  if (t != in->in_bps_time) {
+    in->in_bps_time = t;
+    bps = in->in_bps;
+    in->in_bps = 0;
     if (in->in_max_bandwidth &&
-        in->in_bps > in->in_max_bandwidth * 1024) {
+        bps > in->in_max_bandwidth * 1024) {
       if (!in->in_bw_limited) {
         tvhinfo("iptv", "%s bandwidth limited exceeded",
                 idnode_get_title(&in->mn_id));
         in->in_bw_limited = 1;
       }
     }
-    in->in_bps = 0;
-    t1 = t2;
   }
+  pthread_mutex_unlock(&in->in_bps_lock);
 
   /* Pass on */
   mmi = im->mm_active;
-  if (mmi)
-    mpegts_input_recv_packets((mpegts_input_t*)iptv_input, mmi,
-                              &im->mm_iptv_buffer, NULL, NULL);
+  if (mmi) {
+    im->mm_iptv_input->ii_packets += len / 188;
+    if (im->mm_iptv_batch)
+      mpegts_input_recv_batch((mpegts_input_t*)im->mm_iptv_input, mmi,
+                              &im->mm_iptv_batch, &im->mm_iptv_buffer);
+    else
+      mpegts_input_recv_packets((mpegts_input_t*)im->mm_iptv_input, mmi,
+                                &im->mm_iptv_buffer, NULL, NULL);
+  }
+}
+
+void
+iptv_input_socket_drops ( iptv_mux_t *im, uint32_t total )
+{
+  if (total != im->mm_iptv_rxq_drops) {
+    im->mm_iptv_input->ii_drops += total - im->mm_iptv_rxq_drops;
+    im->mm_iptv_rxq_drops = total;
+  }
 }
 
 int
@@ -378,7 +501,7 @@ iptv_input_fd_started ( iptv_mux_t *im )
     ev.data.ptr = im;
 
     /* Error? */
-    if (tvhpoll_add(iptv_poll, &ev, 1) == -1) {
+    if (tvhpoll_add(im->mm_iptv_input->ii_poll, &ev, 1) == -1) {
       mpegts_mux_nice_name((mpegts_mux_t*)im, buf, sizeof(buf));
       tvherror("iptv", "%s - failed to add to poll q", buf);
       close(im->mm_iptv_fd);
@@ -394,7 +517,7 @@ iptv_input_fd_started ( iptv_mux_t *im )
     ev.data.ptr = im;
 
     /* Error? */
-    if (tvhpoll_add(iptv_poll, &ev, 1) == -1) {
+    if (tvhpoll_add(im->mm_iptv_input->ii_poll, &ev, 1) == -1) {
       mpegts_mux_nice_name((mpegts_mux_t*)im, buf, sizeof(buf));
       tvherror("iptv", "%s - failed to add to poll q (2)", buf);
       close(im->mm_iptv_fd2);
@@ -482,6 +605,27 @@ const idclass_t iptv_network_class = {
       .off      = offsetof(iptv_network_t, in_max_timeout),
       .def.i    = 15,
     },
+    {
+      .type     = PT_BOOL,
+      .id       = "rtp_jitter",
+      .name     = "Measure RTP Jitter",
+      .off      = offsetof(iptv_network_t, in_rtp_jitter),
+      .opts     = PO_ADVANCED
+    },
+    {
+      .type     = PT_INT,
+      .id       = "rtp_reorder",
+      .name     = "RTP Reorder Window (packets)",
+      .off      = offsetof(iptv_network_t, in_rtp_reorder),
+      .opts     = PO_ADVANCED
+    },
+    {
+      .type     = PT_BOOL,
+      .id       = "rtp_fec",
+      .name     = "RTP FEC (SMPTE 2022-1)",
+      .off      = offsetof(iptv_network_t, in_rtp_fec),
+      .opts     = PO_ADVANCED
+    },
     {}
   }
 };
@@ -524,10 +668,12 @@ iptv_network_create0
 {
   iptv_network_t *in = calloc(1, sizeof(*in));
   htsmsg_t *c;
+  int i;
 
   /* Init Network */
   in->in_priority       = 1;
   in->in_streaming_priority = 1;
+  pthread_mutex_init(&in->in_bps_lock, NULL);
   if (!mpegts_network_create0((mpegts_network_t *)in,
                               &iptv_network_class,
                               uuid, NULL, conf)) {
@@ -545,7 +691,9 @@ iptv_network_create0
   }
 
   /* Link */
-  mpegts_input_add_network((mpegts_input_t*)iptv_input, (mpegts_network_t*)in);
+  for (i = 0; i < iptv_input_count; i++)
+    mpegts_input_add_network((mpegts_input_t*)iptv_inputs[i],
+                             (mpegts_network_t*)in);
 
   /* Load muxes */
   if ((c = hts_settings_load_r(1, "input/iptv/networks/%s/muxes",
@@ -596,47 +744,67 @@ iptv_network_init ( void )
   htsmsg_destroy(c);
 }
 
-void iptv_init ( void )
+void iptv_init ( int threads )
 {
+  iptv_input_t *ii;
+  int i;
+
   /* Register handlers */
   iptv_http_init();
   iptv_udp_init();
   iptv_rtsp_init();
   iptv_pipe_init();
 
-  iptv_input = calloc(1, sizeof(iptv_input_t));
-
-  /* Init Input */
-  mpegts_input_create0((mpegts_input_t*)iptv_input,
-                       &iptv_input_class, NULL, NULL);
-  iptv_input->mi_warm_mux       = iptv_input_warm_mux;
-  iptv_input->mi_start_mux      = iptv_input_start_mux;
-  iptv_input->mi_stop_mux       = iptv_input_stop_mux;
-  iptv_input->mi_get_weight     = iptv_input_get_weight;
-  iptv_input->mi_get_grace      = iptv_input_get_grace;
-  iptv_input->mi_get_priority   = iptv_input_get_priority;
-  iptv_input->mi_display_name   = iptv_input_display_name;
-  iptv_input->mi_enabled        = 1;
+  if (threads < 1)
+    threads = 1;
+  iptv_input_count = MIN(threads, IPTV_INPUTS_MAX);
+
+  /* Init Inputs */
+  for (i = 0; i < iptv_input_count; i++) {
+    ii = iptv_inputs[i] = calloc(1, sizeof(iptv_input_t));
+    ii->ii_index = i;
+    mpegts_input_create0((mpegts_input_t*)ii,
+                         &iptv_input_class, NULL, NULL);
+    ii->mi_is_enabled     = iptv_input_is_enabled;
+    ii->mi_warm_mux       = iptv_input_warm_mux;
+    ii->mi_start_mux      = iptv_input_start_mux;
+    ii->mi_stop_mux       = iptv_input_stop_mux;
+    ii->mi_get_weight     = iptv_input_get_weight;
+    ii->mi_get_grace      = iptv_input_get_grace;
+    ii->mi_get_priority   = iptv_input_get_priority;
+    ii->mi_display_name   = iptv_input_display_name;
+    ii->mi_enabled        = 1;
+    ii->ii_poll           = tvhpoll_create(10);
+    pthread_mutex_init(&ii->ii_lock, NULL);
+  }
 
   /* Init Network */
   iptv_network_init();
 
-  /* Setup TS thread */
-  iptv_poll = tvhpoll_create(10);
-  pthread_mutex_init(&iptv_lock, NULL);
-  tvhthread_create(&iptv_thread, NULL, iptv_input_thread, NULL);
+  /* Setup TS threads */
+  for (i = 0; i < iptv_input_count; i++)
+    tvhthread_create(&iptv_inputs[i]->ii_thread, NULL,
+                     iptv_input_thread, iptv_inputs[i]);
+  if (iptv_input_count > 1)
+    tvhinfo("iptv", "using %d input threads", iptv_input_count);
 }
 
 void iptv_done ( void )
 {
-  pthread_kill(iptv_thread, SIGTERM);
-  pthread_join(iptv_thread, NULL);
-  tvhpoll_destroy(iptv_poll);
+  int i;
+
+  for (i = 0; i < iptv_input_count; i++) {
+    pthread_kill(iptv_inputs[i]->ii_thread, SIGTERM);
+    pthread_join(iptv_inputs[i]->ii_thread, NULL);
+    tvhpoll_destroy(iptv_inputs[i]->ii_poll);
+  }
   pthread_mutex_lock(&global_lock);
   mpegts_network_unregister_builder(&iptv_network_class);
   mpegts_network_class_delete(&iptv_network_class, 0);
-  mpegts_input_stop_all((mpegts_input_t*)iptv_input);
-  mpegts_input_delete((mpegts_input_t *)iptv_input, 0);
+  for (i = 0; i < iptv_input_count; i++) {
+    mpegts_input_stop_all((mpegts_input_t*)iptv_inputs[i]);
+    mpegts_input_delete((mpegts_input_t *)iptv_inputs[i], 0);
+  }
   pthread_mutex_unlock(&global_lock);
 }
 
@@ -51,7 +51,7 @@ iptv_http_data
   if (im == NULL)
     return 0;
 
-  pthread_mutex_lock(&iptv_lock);
+  pthread_mutex_lock(&im->mm_iptv_input->ii_lock);
 
   tsdebug_write((mpegts_mux_t *)im, buf, len);
   sbuf_append(&im->mm_iptv_buffer, buf, len);
@@ -59,7 +59,7 @@ iptv_http_data
   if (len > 0)
     iptv_input_recv_packets(im, len);
 
-  pthread_mutex_unlock(&iptv_lock);
+  pthread_mutex_unlock(&im->mm_iptv_input->ii_lock);
 
   return 0;
 }
@@ -102,9 +102,9 @@ iptv_http_stop
   http_client_t *hc = im->im_data;
 
   hc->hc_aux = NULL;
-  pthread_mutex_unlock(&iptv_lock);
+  pthread_mutex_unlock(&im->mm_iptv_input->ii_lock);
   http_client_close(hc);
-  pthread_mutex_lock(&iptv_lock);
+  pthread_mutex_lock(&im->mm_iptv_input->ii_lock);
 }
 
 
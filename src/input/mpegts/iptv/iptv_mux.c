@@ -211,6 +211,7 @@ iptv_mux_t *
 iptv_mux_create0 ( iptv_network_t *in, const char *uuid, htsmsg_t *conf )
 {
   htsmsg_t *c, *e;
+  int i;
   htsmsg_field_t *f;
 
   /* Create Mux */
@@ -223,10 +224,11 @@ iptv_mux_create0 ( iptv_network_t *in, const char *uuid, htsmsg_t *conf )
   im->mm_config_save      = iptv_mux_config_save;
   im->mm_delete           = iptv_mux_delete;
 
-  /* Create Instance */
-  (void)mpegts_mux_instance_create(mpegts_mux_instance, NULL,
-                                   (mpegts_input_t*)iptv_input,
-                                   (mpegts_mux_t*)im);
+  /* Create Instances (one per input thread) */
+  for (i = 0; i < iptv_input_count; i++)
+    (void)mpegts_mux_instance_create(mpegts_mux_instance, NULL,
+                                     (mpegts_input_t*)iptv_inputs[i],
+                                     (mpegts_mux_t*)im);
 
   /* Services */
   c = hts_settings_load_r(1, "input/iptv/networks/%s/muxes/%s/services",
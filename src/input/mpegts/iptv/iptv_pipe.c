@@ -115,9 +115,9 @@ iptv_pipe_read ( iptv_mux_t *im )
                  r < 0 ? strerror(errno) : "No data");
       } else {
         /* avoid deadlock here */
-        pthread_mutex_unlock(&iptv_lock);
+        pthread_mutex_unlock(&im->mm_iptv_input->ii_lock);
         pthread_mutex_lock(&global_lock);
-        pthread_mutex_lock(&iptv_lock);
+        pthread_mutex_lock(&im->mm_iptv_input->ii_lock);
         if (im->mm_active) {
           if (iptv_pipe_start(im, im->mm_iptv_url, NULL)) {
             tvherror("iptv", "unable to respawn %s", im->mm_iptv_url);
@@ -126,9 +126,9 @@ iptv_pipe_read ( iptv_mux_t *im )
             im->mm_iptv_respawn_last = dispatch_clock;
           }
         }
-        pthread_mutex_unlock(&iptv_lock);
+        pthread_mutex_unlock(&im->mm_iptv_input->ii_lock);
         pthread_mutex_unlock(&global_lock);
-        pthread_mutex_lock(&iptv_lock);
+        pthread_mutex_lock(&im->mm_iptv_input->ii_lock);
       }
       break;
     }
@@ -24,12 +24,15 @@
 #include "htsbuf.h"
 #include "url.h"
 #include "udp.h"
+#include "tvhpoll.h"
 
 #define IPTV_BUF_SIZE    (300*188)
 #define IPTV_PKTS        32
 #define IPTV_PKT_PAYLOAD 1472
+#define IPTV_PKT_TS      (7*188)
+#define IPTV_BATCH_SIZE  (IPTV_BUF_SIZE + IPTV_PKTS * IPTV_PKT_PAYLOAD)
 
-extern pthread_mutex_t iptv_lock;
+#define IPTV_INPUTS_MAX  32
 
 typedef struct iptv_input   iptv_input_t;
 typedef struct iptv_network iptv_network_t;
@@ -49,21 +52,42 @@ struct iptv_handler
 
 void iptv_handler_register ( iptv_handler_t *ih, int num );
 
+/*
+ * Each input is a shard with its own poll thread, lock and demux
+ * threads, muxes are started on the least loaded one.
+ */
 struct iptv_input
 {
   mpegts_input_t;
+
+  int              ii_index;
+  tvhpoll_t       *ii_poll;
+  pthread_t        ii_thread;
+  pthread_mutex_t  ii_lock;       ///< protects the muxes of this shard
+  int              ii_muxes;      ///< active muxes (global_lock)
+
+  /* Statistics */
+  uint32_t         ii_packets;    ///< TS packets since the last report
+  uint32_t         ii_drops;      ///< socket drops since the last report
+  time_t           ii_report;
+  uint32_t         ii_pps;        ///< last reported packets/s
+  uint32_t         ii_drops_total;
 };
 
 int  iptv_input_fd_started ( iptv_mux_t *im );
 void iptv_input_mux_started ( iptv_mux_t *im );
 void iptv_input_recv_packets ( iptv_mux_t *im, ssize_t len );
+void iptv_input_socket_drops ( iptv_mux_t *im, uint32_t total );
 
 struct iptv_network
 {
   mpegts_network_t;
 
-  int in_bps;
-  int in_bw_limited;
+  /* the network may be served by several shards */
+  pthread_mutex_t in_bps_lock;
+  int in_bps;         ///< in_bps_lock
+  int in_bw_limited;  ///< in_bps_lock
+  time_t in_bps_time; ///< in_bps_lock
 
   int in_priority;
   int in_streaming_priority;
@@ -71,10 +95,59 @@ struct iptv_network
   uint32_t in_max_streams;
   uint32_t in_max_bandwidth;
   uint32_t in_max_timeout;
+  int      in_rtp_jitter;
+  int      in_rtp_reorder;
+  int      in_rtp_fec;
 };
 
 iptv_network_t *iptv_network_create0 ( const char *uuid, htsmsg_t *conf );
 
+/*
+ * RTP reordering / FEC (iptv_rtp.c)
+ */
+#define IPTV_RTP_WINDOW  128   /* max. reorder depth, datagrams */
+#define IPTV_RTP_HISTORY 256   /* media kept for FEC, power of 2 */
+
+#define IPTV_RTP_EMIT    0
+#define IPTV_RTP_HOLD    1
+#define IPTV_RTP_DROP    2
+#define IPTV_RTP_FLUSH   3
+
+typedef struct iptv_rtp_pkt {
+  int      seq;
+  int      held;
+  int      len;
+  uint8_t  data[IPTV_PKT_PAYLOAD];
+} iptv_rtp_pkt_t;
+
+typedef struct iptv_rtp {
+  int               ir_depth;    ///< datagrams to wait for a missing one
+  int               ir_wmask;
+  iptv_rtp_pkt_t   *ir_win;
+  int64_t           ir_timeout;
+  int               ir_started;
+  uint16_t          ir_seq;      ///< next expected sequence number
+  uint16_t          ir_highest;
+  uint16_t          ir_limit;    ///< flush up to this one
+  int               ir_flush;
+  int               ir_held;
+  int64_t           ir_hole;     ///< when the current hole was seen
+  iptv_rtp_pkt_t   *ir_hist;     ///< received media for FEC
+  udp_connection_t *ir_fec_conn[2];
+  int               ir_fec_fd[2];
+} iptv_rtp_t;
+
+iptv_rtp_t *iptv_rtp_create ( int depth, int fec );
+void iptv_rtp_destroy ( iptv_rtp_t *ir );
+int iptv_rtp_order
+  ( iptv_rtp_t *ir, uint16_t seq, tvh_input_stream_stats_t *st );
+uint8_t *iptv_rtp_hold ( iptv_rtp_t *ir, uint16_t seq, int len );
+iptv_rtp_pkt_t *iptv_rtp_pop ( iptv_rtp_t *ir, tvh_input_stream_stats_t *st );
+void iptv_rtp_expire ( iptv_rtp_t *ir );
+int iptv_rtp_fec_open ( iptv_rtp_t *ir, iptv_mux_t *im, const url_t *url );
+uint8_t *iptv_rtp_record ( iptv_rtp_t *ir, uint16_t seq, int len );
+void iptv_rtp_fec_read ( iptv_rtp_t *ir, tvh_input_stream_stats_t *st );
+
 struct iptv_mux
 {
   mpegts_mux_t;
@@ -101,6 +174,16 @@ struct iptv_mux
   sbuf_t                mm_iptv_buffer;
 
   iptv_handler_t       *im_handler;
+  iptv_input_t         *mm_iptv_input;
+  uint32_t              mm_iptv_rxq_drops;
+  mpegts_packet_t      *mm_iptv_batch;     ///< UDP data received in place
+  int                   mm_iptv_batch_size;
+  iptv_rtp_t           *mm_iptv_rtp;
+
+  /* RTP interarrival jitter (RFC 3550, 1/16 of 90kHz units) */
+  int64_t               mm_iptv_rtp_transit;
+  uint32_t              mm_iptv_rtp_jitter;
+  time_t                mm_iptv_rtp_report;
 
   void                 *im_data;
 
@@ -118,7 +201,8 @@ iptv_service_t *iptv_service_create0
   ( iptv_mux_t *im, uint16_t sid, uint16_t pmt_pid,
     const char *uuid, htsmsg_t *conf );
 
-extern iptv_input_t   *iptv_input;
+extern iptv_input_t   *iptv_inputs[IPTV_INPUTS_MAX];
+extern int             iptv_input_count;
 extern iptv_network_t *iptv_network;
 
 void iptv_mux_load_all ( void );
@@ -0,0 +1,372 @@
+/*
+ *  IPTV - RTP sequence tracking, reordering and SMPTE 2022-1 FEC
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tvheadend.h"
+#include "iptv_private.h"
+
+#include <sys/socket.h>
+
+#define IPTV_RTP_TIMEOUT      100000  /* us to wait for a missing datagram */
+#define IPTV_RTP_FEC_TIMEOUT  500000  /* ... when FEC may still recover it */
+#define IPTV_RTP_FEC_DEPTH    100     /* L x D limit of SMPTE 2022-1 */
+#define IPTV_RTP_FEC_HDR      16
+#define IPTV_RTP_RESYNC       64      /* min. jump to restart the sequence */
+
+/*
+ * Create / destroy
+ */
+iptv_rtp_t *
+iptv_rtp_create ( int depth, int fec )
+{
+  iptv_rtp_t *ir = calloc(1, sizeof(*ir));
+  int i, w;
+
+  if (fec && depth < IPTV_RTP_FEC_DEPTH)
+    depth = IPTV_RTP_FEC_DEPTH;
+  ir->ir_depth   = MIN(MAX(depth, 0), IPTV_RTP_WINDOW);
+  ir->ir_timeout = fec ? IPTV_RTP_FEC_TIMEOUT : IPTV_RTP_TIMEOUT;
+  ir->ir_fec_fd[0] = ir->ir_fec_fd[1] = -1;
+  if (ir->ir_depth) {
+    for (w = 1; w < ir->ir_depth; w <<= 1);
+    ir->ir_wmask = w - 1;
+    ir->ir_win   = malloc(w * sizeof(iptv_rtp_pkt_t));
+    for (i = 0; i < w; i++)
+      ir->ir_win[i].seq = -1;
+  }
+  if (fec) {
+    ir->ir_hist = malloc(IPTV_RTP_HISTORY * sizeof(iptv_rtp_pkt_t));
+    for (i = 0; i < IPTV_RTP_HISTORY; i++)
+      ir->ir_hist[i].seq = -1;
+  }
+  return ir;
+}
+
+void
+iptv_rtp_destroy ( iptv_rtp_t *ir )
+{
+  int i;
+
+  if (ir == NULL)
+    return;
+  for (i = 0; i < 2; i++)
+    udp_close(ir->ir_fec_conn[i]);
+  free(ir->ir_win);
+  free(ir->ir_hist);
+  free(ir);
+}
+
+/*
+ * Sequence handling
+ *
+ * Returns IPTV_RTP_EMIT when the datagram is the next one, IPTV_RTP_HOLD
+ * when it has to wait in the window (use iptv_rtp_hold), IPTV_RTP_DROP
+ * for duplicates and datagrams given up on, and IPTV_RTP_FLUSH when the
+ * window must be drained with iptv_rtp_pop() before asking again.
+ */
+int
+iptv_rtp_order
+  ( iptv_rtp_t *ir, uint16_t seq, tvh_input_stream_stats_t *st )
+{
+  iptv_rtp_pkt_t *p;
+  int16_t d;
+  int limit;
+
+  if (!ir->ir_started) {
+    ir->ir_started = 1;
+    ir->ir_seq     = seq + 1;
+    ir->ir_highest = seq;
+    return IPTV_RTP_EMIT;
+  }
+
+  d = (int16_t)(seq - ir->ir_seq);
+
+  /* Sequence jump (encoder restart, source switch), do not wait for
+     the old sequence to come back: pass on what the window holds and
+     start over (forward jumps without a window are only loss) */
+  limit = MAX(3 * ir->ir_depth, IPTV_RTP_RESYNC);
+  if (d < -limit || (ir->ir_depth && d > limit)) {
+    if (ir->ir_held) {
+      ir->ir_limit = ir->ir_seq + ir->ir_wmask + 1;
+      ir->ir_flush = 1;
+      return IPTV_RTP_FLUSH;
+    }
+    tvhtrace("iptv", "RTP sequence jump %d (%u -> %u), resync",
+             d, (uint16_t)ir->ir_seq, seq);
+    ir->ir_seq     = seq + 1;
+    ir->ir_highest = seq;
+    return IPTV_RTP_EMIT;
+  }
+
+  /* No window, only account */
+  if (ir->ir_depth == 0) {
+    if (d > 0)
+      st->loss += d;
+    else if (d < 0) {
+      st->reorder++;
+      return IPTV_RTP_EMIT;
+    }
+    ir->ir_seq = seq + 1;
+    return IPTV_RTP_EMIT;
+  }
+
+  /* Behind the window */
+  if (d < 0) {
+    p = &ir->ir_win[seq & ir->ir_wmask];
+    if (p->seq == seq && -d <= ir->ir_wmask)
+      st->dup++;
+    else
+      st->reorder++;
+    return IPTV_RTP_DROP;
+  }
+
+  /* Too far ahead, give up on the oldest holes */
+  if (d >= ir->ir_depth) {
+    ir->ir_limit = seq - ir->ir_depth + 1;
+    ir->ir_flush = 1;
+    return IPTV_RTP_FLUSH;
+  }
+
+  p = &ir->ir_win[seq & ir->ir_wmask];
+  if (p->seq == seq && p->held) {
+    st->dup++;
+    return IPTV_RTP_DROP;
+  }
+
+  /* Older than something already received */
+  if ((int16_t)(seq - ir->ir_highest) > 0)
+    ir->ir_highest = seq;
+  else
+    st->reorder++;
+
+  if (d == 0) {
+    p->seq  = seq;
+    p->held = 0;
+    ir->ir_seq++;
+    return IPTV_RTP_EMIT;
+  }
+  return IPTV_RTP_HOLD;
+}
+
+uint8_t *
+iptv_rtp_hold ( iptv_rtp_t *ir, uint16_t seq, int len )
+{
+  iptv_rtp_pkt_t *p = &ir->ir_win[seq & ir->ir_wmask];
+
+  if (ir->ir_held++ == 0)
+    ir->ir_hole = getmonoclock();
+  p->seq  = seq;
+  p->held = 1;
+  p->len  = len;
+  return p->data;
+}
+
+/*
+ * Next datagram to pass on from the window, skipping the holes when
+ * flushing (they are counted as lost)
+ */
+iptv_rtp_pkt_t *
+iptv_rtp_pop ( iptv_rtp_t *ir, tvh_input_stream_stats_t *st )
+{
+  iptv_rtp_pkt_t *p;
+
+  if (ir->ir_depth == 0)
+    return NULL;
+  while (1) {
+    p = &ir->ir_win[ir->ir_seq & ir->ir_wmask];
+    if (p->held && p->seq == ir->ir_seq) {
+      p->held = 0;
+      ir->ir_seq++;
+      if (--ir->ir_held > 0)
+        ir->ir_hole = getmonoclock();
+      return p;
+    }
+    if (!ir->ir_flush || (int16_t)(ir->ir_limit - ir->ir_seq) <= 0) {
+      ir->ir_flush = 0;
+      return NULL;
+    }
+    st->loss++;
+    ir->ir_seq++;
+  }
+}
+
+/*
+ * Stop waiting for a missing datagram after the timeout
+ */
+void
+iptv_rtp_expire ( iptv_rtp_t *ir )
+{
+  int i;
+
+  if (ir->ir_held == 0 || getmonoclock() - ir->ir_hole < ir->ir_timeout)
+    return;
+  for (i = 1; i <= ir->ir_depth; i++)
+    if (ir->ir_win[(ir->ir_seq + i) & ir->ir_wmask].held) {
+      ir->ir_limit = ir->ir_seq + i;
+      ir->ir_flush = 1;
+      return;
+    }
+}
+
+/*
+ * SMPTE 2022-1 FEC
+ */
+static int
+iptv_rtp_fec_bind
+  ( iptv_rtp_t *ir, iptv_mux_t *im, const url_t *url, int idx )
+{
+  char name[256];
+  tvhpoll_event_t ev = { 0 };
+  udp_connection_t *uc;
+
+  mpegts_mux_nice_name((mpegts_mux_t*)im, name, sizeof(name));
+  snprintf(name + strlen(name), sizeof(name) - strlen(name),
+           " FEC %s", idx ? "row" : "column");
+  uc = udp_bind("iptv", name, url->host, url->port + 2 + idx * 2,
+                im->mm_iptv_interface, IPTV_PKTS * IPTV_PKT_PAYLOAD, 0);
+  if (uc == NULL || uc == UDP_FATAL_ERROR)
+    return -1;
+  ev.fd       = uc->fd;
+  ev.events   = TVHPOLL_IN;
+  ev.data.ptr = im;
+  if (tvhpoll_add(im->mm_iptv_input->ii_poll, &ev, 1) == -1) {
+    udp_close(uc);
+    return -1;
+  }
+  ir->ir_fec_conn[idx] = uc;
+  ir->ir_fec_fd[idx]   = uc->fd;
+  return 0;
+}
+
+int
+iptv_rtp_fec_open ( iptv_rtp_t *ir, iptv_mux_t *im, const url_t *url )
+{
+  int r = 0;
+
+  if (ir->ir_hist == NULL || url->port <= 0)
+    return -1;
+  if (iptv_rtp_fec_bind(ir, im, url, 0))
+    r--;
+  if (iptv_rtp_fec_bind(ir, im, url, 1))
+    r--;
+  return r == -2 ? -1 : 0;
+}
+
+/*
+ * Remember received media for the recovery, returns the buffer for
+ * the len bytes following the fixed RTP header
+ */
+uint8_t *
+iptv_rtp_record ( iptv_rtp_t *ir, uint16_t seq, int len )
+{
+  iptv_rtp_pkt_t *p;
+
+  if (ir->ir_hist == NULL || len > IPTV_PKT_PAYLOAD)
+    return NULL;
+  p = &ir->ir_hist[seq & (IPTV_RTP_HISTORY - 1)];
+  p->seq  = seq;
+  p->len  = len;
+  return p->data;
+}
+
+static void
+iptv_rtp_fec_recover
+  ( iptv_rtp_t *ir, const uint8_t *fec, int len,
+    tvh_input_stream_stats_t *st )
+{
+  iptv_rtp_pkt_t *p;
+  uint16_t snbase, seq, missing = 0;
+  int i, j, offset, na, rlen, count = 0;
+  uint8_t *dst;
+  int16_t d;
+
+  snbase = (fec[0] << 8) | fec[1];
+  offset = fec[13];
+  na     = fec[14];
+  if (offset == 0 || na == 0)
+    return;
+
+  for (j = 0; j < na; j++) {
+    seq = snbase + j * offset;
+    if (ir->ir_hist[seq & (IPTV_RTP_HISTORY - 1)].seq != seq) {
+      missing = seq;
+      if (++count > 1)
+        return;
+    }
+  }
+  if (count != 1)
+    return;
+
+  /* Only while we are still waiting for it, and not for datagrams past
+     the newest media: those may still be queued on the media socket */
+  d = (int16_t)(missing - ir->ir_seq);
+  if (d < 0 || d >= ir->ir_depth ||
+      (int16_t)(missing - ir->ir_highest) > 0)
+    return;
+  p = &ir->ir_win[missing & ir->ir_wmask];
+  if (p->held && p->seq == missing)
+    return;
+
+  rlen = (fec[2] << 8) | fec[3];
+  for (j = 0; j < na; j++) {
+    seq = snbase + j * offset;
+    if (seq != missing)
+      rlen ^= ir->ir_hist[seq & (IPTV_RTP_HISTORY - 1)].len;
+  }
+  len -= IPTV_RTP_FEC_HDR;
+  if (rlen <= 0 || rlen > len || rlen > IPTV_PKT_PAYLOAD || (rlen % 188) != 0)
+    return;
+
+  dst = iptv_rtp_hold(ir, missing, rlen);
+  memcpy(dst, fec + IPTV_RTP_FEC_HDR, rlen);
+  for (j = 0; j < na; j++) {
+    seq = snbase + j * offset;
+    if (seq == missing)
+      continue;
+    p = &ir->ir_hist[seq & (IPTV_RTP_HISTORY - 1)];
+    for (i = 0; i < MIN(p->len, rlen); i++)
+      dst[i] ^= p->data[i];
+  }
+  p = &ir->ir_hist[missing & (IPTV_RTP_HISTORY - 1)];
+  p->seq = missing;
+  p->len = rlen;
+  memcpy(p->data, dst, rlen);
+  st->fec++;
+}
+
+/*
+ * Drain the FEC sockets, recovered datagrams are put to the window
+ */
+void
+iptv_rtp_fec_read ( iptv_rtp_t *ir, tvh_input_stream_stats_t *st )
+{
+  uint8_t buf[12 + IPTV_RTP_FEC_HDR + IPTV_PKT_PAYLOAD];
+  ssize_t r;
+  int i, hlen;
+
+  for (i = 0; i < 2; i++) {
+    if (ir->ir_fec_fd[i] < 0)
+      continue;
+    while ((r = recv(ir->ir_fec_fd[i], buf, sizeof(buf), MSG_DONTWAIT)) > 0) {
+      if (r < 12 || (buf[0] & 0xC0) != 0x80)
+        continue;
+      hlen = ((buf[0] & 0xf) * 4) + 12;
+      if (r < hlen + IPTV_RTP_FEC_HDR)
+        continue;
+      iptv_rtp_fec_recover(ir, buf + hlen, r - hlen, st);
+    }
+  }
+}
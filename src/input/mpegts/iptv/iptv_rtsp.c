@@ -195,7 +195,7 @@ iptv_rtsp_stop
   rp->hc->hc_aux = NULL;
   if (play)
     rtsp_teardown(rp->hc, rp->path, "");
-  pthread_mutex_unlock(&iptv_lock);
+  pthread_mutex_unlock(&im->mm_iptv_input->ii_lock);
   gtimer_disarm(&rp->alive_timer);
   udp_multirecv_free(&rp->um);
   if (!play)
@@ -203,7 +203,7 @@ iptv_rtsp_stop
   free(rp->path);
   free(rp->query);
   free(rp);
-  pthread_mutex_lock(&iptv_lock);
+  pthread_mutex_lock(&im->mm_iptv_input->ii_lock);
 }
 
 /*
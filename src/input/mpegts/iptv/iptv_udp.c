@@ -37,6 +37,7 @@ iptv_udp_start ( iptv_mux_t *im, const char *raw, const url_t *url )
   char name[256];
   udp_connection_t *conn;
   udp_multirecv_t *um;
+  iptv_network_t *in = (iptv_network_t *)im->mm_network;
 
   mpegts_mux_nice_name((mpegts_mux_t*)im, name, sizeof(name));
 
@@ -56,6 +57,13 @@ iptv_udp_start ( iptv_mux_t *im, const char *raw, const url_t *url )
   im->im_data = um;
 
   iptv_input_mux_started(im);
+
+  /* RTP sequence tracking */
+  if (strcmp(url->scheme, "rtp") == 0) {
+    im->mm_iptv_rtp = iptv_rtp_create(in->in_rtp_reorder, in->in_rtp_fec);
+    if (in->in_rtp_fec && iptv_rtp_fec_open(im->mm_iptv_rtp, im, url))
+      tvhwarn("iptv", "%s - unable to open the FEC ports", name);
+  }
   return 0;
 }
 
@@ -66,82 +74,289 @@ iptv_udp_stop
   udp_multirecv_t *um = im->im_data;
 
   im->im_data = NULL;
-  pthread_mutex_unlock(&iptv_lock);
+  pthread_mutex_unlock(&im->mm_iptv_input->ii_lock);
   udp_multirecv_free(um);
   free(um);
-  pthread_mutex_lock(&iptv_lock);
+  pthread_mutex_lock(&im->mm_iptv_input->ii_lock);
 }
 
-static ssize_t
-iptv_udp_read ( iptv_mux_t *im )
+/*
+ * Datagrams are scattered by udp_multirecv_read_into(): hsize bytes to
+ * the scratch buffer, IPTV_PKT_TS bytes to the batch slot, the rest
+ * behind the header in the scratch buffer.
+ */
+static inline uint8_t *
+iptv_udp_ptr ( uint8_t *hdr, uint8_t *slot, int hsize, int off )
 {
-  int i, n;
-  struct iovec *iovec;
-  udp_multirecv_t *um = im->im_data;
-  ssize_t res = 0;
+  if (off < hsize)
+    return hdr + off;
+  if (off < hsize + IPTV_PKT_TS)
+    return slot + off - hsize;
+  return hdr + off - IPTV_PKT_TS;
+}
 
-  n = udp_multirecv_read(um, im->mm_iptv_fd, IPTV_PKTS, &iovec);
-  if (n < 0)
-    return -1;
+static void
+iptv_udp_copy
+  ( uint8_t *dst, uint8_t *hdr, uint8_t *slot, int hsize, int off, int len )
+{
+  int l;
 
-  for (i = 0; i < n; i++, iovec++) {
-    sbuf_append(&im->mm_iptv_buffer, iovec->iov_base, iovec->iov_len);
-    res += iovec->iov_len;
+  if (off < hsize + IPTV_PKT_TS) {
+    l = MIN(len, hsize + IPTV_PKT_TS - off);
+    memmove(dst, slot + off - hsize, l);
+    dst += l;
+    off += l;
+    len -= l;
+  }
+  if (len > 0)
+    memcpy(dst, hdr + off - IPTV_PKT_TS, len);
+}
+
+static void
+iptv_rtp_jitter ( iptv_mux_t *im, const uint8_t *rtp, int64_t tstamp )
+{
+  int64_t arrival, transit, d;
+  uint32_t ts = (rtp[4] << 24) | (rtp[5] << 16) | (rtp[6] << 8) | rtp[7];
+  char buf[256];
+
+  /* RFC 3550 A.8, in 90kHz units */
+  arrival = (tstamp / 100000) * 9;
+  transit = (int32_t)((uint32_t)arrival - ts);
+  if (im->mm_iptv_rtp_transit != INT64_MIN) {
+    d = transit - im->mm_iptv_rtp_transit;
+    if (d < 0)
+      d = -d;
+    im->mm_iptv_rtp_jitter += d - ((im->mm_iptv_rtp_jitter + 8) >> 4);
   }
+  im->mm_iptv_rtp_transit = transit;
 
-  return res;
+  if (dispatch_clock - im->mm_iptv_rtp_report >= 10) {
+    im->mm_iptv_rtp_report = dispatch_clock;
+    mpegts_mux_nice_name((mpegts_mux_t*)im, buf, sizeof(buf));
+    tvhdebug("iptv", "%s - RTP jitter %u us", buf,
+             (im->mm_iptv_rtp_jitter >> 4) * 100 / 9);
+  }
 }
 
-ssize_t
-iptv_rtp_read ( iptv_mux_t *im, udp_multirecv_t *um )
+/*
+ * Output to the batch, switching to a bounce buffer once the data
+ * would overwrite datagrams not processed yet
+ */
+typedef struct iptv_udp_out {
+  uint8_t *w;        ///< write position in the batch
+  uint8_t *limit;    ///< first byte not consumed yet
+  uint8_t *end;      ///< end of the batch
+  uint8_t *bounce;
+  uint8_t *b;
+  int      bsize;
+} iptv_udp_out_t;
+
+/*
+ * The bounce buffer is copied to the write position at the end, which
+ * doesn't move once it's in use. Datagrams not fitting are dropped and
+ * counted as lost.
+ */
+static uint8_t *
+iptv_udp_out_bounce
+  ( iptv_udp_out_t *o, int len, tvh_input_stream_stats_t *st )
+{
+  uint8_t *r;
+
+  if (o->bounce == NULL) {
+    o->bsize  = MIN(o->bsize, o->end - o->w);
+    o->bounce = o->b = malloc(o->bsize);
+  }
+  if (len > o->bsize - (o->b - o->bounce)) {
+    tvhtrace("iptv", "bounce buffer full, %d bytes dropped", len);
+    st->loss++;
+    return NULL;
+  }
+  r = o->b;
+  o->b += len;
+  return r;
+}
+
+static void
+iptv_udp_out_drain
+  ( iptv_rtp_t *ir, iptv_udp_out_t *o, tvh_input_stream_stats_t *st )
+{
+  iptv_rtp_pkt_t *p;
+  uint8_t *dst;
+
+  while ((p = iptv_rtp_pop(ir, st)) != NULL) {
+    if (o->bounce == NULL && o->w + p->len <= o->limit) {
+      memcpy(o->w, p->data, p->len);
+      o->w += p->len;
+    } else if ((dst = iptv_udp_out_bounce(o, p->len, st)) != NULL) {
+      memcpy(dst, p->data, p->len);
+    }
+  }
+}
+
+/*
+ * Receive datagrams straight into the mux batch, stripping the RTP
+ * headers by offset. Payloads of the usual 7 TS packets land back to
+ * back; odd sizes are compacted in place. RTP datagrams out of order
+ * wait in the reorder window (iptv_rtp.c).
+ */
+static ssize_t
+iptv_udp_read_batch ( iptv_mux_t *im, udp_multirecv_t *um, int rtp )
 {
-  ssize_t len, hlen;
-  uint8_t *rtp;
-  int i, n;
+  const int hsize = rtp ? 12 : 0;
+  mpegts_packet_t *mp;
+  uint8_t *hdr, *slot, *start, *dst, *rec;
+  int i, n, len, hlen, room, act;
+  uint16_t seq;
   struct iovec *iovec;
-  ssize_t res = 0;
+  iptv_network_t *in = (iptv_network_t *)im->mm_network;
+  tvh_input_stream_stats_t *st = &im->mm_active->tii_stats;
+  iptv_rtp_t *ir = NULL;
+  iptv_udp_out_t o;
 
-  n = udp_multirecv_read(um, im->mm_iptv_fd, IPTV_PKTS, &iovec);
-  if (n < 0)
-    return -1;
+  if (rtp) {
+    if (im->mm_iptv_rtp == NULL)
+      im->mm_iptv_rtp = iptv_rtp_create(in->in_rtp_reorder, 0);
+    ir = im->mm_iptv_rtp;
+  }
+
+  if ((mp = im->mm_iptv_batch) == NULL) {
+    im->mm_iptv_batch_size = IPTV_BATCH_SIZE +
+                             (ir ? ir->ir_depth * IPTV_PKT_PAYLOAD : 0);
+    mp = im->mm_iptv_batch = malloc(sizeof(mpegts_packet_t) +
+                                    im->mm_iptv_batch_size);
+    mp->mp_len = 0;
+  }
+  start    = o.w = mp->mp_data + mp->mp_len;
+  o.limit  = o.end = mp->mp_data + im->mm_iptv_batch_size;
+  o.bounce = o.b = NULL;
+  o.bsize  = (IPTV_PKTS + (ir ? ir->ir_depth : 0)) * IPTV_PKT_PAYLOAD;
+
+  /* Keep space for everything the window may release */
+  room = MIN(IPTV_PKTS, (o.limit - o.w) / IPTV_PKT_PAYLOAD -
+                        (ir ? ir->ir_depth : 0));
+  dst  = o.w;
+  n    = 0;
+
+  if (rtp && in->in_rtp_jitter && um->um_tstamp == NULL) {
+    udp_multirecv_timestamps(um, im->mm_iptv_fd);
+    im->mm_iptv_rtp_transit = INT64_MIN;
+  }
+
+  if (room > 0) {
+    n = udp_multirecv_read_into(um, im->mm_iptv_fd, room, dst,
+                                IPTV_PKT_TS, hsize, &iovec);
+    if (n < 0) {
+      /* woken up by the FEC sockets */
+      if (!ERRNO_AGAIN(errno) || ir == NULL || ir->ir_hist == NULL)
+        return -1;
+      n = 0;
+    }
+    iptv_input_socket_drops(im, um->um_drops);
+  }
 
   for (i = 0; i < n; i++, iovec++) {
 
     /* Raw packet */
-    rtp = iovec->iov_base;
-    len = iovec->iov_len;
+    hdr     = iovec->iov_base;
+    slot    = dst + i * IPTV_PKT_TS;
+    len     = iovec->iov_len;
+    hlen    = 0;
+    o.limit = slot;
+
+    if (rtp) {
+      /* Strip RTP header */
+      if (len < 12)
+        continue;
 
-    /* Strip RTP header */
-    if (len < 12)
-      continue;
+      /* Version 2 */
+      if ((hdr[0] & 0xC0) != 0x80)
+        continue;
 
-    /* Version 2 */
-    if ((rtp[0] & 0xC0) != 0x80)
-      continue;
+      /* MPEG-TS */
+      if ((hdr[1] & 0x7F) != 33)
+        continue;
+
+      /* Header length (4bytes per CSRC) */
+      hlen = ((hdr[0] & 0xf) * 4) + 12;
+      if (hdr[0] & 0x10) {
+        if (len < hlen+4)
+          continue;
+        hlen += ((*iptv_udp_ptr(hdr, slot, hsize, hlen+2) << 8) |
+                  *iptv_udp_ptr(hdr, slot, hsize, hlen+3)) * 4;
+        hlen += 4;
+      }
+      if (len < hlen || ((len - hlen) % 188) != 0)
+        continue;
 
-    /* MPEG-TS */
-    if ((rtp[1] & 0x7F) != 33)
-      continue;
+      if (um->um_tstamp && um->um_tstamp[i] && in->in_rtp_jitter)
+        iptv_rtp_jitter(im, hdr, um->um_tstamp[i]);
 
-    /* Header length (4bytes per CSRC) */
-    hlen = ((rtp[0] & 0xf) * 4) + 12;
-    if (rtp[0] & 0x10) {
-      if (len < hlen+4)
+      /* Sequence */
+      seq = (hdr[2] << 8) | hdr[3];
+      if (ir->ir_hist && (rec = iptv_rtp_record(ir, seq, len - 12)) != NULL)
+        iptv_udp_copy(rec, hdr, slot, hsize, 12, len - 12);
+      while ((act = iptv_rtp_order(ir, seq, st)) == IPTV_RTP_FLUSH)
+        iptv_udp_out_drain(ir, &o, st);
+      if (act == IPTV_RTP_DROP)
         continue;
-      hlen += ((rtp[hlen+2] << 8) | rtp[hlen+3]) * 4;
-      hlen += 4;
+      if (act == IPTV_RTP_HOLD) {
+        rec = iptv_rtp_hold(ir, seq, len - hlen);
+        iptv_udp_copy(rec, hdr, slot, hsize, hlen, len - hlen);
+        continue;
+      }
     }
-    if (len < hlen || ((len - hlen) % 188) != 0)
-      continue;
 
-    /* Move data */
     len -= hlen;
-    tsdebug_write((mpegts_mux_t *)im, rtp + hlen, len);
-    sbuf_append(&im->mm_iptv_buffer, rtp + hlen, len);
-    res += len;
+
+    /* Fast path - payload in the slot, at most compacted */
+    if (o.bounce == NULL && hlen + len <= hsize + IPTV_PKT_TS) {
+      if (o.w != slot + hlen - hsize)
+        memmove(o.w, slot + hlen - hsize, len);
+      o.w += len;
+    } else if (len > 0) {
+      /* Oversized - would overwrite the following slots */
+      if ((rec = iptv_udp_out_bounce(&o, len, st)) != NULL)
+        iptv_udp_copy(rec, hdr, slot, hsize, hlen, len);
+    }
+
+    /* Datagrams waiting for this one */
+    if (ir && ir->ir_held) {
+      o.limit = slot + IPTV_PKT_TS;
+      iptv_udp_out_drain(ir, &o, st);
+    }
   }
 
-  return res;
+  /* Recovered or timed out datagrams from the window */
+  if (ir) {
+    o.limit = mp->mp_data + im->mm_iptv_batch_size;
+    if (ir->ir_hist)
+      iptv_rtp_fec_read(ir, st);
+    iptv_rtp_expire(ir);
+    iptv_udp_out_drain(ir, &o, st);
+  }
+
+  if (o.bounce) {
+    memcpy(o.w, o.bounce, o.b - o.bounce);
+    o.w += o.b - o.bounce;
+    free(o.bounce);
+  }
+
+  if (o.w != start)
+    tsdebug_write((mpegts_mux_t *)im, start, o.w - start);
+  mp->mp_len += o.w - start;
+  return o.w - start;
+}
+
+static ssize_t
+iptv_udp_read ( iptv_mux_t *im )
+{
+  return iptv_udp_read_batch(im, im->im_data, 0);
+}
+
+ssize_t
+iptv_rtp_read ( iptv_mux_t *im, udp_multirecv_t *um )
+{
+  return iptv_udp_read_batch(im, um, 1);
 }
 
 static ssize_t
@@ -138,6 +138,8 @@ mpegts_input_enabled_notify ( void *p )
   /* Alert */
   if (mi->mi_enabled_updated)
     mi->mi_enabled_updated(mi);
+
+  subscription_input_changed();
 }
 
 static int
@@ -272,6 +274,13 @@ const idclass_t mpegts_input_class =
       .def.i    = 1,
       .opts     = PO_ADVANCED,
     },
+    {
+      .type     = PT_BOOL,
+      .id       = "prewarm",
+      .name     = "Pre-tune",
+      .off      = offsetof(mpegts_input_t, mi_prewarm),
+      .opts     = PO_ADVANCED,
+    },
     {
       .type     = PT_STR,
       .id       = "networks",
@@ -308,6 +317,8 @@ mpegts_input_is_enabled ( mpegts_input_t *mi, mpegts_mux_t *mm, int flags )
     return 0;
   if ((flags & SUBSCRIPTION_IDLESCAN) != 0 && !mi->mi_idlescan)
     return 0;
+  if ((flags & SUBSCRIPTION_PREWARM) != 0 && !mi->mi_prewarm)
+    return 0;
   return mi->mi_enabled;
 }
 
@@ -925,6 +936,7 @@ mpegts_input_recv_packets
     pthread_mutex_lock(&mi->mi_input_lock);
     if (mmi->mmi_mux->mm_active == mmi) {
       TAILQ_INSERT_TAIL(&mi->mi_input_queue, mp, mp_link);
+      mi->mi_input_queue_size += len2;
       pthread_cond_signal(&mi->mi_input_cond);
     } else {
       free(mp);
@@ -939,6 +951,51 @@ mpegts_input_recv_packets
     sb->sb_ptr = 0;    // clear
 }
 
+/*
+ * Queue a block the input received straight into a mpegts_packet_t,
+ * the packet is handed over (*mpp cleared) when it is queued. Blocks
+ * out of sync or behind data left over in sb go through the copying
+ * mpegts_input_recv_packets() path.
+ */
+void
+mpegts_input_recv_batch
+  ( mpegts_input_t *mi, mpegts_mux_instance_t *mmi, mpegts_packet_t **mpp,
+    sbuf_t *sb )
+{
+  mpegts_packet_t *mp = *mpp;
+  int len = mp->mp_len;
+
+  if (len == 0)
+    return;
+
+  if (sb->sb_ptr || (len % 188) != 0 || ts_sync_count(mp->mp_data, len) != len) {
+    sbuf_append(sb, mp->mp_data, len);
+    mp->mp_len = 0;
+    mpegts_input_recv_packets(mi, mmi, sb, NULL, NULL);
+    return;
+  }
+
+  if (len < (MIN_TS_PKT * 188)) {
+    /* For slow streams, check also against the clock */
+    if (dispatch_clock == mi->mi_last_dispatch)
+      return;
+  }
+  mi->mi_last_dispatch = dispatch_clock;
+
+  *mpp = NULL;
+  mp->mp_mux = mmi->mmi_mux;
+
+  pthread_mutex_lock(&mi->mi_input_lock);
+  if (mmi->mmi_mux->mm_active == mmi) {
+    TAILQ_INSERT_TAIL(&mi->mi_input_queue, mp, mp_link);
+    mi->mi_input_queue_size += len;
+    pthread_cond_signal(&mi->mi_input_cond);
+  } else {
+    free(mp);
+  }
+  pthread_mutex_unlock(&mi->mi_input_lock);
+}
+
 static void
 mpegts_input_table_dispatch ( mpegts_mux_t *mm, const uint8_t *tsb, int tsb_len )
 {
@@ -1259,6 +1316,7 @@ mpegts_input_thread ( void * p )
       continue;
     }
     TAILQ_REMOVE(&mi->mi_input_queue, mp, mp_link);
+    mi->mi_input_queue_size -= mp->mp_len;
     pthread_mutex_unlock(&mi->mi_input_lock);
       
     /* Process */
@@ -1299,6 +1357,7 @@ mpegts_input_thread ( void * p )
     TAILQ_REMOVE(&mi->mi_input_queue, mp, mp_link);
     free(mp);
   }
+  mi->mi_input_queue_size = 0;
   pthread_mutex_unlock(&mi->mi_input_lock);
 
   return NULL;
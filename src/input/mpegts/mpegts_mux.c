@@ -237,6 +237,8 @@ mpegts_mux_instance_start
   /* Start */
   mi->mi_display_name(mi, buf2, sizeof(buf2));
   tvhinfo("mpegts", "%s - tuning on %s", buf, buf2);
+  mm->mm_tune_start = getmonoclock();
+  mm->mm_psi_time   = 0;
   r = mi->mi_warm_mux(mi, mmi);
   if (r) return r;
   r = mi->mi_start_mux(mi, mmi);
@@ -555,6 +557,13 @@ const idclass_t mpegts_mux_class =
       .opts     = PO_RDONLY | PO_SORTKEY,
       .list     = mpegts_mux_class_scan_result_enum,
     },
+    {
+      .type     = PT_INT,
+      .id       = "psi_time",
+      .name     = "Tables Acquired (ms)",
+      .off      = offsetof(mpegts_mux_t, mm_psi_time),
+      .opts     = PO_RDONLY | PO_NOSAVE | PO_ADVANCED,
+    },
     {
       .type     = PT_STR,
       .id       = "charset",
@@ -1025,6 +1034,77 @@ again:
   }
 }
 
+/*
+ * All other tables are complete, do not wait the whole grace period
+ * for PMTs not carried (PMTs repeat at least twice a second)
+ */
+#define MPEGTS_SCAN_QUICK 2
+
+void
+mpegts_mux_scan_quick ( mpegts_mux_t *mm )
+{
+  if (mm->mm_scan_state != MM_SCAN_STATE_ACTIVE || mm->mm_scan_init)
+    return;
+  if (mm->mm_scan_timeout.gti_expire.tv_sec > dispatch_clock + MPEGTS_SCAN_QUICK)
+    gtimer_arm(&mm->mm_scan_timeout, mpegts_mux_scan_timeout, mm,
+               MPEGTS_SCAN_QUICK);
+}
+
+/*
+ * Inputs without a free tuner, the planners (scan, EPG) skip the muxes
+ * which can be tuned only by those
+ */
+int
+mpegts_mux_inputs_busy
+  ( mpegts_mux_t *mm, int flags, mpegts_input_t **busy, int nbusy )
+{
+  mpegts_mux_instance_t *mmi;
+  int i;
+
+  mm->mm_create_instances(mm);
+  LIST_FOREACH(mmi, &mm->mm_instances, mmi_mux_link) {
+    if (mmi->mmi_tune_failed ||
+        !mmi->mmi_input->mi_is_enabled(mmi->mmi_input, mm, flags))
+      continue;
+    for (i = 0; i < nbusy; i++)
+      if (busy[i] == mmi->mmi_input)
+        break;
+    if (i >= nbusy)
+      return 0;
+  }
+  return 1;
+}
+
+int
+mpegts_mux_inputs_add_busy
+  ( mpegts_mux_t *mm, mpegts_input_t **busy, int nbusy, int max )
+{
+  mpegts_mux_instance_t *mmi;
+  int i;
+
+  LIST_FOREACH(mmi, &mm->mm_instances, mmi_mux_link) {
+    for (i = 0; i < nbusy; i++)
+      if (busy[i] == mmi->mmi_input)
+        break;
+    if (i >= nbusy && nbusy < max)
+      busy[nbusy++] = mmi->mmi_input;
+  }
+  return nbusy;
+}
+
+/*
+ * All required tables, the SDT/VCT included, were seen complete,
+ * remember how long it took (not called on scan timeouts)
+ */
+void
+mpegts_mux_psi_acquired ( mpegts_mux_t *mm, const char *buf )
+{
+  if (mm->mm_psi_time || !mm->mm_tune_start)
+    return;
+  mm->mm_psi_time = MAX(1, (getmonoclock() - mm->mm_tune_start) / 1000);
+  tvhdebug("mpegts", "%s - tables acquired in %d ms", buf, mm->mm_psi_time);
+}
+
 /* **************************************************************************
  * Creation / Config
  * *************************************************************************/
@@ -111,6 +111,16 @@ mpegts_network_class_get_scanq_length ( void *ptr )
   return &n;
 }
 
+static const void *
+mpegts_network_class_get_scan_rate ( void *ptr )
+{
+  static __thread int n;
+
+  n = mpegts_network_scan_rate((mpegts_network_t *)ptr);
+
+  return &n;
+}
+
 static void
 mpegts_network_class_idlescan_notify ( void *p )
 {
@@ -239,6 +249,13 @@ const idclass_t mpegts_network_class =
       .opts     = PO_RDONLY | PO_NOSAVE,
       .get      = mpegts_network_class_get_scanq_length,
     },
+    {
+      .type     = PT_INT,
+      .id       = "scan_rate",
+      .name     = "Scan rate (muxes/min)",
+      .opts     = PO_RDONLY | PO_NOSAVE | PO_ADVANCED,
+      .get      = mpegts_network_class_get_scan_rate,
+    },
     {}
   }
 };
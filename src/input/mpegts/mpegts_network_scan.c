@@ -19,6 +19,9 @@
 
 #include "input.h"
 
+/* Expected scan time of a mux not scanned yet (ms) */
+#define MPEGTS_SCAN_TIME_DEFAULT 10000
+
 /******************************************************************************
  * Timer
  *****************************************************************************/
@@ -31,10 +34,54 @@ mpegts_network_scan_notify ( mpegts_mux_t *mm )
   idnode_notify_changed(&mm->mm_network->mn_id);
 }
 
+static inline int
+mm_scan_time ( mpegts_mux_t *mm )
+{
+  return mm->mm_scan_time ?: MPEGTS_SCAN_TIME_DEFAULT;
+}
+
+/* Highest weight first, then the muxes with the tables arriving early */
 static int
 mm_cmp ( mpegts_mux_t *a, mpegts_mux_t *b )
 {
-  return b->mm_scan_weight - a->mm_scan_weight;
+  int r = b->mm_scan_weight - a->mm_scan_weight;
+  if (r == 0)
+    r = mm_scan_time(a) - mm_scan_time(b);
+  return r;
+}
+
+/* Scan run statistics */
+static void
+mpegts_network_scan_finish ( mpegts_network_t *mn )
+{
+  char buf[256];
+  int64_t t;
+  int n = mn->mn_scan_ok + mn->mn_scan_fail;
+
+  if (mn->mn_scan_start == 0)
+    return;
+  t = MAX(1, getmonoclock() - mn->mn_scan_start);
+  mn->mn_scan_rate = (n * 60000000LL + t / 2) / t;
+  mn->mn_scan_start = 0;
+  if (n) {
+    mn->mn_display_name(mn, buf, sizeof(buf));
+    tvhinfo("mpegts", "%s - scan finished, %d muxes (%d failed) in %"PRId64"s, "
+                      "%.1f muxes/min", buf, n, mn->mn_scan_fail,
+                      (t + 500000) / 1000000, n * 60000000.0 / t);
+  }
+  mn->mn_scan_ok = mn->mn_scan_fail = 0;
+  idnode_notify_changed(&mn->mn_id);
+}
+
+int
+mpegts_network_scan_rate ( mpegts_network_t *mn )
+{
+  int64_t t;
+
+  if (mn->mn_scan_start == 0)
+    return mn->mn_scan_rate;
+  t = MAX(1, getmonoclock() - mn->mn_scan_start);
+  return ((mn->mn_scan_ok + mn->mn_scan_fail) * 60000000LL + t / 2) / t;
 }
 
 void
@@ -42,7 +89,13 @@ mpegts_network_scan_timer_cb ( void *p )
 {
   mpegts_network_t *mn = p;
   mpegts_mux_t *mm, *nxt = NULL;
-  int r;
+  mpegts_network_link_t *mnl;
+  mpegts_input_t **busy;
+  int r, nbusy = 0, ninputs = 0;
+
+  LIST_FOREACH(mnl, &mn->mn_inputs, mnl_mn_link)
+    ninputs++;
+  busy = alloca(MAX(1, ninputs) * sizeof(mpegts_input_t *));
 
   /* Process Q */
   for (mm = TAILQ_FIRST(&mn->mn_scan_pend); mm != NULL; mm = nxt) {
@@ -52,6 +105,10 @@ mpegts_network_scan_timer_cb ( void *p )
     /* Don't try to subscribe already tuned muxes */
     if (mm->mm_active) continue;
 
+    /* All inputs able to tune this mux are taken, try the others */
+    if (nbusy && mpegts_mux_inputs_busy(mm, mm->mm_scan_flags, busy, nbusy))
+      continue;
+
     /* Attempt to tune */
     r = mpegts_mux_subscribe(mm, NULL, "scan", mm->mm_scan_weight,
                              mm->mm_scan_flags |
@@ -65,9 +122,13 @@ mpegts_network_scan_timer_cb ( void *p )
     }
     assert(mm->mm_scan_state == MM_SCAN_STATE_PEND);
 
-    /* No free tuners - stop */
-    if (r == SM_CODE_NO_FREE_ADAPTER)
-      break;
+    /* No free tuners for this mux, other muxes may use other inputs */
+    if (r == SM_CODE_NO_FREE_ADAPTER) {
+      nbusy = mpegts_mux_inputs_add_busy(mm, busy, nbusy, ninputs);
+      if (nbusy >= ninputs)
+        break;
+      continue;
+    }
 
     /* No valid tuners (subtly different, might be able to tuner a later
      * mux)
@@ -86,6 +147,10 @@ mpegts_network_scan_timer_cb ( void *p )
     mpegts_network_scan_notify(mm);
   }
 
+  /* Queue is empty */
+  if (TAILQ_EMPTY(&mn->mn_scan_pend) && TAILQ_EMPTY(&mn->mn_scan_active))
+    mpegts_network_scan_finish(mn);
+
   /* Re-arm timer. Really this is just a safety measure as we'd normally
    * expect the timer to be forcefully triggered on finish of a mux scan
    */
@@ -102,6 +167,18 @@ mpegts_network_scan_mux_done0
   ( mpegts_mux_t *mm, mpegts_mux_scan_result_t result, int weight )
 {
   mpegts_network_t *mn = mm->mm_network;
+  int t;
+
+  /* Learn the scan time, done and failed muxes are ordered by it */
+  if (mm->mm_scan_start && result != MM_SCAN_NONE) {
+    t = (getmonoclock() - mm->mm_scan_start) / 1000;
+    mm->mm_scan_time = mm->mm_scan_time ? (3 * mm->mm_scan_time + t) / 4 : MAX(1, t);
+    if (result == MM_SCAN_OK)
+      mn->mn_scan_ok++;
+    else
+      mn->mn_scan_fail++;
+  }
+  mm->mm_scan_start = 0;
 
   mpegts_mux_unsubscribe_by_name(mm, "scan");
   if (mm->mm_scan_state == MM_SCAN_STATE_PEND) {
@@ -177,6 +254,9 @@ mpegts_network_scan_mux_active ( mpegts_mux_t *mm )
     return;
   mm->mm_scan_state = MM_SCAN_STATE_ACTIVE;
   mm->mm_scan_init  = 0;
+  mm->mm_scan_start = getmonoclock();
+  if (mn->mn_scan_start == 0)
+    mn->mn_scan_start = mm->mm_scan_start;
   TAILQ_REMOVE(&mn->mn_scan_pend, mm, mm_scan_link);
   TAILQ_INSERT_TAIL(&mn->mn_scan_active, mm, mm_scan_link);
 }
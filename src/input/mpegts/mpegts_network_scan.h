@@ -30,6 +30,8 @@
  */
 void mpegts_network_scan_timer_cb ( void *p );
 
+int mpegts_network_scan_rate ( mpegts_network_t *mn );
+
 /*
  * Registration functions
  */
@@ -319,6 +319,8 @@ mpegts_service_start(service_t *t, int instance, int flags)
     return SM_CODE_UNDEFINED_ERROR;
 
   /* Start Mux */
+  if (t->s_type == STYPE_STD)
+    mpegts_warm_service_start(m);
   r = mpegts_mux_instance_start(&mmi);
 
   /* Start */
@@ -46,6 +46,7 @@ mpegts_table_fastswitch ( mpegts_mux_t *mm, mpegts_table_t *mtm )
 {
   char buf[256];
   mpegts_table_t   *mt;
+  int missing = 0, names = 0;
 
   assert(mm == mtm->mt_mux);
 
@@ -54,7 +55,7 @@ mpegts_table_fastswitch ( mpegts_mux_t *mm, mpegts_table_t *mtm )
   if ((mtm->mt_flags & MT_ONESHOT) && (mtm->mt_complete && !mtm->mt_working))
     mm->mm_unsubscribe_table(mm, mtm);
 
-  if (mm->mm_scan_state != MM_SCAN_STATE_ACTIVE) {
+  if (mm->mm_scan_state != MM_SCAN_STATE_ACTIVE && mm->mm_psi_time) {
     pthread_mutex_unlock(&mm->mm_tables_lock);
     return;
   }
@@ -62,15 +63,39 @@ mpegts_table_fastswitch ( mpegts_mux_t *mm, mpegts_table_t *mtm )
   LIST_FOREACH(mt, &mm->mm_tables, mt_link) {
     if (!(mt->mt_flags & MT_QUICKREQ) && !mt->mt_working)
       continue;
+    /* PMT announced in the PAT but not seen yet (PMTs repeat at least
+       twice a second), the other tables repeat less often and are
+       waited for until the scan timeout */
+    if(!mt->mt_count && mt->mt_table == DVB_PMT_BASE) {
+      missing++;
+      continue;
+    }
     if(!mt->mt_complete || mt->mt_working) {
       pthread_mutex_unlock(&mm->mm_tables_lock);
       return;
     }
+    if (mt->mt_table == DVB_SDT_BASE || mt->mt_table == DVB_VCT_T_BASE ||
+        mt->mt_table == DVB_VCT_C_BASE)
+      names = 1;
   }
 
   pthread_mutex_unlock(&mm->mm_tables_lock);
 
   mpegts_mux_nice_name(mm, buf, sizeof(buf));
+  /* The services are only usable with their names, tables dropped
+     by the scan timeout do not count as acquired */
+  if (!missing && names &&
+      !(mm->mm_scan_state == MM_SCAN_STATE_ACTIVE && mm->mm_scan_init))
+    mpegts_mux_psi_acquired(mm, buf);
+
+  if (mm->mm_scan_state != MM_SCAN_STATE_ACTIVE)
+    return;
+
+  if (missing) {
+    mpegts_mux_scan_quick(mm);
+    return;
+  }
+
   tvhinfo("mpegts", "%s scan complete", buf);
   mpegts_mux_scan_done(mm, buf, 1);
 }
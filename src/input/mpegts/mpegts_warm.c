@@ -0,0 +1,495 @@
+/*
+ *  Tvheadend - MPEGTS input pre-tuning planner
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Idle inputs with the "prewarm" option are tuned ahead of upcoming
+ * recordings and of the muxes users zap to often, and a mux a user
+ * zapped away from is kept tuned for a grace period. The muxes are held
+ * by oneshot raw subscriptions with the lowest (keep) weight, so any
+ * other subscription takes the input over as from an idle one.
+ */
+
+#include "input.h"
+#include "channels.h"
+#include "streaming.h"
+#include "dvr/dvr.h"
+
+#define MPEGTS_WARM_NAME      "prewarm"
+#define MPEGTS_WARM_PERIOD    5     /* planner pass (s) */
+#define MPEGTS_WARM_DVR_LEAD  30    /* tune before the recording starts (s) */
+#define MPEGTS_WARM_DVR_KEEP  60    /* ... and hold it after that (s) */
+#define MPEGTS_WARM_GRACE     30    /* hold a released mux per past zap (s) */
+#define MPEGTS_WARM_ZAPS      4     /* ... counting up to this many zaps */
+#define MPEGTS_WARM_HISTORY   16    /* muxes remembered per user */
+#define MPEGTS_WARM_USER_AGE  (7 * 24 * 3600)
+#define MPEGTS_WARM_STATS     600   /* summary period (s) */
+
+typedef enum {
+  MW_DVR,                           /* upcoming recording */
+  MW_RELEASE,                       /* user zapped away */
+  MW_HISTORY,                       /* user's most common other mux */
+  MW_REASONS
+} mpegts_warm_reason_t;
+
+static const char *mpegts_warm_reason_names[MW_REASONS] = {
+  "dvr", "release", "history"
+};
+
+typedef struct mpegts_warm {
+  LIST_ENTRY(mpegts_warm) mw_link;
+  char                   *mw_mux;   /* mux uuid */
+  mpegts_warm_reason_t    mw_reason;
+  int                     mw_hit;
+  time_t                  mw_expire;
+} mpegts_warm_t;
+
+typedef struct mpegts_warm_user {
+  LIST_ENTRY(mpegts_warm_user) mwu_link;
+  char                        *mwu_name;
+  time_t                       mwu_last;
+  struct {
+    char *mux;
+    int   zaps;
+  } mwu_hist[MPEGTS_WARM_HISTORY];  /* most recent first */
+} mpegts_warm_user_t;
+
+typedef struct mpegts_warm_stats {
+  int planned;
+  int hit;
+  int missed;
+  int failed;
+} mpegts_warm_stats_t;
+
+static LIST_HEAD(, mpegts_warm)      mpegts_warm_entries;
+static LIST_HEAD(, mpegts_warm_user) mpegts_warm_users;
+static gtimer_t                      mpegts_warm_timer;
+static mpegts_warm_stats_t           mpegts_warm_stats[MW_REASONS];
+static time_t                        mpegts_warm_stats_time;
+
+static void mpegts_warm_timer_cb ( void *aux );
+
+/******************************************************************************
+ * Helpers
+ *****************************************************************************/
+
+static int
+mpegts_warm_enabled ( void )
+{
+  mpegts_input_t *mi;
+
+  LIST_FOREACH(mi, &mpegts_input_all, mi_global_link)
+    if (mi->mi_enabled && mi->mi_prewarm)
+      return 1;
+  return 0;
+}
+
+static mpegts_warm_t *
+mpegts_warm_find ( mpegts_mux_t *mm )
+{
+  mpegts_warm_t *mw;
+  const char *uuid = idnode_uuid_as_str(&mm->mm_id);
+
+  LIST_FOREACH(mw, &mpegts_warm_entries, mw_link)
+    if (!strcmp(mw->mw_mux, uuid))
+      return mw;
+  return NULL;
+}
+
+/* Raw subscription of the planner which is still running the mux */
+static int
+mpegts_warm_linked ( mpegts_mux_t *mm )
+{
+  th_subscription_t *ths;
+
+  LIST_FOREACH(ths, &mm->mm_raw_subs, ths_mux_link)
+    if (ths->ths_service && !strcmp(ths->ths_title, MPEGTS_WARM_NAME))
+      return 1;
+  return 0;
+}
+
+/* Bumped subscriptions are unlinked, so do not use ths_service here */
+static void
+mpegts_warm_release ( mpegts_mux_t *mm )
+{
+  th_subscription_t *ths, *next;
+
+  for (ths = LIST_FIRST(&mm->mm_raw_subs); ths; ths = next) {
+    next = LIST_NEXT(ths, ths_mux_link);
+    if (!strcmp(ths->ths_title, MPEGTS_WARM_NAME))
+      subscription_unsubscribe(ths, 1);
+  }
+}
+
+static void
+mpegts_warm_destroy ( mpegts_warm_t *mw )
+{
+  LIST_REMOVE(mw, mw_link);
+  free(mw->mw_mux);
+  free(mw);
+}
+
+/*
+ * Tune an idle input (or keep mi) on the mux
+ */
+static void
+mpegts_warm_start
+  ( mpegts_mux_t *mm, mpegts_input_t *mi,
+    mpegts_warm_reason_t reason, time_t expire )
+{
+  mpegts_warm_t *mw;
+  char buf[256];
+  int r;
+
+  if ((mw = mpegts_warm_find(mm)) != NULL) {
+    if (!mw->mw_hit) {
+      if (mw->mw_expire < expire)
+        mw->mw_expire = expire;
+      return;
+    }
+    mpegts_warm_destroy(mw);
+  }
+
+  mpegts_mux_nice_name(mm, buf, sizeof(buf));
+  r = mpegts_mux_subscribe(mm, mi, MPEGTS_WARM_NAME, SUBSCRIPTION_PRIO_KEEP,
+                           SUBSCRIPTION_ONESHOT | SUBSCRIPTION_MINIMAL |
+                           SUBSCRIPTION_PREWARM);
+  if (r) {
+    mpegts_warm_stats[reason].failed++;
+    tvhtrace("mpegts", "%s - pre-tune (%s) failed: %s",
+             buf, mpegts_warm_reason_names[reason], streaming_code2txt(r));
+    return;
+  }
+
+  mw = calloc(1, sizeof(*mw));
+  mw->mw_mux    = strdup(idnode_uuid_as_str(&mm->mm_id));
+  mw->mw_reason = reason;
+  mw->mw_expire = expire;
+  LIST_INSERT_HEAD(&mpegts_warm_entries, mw, mw_link);
+  mpegts_warm_stats[reason].planned++;
+  tvhdebug("mpegts", "%s - pre-tuned (%s) for %"PRItime_t"s",
+           buf, mpegts_warm_reason_names[reason],
+           (time_t)(expire - dispatch_clock));
+}
+
+/******************************************************************************
+ * Zap history
+ *****************************************************************************/
+
+static mpegts_warm_user_t *
+mpegts_warm_user_find ( const char *name, int create )
+{
+  mpegts_warm_user_t *mwu;
+
+  LIST_FOREACH(mwu, &mpegts_warm_users, mwu_link)
+    if (!strcmp(mwu->mwu_name, name))
+      return mwu;
+  if (!create)
+    return NULL;
+  mwu = calloc(1, sizeof(*mwu));
+  mwu->mwu_name = strdup(name);
+  LIST_INSERT_HEAD(&mpegts_warm_users, mwu, mwu_link);
+  return mwu;
+}
+
+static void
+mpegts_warm_user_destroy ( mpegts_warm_user_t *mwu )
+{
+  int i;
+
+  LIST_REMOVE(mwu, mwu_link);
+  for (i = 0; i < MPEGTS_WARM_HISTORY; i++)
+    free(mwu->mwu_hist[i].mux);
+  free(mwu->mwu_name);
+  free(mwu);
+}
+
+/* Move the mux to the front of the history, returns its zap count */
+static int
+mpegts_warm_user_zap ( mpegts_warm_user_t *mwu, const char *uuid )
+{
+  char *mux = NULL;
+  int i, zaps = 0;
+
+  for (i = 0; i < MPEGTS_WARM_HISTORY - 1; i++)
+    if (mwu->mwu_hist[i].mux && !strcmp(mwu->mwu_hist[i].mux, uuid))
+      break;
+  mux  = mwu->mwu_hist[i].mux;
+  zaps = mwu->mwu_hist[i].zaps;
+  if (mux && strcmp(mux, uuid)) {
+    free(mux);
+    mux  = NULL;
+    zaps = 0;
+  }
+  memmove(&mwu->mwu_hist[1], &mwu->mwu_hist[0], i * sizeof(mwu->mwu_hist[0]));
+  mwu->mwu_hist[0].mux  = mux ?: strdup(uuid);
+  mwu->mwu_hist[0].zaps = ++zaps;
+  mwu->mwu_last = dispatch_clock;
+  return zaps;
+}
+
+/*
+ * A streaming channel subscription is going away, remember the mux and
+ * hold it for a while in case the user comes back
+ */
+void
+mpegts_warm_unsubscribe ( th_subscription_t *s )
+{
+  service_t *t = s->ths_service;
+  mpegts_mux_t *mm;
+  mpegts_input_t *mi;
+  mpegts_warm_user_t *mwu;
+  int zaps;
+
+  lock_assert(&global_lock);
+
+  if (!tvheadend_running || t == NULL || s->ths_channel == NULL)
+    return;
+  if (!(s->ths_flags & SUBSCRIPTION_STREAMING) ||
+      s->ths_state != SUBSCRIPTION_GOT_SERVICE)
+    return;
+  if (t->s_type != STYPE_STD ||
+      !idnode_is_instance(&t->s_id, &mpegts_service_class))
+    return;
+
+  mm = ((mpegts_service_t *)t)->s_dvb_mux;
+  if (mm->mm_active == NULL)
+    return;
+  mi = mm->mm_active->mmi_input;
+  if (!mi->mi_prewarm)
+    return;
+
+  mwu  = mpegts_warm_user_find(s->ths_username ?: s->ths_hostname ?: "", 1);
+  zaps = mpegts_warm_user_zap(mwu, idnode_uuid_as_str(&mm->mm_id));
+
+  mpegts_warm_start(mm, mi, MW_RELEASE,
+                    dispatch_clock + MPEGTS_WARM_GRACE * MIN(zaps, MPEGTS_WARM_ZAPS));
+}
+
+/*
+ * A service starts on the mux, count it if the planner tuned it
+ */
+void
+mpegts_warm_service_start ( mpegts_mux_t *mm )
+{
+  mpegts_warm_t *mw;
+  char buf[256];
+
+  if (LIST_EMPTY(&mpegts_warm_entries) || mm->mm_active == NULL)
+    return;
+  if ((mw = mpegts_warm_find(mm)) == NULL || mw->mw_hit)
+    return;
+  if (!mpegts_warm_linked(mm))
+    return;
+
+  mw->mw_hit = 1;
+  mpegts_warm_stats[mw->mw_reason].hit++;
+  mpegts_mux_nice_name(mm, buf, sizeof(buf));
+  tvhdebug("mpegts", "%s - pre-tuned mux used (%s)",
+           buf, mpegts_warm_reason_names[mw->mw_reason]);
+
+  /* The new subscriber holds the mux now */
+  gtimer_arm(&mpegts_warm_timer, mpegts_warm_timer_cb, NULL, 0);
+}
+
+/******************************************************************************
+ * Planner
+ *****************************************************************************/
+
+static void
+mpegts_warm_expire ( void )
+{
+  mpegts_warm_t *mw, *next;
+  mpegts_mux_t *mm;
+  char buf[256];
+
+  for (mw = LIST_FIRST(&mpegts_warm_entries); mw; mw = next) {
+    next = LIST_NEXT(mw, mw_link);
+    mm = mpegts_mux_find(mw->mw_mux);
+    if (mm == NULL) {
+      mpegts_warm_destroy(mw);
+      continue;
+    }
+    if (!mw->mw_hit) {
+      /* Taken over by someone else, or not needed in time */
+      if (mpegts_warm_linked(mm) && mw->mw_expire > dispatch_clock)
+        continue;
+      mpegts_warm_stats[mw->mw_reason].missed++;
+      mpegts_mux_nice_name(mm, buf, sizeof(buf));
+      tvhdebug("mpegts", "%s - pre-tuned mux %s (%s)", buf,
+               mpegts_warm_linked(mm) ? "expired" : "taken over",
+               mpegts_warm_reason_names[mw->mw_reason]);
+    }
+    mpegts_warm_release(mm);
+    mpegts_warm_destroy(mw);
+  }
+}
+
+/* Mux of a channel which can be tuned ahead */
+static void
+mpegts_warm_channel ( channel_t *ch, time_t expire )
+{
+  channel_service_mapping_t *csm;
+  mpegts_service_t *s;
+
+  LIST_FOREACH(csm, &ch->ch_services, csm_chn_link) {
+    if (!idnode_is_instance(&csm->csm_svc->s_id, &mpegts_service_class))
+      continue;
+    s = (mpegts_service_t *)csm->csm_svc;
+    if (s->s_dvb_mux->mm_active)
+      return;
+  }
+
+  LIST_FOREACH(csm, &ch->ch_services, csm_chn_link) {
+    if (!idnode_is_instance(&csm->csm_svc->s_id, &mpegts_service_class))
+      continue;
+    s = (mpegts_service_t *)csm->csm_svc;
+    if (!s->s_enabled || !s->s_dvb_mux->mm_is_enabled(s->s_dvb_mux))
+      continue;
+    if (mpegts_warm_find(s->s_dvb_mux))
+      return;
+    mpegts_warm_start(s->s_dvb_mux, NULL, MW_DVR, expire);
+    if (mpegts_warm_find(s->s_dvb_mux))
+      return;
+  }
+}
+
+static void
+mpegts_warm_dvr ( void )
+{
+  dvr_entry_t *de;
+  time_t start;
+
+  LIST_FOREACH(de, &dvrentries, de_global_link) {
+    if (de->de_sched_state != DVR_SCHEDULED || de->de_channel == NULL)
+      continue;
+    start = dvr_entry_get_start_time(de);
+    if (start < dispatch_clock || start > dispatch_clock + MPEGTS_WARM_DVR_LEAD)
+      continue;
+    mpegts_warm_channel(de->de_channel, start + MPEGTS_WARM_DVR_KEEP);
+  }
+}
+
+/*
+ * Users watching something now get their most zapped other mux tuned
+ */
+static void
+mpegts_warm_history ( void )
+{
+  th_subscription_t *s;
+  mpegts_warm_user_t *mwu, *next;
+  mpegts_mux_t *mm, *best;
+  int i, zaps;
+
+  LIST_FOREACH(s, &subscriptions, ths_global_link) {
+    if (s->ths_channel == NULL || !(s->ths_flags & SUBSCRIPTION_STREAMING) ||
+        s->ths_state != SUBSCRIPTION_GOT_SERVICE)
+      continue;
+    mwu = mpegts_warm_user_find(s->ths_username ?: s->ths_hostname ?: "", 0);
+    if (mwu == NULL)
+      continue;
+    mwu->mwu_last = dispatch_clock;
+    best = NULL;
+    zaps = 1;
+    for (i = 0; i < MPEGTS_WARM_HISTORY && mwu->mwu_hist[i].mux; i++) {
+      if (mwu->mwu_hist[i].zaps <= zaps)
+        continue;
+      mm = mpegts_mux_find(mwu->mwu_hist[i].mux);
+      if (mm == NULL || mm->mm_active || !mm->mm_is_enabled(mm))
+        continue;
+      best = mm;
+      zaps = mwu->mwu_hist[i].zaps;
+    }
+    if (best)
+      mpegts_warm_start(best, NULL, MW_HISTORY,
+                        dispatch_clock + 2 * MPEGTS_WARM_PERIOD);
+  }
+
+  for (mwu = LIST_FIRST(&mpegts_warm_users); mwu; mwu = next) {
+    next = LIST_NEXT(mwu, mwu_link);
+    if (mwu->mwu_last + MPEGTS_WARM_USER_AGE < dispatch_clock)
+      mpegts_warm_user_destroy(mwu);
+  }
+}
+
+static void
+mpegts_warm_report ( void )
+{
+  mpegts_warm_stats_t *st;
+  int i;
+
+  for (i = 0; i < MW_REASONS; i++) {
+    st = &mpegts_warm_stats[i];
+    if (st->planned == 0)
+      continue;
+    tvhinfo("mpegts", "pre-tune %s: %d planned, %d used (%d%%), %d unused, %d failed",
+            mpegts_warm_reason_names[i], st->planned, st->hit,
+            st->hit * 100 / st->planned, st->missed, st->failed);
+  }
+}
+
+static void
+mpegts_warm_timer_cb ( void *aux )
+{
+  mpegts_warm_expire();
+
+  if (mpegts_warm_enabled()) {
+    mpegts_warm_dvr();
+    mpegts_warm_history();
+  }
+
+  if (mpegts_warm_stats_time + MPEGTS_WARM_STATS <= dispatch_clock) {
+    mpegts_warm_stats_time = dispatch_clock;
+    mpegts_warm_report();
+  }
+
+  gtimer_arm(&mpegts_warm_timer, mpegts_warm_timer_cb, NULL,
+             MPEGTS_WARM_PERIOD);
+}
+
+/******************************************************************************
+ * Init / Teardown
+ *****************************************************************************/
+
+void
+mpegts_warm_init ( void )
+{
+  mpegts_warm_stats_time = dispatch_clock;
+  gtimer_arm(&mpegts_warm_timer, mpegts_warm_timer_cb, NULL,
+             MPEGTS_WARM_PERIOD);
+}
+
+void
+mpegts_warm_done ( void )
+{
+  mpegts_warm_user_t *mwu;
+  mpegts_warm_t *mw;
+
+  pthread_mutex_lock(&global_lock);
+  gtimer_disarm(&mpegts_warm_timer);
+  mpegts_warm_report();
+  while ((mw = LIST_FIRST(&mpegts_warm_entries)) != NULL)
+    mpegts_warm_destroy(mw);
+  while ((mwu = LIST_FIRST(&mpegts_warm_users)) != NULL)
+    mpegts_warm_user_destroy(mwu);
+  pthread_mutex_unlock(&global_lock);
+}
+
+/******************************************************************************
+ * Editor Configuration
+ *
+ * vim:sts=2:ts=2:sw=2:et
+ *****************************************************************************/
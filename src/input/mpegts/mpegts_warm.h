@@ -0,0 +1,42 @@
+/*
+ *  Tvheadend - MPEGTS input pre-tuning planner
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __TVH_MPEGTS_WARM_H__
+#define __TVH_MPEGTS_WARM_H__
+
+#include "tvheadend.h"
+#include "subscriptions.h"
+
+/*
+ * Events
+ */
+void mpegts_warm_service_start ( mpegts_mux_t *mm );
+void mpegts_warm_unsubscribe   ( th_subscription_t *s );
+
+/*
+ * Init / Teardown
+ */
+void mpegts_warm_init ( void );
+void mpegts_warm_done ( void );
+
+#endif /* __TVH_MPEGTS_WARM_H__ */
+
+/******************************************************************************
+ * Editor Configuration
+ *
+ * vim:sts=2:ts=2:sw=2:et
+ *****************************************************************************/
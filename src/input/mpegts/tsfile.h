@@ -25,8 +25,9 @@
 struct mpegts_mux;
 struct mpegts_network;
 
-/* Initialise system (with N tuners) */
-void tsfile_init ( int tuners );
+/* Initialise system (with N tuners, speed "max" or a real time multiplier,
+ * loops = number of file passes or 0 to repeat forever) */
+void tsfile_init ( int tuners, const char *speed, int loops );
 
 /* Shutdown */
 void tsfile_done ( void );
@@ -29,6 +29,8 @@
 pthread_mutex_t          tsfile_lock;
 mpegts_network_t         *tsfile_network;
 tsfile_input_list_t      tsfile_inputs;
+double                   tsfile_speed = 1;
+int                      tsfile_loops;
 
 extern const idclass_t mpegts_service_class;
 extern const idclass_t mpegts_network_class;
@@ -61,11 +63,32 @@ tsfile_network_create_service
 /*
  * Initialise
  */
-void tsfile_init ( int tuners )
+void tsfile_init ( int tuners, const char *speed, int loops )
 {
   int i;
   tsfile_input_t *mi;
 
+  /* Playback speed */
+  if (speed && !strcmp(speed, "max")) {
+    tsfile_speed = 0;
+  } else if (speed) {
+    tsfile_speed = atof(speed);
+    if (tsfile_speed <= 0) {
+      tvhlog(LOG_WARNING, "tsfile", "invalid speed '%s', using real time", speed);
+      tsfile_speed = 1;
+    }
+  }
+  tsfile_loops = MAX(loops, 0);
+  if (tsfile_speed != 1 || tsfile_loops) {
+    char buf[32];
+    if (tsfile_speed > 0)
+      snprintf(buf, sizeof(buf), "%gx", tsfile_speed);
+    else
+      strcpy(buf, "unpaced");
+    tvhlog(LOG_INFO, "tsfile", "playback speed %s, %d passes%s",
+           buf, tsfile_loops, tsfile_loops ? "" : " (forever)");
+  }
+
   /* Mutex - used for minor efficiency in service processing */
   pthread_mutex_init(&tsfile_lock, NULL);
 
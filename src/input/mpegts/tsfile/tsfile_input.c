@@ -33,13 +33,41 @@
 
 extern const idclass_t mpegts_input_class;
 
+#define TSFILE_QUEUE_MAX (4*1024*1024) /* input queue limit in bytes */
+
+static int64_t
+tsfile_input_clock ( clockid_t id )
+{
+  struct timespec ts;
+  if (clock_gettime(id, &ts))
+    return 0;
+  return (int64_t)ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+/*
+ * Playback statistics (one file pass)
+ */
+static void
+tsfile_input_stats
+  ( tsfile_input_t *mi, int pass, uint64_t bytes, int64_t wall, int64_t cpu )
+{
+  double secs = MAX(wall, 1) / 1000000.0;
+
+  tvhdebug("tsfile", "adapter %d pass %d: %"PRIu64" bytes in %.3fs, "
+           "%.1f Mbit/s, %.0f packets/s, cpu %.1f%%",
+           mi->mi_instance, pass, bytes, secs,
+           (bytes * 8) / secs / 1000000.0, (bytes / 188) / secs,
+           (cpu * 100.0) / MAX(wall, 1));
+}
 
 static void *
 tsfile_input_thread ( void *aux )
 {
-  int fd = -1, nfds;
-  size_t len, rem;
+  int fd = -1, nfds, pass = 0;
+  size_t len, rem, qsize;
   ssize_t c;
+  uint64_t bytes = 0, total = 0;
+  int64_t start, cpu, pstart, pcpu, now, ncpu;
   tvhpoll_t *efd;
   tvhpoll_event_t ev;
   struct stat st;
@@ -89,6 +117,9 @@ tsfile_input_thread ( void *aux )
   len = 0;
   tvhtrace("tsfile", "adapter %d file size %jd rem %zu",
            mi->mi_instance, (intmax_t)st.st_size, rem);
+
+  start = pstart = tsfile_input_clock(CLOCK_MONOTONIC);
+  cpu = pcpu = tsfile_input_clock(CLOCK_THREAD_CPUTIME_ID);
   
   /* Process input */
   while (1) {
@@ -107,6 +138,15 @@ tsfile_input_thread ( void *aux )
     /* Check for terminate */
     nfds = tvhpoll_wait(efd, &ev, 1, 0);
     if (nfds == 1) break;
+
+    /* Let the input thread catch up (unpaced playback) */
+    pthread_mutex_lock(&mi->mi_input_lock);
+    qsize = mi->mi_input_queue_size;
+    pthread_mutex_unlock(&mi->mi_input_lock);
+    if (qsize > TSFILE_QUEUE_MAX) {
+      if (tvhpoll_wait(efd, &ev, 1, 1) == 1) break;
+      continue;
+    }
     
     /* Read */
     c = sbuf_read(&buf, fd);
@@ -123,9 +163,31 @@ tsfile_input_thread ( void *aux )
     if (len >= st.st_size) {
       len = 0;
       c -= rem;
+      bytes += c;
+      pass++;
+      now  = tsfile_input_clock(CLOCK_MONOTONIC);
+      ncpu = tsfile_input_clock(CLOCK_THREAD_CPUTIME_ID);
+      tsfile_input_stats(mi, pass, bytes, now - pstart, ncpu - pcpu);
+      total += bytes;
+      bytes  = 0;
+      pstart = now;
+      pcpu   = ncpu;
+      if (tsfile_loops > 0 && pass >= tsfile_loops) {
+        if (c > 0)
+          mpegts_input_recv_packets((mpegts_input_t*)mi, mmi, &buf, NULL, NULL);
+        tvhlog(LOG_INFO, "tsfile", "adapter %d finished %d passes, "
+               "%.1f Mbit/s, cpu %.1f%%", mi->mi_instance, pass,
+               (total * 8.0) / MAX(pstart - start, 1),
+               ((pcpu - cpu) * 100.0) / MAX(pstart - start, 1));
+        /* Idle until stopped */
+        while (tvhpoll_wait(efd, &ev, 1, -1) < 0 && ERRNO_AGAIN(errno));
+        break;
+      }
       tvhtrace("tsfile", "adapter %d reached eof, resetting", mi->mi_instance);
       lseek(fd, 0, SEEK_SET);
       pcr_last = PTS_UNSET;
+    } else {
+      bytes += c;
     }
 
     /* Process */
@@ -135,7 +197,7 @@ tsfile_input_thread ( void *aux )
                                 &pcr, &tmi->mmi_tsfile_pcr_pid);
 
       /* Delay */
-      if (pcr != PTS_UNSET) {
+      if (pcr != PTS_UNSET && tsfile_speed > 0) {
         if (pcr_last != PTS_UNSET) {
           struct timespec slp;
           int64_t delta;
@@ -146,7 +208,7 @@ tsfile_input_thread ( void *aux )
             delta = 0;
           else if (delta > 90000)
             delta = 90000;
-          delta *= 11;
+          delta = delta * 11 / tsfile_speed;
 
 #if PLATFORM_LINUX
           delta += pcr_last_realtime;
@@ -35,6 +35,8 @@ typedef LIST_HEAD(,tsfile_input)   tsfile_input_list_t;
 extern mpegts_network_t    *tsfile_network;
 extern tsfile_input_list_t tsfile_inputs;
 extern pthread_mutex_t     tsfile_lock;
+extern double              tsfile_speed; ///< playback speed, 0 = unpaced
+extern int                 tsfile_loops; ///< file passes, 0 = forever
 
 
 /*
@@ -614,7 +614,9 @@ main(int argc, char **argv)
               opt_satip_rtsp   = 0,
 #if ENABLE_TSFILE
               opt_tsfile_tuner = 0,
+              opt_tsfile_loops = 0,
 #endif
+              opt_iptv_threads = 1,
               opt_dump         = 0,
               opt_xspf         = 0,
               opt_dbus         = 0,
@@ -630,6 +632,9 @@ main(int argc, char **argv)
              *opt_pidpath      = "/var/run/tvheadend.pid",
 #if ENABLE_LINUXDVB
              *opt_dvb_adapters = NULL,
+#endif
+#if ENABLE_TSFILE
+             *opt_tsfile_speed = NULL,
 #endif
              *opt_bindaddr     = NULL,
              *opt_subscribe    = NULL,
@@ -672,6 +677,10 @@ main(int argc, char **argv)
 #if ENABLE_SATIP_CLIENT
     {   0, "satip_xml", "URL with the SAT>IP server XML location",
       OPT_STR_LIST, &opt_satip_xml },
+#endif
+#if ENABLE_IPTV
+    {   0, "iptv_threads", "Number of IPTV input threads",
+      OPT_INT, &opt_iptv_threads },
 #endif
     {   0, NULL,         "Server Connectivity",    OPT_BOOL, NULL         },
     { '6', "ipv6",       "Listen on IPv6",         OPT_BOOL, &opt_ipv6    },
@@ -716,6 +725,10 @@ main(int argc, char **argv)
 #if ENABLE_TSFILE
     { 0, "tsfile_tuners", "Number of tsfile tuners", OPT_INT, &opt_tsfile_tuner },
     { 0, "tsfile", "tsfile input (mux file)", OPT_STR_LIST, &opt_tsfile },
+    { 0, "tsfile_speed", "tsfile playback speed (max = unpaced, N = N times real time)",
+      OPT_STR, &opt_tsfile_speed },
+    { 0, "tsfile_loops", "Number of tsfile passes (0 = forever)",
+      OPT_INT, &opt_tsfile_loops },
 #endif
 #if ENABLE_TSDEBUG
     { 0, "tsdebug", "Output directory for tsdebug", OPT_STR, &tvheadend_tsdebug },
@@ -994,7 +1007,8 @@ main(int argc, char **argv)
   dvb_init();
 
 #if ENABLE_MPEGTS
-  mpegts_init(adapter_mask, &opt_satip_xml, &opt_tsfile, opt_tsfile_tuner);
+  mpegts_init(adapter_mask, &opt_satip_xml, &opt_tsfile, opt_tsfile_tuner,
+              opt_tsfile_speed, opt_tsfile_loops, opt_iptv_threads);
 #endif
 
   channel_init();
@@ -1080,6 +1094,7 @@ main(int argc, char **argv)
   tvhftrace("main", fsmonitor_done);
   tvhftrace("main", http_client_done);
   tvhftrace("main", tcp_server_done);
+  tvhftrace("main", webui_share_done);
 
   // Note: the locking is obviously a bit redundant, but without
   //       we need to disable the gtimer_arm call in epg_save()
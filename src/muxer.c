@@ -269,7 +269,8 @@ static struct strtab cache_types[] = {
   { "System",             MC_CACHE_SYSTEM },
   { "Do not keep",        MC_CACHE_DONTKEEP },
   { "Sync",               MC_CACHE_SYNC },
-  { "Sync + Do not keep", MC_CACHE_SYNCDONTKEEP }
+  { "Sync + Do not keep", MC_CACHE_SYNCDONTKEEP },
+  { "Direct I/O",         MC_CACHE_DIRECT }
 };
 
 const char*
@@ -296,6 +297,7 @@ muxer_cache_update(muxer_t *m, int fd, off_t pos, size_t size)
   switch (m->m_config.m_cache) {
   case MC_CACHE_UNKNOWN:
   case MC_CACHE_SYSTEM:
+  case MC_CACHE_DIRECT:
     break;
   case MC_CACHE_SYNC:
     fdatasync(fd);
@@ -41,7 +41,8 @@ typedef enum {
   MC_CACHE_DONTKEEP     = 2,
   MC_CACHE_SYNC         = 3,
   MC_CACHE_SYNCDONTKEEP = 4,
-  MC_CACHE_LAST         = MC_CACHE_SYNCDONTKEEP
+  MC_CACHE_DIRECT       = 5,
+  MC_CACHE_LAST         = MC_CACHE_DIRECT
 } muxer_cache_type_t;
 
 /* Muxer configuration used when creating a muxer. */
@@ -68,6 +69,7 @@ struct streaming_start;
 struct th_pkt;
 struct epg_broadcast;
 struct service;
+struct dvr_io;
 
 typedef struct muxer {
   int         (*m_open_stream)(struct muxer *, int fd);                 // Open for socket streaming
@@ -91,6 +93,7 @@ typedef struct muxer {
   int                    m_eos;        // End of stream
   int                    m_errors;     // Number of errors
   muxer_config_t         m_config;     // general configuration
+  struct dvr_io         *m_io;         // Write-behind I/O (recordings)
 } muxer_t;
 
 
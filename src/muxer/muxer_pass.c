@@ -455,6 +455,7 @@ pass_muxer_open_file(muxer_t *m, const char *filename)
   pm->pm_seekable = 1;
   pm->pm_fd       = fd;
   pm->pm_filename = strdup(filename);
+  pm->m_io        = dvr_io_create(m, fd, filename);
   return 0;
 }
 
@@ -469,6 +470,11 @@ pass_muxer_write(muxer_t *m, const void *data, size_t size)
 
   if(pm->pm_error) {
     pm->m_errors++;
+  } else if(m->m_io) {
+    if((pm->pm_error = dvr_io_write(m->m_io, pm->pm_off, data, size)) != 0)
+      m->m_errors++;
+    else
+      pm->pm_off += size;
   } else if(tvh_write(pm->pm_fd, data, size)) {
     pm->pm_error = errno;
     if (!MC_IS_EOS_ERROR(errno))
@@ -605,7 +611,17 @@ pass_muxer_close(muxer_t *m)
 {
   pass_muxer_t *pm = (pass_muxer_t*)m;
 
-  if(pm->pm_seekable && close(pm->pm_fd)) {
+  if(m->m_io) {
+    int err = dvr_io_close(m->m_io);
+    m->m_io = NULL;
+    if(err) {
+      pm->pm_error = err;
+      tvhlog(LOG_ERR, "pass", "%s: Unable to close file -- %s",
+             pm->pm_filename, strerror(err));
+      pm->m_errors++;
+      return -1;
+    }
+  } else if(pm->pm_seekable && close(pm->pm_fd)) {
     pm->pm_error = errno;
     tvhlog(LOG_ERR, "pass", "%s: Unable to close file, close failed -- %s",
 	   pm->pm_filename, strerror(errno));
@@ -625,6 +641,9 @@ pass_muxer_destroy(muxer_t *m)
 {
   pass_muxer_t *pm = (pass_muxer_t*)m;
 
+  if(m->m_io)
+    dvr_io_close(m->m_io);
+
   if(pm->pm_filename)
     free(pm->pm_filename);
 
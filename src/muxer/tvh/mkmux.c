@@ -470,6 +470,16 @@ mk_write_to_fd(mk_mux_t *mkm, htsbuf_queue_t *hq)
     iov[i++].iov_len  = hd->hd_data_len - hd->hd_data_off;
   }
 
+  if(mkm->m->m_io) {
+    if((mkm->error = dvr_io_writev(mkm->m->m_io, mkm->fdpos, iov, i)) != 0) {
+      errno = mkm->error;
+      return -1;
+    }
+    while(i--)
+      mkm->fdpos += iov[i].iov_len;
+    return 0;
+  }
+
   do {
     ssize_t r;
     int iovcnt = i < dvr_iov_max ? i : dvr_iov_max;
@@ -1132,6 +1142,7 @@ mk_mux_open_file(mk_mux_t *mkm, const char *filename, int permissions)
   mkm->fd = fd;
   mkm->cluster_maxsize = 2000000/4;
   mkm->seekable = 1;
+  mkm->m->m_io = dvr_io_create(mkm->m, fd, filename);
 
   return 0;
 }
@@ -1292,6 +1303,7 @@ mk_mux_close(mk_mux_t *mkm)
 
   if(mkm->seekable) {
     // Rewrite segment info to update duration
+    mkm->fdpos = mkm->segmentinfo_pos;
     if(lseek(mkm->fd, mkm->segmentinfo_pos, SEEK_SET) == mkm->segmentinfo_pos)
       mk_write_master(mkm, 0x1549a966, mk_build_segment_info(mkm));
     else {
@@ -1301,6 +1313,7 @@ mk_mux_close(mk_mux_t *mkm)
     }
 
     // Rewrite segment header to update total size
+    mkm->fdpos = mkm->segment_header_pos;
     if(lseek(mkm->fd, mkm->segment_header_pos, SEEK_SET) == mkm->segment_header_pos) {
       mk_write_segment_header(mkm, totsize - mkm->segment_header_pos - 12);
     } else {
@@ -1309,7 +1322,15 @@ mk_mux_close(mk_mux_t *mkm)
 	     mkm->filename, strerror(errno));
     }
 
-    if(close(mkm->fd)) {
+    if(mkm->m->m_io) {
+      int err = dvr_io_close(mkm->m->m_io);
+      mkm->m->m_io = NULL;
+      if(err) {
+        mkm->error = err;
+        tvhlog(LOG_ERR, "mkv", "%s: Unable to close the file -- %s",
+               mkm->filename, strerror(err));
+      }
+    } else if(close(mkm->fd)) {
       mkm->error = errno;
       tvhlog(LOG_ERR, "mkv", "%s: Unable to close the file descriptor, close failed -- %s",
 	     mkm->filename, strerror(errno));
@@ -1328,6 +1349,11 @@ mk_mux_destroy(mk_mux_t *mkm)
 {
   mk_chapter_t *ch;
 
+  if(mkm->m->m_io) {
+    dvr_io_close(mkm->m->m_io);
+    mkm->m->m_io = NULL;
+  }
+
   while((ch = TAILQ_FIRST(&mkm->chapters)) != NULL) {
     TAILQ_REMOVE(&mkm->chapters, ch, link);
     free(ch);
@@ -32,6 +32,53 @@ static htsmsg_t              *notify_queue;
 static pthread_t              notify_tid;
 static void*                  notify_thread(void* p);
 
+/* Queued event / action / id triplets */
+#define NOTIFY_HASH_SIZE 1024
+
+typedef struct notify_key {
+  LIST_ENTRY(notify_key) link;
+  char key[0];
+} notify_key_t;
+
+static LIST_HEAD(, notify_key) notify_hash[NOTIFY_HASH_SIZE];
+
+static int
+notify_hash_add(const char *id, const char *event, const char *action)
+{
+  size_t l1 = strlen(event) + 1, l2 = strlen(action) + 1, l3 = strlen(id) + 1;
+  char key[l1 + l2 + l3];
+  notify_key_t *nk;
+  uint32_t h = 2166136261u;
+  size_t i;
+
+  memcpy(key, event, l1);
+  memcpy(key + l1, action, l2);
+  memcpy(key + l1 + l2, id, l3);
+  for (i = 0; i < sizeof(key); i++)
+    h = (h ^ (uint8_t)key[i]) * 16777619u;
+  h &= NOTIFY_HASH_SIZE - 1;
+  LIST_FOREACH(nk, &notify_hash[h], link)
+    if (!memcmp(nk->key, key, sizeof(key)))
+      return 0;
+  nk = malloc(sizeof(*nk) + sizeof(key));
+  memcpy(nk->key, key, sizeof(key));
+  LIST_INSERT_HEAD(&notify_hash[h], nk, link);
+  return 1;
+}
+
+static void
+notify_hash_clear(void)
+{
+  notify_key_t *nk;
+  int i;
+
+  for (i = 0; i < NOTIFY_HASH_SIZE; i++)
+    while ((nk = LIST_FIRST(&notify_hash[i])) != NULL) {
+      LIST_REMOVE(nk, link);
+      free(nk);
+    }
+}
+
 void
 notify_by_msg(const char *class, htsmsg_t *m)
 {
@@ -53,12 +100,13 @@ void
 notify_delayed(const char *id, const char *event, const char *action)
 {
   htsmsg_t *m = NULL, *e = NULL;
-  htsmsg_field_t *f;
 
   if (!tvheadend_running)
     return;
 
   pthread_mutex_lock(&notify_mutex);
+  if (!notify_hash_add(id, event, action))
+    goto skip;
   if (notify_queue == NULL) {
     notify_queue = htsmsg_create_map();
   } else {
@@ -71,9 +119,6 @@ notify_delayed(const char *id, const char *event, const char *action)
   }
   if (e == NULL)
     e = htsmsg_add_msg(m, action, htsmsg_create_list());
-  HTSMSG_FOREACH(f, e)
-    if (strcmp(htsmsg_field_get_str(f) ?: "", id) == 0)
-      goto skip;
   htsmsg_add_str(e, NULL, id);
   pthread_cond_signal(&notify_cond);
 skip:
@@ -97,6 +142,7 @@ notify_thread ( void *p )
     }
     q            = notify_queue;
     notify_queue = NULL;
+    notify_hash_clear();
     pthread_mutex_unlock(&notify_mutex);
 
     /* Process */
@@ -137,5 +183,6 @@ void notify_done( void )
   pthread_mutex_lock(&notify_mutex);
   htsmsg_destroy(notify_queue);
   notify_queue = NULL;
+  notify_hash_clear();
   pthread_mutex_unlock(&notify_mutex);
 }
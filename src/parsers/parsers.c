@@ -1485,6 +1485,19 @@ parser_deliver(service_t *t, elementary_stream_t *st, th_pkt_t *pkt)
   pkt->pkt_aspect_num = st->es_aspect_num;
   pkt->pkt_aspect_den = st->es_aspect_den;
 
+  /* Remember the stream parameters for the next start */
+  if (pkt->pkt_meta && pkt->pkt_meta != st->es_meta) {
+    if (st->es_meta)
+      pktbuf_ref_dec(st->es_meta);
+    st->es_meta = pkt->pkt_meta;
+    pktbuf_ref_inc(st->es_meta);
+  }
+  if (SCT_ISAUDIO(st->es_type) && pkt->pkt_channels && pkt->pkt_sri) {
+    st->es_channels = pkt->pkt_channels;
+    st->es_sri      = pkt->pkt_sri;
+    st->es_ext_sri  = pkt->pkt_ext_sri;
+  }
+
   //  avgstat_add(&st->es_rate, pkt->pkt_payloadlen, dispatch_clock);
 
   /**
@@ -1498,6 +1511,8 @@ parser_deliver(service_t *t, elementary_stream_t *st, th_pkt_t *pkt)
   /* Forward packet */
   pkt->pkt_componentindex = st->es_index;
 
+  service_gop_add(t, st, pkt);
+
   streaming_pad_deliver(&t->s_streaming_pad, streaming_msg_create_pkt(pkt));
 
   /* Decrease our own reference to the packet */
@@ -32,6 +32,12 @@ typedef struct globalheaders {
 
   int gh_passthru;
 
+  int64_t gh_start_time;
+  int gh_hold_time;   /* ms from start to the complete headers */
+
+  uint8_t *gh_live;   /* per component, live header seen */
+  int gh_unverified;  /* released with cached headers not seen live yet */
+
 } globalheaders_t;
 
 #define PTS_MASK      0x1ffffffffLL
@@ -69,6 +75,9 @@ gh_flush(globalheaders_t *gh)
     streaming_start_unref(gh->gh_ss);
     gh->gh_ss = NULL;
   }
+  free(gh->gh_live);
+  gh->gh_live = NULL;
+  gh->gh_unverified = 0;
 
   pktref_clear_queue(&gh->gh_holdq);
 }
@@ -83,7 +92,10 @@ apply_header(streaming_start_component_t *ssc, th_pkt_t *pkt)
   if(ssc->ssc_frameduration == 0 && pkt->pkt_duration != 0)
     ssc->ssc_frameduration = pkt->pkt_duration;
 
-  if(SCT_ISAUDIO(ssc->ssc_type) && !ssc->ssc_channels && !ssc->ssc_sri) {
+  /* the start message may carry cached values, the live ones win */
+  if(SCT_ISAUDIO(ssc->ssc_type) &&
+     ((!ssc->ssc_channels && !ssc->ssc_sri) ||
+      (pkt->pkt_channels && pkt->pkt_sri))) {
     ssc->ssc_channels = pkt->pkt_channels;
     ssc->ssc_sri      = pkt->pkt_sri;
     ssc->ssc_ext_sri  = pkt->pkt_ext_sri;
@@ -96,15 +108,25 @@ apply_header(streaming_start_component_t *ssc, th_pkt_t *pkt)
     }
   }
 
-  if(ssc->ssc_gh != NULL)
-    return;
-
-  if(pkt->pkt_meta != NULL) {
+  if(pkt->pkt_meta != NULL && pkt->pkt_meta != ssc->ssc_gh) {
+    if(ssc->ssc_gh != NULL) {
+      if(pktbuf_len(ssc->ssc_gh) == pktbuf_len(pkt->pkt_meta) &&
+         !memcmp(pktbuf_ptr(ssc->ssc_gh), pktbuf_ptr(pkt->pkt_meta),
+                 pktbuf_len(pkt->pkt_meta)))
+        return;
+      tvhdebug("parser", "gh stream %d %s (PID %i) cached headers replaced",
+               ssc->ssc_index, streaming_component_type2txt(ssc->ssc_type),
+               ssc->ssc_pid);
+      pktbuf_ref_dec(ssc->ssc_gh);
+    }
     ssc->ssc_gh = pkt->pkt_meta;
     pktbuf_ref_inc(ssc->ssc_gh);
     return;
   }
 
+  if(ssc->ssc_gh != NULL)
+    return;
+
   if (ssc->ssc_type == SCT_MP4A || ssc->ssc_type == SCT_AAC) {
     ssc->ssc_gh = pktbuf_alloc(NULL, pkt->pkt_ext_sri ? 5 : 2);
     uint8_t *d = pktbuf_ptr(ssc->ssc_gh);
@@ -262,10 +284,69 @@ static void
 gh_start(globalheaders_t *gh, streaming_message_t *sm)
 {
   gh->gh_ss = streaming_start_copy(sm->sm_data);
+  gh->gh_live = calloc(1, MAX(1, gh->gh_ss->ss_num_components));
+  gh->gh_start_time = getmonoclock();
+  gh->gh_hold_time = 0;
   streaming_msg_free(sm);
 }
 
 
+/**
+ * Headers taken from the service cache, not seen in the stream yet
+ */
+static void
+gh_count_unverified(globalheaders_t *gh)
+{
+  streaming_start_component_t *ssc;
+  int i;
+
+  gh->gh_unverified = 0;
+  for(i = 0; i < gh->gh_ss->ss_num_components; i++) {
+    ssc = &gh->gh_ss->ss_components[i];
+    if(ssc->ssc_gh && !ssc->ssc_disabled && !gh->gh_live[i] &&
+       gh_require_meta(ssc->ssc_type))
+      gh->gh_unverified++;
+  }
+}
+
+
+/**
+ * The first live header of a component released with a cached one,
+ * restart the output when they differ (re-encoded channel)
+ */
+static void
+gh_verify(globalheaders_t *gh, th_pkt_t *pkt)
+{
+  streaming_start_component_t *ssc;
+  int i;
+
+  ssc = streaming_start_component_find_by_index(gh->gh_ss,
+                                                pkt->pkt_componentindex);
+  if(ssc == NULL)
+    return;
+  i = ssc - gh->gh_ss->ss_components;
+  if(gh->gh_live[i])
+    return;
+  gh->gh_live[i] = 1;
+  if(!gh_require_meta(ssc->ssc_type) || ssc->ssc_disabled)
+    return;
+  gh->gh_unverified--;
+  if(ssc->ssc_gh == NULL ||
+     (pktbuf_len(ssc->ssc_gh) == pktbuf_len(pkt->pkt_meta) &&
+      !memcmp(pktbuf_ptr(ssc->ssc_gh), pktbuf_ptr(pkt->pkt_meta),
+              pktbuf_len(pkt->pkt_meta))))
+    return;
+  tvhdebug("parser", "gh stream %d %s (PID %i) cached headers differ, restart",
+           ssc->ssc_index, streaming_component_type2txt(ssc->ssc_type),
+           ssc->ssc_pid);
+  pktbuf_ref_dec(ssc->ssc_gh);
+  ssc->ssc_gh = pkt->pkt_meta;
+  pktbuf_ref_inc(ssc->ssc_gh);
+  streaming_target_deliver2(gh->gh_output,
+    streaming_msg_create_data(SMT_START, streaming_start_copy(gh->gh_ss)));
+}
+
+
 /**
  *
  */
@@ -286,6 +367,8 @@ gh_hold(globalheaders_t *gh, streaming_message_t *sm)
     pkt_ref_inc(pkt);
 
     apply_header(ssc, pkt);
+    if (pkt->pkt_meta)
+      gh->gh_live[ssc - gh->gh_ss->ss_components] = 1;
 
     pktref_enqueue(&gh->gh_holdq, pkt);
 
@@ -297,6 +380,10 @@ gh_hold(globalheaders_t *gh, streaming_message_t *sm)
     if(!headers_complete(gh))
       break;
 
+    gh->gh_hold_time = MAX(1, (getmonoclock() - gh->gh_start_time) / 1000);
+    tvhtrace("parser", "gh headers complete in %d ms", gh->gh_hold_time);
+    gh_count_unverified(gh);
+
     // Send our modified start
     sm = streaming_msg_create_data(SMT_START, 
 				   streaming_start_copy(gh->gh_ss));
@@ -374,6 +461,8 @@ gh_pass(globalheaders_t *gh, streaming_message_t *sm)
     break;
   case SMT_PACKET:
     pkt = sm->sm_data;
+    if (gh->gh_unverified > 0 && pkt->pkt_meta)
+      gh_verify(gh, pkt);
     if (pkt->pkt_payload || pkt->pkt_err)
       streaming_target_deliver2(gh->gh_output, sm);
     else
@@ -414,6 +503,17 @@ globalheaders_create(streaming_target_t *output)
 }
 
 
+/**
+ *
+ */
+int
+globalheaders_hold_time(streaming_target_t *pad)
+{
+  globalheaders_t *gh = (globalheaders_t *)pad;
+  return gh->gh_hold_time;
+}
+
+
 /**
  *
  */
@@ -25,5 +25,7 @@ streaming_target_t *globalheaders_create(streaming_target_t *output);
 
 void globalheaders_destroy(streaming_target_t *gh);
 
+int globalheaders_hold_time(streaming_target_t *gh);
+
 
 #endif // GLOBALHEADERS_H__
@@ -985,6 +985,13 @@ const idclass_t profile_mpegts_pass_class =
       .off      = offsetof(profile_mpegts_t, pro_rewrite_eit),
       .def.i    = 1,
     },
+    {
+      .type     = PT_BOOL,
+      .id       = "http_share",
+      .name     = "Share HTTP Streams",
+      .off      = offsetof(profile_t, pro_http_share),
+      .def.i    = 0,
+    },
     { }
   }
 };
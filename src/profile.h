@@ -123,6 +123,7 @@ typedef struct profile {
   int pro_timeout;
   int pro_restart;
   int pro_contaccess;
+  int pro_http_share;
 
   void (*pro_free)(struct profile *pro);
   void (*pro_conf_changed)(struct profile *pro);
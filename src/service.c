@@ -335,6 +335,9 @@ service_stream_destroy(service_t *t, elementary_stream_t *es)
     free(c);
   }
 
+  if (es->es_meta)
+    pktbuf_ref_dec(es->es_meta);
+
   free(es->es_section);
   free(es->es_nicename);
   free(es);
@@ -367,10 +370,15 @@ service_stop(service_t *t)
   TAILQ_FOREACH(st, &t->s_components, es_link)
     stream_clean(st);
 
+  service_gop_flush(t);
+
   t->s_status = SERVICE_IDLE;
   tvhlog_limit_reset(&t->s_tei_log);
 
   pthread_mutex_unlock(&t->s_stream_mutex);
+
+  /* Input released */
+  subscription_input_changed();
 }
 
 
@@ -853,6 +861,9 @@ service_destroy(service_t *t, int delconf)
   while((st = TAILQ_FIRST(&t->s_components)) != NULL)
     service_stream_destroy(t, st);
 
+  free(t->s_descramble_keys);
+  t->s_descramble_keys = NULL;
+
   avgstat_flush(&t->s_rate);
 
   if (t->s_type == STYPE_RAW)
@@ -927,6 +938,7 @@ service_create0
   t->s_provider_name  = service_provider_name;
   TAILQ_INIT(&t->s_components);
   TAILQ_INIT(&t->s_filt_components);
+  TAILQ_INIT(&t->s_gop_queue);
   t->s_last_pid = -1;
 
   streaming_pad_init(&t->s_streaming_pad);
@@ -1232,6 +1244,7 @@ service_restart(service_t *t)
                    t->s_running;
 
   service_build_filter(t);
+  service_gop_flush(t);
 
   if(TAILQ_FIRST(&t->s_filt_components) != NULL) {
     if (had_components)
@@ -1260,6 +1273,66 @@ refresh:
 }
 
 
+/**
+ * GOP cache
+ */
+#define SERVICE_GOP_MAX (4 * 1024 * 1024)
+
+void
+service_gop_flush(service_t *t)
+{
+  pktref_clear_queue(&t->s_gop_queue);
+  t->s_gop_size = 0;
+}
+
+/**
+ * Service stream lock must be held
+ */
+void
+service_gop_add(service_t *t, elementary_stream_t *st, th_pkt_t *pkt)
+{
+  size_t len;
+
+  if (t->s_type != STYPE_STD || pkt->pkt_payload == NULL)
+    return;
+
+  if (SCT_ISVIDEO(st->es_type) && pkt->pkt_frametype == PKT_I_FRAME)
+    service_gop_flush(t);
+  else if (TAILQ_EMPTY(&t->s_gop_queue))
+    return;
+
+  /* Too long GOP, wait for the next I-frame */
+  len = pktbuf_len(pkt->pkt_payload);
+  if (t->s_gop_size + len > SERVICE_GOP_MAX) {
+    service_gop_flush(t);
+    return;
+  }
+
+  pkt_ref_inc(pkt);
+  pktref_enqueue(&t->s_gop_queue, pkt);
+  t->s_gop_size += len;
+}
+
+/**
+ * Service stream lock must be held
+ */
+void
+service_gop_deliver(service_t *t, streaming_target_t *st)
+{
+  th_pktref_t *pr;
+  int n = 0;
+
+  lock_assert(&t->s_stream_mutex);
+
+  TAILQ_FOREACH(pr, &t->s_gop_queue, pr_link) {
+    streaming_target_deliver(st, streaming_msg_create_pkt(pr->pr_pkt));
+    n++;
+  }
+  if (n)
+    tvhtrace("service", "%s: sent %d cached packets (%zu bytes)",
+             t->s_nicename, n, t->s_gop_size);
+}
+
 /**
  * Generate a message containing info about all components
  */
@@ -1295,6 +1368,14 @@ service_build_stream_start(service_t *t)
     ssc->ssc_width = st->es_width;
     ssc->ssc_height = st->es_height;
     ssc->ssc_frameduration = st->es_frame_duration;
+    /* parameters from the previous run, corrected by the live stream */
+    ssc->ssc_aspect_num = st->es_aspect_num;
+    ssc->ssc_aspect_den = st->es_aspect_den;
+    ssc->ssc_channels = st->es_channels;
+    ssc->ssc_sri = st->es_sri;
+    ssc->ssc_ext_sri = st->es_ext_sri;
+    if ((ssc->ssc_gh = st->es_meta) != NULL)
+      pktbuf_ref_inc(ssc->ssc_gh);
   }
 
   t->s_setsourceinfo(t, &ss->ss_si);
@@ -100,6 +100,12 @@ typedef struct elementary_stream {
 
   int es_meta_change;
 
+  /* Last stream parameters, kept over restarts to start quickly */
+  struct pktbuf *es_meta;    /* global headers (SPS/PPS, sequence header) */
+  uint8_t es_channels;
+  uint8_t es_sri;
+  uint8_t es_ext_sri;
+
   /* CA ID's on this stream */
   struct caid_list es_caids;
 
@@ -446,6 +452,7 @@ typedef struct service {
   struct th_descrambler_list s_descramblers;
   uint16_t s_scrambled_seen;
   th_descrambler_runtime_t *s_descramble;
+  th_descrambler_keys_t *s_descramble_keys;
 
   /**
    * List of all and filtered components.
@@ -460,6 +467,13 @@ typedef struct service {
    */
   streaming_pad_t s_streaming_pad;
 
+  /**
+   * Packets since the last video I-frame, sent to the late subscribers
+   * so they can start without waiting for the next one
+   */
+  struct th_pktref_queue s_gop_queue;
+  size_t s_gop_size;
+
   tvhlog_limit_t s_tei_log;
 
   int64_t s_current_pts;
@@ -561,6 +575,12 @@ struct streaming_start *service_build_stream_start(service_t *t);
 
 void service_restart(service_t *t);
 
+void service_gop_add(service_t *t, elementary_stream_t *st, struct th_pkt *pkt);
+
+void service_gop_deliver(service_t *t, streaming_target_t *st);
+
+void service_gop_flush(service_t *t);
+
 void service_stream_destroy(service_t *t, elementary_stream_t *st);
 
 void service_request_save(service_t *t, int restart);
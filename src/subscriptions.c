@@ -42,11 +42,17 @@
 #include "atomic.h"
 #include "input.h"
 #include "dbus.h"
+#include "plumbing/globalheaders.h"
 
 struct th_subscription_list subscriptions;
 struct th_subscription_list subscriptions_remove;
 static gtimer_t             subscription_reschedule_timer;
 static int                  subscription_postpone;
+static int                  subscription_rescheduling;
+static int                  subscription_input_gen;
+
+/* Retry period for subscriptions which got SMT_NOSTART */
+#define SUBSCRIPTION_RETRY_IDLE 10
 
 /**
  *
@@ -61,6 +67,21 @@ shortid(th_subscription_t *s)
  * Subscription linking
  * *************************************************************************/
 
+/**
+ * Pass the stream start to the client
+ */
+static void
+subscription_deliver_start(th_subscription_t *s)
+{
+  if (s->ths_zap_time == 0) {
+    s->ths_zap_time = MAX(1, (getmonoclock() - s->ths_start_mono) / 1000);
+    tvhdebug("subscription", "%04X: stream started in %d ms",
+             shortid(s), s->ths_zap_time);
+  }
+  streaming_target_deliver(s->ths_output, s->ths_start_message);
+  s->ths_start_message = NULL;
+}
+
 /**
  * The service is producing output.
  */
@@ -100,14 +121,16 @@ subscription_link_service(th_subscription_t *s, service_t *t)
     s->ths_state = SUBSCRIPTION_GOT_SERVICE;
 
     // Send a START message to the subscription client
-    streaming_target_deliver(s->ths_output, s->ths_start_message);
-    s->ths_start_message = NULL;
+    subscription_deliver_start(s);
     t->s_running = 1;
 
     // Send status report
     sm = streaming_msg_create_code(SMT_SERVICE_STATUS, 
 				   t->s_streaming_status);
     streaming_target_deliver(s->ths_output, sm);
+
+    // Start from the last I-frame
+    service_gop_deliver(t, &s->ths_input);
   }
 
   pthread_mutex_unlock(&t->s_stream_mutex);
@@ -142,6 +165,7 @@ subscription_unlink_service0(th_subscription_t *s, int reason, int stop)
 
   LIST_REMOVE(s, ths_service_link);
   s->ths_service = NULL;
+  s->ths_reschedule = 1;
 }
 
 void
@@ -280,34 +304,67 @@ subscription_start_instance
   return s->ths_current_instance = si;
 }
 
+/**
+ * Input availability change feed, the waiting subscriptions are
+ * evaluated again (tuner released, input enabled, weight changed...)
+ */
+void
+subscription_input_changed(void)
+{
+  lock_assert(&global_lock);
+
+  subscription_input_gen++;
+  if (!subscription_rescheduling)
+    gtimer_arm(&subscription_reschedule_timer,
+               subscription_reschedule_cb, NULL, 0);
+}
+
+/**
+ *
+ */
+static inline int
+subscription_reschedule_needed(th_subscription_t *s)
+{
+  return s->ths_reschedule ||
+         s->ths_reschedule_gen != subscription_input_gen ||
+         s->ths_reschedule_time <= dispatch_clock;
+}
+
 /**
  *
  */
 void
 subscription_reschedule(void)
 {
-  static int reenter = 0;
   th_subscription_t *s;
   service_t *t;
   service_instance_t *si;
   streaming_message_t *sm;
-  int error, postpone = INT_MAX;
-  assert(reenter == 0);
-  reenter = 1;
+  int error, postpone = INT_MAX, gen, count = 0, found = 0;
+  struct timespec ts1, ts2;
+  assert(subscription_rescheduling == 0);
+  subscription_rescheduling = 1;
 
   lock_assert(&global_lock);
 
+  clock_gettime(CLOCK_MONOTONIC, &ts1);
+  gen = subscription_input_gen;
+
   LIST_FOREACH(s, &subscriptions, ths_global_link) {
     if (!s->ths_service && !s->ths_channel) continue;
     if (s->ths_flags & SUBSCRIPTION_ONESHOT) continue;
+    count++;
 
     /* Postpone the tuner decision */
     /* Leave some time to wakeup tuners through DBus or so */
     if (s->ths_postpone_end > dispatch_clock) {
       if (postpone > s->ths_postpone_end - dispatch_clock)
         postpone = s->ths_postpone_end - dispatch_clock;
-      sm = streaming_msg_create_code(SMT_GRACE, (s->ths_postpone_end - dispatch_clock) + 5);
-      streaming_target_deliver(s->ths_output, sm);
+      if (s->ths_reschedule) {
+        sm = streaming_msg_create_code(SMT_GRACE, (s->ths_postpone_end - dispatch_clock) + 5);
+        streaming_target_deliver(s->ths_output, sm);
+        s->ths_reschedule = 0;
+      }
       continue;
     }
 
@@ -339,12 +396,25 @@ subscription_reschedule(void)
         s->ths_service = si->si_s;
 
       s->ths_last_error = 0;
+
+    } else if (!subscription_reschedule_needed(s)) {
+      /* Still waiting, nothing changed for this one */
+      if (postpone > s->ths_reschedule_time - dispatch_clock)
+        postpone = s->ths_reschedule_time - dispatch_clock;
+      continue;
     }
 
+    found++;
+    s->ths_reschedule = 0;
+    s->ths_reschedule_time = dispatch_clock + 2;
+
     error = s->ths_testing_error;
     si = subscription_start_instance(s, &error);
     s->ths_current_instance = si;
 
+    /* Changes caused by this subscription do not count for it */
+    s->ths_reschedule_gen = subscription_input_gen;
+
     if(si == NULL) {
       if (s->ths_last_error != error || s->ths_last_find + 2 >= dispatch_clock) {
         tvhtrace("subscription", "%04X: instance not available, retrying", shortid(s));
@@ -362,6 +432,7 @@ subscription_reschedule(void)
                   shortid(s), s->ths_service->s_nicename);
         s->ths_testing_error = 0;
         s->ths_current_instance = NULL;
+        s->ths_reschedule = 1;
         service_instance_list_clear(&s->ths_instances);
         continue;
       }
@@ -369,6 +440,7 @@ subscription_reschedule(void)
       sm = streaming_msg_create_code(SMT_NOSTART, error);
       streaming_target_deliver(s->ths_output, sm);
       subscription_show_none(s);
+      s->ths_reschedule_time = dispatch_clock + SUBSCRIPTION_RETRY_IDLE;
       continue;
     }
 
@@ -379,12 +451,28 @@ subscription_reschedule(void)
   while ((s = LIST_FIRST(&subscriptions_remove)))
     subscription_unsubscribe(s, 0);
 
+  /* Inputs changed after some subscriptions were evaluated */
+  if (gen != subscription_input_gen && postpone > 1)
+    LIST_FOREACH(s, &subscriptions, ths_global_link)
+      if (!s->ths_current_instance &&
+          s->ths_reschedule_gen != subscription_input_gen) {
+        postpone = 1;
+        break;
+      }
+
   if (postpone <= 0 || postpone == INT_MAX)
     postpone = 2;
   gtimer_arm(&subscription_reschedule_timer,
 	           subscription_reschedule_cb, NULL, postpone);
 
-  reenter = 0;
+  clock_gettime(CLOCK_MONOTONIC, &ts2);
+  tvhtrace("subscription", "reschedule: %d of %d evaluated in %"PRId64"us, next in %ds",
+           found, count,
+           (int64_t)(ts2.tv_sec - ts1.tv_sec) * 1000000 +
+             (ts2.tv_nsec - ts1.tv_nsec) / 1000,
+           postpone);
+
+  subscription_rescheduling = 0;
 }
 
 /**
@@ -411,6 +499,7 @@ subscription_set_postpone(void *aux, const char *path, int64_t postpone)
       s->ths_postpone = postpone;
       if (s->ths_postpone_end > now && s->ths_postpone_end - now > postpone)
         s->ths_postpone_end = now + postpone;
+      s->ths_reschedule = 1;
     }
     gtimer_arm(&subscription_reschedule_timer,
   	       subscription_reschedule_cb, NULL, 0);
@@ -507,8 +596,7 @@ subscription_input(void *opauqe, streaming_message_t *sm)
     if(sm->sm_type == SMT_SERVICE_STATUS &&
        sm->sm_code & TSS_PACKETS) {
       if(s->ths_start_message != NULL) {
-        streaming_target_deliver(s->ths_output, s->ths_start_message);
-        s->ths_start_message = NULL;
+        subscription_deliver_start(s);
         if (s->ths_service)
           s->ths_service->s_running = 1;
       }
@@ -555,6 +643,10 @@ subscription_unsubscribe(th_subscription_t *s, int quiet)
 
   lock_assert(&global_lock);
 
+#if ENABLE_MPEGTS
+  mpegts_warm_unsubscribe(s);
+#endif
+
   s->ths_state = SUBSCRIPTION_ZOMBIE;
 
   service_instance_list_clear(&s->ths_instances);
@@ -663,6 +755,7 @@ subscription_create
   s->ths_timeout           = pro ? pro->pro_timeout : 0;
   s->ths_postpone          = subscription_postpone;
   s->ths_postpone_end      = dispatch_clock + s->ths_postpone;
+  s->ths_reschedule        = 1;
 
   if (s->ths_prch)
     s->ths_weight = profile_chain_weight(s->ths_prch, weight);
@@ -677,6 +770,7 @@ subscription_create
   }
 
   time(&s->ths_start);
+  s->ths_start_mono = getmonoclock();
 
   s->ths_id = ++tally;
 
@@ -840,6 +934,13 @@ subscription_create_msg(th_subscription_t *s)
   htsmsg_add_u32(m, "id", s->ths_id);
   htsmsg_add_u32(m, "start", s->ths_start);
   htsmsg_add_u32(m, "errors", s->ths_total_err);
+  if (s->ths_zap_time) {
+    int zap = s->ths_zap_time;
+    /* the client gets the start after the global headers are known */
+    if (s->ths_prch && s->ths_prch->prch_gh)
+      zap += globalheaders_hold_time(s->ths_prch->prch_gh);
+    htsmsg_add_u32(m, "zap", zap);
+  }
 
   const char *state;
   switch(s->ths_state) {
@@ -959,8 +1060,9 @@ subscription_change_weight(th_subscription_t *s, int weight)
   s->ths_weight = weight;
   LIST_INSERT_SORTED(&subscriptions, s, ths_global_link, subscription_sort);
 
-  gtimer_arm(&subscription_reschedule_timer, 
-	           subscription_reschedule_cb, NULL, 0);
+  /* Other subscriptions may bump (or no longer bump) this one */
+  s->ths_reschedule = 1;
+  subscription_input_changed();
 }
 
 /**
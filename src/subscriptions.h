@@ -39,6 +39,7 @@ extern struct th_subscription_list subscriptions;
 #define SUBSCRIPTION_IDLESCAN  0x2000 ///< for mux subscriptions
 #define SUBSCRIPTION_USERSCAN  0x4000 ///< for mux subscriptions
 #define SUBSCRIPTION_EPG       0x8000 ///< for mux subscriptions
+#define SUBSCRIPTION_PREWARM  0x10000 ///< for mux subscriptions
 
 /* Some internal priorities */
 #define SUBSCRIPTION_PRIO_KEEP        1 ///< Keep input rolling
@@ -84,6 +85,8 @@ typedef struct th_subscription {
 
   char *ths_title; /* display title */
   time_t ths_start;  /* time when subscription started */
+  int64_t ths_start_mono;
+  int ths_zap_time;  /* ms from the start to the service output */
   int ths_total_err; /* total errors during entire subscription */
   int ths_bytes_in;   // Reset every second to get aprox. bandwidth (in)
   int ths_bytes_out; // Reset every second to get approx bandwidth (out)
@@ -117,6 +120,14 @@ typedef struct th_subscription {
   int    ths_postpone;
   time_t ths_postpone_end;
 
+  /**
+   * Reschedule state, waiting subscriptions are evaluated only when
+   * flagged, when the inputs changed or when the retry time is reached
+   */
+  int    ths_reschedule;
+  int    ths_reschedule_gen;
+  time_t ths_reschedule_time;
+
   /*
    * MPEG-TS mux chain
    */
@@ -141,6 +152,8 @@ void subscription_set_weight(th_subscription_t *s, unsigned int weight);
 
 void subscription_reschedule(void);
 
+void subscription_input_changed(void);
+
 th_subscription_t *
 subscription_create_from_channel(struct profile_chain *prch,
                                  struct tvh_input *ti,
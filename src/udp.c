@@ -281,6 +281,12 @@ udp_bind ( const char *subsystem, const char *name,
     tvhwarn(subsystem, "%s - cannot change UDP rx buffer size [%s]",
             name, strerror(errno));
 
+#ifdef SO_RXQ_OVFL
+  /* Report dropped datagrams (see udp_multirecv_read) */
+  if (rxsize > 0)
+    setsockopt(fd, SOL_SOCKET, SO_RXQ_OVFL, &reuse, sizeof(reuse));
+#endif
+
   /* Increase/Decrease TX buffer size */
   if (txsize > 0 &&
       setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &txsize, sizeof(txsize)) == -1)
@@ -570,6 +576,18 @@ recvmmsg(int sockfd, struct mmsghdr *msgvec, unsigned int vlen,
 
 #endif
 
+#ifdef SO_RXQ_OVFL
+#define UDP_CMSG_OVFL CMSG_SPACE(sizeof(uint32_t))
+#else
+#define UDP_CMSG_OVFL 0
+#endif
+#ifdef SO_TIMESTAMPNS
+#define UDP_CMSG_TS   CMSG_SPACE(sizeof(struct timespec))
+#else
+#define UDP_CMSG_TS   0
+#endif
+#define UDP_CMSG_SIZE (UDP_CMSG_OVFL + UDP_CMSG_TS)
+
 void
 udp_multirecv_init( udp_multirecv_t *um, int packets, int psize )
 {
@@ -581,22 +599,50 @@ udp_multirecv_init( udp_multirecv_t *um, int packets, int psize )
   um->um_data    = malloc(packets * psize);
   um->um_iovec   = malloc(packets * sizeof(struct iovec));
   um->um_riovec  = malloc(packets * sizeof(struct iovec));
+  um->um_siovec  = NULL;
   um->um_msg     = calloc(packets,  sizeof(struct mmsghdr));
+  um->um_cmsg    = UDP_CMSG_SIZE ? calloc(packets, UDP_CMSG_SIZE) : NULL;
+  um->um_tstamp  = NULL;
+  um->um_drops   = 0;
   for (i = 0; i < packets; i++) {
     ((struct mmsghdr *)um->um_msg)[i].msg_hdr.msg_iov    = &um->um_iovec[i];
     ((struct mmsghdr *)um->um_msg)[i].msg_hdr.msg_iovlen = 1;
+    if (um->um_cmsg)
+      ((struct mmsghdr *)um->um_msg)[i].msg_hdr.msg_control =
+        um->um_cmsg + i * UDP_CMSG_SIZE;
     um->um_iovec[i].iov_base  = /* follow thru */
     um->um_riovec[i].iov_base = um->um_data + i * psize;
     um->um_iovec[i].iov_len   = psize;
   }
 }
 
+int
+udp_multirecv_timestamps( udp_multirecv_t *um, int fd )
+{
+#ifdef SO_TIMESTAMPNS
+  int one = 1;
+
+  if (um->um_tstamp)
+    return 0;
+  if (setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPNS, &one, sizeof(one)) < 0)
+    return -1;
+  um->um_tstamp = calloc(um->um_packets, sizeof(int64_t));
+  return 0;
+#else
+  errno = ENOSYS;
+  return -1;
+#endif
+}
+
 void
 udp_multirecv_free( udp_multirecv_t *um )
 {
   if (um == NULL)
     return;
   free(um->um_msg);    um->um_msg   = NULL;
+  free(um->um_cmsg);   um->um_cmsg  = NULL;
+  free(um->um_tstamp); um->um_tstamp = NULL;
+  free(um->um_siovec); um->um_siovec = NULL;
   free(um->um_riovec); um->um_riovec = NULL;
   free(um->um_iovec);  um->um_iovec = NULL;
   free(um->um_data);   um->um_data  = NULL;
@@ -604,18 +650,39 @@ udp_multirecv_free( udp_multirecv_t *um )
   um->um_packets = 0;
 }
 
-int
-udp_multirecv_read( udp_multirecv_t *um, int fd, int packets,
-                    struct iovec **iovec )
+static void
+udp_multirecv_cmsg( udp_multirecv_t *um, int i )
+{
+  struct msghdr *mh = &((struct mmsghdr *)um->um_msg)[i].msg_hdr;
+  struct cmsghdr *cm;
+
+  for (cm = CMSG_FIRSTHDR(mh); cm; cm = CMSG_NXTHDR(mh, cm)) {
+    if (cm->cmsg_level != SOL_SOCKET)
+      continue;
+#ifdef SO_RXQ_OVFL
+    /* the kernel reports the running total with every datagram */
+    if (cm->cmsg_type == SO_RXQ_OVFL)
+      memcpy(&um->um_drops, CMSG_DATA(cm), sizeof(uint32_t));
+#endif
+#ifdef SO_TIMESTAMPNS
+    if (cm->cmsg_type == SO_TIMESTAMPNS && um->um_tstamp) {
+      struct timespec ts;
+      memcpy(&ts, CMSG_DATA(cm), sizeof(ts));
+      um->um_tstamp[i] = (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+    }
+#endif
+  }
+}
+
+static int
+udp_multirecv_recv( udp_multirecv_t *um, int fd, int packets )
 {
   static char use_emul = 0;
   int n, i;
-  if (um == NULL || iovec == NULL) {
-    errno = EINVAL;
-    return -1;
-  }
-  if (packets > um->um_packets)
-    packets = um->um_packets;
+
+  if (um->um_cmsg)
+    for (i = 0; i < packets; i++)
+      ((struct mmsghdr *)um->um_msg)[i].msg_hdr.msg_controllen = UDP_CMSG_SIZE;
   if (!use_emul) {
     n = recvmmsg(fd, (struct mmsghdr *)um->um_msg, packets, MSG_DONTWAIT, NULL);
   } else {
@@ -629,8 +696,76 @@ udp_multirecv_read( udp_multirecv_t *um, int fd, int packets,
   if (n > 0) {
     for (i = 0; i < n; i++)
       um->um_riovec[i].iov_len = ((struct mmsghdr *)um->um_msg)[i].msg_len;
+    if (um->um_cmsg) {
+      if (um->um_tstamp)
+        for (i = 0; i < n; i++)
+          udp_multirecv_cmsg(um, i);
+      else
+        udp_multirecv_cmsg(um, n - 1);
+    }
+  }
+  return n;
+}
+
+int
+udp_multirecv_read( udp_multirecv_t *um, int fd, int packets,
+                    struct iovec **iovec )
+{
+  int n, i;
+  if (um == NULL || iovec == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+  if (packets > um->um_packets)
+    packets = um->um_packets;
+  if (um->um_siovec)
+    for (i = 0; i < packets; i++) {
+      ((struct mmsghdr *)um->um_msg)[i].msg_hdr.msg_iov    = &um->um_iovec[i];
+      ((struct mmsghdr *)um->um_msg)[i].msg_hdr.msg_iovlen = 1;
+    }
+  n = udp_multirecv_recv(um, fd, packets);
+  if (n > 0)
     *iovec = um->um_riovec;
+  return n;
+}
+
+/*
+ * Scatter each datagram: the first hsize bytes go to the message
+ * scratch buffer, the next slot bytes to dst + i * slot and the rest
+ * behind the header in the scratch buffer. Fixed size payloads thus
+ * land back to back in dst. The returned iovecs point to the scratch
+ * buffers and carry the full datagram lengths.
+ */
+int
+udp_multirecv_read_into( udp_multirecv_t *um, int fd, int packets,
+                         uint8_t *dst, int slot, int hsize,
+                         struct iovec **iovec )
+{
+  struct iovec *v;
+  int n, i;
+
+  if (um == NULL || iovec == NULL || hsize + slot > um->um_psize) {
+    errno = EINVAL;
+    return -1;
+  }
+  if (packets > um->um_packets)
+    packets = um->um_packets;
+  if (um->um_siovec == NULL)
+    um->um_siovec = malloc(3 * um->um_packets * sizeof(struct iovec));
+  for (i = 0; i < packets; i++) {
+    v = um->um_siovec + 3 * i;
+    v[0].iov_base = um->um_data + i * um->um_psize;
+    v[0].iov_len  = hsize;
+    v[1].iov_base = dst + i * slot;
+    v[1].iov_len  = slot;
+    v[2].iov_base = um->um_data + i * um->um_psize + hsize;
+    v[2].iov_len  = um->um_psize - hsize - slot;
+    ((struct mmsghdr *)um->um_msg)[i].msg_hdr.msg_iov    = v;
+    ((struct mmsghdr *)um->um_msg)[i].msg_hdr.msg_iovlen = 3;
   }
+  n = udp_multirecv_recv(um, fd, packets);
+  if (n > 0)
+    *iovec = um->um_riovec;
   return n;
 }
 
@@ -72,7 +72,11 @@ typedef struct udp_multirecv {
   uint8_t        *um_data;
   struct iovec   *um_iovec;
   struct iovec   *um_riovec;
+  struct iovec   *um_siovec;  ///< scatter vectors for udp_multirecv_read_into
   struct mmsghdr *um_msg;
+  uint8_t        *um_cmsg;
+  int64_t        *um_tstamp;  ///< receive time in ns (SO_TIMESTAMPNS)
+  uint32_t        um_drops;   ///< socket queue overflows (SO_RXQ_OVFL)
 } udp_multirecv_t;
 
 void
@@ -80,8 +84,14 @@ udp_multirecv_init( udp_multirecv_t *um, int packets, int psize );
 void
 udp_multirecv_free( udp_multirecv_t *um );
 int
+udp_multirecv_timestamps( udp_multirecv_t *um, int fd );
+int
 udp_multirecv_read( udp_multirecv_t *um, int fd, int packets,
                     struct iovec **iovec );
+int
+udp_multirecv_read_into( udp_multirecv_t *um, int fd, int packets,
+                         uint8_t *dst, int slot, int hsize,
+                         struct iovec **iovec );
 
 typedef struct udp_multisend {
   int             um_psize;
@@ -20,8 +20,10 @@
 #include <assert.h>
 #include <stdio.h>
 #include <unistd.h>
+#include <fcntl.h>
 #include <stdlib.h>
 #include <string.h>
+#include <poll.h>
 #include <arpa/inet.h>
 #include <sys/socket.h>
 #include <openssl/sha.h>
@@ -45,19 +47,76 @@ static pthread_cond_t comet_cond = PTHREAD_COND_INITIALIZER;
 #define mbdebug(fmt...)
 
 
+#define WS_GUID "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+
 static LIST_HEAD(, comet_mailbox) mailboxes;
+static int mailbox_count;
 
 int mailbox_tally;
 int comet_running;
 
 typedef struct comet_mailbox {
   char *cmb_boxid; /* SHA-1 hash */
-  htsmsg_t *cmb_messages; /* A vector */
+  htsmsg_t *cmb_messages; /* A vector (messages for this mailbox only) */
+  uint64_t cmb_seq; /* Last shared message taken */
   time_t cmb_last_used;
   LIST_ENTRY(comet_mailbox) cmb_link;
   int cmb_debug;
 } comet_mailbox_t;
 
+/*
+ * Shared messages, serialized once, released when the mailboxes
+ * present at the time they were added have all passed them
+ */
+typedef struct comet_message {
+  TAILQ_ENTRY(comet_message) cm_link;
+  uint64_t cm_seq;
+  int      cm_refcount;
+  int      cm_debug;
+  char    *cm_json;
+} comet_message_t;
+
+static TAILQ_HEAD(comet_message_queue, comet_message) comet_messages =
+  TAILQ_HEAD_INITIALIZER(comet_messages);
+static uint64_t comet_seq;
+
+/*
+ * WebSocket connections wait in poll() on the socket and a pipe
+ */
+typedef struct comet_ws {
+  LIST_ENTRY(comet_ws) cw_link;
+  th_pipe_t cw_pipe;
+} comet_ws_t;
+
+static LIST_HEAD(, comet_ws) comet_ws_waiters;
+
+/**
+ * Wake up the long polls and the WebSocket connections
+ */
+static void
+comet_wakeup(void)
+{
+  comet_ws_t *cw;
+  ssize_t r;
+
+  pthread_cond_broadcast(&comet_cond);
+  LIST_FOREACH(cw, &comet_ws_waiters, cw_link)
+    r = write(cw->cw_pipe.wr, "", 1); /* full pipe is fine */
+  (void)r;
+}
+
+/**
+ *
+ */
+static void
+cm_release(comet_message_t *cm)
+{
+  if (--cm->cm_refcount > 0)
+    return;
+  TAILQ_REMOVE(&comet_messages, cm, cm_link);
+  free(cm->cm_json);
+  free(cm);
+}
 
 /**
  *
@@ -65,12 +124,21 @@ typedef struct comet_mailbox {
 static void
 cmb_destroy(comet_mailbox_t *cmb)
 {
+  comet_message_t *cm, *next;
+
   mbdebug("mailbox[%s]: destroyed\n", cmb->cmb_boxid);
 
   if(cmb->cmb_messages != NULL)
     htsmsg_destroy(cmb->cmb_messages);
 
+  for (cm = TAILQ_FIRST(&comet_messages); cm; cm = next) {
+    next = TAILQ_NEXT(cm, cm_link);
+    if (cm->cm_seq > cmb->cmb_seq)
+      cm_release(cm);
+  }
+
   LIST_REMOVE(cmb, cmb_link);
+  mailbox_count--;
 
   free(cmb->cmb_boxid);
   free(cmb);
@@ -125,13 +193,89 @@ comet_mailbox_create(void)
   id[40] = 0;
 
   cmb->cmb_boxid = strdup(id);
+  cmb->cmb_seq = comet_seq;
   time(&cmb->cmb_last_used);
   mailbox_tally++;
 
   LIST_INSERT_HEAD(&mailboxes, cmb, cmb_link);
+  mailbox_count++;
   return cmb;
 }
 
+/**
+ * Anything to deliver?
+ */
+static int
+comet_mailbox_pending(comet_mailbox_t *cmb)
+{
+  comet_message_t *cm;
+
+  if (cmb->cmb_messages)
+    return 1;
+  TAILQ_FOREACH_REVERSE(cm, &comet_messages, comet_message_queue, cm_link) {
+    if (cm->cm_seq <= cmb->cmb_seq)
+      break;
+    if (!cm->cm_debug || cmb->cmb_debug)
+      return 1;
+  }
+  return 0;
+}
+
+/**
+ * Take the mailbox content as the JSON reply (comet_mutex held)
+ */
+static void
+comet_mailbox_take(comet_mailbox_t *cmb, htsbuf_queue_t *hq)
+{
+  comet_message_t *cm, *next;
+  htsmsg_field_t *f;
+  htsmsg_t *m;
+  int first = 1;
+
+  htsbuf_qprintf(hq, "{\"boxid\":\"%s\",\"messages\":[", cmb->cmb_boxid);
+  if (cmb->cmb_messages) {
+    HTSMSG_FOREACH(f, cmb->cmb_messages) {
+      if ((m = htsmsg_field_get_map(f)) == NULL)
+        continue;
+      if (!first)
+        htsbuf_append(hq, ",", 1);
+      htsmsg_json_serialize(m, hq, 0);
+      first = 0;
+    }
+    htsmsg_destroy(cmb->cmb_messages);
+    cmb->cmb_messages = NULL;
+  }
+  for (cm = TAILQ_FIRST(&comet_messages); cm; cm = next) {
+    next = TAILQ_NEXT(cm, cm_link);
+    if (cm->cm_seq <= cmb->cmb_seq)
+      continue;
+    if (!cm->cm_debug || cmb->cmb_debug) {
+      if (!first)
+        htsbuf_append(hq, ",", 1);
+      htsbuf_append(hq, cm->cm_json, strlen(cm->cm_json));
+      first = 0;
+    }
+    cmb->cmb_seq = cm->cm_seq;
+    cm_release(cm);
+  }
+  htsbuf_append(hq, "]}", 2);
+}
+
+/**
+ *
+ */
+static comet_mailbox_t *
+comet_mailbox_find(const char *cometid)
+{
+  comet_mailbox_t *cmb;
+
+  if (cometid != NULL)
+    LIST_FOREACH(cmb, &mailboxes, cmb_link)
+      if (!strcmp(cmb->cmb_boxid, cometid))
+        return cmb;
+  return NULL;
+}
+
 /**
  *
  */
@@ -200,7 +344,6 @@ comet_mailbox_poll(http_connection_t *hc, const char *remain, void *opaque)
   int im = immediate ? atoi(immediate) : 0;
   time_t reqtime;
   struct timespec ts;
-  htsmsg_t *m;
 
   if(!im)
     usleep(100000); /* Always sleep 0.1 sec to avoid comet storms */
@@ -211,11 +354,7 @@ comet_mailbox_poll(http_connection_t *hc, const char *remain, void *opaque)
     return 400;
   }
 
-  if(cometid != NULL)
-    LIST_FOREACH(cmb, &mailboxes, cmb_link)
-      if(!strcmp(cmb->cmb_boxid, cometid))
-	break;
-    
+  cmb = comet_mailbox_find(cometid);
   if(cmb == NULL) {
     cmb = comet_mailbox_create();
     comet_access_update(hc, cmb);
@@ -228,7 +367,7 @@ comet_mailbox_poll(http_connection_t *hc, const char *remain, void *opaque)
 
   cmb->cmb_last_used = 0; /* Make sure we're not flushed out */
 
-  if(!im && cmb->cmb_messages == NULL) {
+  if(!im && !comet_mailbox_pending(cmb)) {
     pthread_cond_timedwait(&comet_cond, &comet_mutex, &ts);
     if (!comet_running) {
       pthread_mutex_unlock(&comet_mutex);
@@ -236,21 +375,197 @@ comet_mailbox_poll(http_connection_t *hc, const char *remain, void *opaque)
     }
   }
 
-  m = htsmsg_create_map();
-  htsmsg_add_str(m, "boxid", cmb->cmb_boxid);
-  htsmsg_add_msg(m, "messages", cmb->cmb_messages ?: htsmsg_create_list());
-  cmb->cmb_messages = NULL;
+  comet_mailbox_take(cmb, &hc->hc_reply);
   
   cmb->cmb_last_used = dispatch_clock;
 
   pthread_mutex_unlock(&comet_mutex);
 
-  htsmsg_json_serialize(m, &hc->hc_reply, 0);
-  htsmsg_destroy(m);
   http_output_content(hc, "text/x-json; charset=UTF-8");
   return 0;
 }
 
+/**
+ * WebSocket frame output
+ */
+static int
+comet_ws_send(int fd, int opcode, htsbuf_queue_t *hq)
+{
+  uint8_t hdr[10];
+  size_t len = hq ? hq->hq_size : 0;
+  int hlen = 2, i;
+
+  hdr[0] = 0x80 | opcode; /* FIN */
+  if (len < 126) {
+    hdr[1] = len;
+  } else if (len < 65536) {
+    hdr[1] = 126;
+    hdr[2] = len >> 8;
+    hdr[3] = len;
+    hlen = 4;
+  } else {
+    hdr[1] = 127;
+    for (i = 0; i < 8; i++)
+      hdr[2 + i] = (uint64_t)len >> (56 - i * 8);
+    hlen = 10;
+  }
+  if (tvh_write(fd, hdr, hlen))
+    return -1;
+  return hq ? tcp_write_queue(fd, hq) : 0;
+}
+
+/**
+ * WebSocket input - only control frames are expected (the client
+ * does not send data), returns -1 when the connection is done
+ */
+static int
+comet_ws_input(int fd, uint8_t *buf, size_t *used, size_t size)
+{
+  struct pollfd pfd = { .fd = fd, .events = POLLIN };
+  uint64_t len;
+  size_t hlen;
+  ssize_t r;
+  int opcode;
+
+  while (poll(&pfd, 1, 0) > 0) {
+    if (pfd.revents & (POLLERR | POLLHUP))
+      return -1;
+    r = recv(fd, buf + *used, size - *used, MSG_DONTWAIT);
+    if (r <= 0)
+      return -1;
+    *used += r;
+    while (*used >= 2) {
+      opcode = buf[0] & 0x0f;
+      len    = buf[1] & 0x7f;
+      hlen   = 2 + ((buf[1] & 0x80) ? 4 : 0);
+      if (len == 126) {
+        if (*used < 4) break;
+        len = (buf[2] << 8) | buf[3];
+        hlen += 2;
+      } else if (len == 127) {
+        return -1;
+      }
+      if (hlen + len > size)
+        return -1;
+      if (*used < hlen + len)
+        break;
+      if (opcode == 0x8) /* close */
+        return -1;
+      if (opcode == 0x9) { /* ping */
+        htsbuf_queue_t q;
+        size_t i;
+        htsbuf_queue_init(&q, 0);
+        for (i = 0; i < len; i++)
+          buf[hlen + i] ^= (buf[1] & 0x80) ? buf[hlen - 4 + (i & 3)] : 0;
+        htsbuf_append(&q, buf + hlen, len);
+        if (comet_ws_send(fd, 0xA, &q))
+          return -1;
+      }
+      memmove(buf, buf + hlen + len, *used - hlen - len);
+      *used -= hlen + len;
+    }
+  }
+  return 0;
+}
+
+/**
+ * WebSocket push
+ */
+static int
+comet_mailbox_ws(http_connection_t *hc, const char *remain, void *opaque)
+{
+  comet_mailbox_t *cmb;
+  const char *key = http_arg_get(&hc->hc_args, "Sec-WebSocket-Key");
+  const char *upgrade = http_arg_get(&hc->hc_args, "Upgrade");
+  uint8_t sum[20], in[256];
+  char accept[BASE64_SIZE(20)], buf[256];
+  size_t used = 0;
+  htsbuf_queue_t hq;
+  struct pollfd pfd[2];
+  comet_ws_t cw;
+  SHA_CTX sha1;
+  int run = 1;
+
+  if (key == NULL || upgrade == NULL || strcasecmp(upgrade, "websocket"))
+    return HTTP_STATUS_BAD_REQUEST;
+
+  SHA1_Init(&sha1);
+  SHA1_Update(&sha1, key, strlen(key));
+  SHA1_Update(&sha1, WS_GUID, strlen(WS_GUID));
+  SHA1_Final(sum, &sha1);
+  base64_encode(accept, sizeof(accept), sum, sizeof(sum));
+
+  snprintf(buf, sizeof(buf), "HTTP/1.1 101 Switching Protocols\r\n"
+                             "Upgrade: websocket\r\n"
+                             "Connection: Upgrade\r\n"
+                             "Sec-WebSocket-Accept: %s\r\n\r\n", accept);
+  hc->hc_keep_alive = 0;
+  if (tvh_write(hc->hc_fd, buf, strlen(buf)))
+    return 0;
+  if (tvh_pipe(O_NONBLOCK, &cw.cw_pipe))
+    return 0;
+
+  pthread_mutex_lock(&comet_mutex);
+  if (!comet_running) {
+    pthread_mutex_unlock(&comet_mutex);
+    tvh_pipe_close(&cw.cw_pipe);
+    return 0;
+  }
+  cmb = comet_mailbox_find(http_arg_get(&hc->hc_req_args, "boxid"));
+  if (cmb == NULL) {
+    cmb = comet_mailbox_create();
+    comet_access_update(hc, cmb);
+    comet_serverIpPort(hc, cmb);
+  }
+  cmb->cmb_last_used = 0; /* Make sure we're not flushed out */
+  LIST_INSERT_HEAD(&comet_ws_waiters, &cw, cw_link);
+  pthread_mutex_unlock(&comet_mutex);
+  htsbuf_queue_init(&hq, 0);
+
+  while (run && !hc->hc_shutdown) {
+    pthread_mutex_lock(&comet_mutex);
+    /* The mailbox is gone after comet_done() */
+    if (!comet_running) {
+      pthread_mutex_unlock(&comet_mutex);
+      break;
+    }
+    cmb->cmb_last_used = 0;
+    if (comet_mailbox_pending(cmb))
+      comet_mailbox_take(cmb, &hq);
+    pthread_mutex_unlock(&comet_mutex);
+
+    if (hq.hq_size && comet_ws_send(hc->hc_fd, 0x1, &hq))
+      run = 0;
+    htsbuf_queue_flush(&hq);
+    if (!run)
+      break;
+
+    /* Answer pings and closes right away, not only on notifications */
+    pfd[0].fd = hc->hc_fd;
+    pfd[0].events = POLLIN;
+    pfd[0].revents = 0;
+    pfd[1].fd = cw.cw_pipe.rd;
+    pfd[1].events = POLLIN;
+    pfd[1].revents = 0;
+    if (poll(pfd, 2, MAILBOX_EMPTY_REPLY_TIMEOUT * 1000) < 0 && errno != EINTR)
+      break;
+    if (pfd[1].revents & POLLIN)
+      while (read(cw.cw_pipe.rd, buf, sizeof(buf)) > 0);
+    if (pfd[0].revents && comet_ws_input(hc->hc_fd, in, &used, sizeof(in)))
+      run = 0;
+  }
+
+  pthread_mutex_lock(&comet_mutex);
+  LIST_REMOVE(&cw, cw_link);
+  if (comet_running)
+    cmb->cmb_last_used = dispatch_clock;
+  pthread_mutex_unlock(&comet_mutex);
+  tvh_pipe_close(&cw.cw_pipe);
+
+  comet_ws_send(hc->hc_fd, 0x8, NULL);
+  return 0;
+}
+
 
 /**
  * Poll callback
@@ -281,7 +596,7 @@ comet_mailbox_dbg(http_connection_t *hc, const char *remain, void *opaque)
       htsmsg_add_str(m, "logtxt", buf);
       htsmsg_add_msg(cmb->cmb_messages, NULL, m);
 
-      pthread_cond_broadcast(&comet_cond);
+      comet_wakeup();
     }
   }
   pthread_mutex_unlock(&comet_mutex);
@@ -301,6 +616,7 @@ comet_init(void)
   pthread_mutex_unlock(&comet_mutex);
   http_path_add("/comet/poll",  NULL, comet_mailbox_poll, ACCESS_WEB_INTERFACE);
   http_path_add("/comet/debug", NULL, comet_mailbox_dbg,  ACCESS_WEB_INTERFACE);
+  http_path_add("/comet/ws",    NULL, comet_mailbox_ws,   ACCESS_WEB_INTERFACE);
 }
 
 void
@@ -312,6 +628,7 @@ comet_done(void)
   comet_running = 0;
   while ((cmb = LIST_FIRST(&mailboxes)) != NULL)
     cmb_destroy(cmb);
+  comet_wakeup();
   pthread_mutex_unlock(&comet_mutex);
 }
 
@@ -322,21 +639,39 @@ void
 comet_mailbox_add_message(htsmsg_t *m, int isdebug)
 {
   comet_mailbox_t *cmb;
+  comet_message_t *cm;
+  char *json = NULL;
 
   pthread_mutex_lock(&comet_mutex);
 
-  if (comet_running) {
-    LIST_FOREACH(cmb, &mailboxes, cmb_link) {
+  if (isdebug) {
+    LIST_FOREACH(cmb, &mailboxes, cmb_link)
+      if (cmb->cmb_debug)
+        break;
+    if (cmb == NULL) {
+      pthread_mutex_unlock(&comet_mutex);
+      return;
+    }
+  }
 
-      if(isdebug && !cmb->cmb_debug)
-        continue;
+  if (comet_running && mailbox_count > 0) {
+    pthread_mutex_unlock(&comet_mutex);
+    json = htsmsg_json_serialize_to_str(m, 0);
+    pthread_mutex_lock(&comet_mutex);
+  }
 
-      if(cmb->cmb_messages == NULL)
-        cmb->cmb_messages = htsmsg_create_list();
-      htsmsg_add_msg(cmb->cmb_messages, NULL, htsmsg_copy(m));
-    }
+  /* Every mailbox takes it (or skips it, for debug messages) */
+  if (json && comet_running && mailbox_count > 0) {
+    cm = malloc(sizeof(*cm));
+    cm->cm_seq      = ++comet_seq;
+    cm->cm_refcount = mailbox_count;
+    cm->cm_debug    = isdebug;
+    cm->cm_json     = json;
+    TAILQ_INSERT_TAIL(&comet_messages, cm, cm_link);
+    json = NULL;
   }
 
-  pthread_cond_broadcast(&comet_cond);
+  comet_wakeup();
   pthread_mutex_unlock(&comet_mutex);
+  free(json);
 }
@@ -526,13 +526,19 @@ extjs_config(http_connection_t *hc, const char *remain, void *opaque)
     htsmsg_add_u32(m, "tvhtime_ntp_enabled", tvhtime_ntp_enabled);
     htsmsg_add_u32(m, "tvhtime_tolerance", tvhtime_tolerance);
 
+    /* HTTP */
+    htsmsg_set_s32(m, "http_deflate_level",
+                   config_get_int("http_deflate_level", 6));
+    htsmsg_set_s32(m, "http_deflate_threshold",
+                   config_get_int("http_deflate_threshold", 1024));
+
     pthread_mutex_unlock(&global_lock);
 
     out = json_single_record(m, "config");
 
   /* Save settings */
   } else if (!strcmp(op, "saveSettings") ) {
-    int save = 0, ssave = 0;
+    int save = 0, ssave = 0, hsave = 0;
 
     /* Misc settings */
     pthread_mutex_lock(&global_lock);
@@ -570,10 +576,16 @@ extjs_config(http_connection_t *hc, const char *remain, void *opaque)
       ssave |= config_set_int("satip_atsc", atoi(str));
     if ((str = http_arg_get(&hc->hc_req_args, "satip_dvbcb")))
       ssave |= config_set_int("satip_dvbcb", atoi(str));
-    if (save | ssave)
+    if ((str = http_arg_get(&hc->hc_req_args, "http_deflate_level")))
+      hsave |= config_set_int("http_deflate_level", atoi(str));
+    if ((str = http_arg_get(&hc->hc_req_args, "http_deflate_threshold")))
+      hsave |= config_set_int("http_deflate_threshold", atoi(str));
+    if (save | ssave | hsave)
       config_save();
     if (ssave)
       satip_server_config_changed();
+    if (hsave)
+      http_server_config_changed();
 
     /* Time */
     str = http_arg_get(&hc->hc_req_args, "tvhtime_update_enabled");
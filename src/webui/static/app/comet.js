@@ -43,7 +43,7 @@ tvheadend.cometPoller = function() {
                 });
     });
 
-    function parse_comet_response(responsetxt) {
+    function parse_comet_messages(responsetxt) {
         response = Ext.util.JSON.decode(responsetxt);
         tvheadend.boxid = response.boxid;
         for (x = 0; x < response.messages.length; x++) {
@@ -54,9 +54,46 @@ tvheadend.cometPoller = function() {
                 tvheadend.log('comet failure [e=' + e.message + ']');
             }
         }
+    }
+    ;
+
+    function parse_comet_response(responsetxt) {
+        parse_comet_messages(responsetxt);
         cometRequest.delay(100);
     }
     ;
 
-    cometRequest.delay(100);
+    /* Pushed messages, long polling is the fallback */
+    function cometSocket() {
+        var url = window.location.href.replace(/[?#].*$/, '')
+                                      .replace(/[^\/]*$/, '')
+                                      .replace(/^http/, 'ws') + 'comet/ws';
+        var opened = false;
+        var ws;
+        if (tvheadend.boxid)
+            url += '?boxid=' + tvheadend.boxid;
+        try {
+            ws = new WebSocket(url);
+        } catch (e) {
+            cometRequest.delay(100);
+            return;
+        }
+        ws.onopen = function() {
+            opened = true;
+        };
+        ws.onmessage = function(e) {
+            parse_comet_messages(e.data);
+        };
+        ws.onclose = function() {
+            if (opened)
+                cometSocket.defer(1000);
+            else
+                cometRequest.delay(100);
+        };
+    }
+
+    if (window.WebSocket)
+        cometSocket();
+    else
+        cometRequest.delay(100);
 };
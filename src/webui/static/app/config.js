@@ -47,7 +47,8 @@ tvheadend.miscconf = function(panel, index) {
         'prefer_picon', 'chiconpath', 'piconpath',
         'satip_rtsp', 'satip_weight', 'satip_descramble', 'satip_muxcnf',
         'satip_dvbs', 'satip_dvbs2', 'satip_dvbt', 'satip_dvbt2',
-        'satip_dvbc', 'satip_dvbc2', 'satip_atsc', 'satip_dvbcb'
+        'satip_dvbc', 'satip_dvbc2', 'satip_atsc', 'satip_dvbcb',
+        'http_deflate_level', 'http_deflate_threshold'
     ]);
 
     /* ****************************************************************
@@ -160,6 +161,35 @@ tvheadend.miscconf = function(panel, index) {
         items: [preferPicon, chiconPath, piconPath]
     });
 
+    /*
+    * HTTP server
+    */
+
+    var httpDeflateLevel = new Ext.form.NumberField({
+        name: 'http_deflate_level',
+        fieldLabel: 'Compression level (0 = off, 1-9)',
+        allowNegative: false,
+        allowDecimals: false,
+        minValue: 0,
+        maxValue: 9
+    });
+
+    var httpDeflateThreshold = new Ext.form.NumberField({
+        name: 'http_deflate_threshold',
+        fieldLabel: 'Compress replies from (bytes)',
+        allowNegative: false,
+        allowDecimals: false
+    });
+
+    var httpPanel = new Ext.form.FieldSet({
+        title: 'HTTP Server',
+        width: 700,
+        autoHeight: true,
+        collapsible: true,
+        animCollapse: true,
+        items: [httpDeflateLevel, httpDeflateThreshold]
+    });
+
     /*
     * Image cache
     */
@@ -169,7 +199,8 @@ tvheadend.miscconf = function(panel, index) {
             root: 'entries'
         },
         [
-            'enabled', 'ok_period', 'fail_period', 'ignore_sslcert'
+            'enabled', 'ok_period', 'fail_period', 'ignore_sslcert',
+            'max_size'
         ]);
 
         var imagecacheEnabled = new Ext.ux.form.XCheckbox({
@@ -192,6 +223,11 @@ tvheadend.miscconf = function(panel, index) {
             fieldLabel: 'Ignore invalid SSL certificate'
         });
 
+        var imagecacheMaxSize = new Ext.form.NumberField({
+            name: 'max_size',
+            fieldLabel: 'Maximum size (MB, 0 = unlimited)'
+        });
+
         var imagecachePanel = new Ext.form.FieldSet({
             title: 'Image Caching',
             width: 700,
@@ -199,7 +235,7 @@ tvheadend.miscconf = function(panel, index) {
             collapsible: true,
             animCollapse: true,
             items: [imagecacheEnabled, imagecacheOkPeriod, imagecacheFailPeriod,
-                imagecacheIgnoreSSLCert]
+                imagecacheIgnoreSSLCert, imagecacheMaxSize]
         });
 
         var imagecache_form = new Ext.form.FormPanel({
@@ -322,7 +358,8 @@ tvheadend.miscconf = function(panel, index) {
         }
     });
 
-    var _items = [languageWrap, dvbscanWrap, tvhtimePanel, piconPanel];
+    var _items = [languageWrap, dvbscanWrap, tvhtimePanel, piconPanel,
+                  httpPanel];
 
     if (satipPanel)
       _items.push(satipPanel);
@@ -223,7 +223,7 @@ tvheadend.dvr_upcoming = function(panel, index) {
         del: true,
         list: 'duplicate,disp_title,disp_subtitle,episode,pri,start_real,stop_real,' +
               'duration,filesize,channel,owner,creator,config_name,' +
-              'sched_status,errors,data_errors,comment',
+              'sched_status,errors,data_errors,write_latency,write_queue,comment',
         columns: {
             filesize: {
                 renderer: tvheadend.filesizeRenderer()
@@ -27,7 +27,8 @@ tvheadend.epggrab = function(panel, index) {
             op: 'moduleList'
         },
         autoLoad: true,
-        fields: ['id', 'name', 'path', 'type', 'enabled']
+        fields: ['id', 'name', 'path', 'type', 'enabled',
+                 'cache_hits', 'cache_misses']
     });
     var internalModuleStore = new Ext.data.Store({
         recordType: moduleStore.recordType
@@ -239,6 +240,16 @@ tvheadend.epggrab = function(panel, index) {
             dataIndex: 'name',
             width: 200,
             sortable: false
+        }, {
+            header: 'Unchanged sections',
+            dataIndex: 'cache_hits',
+            width: 100,
+            sortable: false
+        }, {
+            header: 'Processed sections',
+            dataIndex: 'cache_misses',
+            width: 100,
+            sortable: false
         }]);
 
     var otaGrid = new Ext.grid.EditorGridPanel({
@@ -21,6 +21,7 @@ tvheadend.status_subs = function(panel, index)
             r.data.service = m.service;
             r.data.state = m.state;
             r.data.errors = m.errors;
+            r.data.zap = m.zap;
             r.data['in'] = m['in'];
             r.data.out = m.out;
 
@@ -45,6 +46,7 @@ tvheadend.status_subs = function(panel, index)
                 { name: 'service' },
                 { name: 'state' },
                 { name: 'errors' },
+                { name: 'zap' },
                 { name: 'in' },
                 { name: 'out' },
                 {
@@ -130,6 +132,12 @@ tvheadend.status_subs = function(panel, index)
                 header: "Errors",
                 dataIndex: 'errors'
             },
+            {
+                width: 50,
+                id: 'zap',
+                header: "Zap (ms)",
+                dataIndex: 'zap'
+            },
             {
                 width: 50,
                 id: 'in',
@@ -232,6 +240,10 @@ tvheadend.status_streams = function(panel, index)
         r.data.tc_bit = m.tc_bit;
         r.data.ec_block = m.ec_block;
         r.data.tc_block = m.tc_block;
+        r.data.rtp_loss = m.rtp_loss;
+        r.data.rtp_reorder = m.rtp_reorder;
+        r.data.rtp_dup = m.rtp_dup;
+        r.data.rtp_fec = m.rtp_fec;
 
         store.afterEdit(r);
         store.fireEvent('updated', store, Ext.data.Record.COMMIT);
@@ -290,7 +302,11 @@ tvheadend.status_streams = function(panel, index)
                 { name: 'ec_bit' },
                 { name: 'tc_bit' },
                 { name: 'ec_block' },
-                { name: 'tc_block' }
+                { name: 'tc_block' },
+                { name: 'rtp_loss' },
+                { name: 'rtp_reorder' },
+                { name: 'rtp_dup' },
+                { name: 'rtp_fec' }
             ],
             url: 'api/status/inputs',
             autoLoad: true,
@@ -379,6 +395,30 @@ tvheadend.status_streams = function(panel, index)
                 width: 50,
                 header: "Continuity Errors",
                 dataIndex: 'cc'
+            },
+            {
+                width: 50,
+                header: "RTP Lost",
+                dataIndex: 'rtp_loss',
+                hidden: true
+            },
+            {
+                width: 50,
+                header: "RTP Reordered",
+                dataIndex: 'rtp_reorder',
+                hidden: true
+            },
+            {
+                width: 50,
+                header: "RTP Duplicates",
+                dataIndex: 'rtp_dup',
+                hidden: true
+            },
+            {
+                width: 50,
+                header: "FEC Recovered",
+                dataIndex: 'rtp_fec',
+                hidden: true
             }
         ]);
 
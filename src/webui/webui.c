@@ -900,6 +900,12 @@ http_stream_channel(http_connection_t *hc, channel_t *ch, int weight)
   else
     qsize = 1500000;
 
+  if (webui_share_allowed(pro)) {
+    res = webui_share_run(hc, ch, pro, weight, qsize);
+    http_stream_postop(tcp_id);
+    return res;
+  }
+
   profile_chain_init(&prch, pro, ch);
   if (!profile_chain_open(&prch, NULL, 0, qsize)) {
 
@@ -1291,6 +1297,8 @@ page_dvrfile(http_connection_t *hc, const char *remain, void *opaque)
   return ret;
 }
 
+#define IMAGECACHE_MAXAGE (24 * 3600)
+
 /**
  * Fetch image cache image
  */
@@ -1301,10 +1309,13 @@ static int
 page_imagecache(http_connection_t *hc, const char *remain, void *opaque)
 {
   uint32_t id;
-  int fd;
-  char buf[8192];
+  int fd, ret = 0;
+  char etag[64];
+  const char *s;
   struct stat st;
-  ssize_t c;
+  off_t content_len;
+  ssize_t r;
+  http_arg_list_t args;
 
   if(remain == NULL)
     return HTTP_STATUS_NOT_FOUND;
@@ -1335,18 +1346,44 @@ page_imagecache(http_connection_t *hc, const char *remain, void *opaque)
     return HTTP_STATUS_NOT_FOUND;
   }
 
-  http_send_header(hc, 200, NULL, st.st_size, 0, NULL, 10, 0, NULL, NULL);
+  /* The clients may keep the images, revalidated by the ETag */
+  snprintf(etag, sizeof(etag), "\"%x-%"PRIx64"-%"PRIx64"\"", id,
+           (uint64_t)st.st_mtime, (uint64_t)st.st_size);
+  http_arg_init(&args);
+  http_arg_set(&args, "ETag", etag);
 
-  while (1) {
-    c = read(fd, buf, sizeof(buf));
-    if (c <= 0)
-      break;
-    if (tvh_write(hc->hc_fd, buf, c))
+  if ((s = http_arg_get(&hc->hc_args, "If-None-Match")) != NULL &&
+      strstr(s, etag)) {
+    close(fd);
+    http_send_header(hc, HTTP_STATUS_NOT_MODIFIED, NULL, 0, NULL, NULL,
+                     IMAGECACHE_MAXAGE, 0, NULL, &args);
+    http_arg_flush(&args);
+    return 0;
+  }
+
+  http_send_header(hc, HTTP_STATUS_OK, NULL, st.st_size, NULL, NULL,
+                   IMAGECACHE_MAXAGE, 0, NULL, &args);
+  http_arg_flush(&args);
+
+  content_len = hc->hc_no_output ? 0 : st.st_size;
+  while (content_len > 0) {
+#if defined(PLATFORM_LINUX)
+    r = sendfile(hc->hc_fd, fd, NULL, content_len);
+#elif defined(PLATFORM_FREEBSD)
+    sendfile(fd, hc->hc_fd, 0, content_len, NULL, &r, 0);
+#elif defined(PLATFORM_DARWIN)
+    r = content_len;
+    sendfile(fd, hc->hc_fd, 0, NULL, &r, 0);
+#endif
+    if (r <= 0) {
+      ret = -1;
       break;
+    }
+    content_len -= r;
   }
   close(fd);
 
-  return 0;
+  return ret;
 }
 
 /**
@@ -1411,10 +1448,13 @@ webui_init(int xspf)
   extjs_start();
   comet_init();
   webui_api_init();
+  webui_share_init();
+  webui_hls_init();
 }
 
 void
 webui_done(void)
 {
+  webui_hls_done();
   comet_done();
 }
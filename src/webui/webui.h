@@ -41,6 +41,40 @@ void extjs_start_dvb(void);
 
 void webui_api_init ( void );
 
+struct channel;
+struct profile;
+
+struct pktbuf;
+
+typedef struct webui_share webui_share_t;
+
+#define WEBUI_SHARE_NOCURSOR UINT64_MAX
+
+void webui_share_init(void);
+
+void webui_share_done(void);
+
+void webui_reap(void (*cb)(void *aux), void *aux);
+
+int webui_share_allowed(struct profile *pro);
+
+webui_share_t *webui_share_get(http_connection_t *hc, struct channel *ch,
+                               struct profile *pro, int weight, size_t qsize,
+                               void *owner);
+
+void webui_share_put(webui_share_t *ws, void *owner);
+
+int webui_share_read(webui_share_t *ws, uint64_t *cursor, struct pktbuf **pb);
+
+const char *webui_share_mime(webui_share_t *ws);
+
+void webui_hls_init(void);
+
+void webui_hls_done(void);
+
+int webui_share_run(http_connection_t *hc, struct channel *ch,
+                    struct profile *pro, int weight, size_t qsize);
+
 
 /**
  *
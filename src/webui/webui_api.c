@@ -31,20 +31,24 @@ webui_api_handler
 {
   int r;
   http_arg_t *ha;
-  htsmsg_t *args, *resp = NULL;
+  htsmsg_arena_t *arena;
+  htsmsg_t *args;
 
-  /* Build arguments */
-  args = htsmsg_create_map();
+  /* Build arguments (only live for the call) */
+  arena = htsmsg_arena_create();
+  args = htsmsg_create_map_arena(arena);
   TAILQ_FOREACH(ha, &hc->hc_req_args, link) {
     htsmsg_add_str(args, ha->key, ha->val);
   }
       
   /* Call */
-  r = api_exec(hc->hc_access, remain, args, &resp);
+  r = api_exec_json(hc->hc_access, remain, args, &hc->hc_reply);
   htsmsg_destroy(args);
+  htsmsg_arena_destroy(arena);
   
   /* Convert error */
   if (r) {
+    htsbuf_queue_flush(&hc->hc_reply);
     switch (r) {
       case EPERM:
       case EACCES:
@@ -61,13 +65,8 @@ webui_api_handler
   }
 
   /* Output response */
-  if (!r && !resp)
-    resp = htsmsg_create_map();
-  if (resp) {
-    htsmsg_json_serialize(resp, &hc->hc_reply, 0);
+  if (!r)
     http_output_content(hc, "text/x-json; charset=UTF-8");
-    htsmsg_destroy(resp);
-  }
   
   return r;
 }
@@ -0,0 +1,602 @@
+/*
+ *  tvheadend, WEBUI / HTTP Live Streaming
+ *  Copyright (C) 2015 Tvheadend Foundation CIC
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * The segmenter is a consumer of the shared HTTP stream (webui_share.c).
+ * The TS output of the pass-through muxer is cut into segments starting
+ * on a video random access point, every segment is prefixed with the
+ * last PAT/PMT so it can be decoded standalone. The finished segments
+ * are kept in a small RAM ring, so any number of clients (or caching
+ * proxies) are served with a plain buffer send. The sequence restarts
+ * with every new segmenter, so the segment names carry the segmenter
+ * instance to keep the cached segments of an old one from being reused.
+ *
+ *   http://tvheadend/hls/<channel uuid>/index.m3u8
+ *   http://tvheadend/hls/<channel uuid>/<instance>-<sequence>.ts
+ */
+
+#include <pthread.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tvheadend.h"
+#include "http.h"
+#include "webui.h"
+#include "access.h"
+#include "channels.h"
+#include "profile.h"
+#include "packet.h"
+
+#define HLS_SEGMENT_DURATION  4   /* target segment duration (seconds) */
+#define HLS_SEGMENTS          6   /* segments kept in the RAM ring */
+#define HLS_PLAYLIST          4   /* segments announced in the playlist */
+#define HLS_IDLE_TIMEOUT      30  /* stop the segmenter without requests */
+
+#define HLS_PCR_MASK          ((1LL << 33) - 1)
+
+typedef struct hls_segment {
+  uint64_t                hsg_seq;
+  int64_t                 hsg_duration;  /* 90kHz */
+  pktbuf_t               *hsg_data;
+} hls_segment_t;
+
+typedef struct hls_stream {
+  LIST_ENTRY(hls_stream)  hs_link;
+  int                     hs_refcount;   /* global_lock */
+  time_t                  hs_last_used;  /* global_lock */
+
+  channel_t              *hs_channel;
+  profile_t              *hs_profile;
+  webui_share_t          *hs_share;
+  uint32_t                hs_instance;
+  pthread_t               hs_tid;
+
+  pthread_mutex_t         hs_mutex;
+  pthread_cond_t          hs_cond;
+  int                     hs_running;    /* hs_mutex */
+  int                     hs_eof;        /* hs_mutex */
+  uint64_t                hs_seq;        /* hs_mutex */
+  hls_segment_t           hs_segments[HLS_SEGMENTS];
+
+  /* segmenter thread only */
+  sbuf_t                  hs_sbuf;
+  int                     hs_started;
+  uint8_t                 hs_pat[188];
+  uint8_t                 hs_pmt[188];
+  int                     hs_pmt_pid;
+  int                     hs_video_pid;
+  int64_t                 hs_pcr;
+  int64_t                 hs_start_pcr;
+  int64_t                 hs_start_mono;
+} hls_stream_t;
+
+static LIST_HEAD(, hls_stream) hls_streams;
+static gtimer_t hls_timer;
+static uint32_t hls_instance;
+
+/**
+ * Return the section start for a PSI packet (pusi set) or NULL
+ */
+static const uint8_t *
+hls_psi_section(const uint8_t *tsb, int *len)
+{
+  int off = 4;
+
+  if (tsb[3] & 0x20)
+    off += 1 + tsb[4];
+  if (!(tsb[3] & 0x10) || off >= 188)
+    return NULL;
+  off += 1 + tsb[off];
+  if (off + 3 > 188)
+    return NULL;
+  *len = MIN(3 + (((tsb[off + 1] & 0x0f) << 8) | tsb[off + 2]), 188 - off);
+  return tsb + off;
+}
+
+/**
+ * Remember the PMT PID of the (only) program
+ */
+static void
+hls_parse_pat(hls_stream_t *hs, const uint8_t *tsb)
+{
+  const uint8_t *sec;
+  int i, len;
+
+  if ((sec = hls_psi_section(tsb, &len)) == NULL || sec[0] != 0x00)
+    return;
+  for (i = 8; i + 4 <= len - 4; i += 4)
+    if ((sec[i] << 8 | sec[i + 1]) != 0) {
+      hs->hs_pmt_pid = (sec[i + 2] & 0x1f) << 8 | sec[i + 3];
+      break;
+    }
+}
+
+/**
+ * Remember the first video PID (the segmentation reference)
+ */
+static void
+hls_parse_pmt(hls_stream_t *hs, const uint8_t *tsb)
+{
+  const uint8_t *sec;
+  int i, len, stype;
+
+  if ((sec = hls_psi_section(tsb, &len)) == NULL || sec[0] != 0x02 || len < 12)
+    return;
+  hs->hs_video_pid = 0;
+  for (i = 12 + (((sec[10] & 0x0f) << 8) | sec[11]); i + 5 <= len - 4;
+       i += 5 + (((sec[i + 3] & 0x0f) << 8) | sec[i + 4])) {
+    stype = sec[i];
+    if (stype == 0x01 || stype == 0x02 || stype == 0x10 ||
+        stype == 0x1b || stype == 0x24) {
+      hs->hs_video_pid = (sec[i + 1] & 0x1f) << 8 | sec[i + 2];
+      break;
+    }
+  }
+}
+
+/**
+ * Current segment duration in 90kHz units
+ */
+static int64_t
+hls_duration(hls_stream_t *hs)
+{
+  int64_t d = -1;
+
+  if (hs->hs_start_pcr != PTS_UNSET && hs->hs_pcr != PTS_UNSET)
+    d = (hs->hs_pcr - hs->hs_start_pcr) & HLS_PCR_MASK;
+  /* no PCR or discontinuity, use the wall clock */
+  if (d < 0 || d > 10 * HLS_SEGMENT_DURATION * 90000LL)
+    d = (getmonoclock() - hs->hs_start_mono) * 9 / 100;
+  return d;
+}
+
+/**
+ *
+ */
+static void
+hls_segment_start(hls_stream_t *hs)
+{
+  hs->hs_start_pcr  = hs->hs_pcr;
+  hs->hs_start_mono = getmonoclock();
+  if (hs->hs_pat[0])
+    sbuf_append(&hs->hs_sbuf, hs->hs_pat, 188);
+  if (hs->hs_pmt[0])
+    sbuf_append(&hs->hs_sbuf, hs->hs_pmt, 188);
+}
+
+/**
+ *
+ */
+static void
+hls_segment_finish(hls_stream_t *hs, int64_t duration)
+{
+  hls_segment_t *hsg;
+  pktbuf_t *pb;
+
+  pb = pktbuf_make(hs->hs_sbuf.sb_data, hs->hs_sbuf.sb_ptr);
+  sbuf_steal_data(&hs->hs_sbuf);
+
+  pthread_mutex_lock(&hs->hs_mutex);
+  hsg = &hs->hs_segments[hs->hs_seq % HLS_SEGMENTS];
+  pktbuf_ref_dec(hsg->hsg_data);
+  hsg->hsg_seq      = hs->hs_seq;
+  hsg->hsg_duration = duration;
+  hsg->hsg_data     = pb;
+  hs->hs_seq++;
+  pthread_cond_broadcast(&hs->hs_cond);
+  pthread_mutex_unlock(&hs->hs_mutex);
+}
+
+/**
+ * Process one TS packet
+ */
+static void
+hls_packet(hls_stream_t *hs, const uint8_t *tsb)
+{
+  int pid = (tsb[1] & 0x1f) << 8 | tsb[2];
+  int pusi = tsb[1] & 0x40, rai = 0, cut = 0;
+  int64_t target = HLS_SEGMENT_DURATION * 90000LL, d;
+
+  if ((tsb[3] & 0x20) && tsb[4] > 0) {
+    rai = tsb[5] & 0x40;
+    if ((tsb[5] & 0x10) && tsb[4] >= 7)
+      hs->hs_pcr = ((int64_t)tsb[6] << 25) | (tsb[7] << 17) |
+                   (tsb[8] << 9) | (tsb[9] << 1) | (tsb[10] >> 7);
+  }
+
+  if (pid == 0 && pusi) {
+    memcpy(hs->hs_pat, tsb, 188);
+    hls_parse_pat(hs, tsb);
+  } else if (pid == hs->hs_pmt_pid && pusi) {
+    memcpy(hs->hs_pmt, tsb, 188);
+    hls_parse_pmt(hs, tsb);
+  }
+
+  if (pusi && hs->hs_pmt[0] &&
+      (hs->hs_video_pid == 0 || pid == hs->hs_video_pid)) {
+    if (!hs->hs_started) {
+      /* the first segment must start on a random access point */
+      d = hls_duration(hs);
+      if (rai || hs->hs_video_pid == 0 || d >= 2 * target) {
+        hs->hs_started = 1;
+        hls_segment_start(hs);
+      }
+    } else {
+      /* fallback for streams without the random access indicator */
+      d = hls_duration(hs);
+      cut = (d >= target && (rai || hs->hs_video_pid == 0)) || d >= 2 * target;
+      if (cut) {
+        hls_segment_finish(hs, d);
+        hls_segment_start(hs);
+      }
+    }
+  }
+
+  if (hs->hs_started)
+    sbuf_append(&hs->hs_sbuf, tsb, 188);
+}
+
+/**
+ * Segmenter thread
+ */
+static void *
+hls_thread(void *aux)
+{
+  hls_stream_t *hs = aux;
+  uint64_t cursor = WEBUI_SHARE_NOCURSOR;
+  pktbuf_t *pb;
+  uint8_t *tsb;
+  size_t len;
+  int run = 1;
+
+  hs->hs_start_mono = getmonoclock();
+  while (run) {
+    pthread_mutex_lock(&hs->hs_mutex);
+    run = hs->hs_running;
+    pthread_mutex_unlock(&hs->hs_mutex);
+    if (!run)
+      break;
+    if (webui_share_read(hs->hs_share, &cursor, &pb) < 0)
+      break;
+    if (pb == NULL)
+      continue;
+    for (tsb = pktbuf_ptr(pb), len = pktbuf_len(pb); len >= 188;
+         tsb += 188, len -= 188)
+      if (tsb[0] == 0x47)
+        hls_packet(hs, tsb);
+    pktbuf_ref_dec(pb);
+  }
+
+  sbuf_free(&hs->hs_sbuf);
+
+  pthread_mutex_lock(&hs->hs_mutex);
+  hs->hs_eof = 1;
+  pthread_cond_broadcast(&hs->hs_cond);
+  pthread_mutex_unlock(&hs->hs_mutex);
+  return NULL;
+}
+
+/**
+ * Reaper callback - join the segmenter and free the stream
+ */
+static void
+hls_stream_reap(void *aux)
+{
+  hls_stream_t *hs = aux;
+  int i;
+
+  pthread_join(hs->hs_tid, NULL);
+
+  pthread_mutex_lock(&global_lock);
+  webui_share_put(hs->hs_share, hs);
+  profile_release(hs->hs_profile);
+  pthread_mutex_unlock(&global_lock);
+
+  for (i = 0; i < HLS_SEGMENTS; i++)
+    pktbuf_ref_dec(hs->hs_segments[i].hsg_data);
+  pthread_cond_destroy(&hs->hs_cond);
+  pthread_mutex_destroy(&hs->hs_mutex);
+  free(hs);
+}
+
+/**
+ * Unlink and stop the stream, the segmenter is joined by the reaper
+ */
+static void
+hls_stream_destroy(hls_stream_t *hs)
+{
+  lock_assert(&global_lock);
+
+  LIST_REMOVE(hs, hs_link);
+
+  pthread_mutex_lock(&hs->hs_mutex);
+  hs->hs_running = 0;
+  pthread_mutex_unlock(&hs->hs_mutex);
+
+  webui_reap(hls_stream_reap, hs);
+}
+
+/**
+ *
+ */
+static hls_stream_t *
+hls_stream_find(channel_t *ch, profile_t *pro)
+{
+  hls_stream_t *hs;
+
+  LIST_FOREACH(hs, &hls_streams, hs_link)
+    if (hs->hs_channel == ch && hs->hs_profile == pro)
+      return hs;
+  return NULL;
+}
+
+/**
+ *
+ */
+static hls_stream_t *
+hls_stream_create(http_connection_t *hc, channel_t *ch, profile_t *pro)
+{
+  hls_stream_t *hs;
+  webui_share_t *ws;
+  const char *str;
+  int weight = 0;
+
+  if ((str = http_arg_get(&hc->hc_req_args, "weight")))
+    weight = atoi(str);
+
+  hs = calloc(1, sizeof(*hs));
+  ws = webui_share_get(hc, ch, pro, weight, 10000000, hs);
+  if (ws == NULL) {
+    free(hs);
+    return NULL;
+  }
+
+  /* unique across restarts too, unless more than one per second */
+  hls_instance     = MAX(hls_instance + 1, (uint32_t)dispatch_clock);
+  hs->hs_channel   = ch;
+  hs->hs_profile   = pro;
+  hs->hs_share     = ws;
+  hs->hs_instance  = hls_instance;
+  hs->hs_running   = 1;
+  hs->hs_pcr       = PTS_UNSET;
+  hs->hs_start_pcr = PTS_UNSET;
+  hs->hs_pmt_pid   = -1;
+  profile_grab(pro);
+  sbuf_init(&hs->hs_sbuf);
+  pthread_mutex_init(&hs->hs_mutex, NULL);
+  pthread_cond_init(&hs->hs_cond, NULL);
+  LIST_INSERT_HEAD(&hls_streams, hs, hs_link);
+  tvhthread_create(&hs->hs_tid, NULL, hls_thread, hs);
+  return hs;
+}
+
+/**
+ * Remove idle and finished streams
+ */
+static void
+hls_timer_cb(void *aux)
+{
+  hls_stream_t *hs, *hs_next;
+  int eof;
+
+  for (hs = LIST_FIRST(&hls_streams); hs; hs = hs_next) {
+    hs_next = LIST_NEXT(hs, hs_link);
+    if (hs->hs_refcount)
+      continue;
+    pthread_mutex_lock(&hs->hs_mutex);
+    eof = hs->hs_eof;
+    pthread_mutex_unlock(&hs->hs_mutex);
+    if (eof || hs->hs_last_used + HLS_IDLE_TIMEOUT < dispatch_clock)
+      hls_stream_destroy(hs);
+  }
+  gtimer_arm(&hls_timer, hls_timer_cb, NULL, 5);
+}
+
+/**
+ * Output the live playlist
+ */
+static int
+hls_playlist(http_connection_t *hc, channel_t *ch, profile_t *pro)
+{
+  htsbuf_queue_t *hq = &hc->hc_reply;
+  hls_stream_t *hs;
+  hls_segment_t *hsg;
+  struct timespec ts;
+  struct timeval tp;
+  const char *profile;
+  uint64_t seq, first;
+  int64_t maxd = 0;
+  int eof;
+
+  hs = hls_stream_find(ch, pro);
+  if (hs) {
+    pthread_mutex_lock(&hs->hs_mutex);
+    eof = hs->hs_eof;
+    pthread_mutex_unlock(&hs->hs_mutex);
+    if (eof && hs->hs_refcount == 0) {
+      hls_stream_destroy(hs);
+      hs = NULL;
+    }
+  }
+  if (hs == NULL && (hs = hls_stream_create(hc, ch, pro)) == NULL)
+    return HTTP_STATUS_SERVICE;
+
+  hs->hs_refcount++;
+  hs->hs_last_used = dispatch_clock;
+  pthread_mutex_unlock(&global_lock);
+
+  /* wait for the first segments (tuning, PSI and the first I-frame) */
+  gettimeofday(&tp, NULL);
+  ts.tv_sec  = tp.tv_sec + 3 * HLS_SEGMENT_DURATION + 10;
+  ts.tv_nsec = tp.tv_usec * 1000;
+  pthread_mutex_lock(&hs->hs_mutex);
+  while (hs->hs_seq < 2 && !hs->hs_eof)
+    if (pthread_cond_timedwait(&hs->hs_cond, &hs->hs_mutex, &ts) == ETIMEDOUT)
+      break;
+  seq = hs->hs_seq;
+  if (seq > 0) {
+    first = seq > HLS_PLAYLIST ? seq - HLS_PLAYLIST : 0;
+    for (; first < seq; first++) {
+      hsg = &hs->hs_segments[first % HLS_SEGMENTS];
+      maxd = MAX(maxd, hsg->hsg_duration);
+    }
+    first = seq > HLS_PLAYLIST ? seq - HLS_PLAYLIST : 0;
+    htsbuf_qprintf(hq, "#EXTM3U\n"
+                       "#EXT-X-VERSION:3\n"
+                       "#EXT-X-TARGETDURATION:%"PRId64"\n"
+                       "#EXT-X-MEDIA-SEQUENCE:%"PRIu64"\n",
+                   (maxd + 89999) / 90000, first);
+    profile = http_arg_get(&hc->hc_req_args, "profile");
+    for (; first < seq; first++) {
+      hsg = &hs->hs_segments[first % HLS_SEGMENTS];
+      htsbuf_qprintf(hq, "#EXTINF:%d.%03d,\n%08x-%"PRIu64".ts",
+                     (int)(hsg->hsg_duration / 90000),
+                     (int)((hsg->hsg_duration % 90000) / 90),
+                     hs->hs_instance, hsg->hsg_seq);
+      if (profile) {
+        htsbuf_append(hq, "?profile=", 9);
+        htsbuf_append_and_escape_url(hq, profile);
+      }
+      htsbuf_append(hq, "\n", 1);
+    }
+  }
+  pthread_mutex_unlock(&hs->hs_mutex);
+
+  pthread_mutex_lock(&global_lock);
+  hs->hs_refcount--;
+  hs->hs_last_used = dispatch_clock;
+
+  if (seq == 0)
+    return HTTP_STATUS_SERVICE;
+
+  http_output_content(hc, "application/vnd.apple.mpegurl");
+  return 0;
+}
+
+/**
+ * Send one cached segment
+ */
+static int
+hls_segment(http_connection_t *hc, channel_t *ch, profile_t *pro,
+            uint32_t instance, uint64_t seq)
+{
+  hls_stream_t *hs;
+  hls_segment_t *hsg;
+  pktbuf_t *pb = NULL;
+
+  if ((hs = hls_stream_find(ch, pro)) == NULL || hs->hs_instance != instance)
+    return HTTP_STATUS_NOT_FOUND;
+
+  hs->hs_last_used = dispatch_clock;
+
+  pthread_mutex_lock(&hs->hs_mutex);
+  hsg = &hs->hs_segments[seq % HLS_SEGMENTS];
+  if (hsg->hsg_data && hsg->hsg_seq == seq)
+    pb = pktbuf_ref_inc(hsg->hsg_data);
+  pthread_mutex_unlock(&hs->hs_mutex);
+
+  if (pb == NULL)
+    return HTTP_STATUS_NOT_FOUND;
+
+  pthread_mutex_unlock(&global_lock);
+  http_send_header(hc, HTTP_STATUS_OK, "video/MP2T", pktbuf_len(pb),
+                   NULL, NULL, HLS_SEGMENTS * HLS_SEGMENT_DURATION,
+                   NULL, NULL, NULL);
+  tvh_write(hc->hc_fd, pktbuf_ptr(pb), pktbuf_len(pb));
+  pktbuf_ref_dec(pb);
+  pthread_mutex_lock(&global_lock);
+  return 0;
+}
+
+/**
+ * Handle the http request. http://tvheadend/hls/<channel uuid>/index.m3u8
+ *                          http://tvheadend/hls/<channel uuid>/<inst>-<seq>.ts
+ */
+static int
+page_hls(http_connection_t *hc, const char *remain, void *opaque)
+{
+  char *components[2], *s;
+  channel_t *ch;
+  profile_t *pro;
+  uint32_t instance;
+  uint64_t seq;
+  int r;
+
+  if (remain == NULL)
+    return HTTP_STATUS_BAD_REQUEST;
+
+  s = tvh_strdupa(remain);
+  if (http_tokenize(s, components, 2, '/') != 2)
+    return HTTP_STATUS_BAD_REQUEST;
+
+  pthread_mutex_lock(&global_lock);
+
+  if ((ch = channel_find(components[0])) == NULL) {
+    r = HTTP_STATUS_NOT_FOUND;
+    goto out;
+  }
+
+  if (http_access_verify_channel(hc, ACCESS_STREAMING, ch, 1)) {
+    r = HTTP_STATUS_UNAUTHORIZED;
+    goto out;
+  }
+
+  if (!(pro = profile_find_by_list(hc->hc_access->aa_profiles,
+                                   http_arg_get(&hc->hc_req_args, "profile"),
+                                   "channel"))) {
+    r = HTTP_STATUS_NOT_ALLOWED;
+    goto out;
+  }
+
+  if (strcmp(components[1], "index.m3u8") == 0)
+    r = hls_playlist(hc, ch, pro);
+  else if (sscanf(components[1], "%8"SCNx32"-%"SCNu64".ts", &instance, &seq) == 2)
+    r = hls_segment(hc, ch, pro, instance, seq);
+  else
+    r = HTTP_STATUS_NOT_FOUND;
+
+out:
+  pthread_mutex_unlock(&global_lock);
+  return r;
+}
+
+/**
+ *
+ */
+void
+webui_hls_init(void)
+{
+  http_path_add("/hls", NULL, page_hls, ACCESS_STREAMING);
+  gtimer_arm(&hls_timer, hls_timer_cb, NULL, 5);
+}
+
+/**
+ *
+ */
+void
+webui_hls_done(void)
+{
+  hls_stream_t *hs;
+
+  pthread_mutex_lock(&global_lock);
+  gtimer_disarm(&hls_timer);
+  while ((hs = LIST_FIRST(&hls_streams)) != NULL)
+    hls_stream_destroy(hs);
+  pthread_mutex_unlock(&global_lock);
+}
@@ -0,0 +1,714 @@
+/*
+ *  tvheadend, WEBUI / shared HTTP streams
+ *  Copyright (C) 2015 Tvheadend Foundation CIC
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Clients requesting the same channel with the same (shareable) profile
+ * are attached to one subscription and one muxer instance. The muxer
+ * writes into a pipe, the pipe reader slices the output into refcounted
+ * TS aligned chunks stored in a ring and every client sends the chunks
+ * from its own cursor. A client which falls behind the ring tail is
+ * disconnected, so one slow consumer cannot stall the others.
+ *
+ * The subscription runs with the highest weight of the attached clients
+ * and its status lists all of them.
+ *
+ * Joining the stream threads may take a second, so finished streams are
+ * handed to a reaper thread instead of being joined under global_lock.
+ */
+
+#include <pthread.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+
+#include "tvheadend.h"
+#include "http.h"
+#include "webui.h"
+#include "channels.h"
+#include "subscriptions.h"
+#include "streaming.h"
+#include "profile.h"
+#include "muxer.h"
+#include "packet.h"
+#include "atomic.h"
+
+#define WEBUI_SHARE_RING   1024              /* max chunks in the ring */
+#define WEBUI_SHARE_CHUNK  (188 * 348)       /* max chunk size (64kB) */
+
+typedef struct webui_share_client {
+  LIST_ENTRY(webui_share_client) wsc_link;
+  void                   *wsc_owner;
+  int                     wsc_weight;
+  char                   *wsc_peer;
+  char                   *wsc_user;
+} webui_share_client_t;
+
+struct webui_share {
+  LIST_ENTRY(webui_share) ws_link;
+  LIST_HEAD(, webui_share_client) ws_clients; /* global_lock */
+  int                     ws_closed;         /* global_lock */
+
+  channel_t              *ws_channel;
+  profile_t              *ws_profile;
+  profile_chain_t         ws_prch;
+  th_subscription_t      *ws_sub;
+  char                   *ws_name;
+
+  th_pipe_t               ws_pipe;
+  pthread_t               ws_mux_tid;
+  pthread_t               ws_read_tid;
+  int                     ws_running;        /* sq_mutex */
+
+  pthread_mutex_t         ws_mutex;
+  pthread_cond_t          ws_cond;
+  char                   *ws_mime;           /* ws_mutex */
+  int                     ws_eof;            /* ws_mutex */
+  size_t                  ws_maxsize;
+  size_t                  ws_size;           /* ws_mutex */
+  uint64_t                ws_head;           /* ws_mutex */
+  uint64_t                ws_tail;           /* ws_mutex */
+  pktbuf_t               *ws_ring[WEBUI_SHARE_RING];
+};
+
+static LIST_HEAD(, webui_share) webui_shares;
+
+typedef struct webui_reap {
+  TAILQ_ENTRY(webui_reap) wr_link;
+  void                  (*wr_cb)(void *aux);
+  void                   *wr_aux;
+} webui_reap_t;
+
+static TAILQ_HEAD(, webui_reap) webui_reaps;
+static pthread_mutex_t          webui_reap_mutex;
+static pthread_cond_t           webui_reap_cond;
+static pthread_t                webui_reap_tid;
+static int                      webui_reap_running;
+
+/**
+ * Reaper thread - run the queued callbacks without any lock held
+ */
+static void *
+webui_reap_thread(void *aux)
+{
+  webui_reap_t *wr;
+
+  pthread_mutex_lock(&webui_reap_mutex);
+  while (1) {
+    if ((wr = TAILQ_FIRST(&webui_reaps)) == NULL) {
+      if (!webui_reap_running)
+        break;
+      pthread_cond_wait(&webui_reap_cond, &webui_reap_mutex);
+      continue;
+    }
+    TAILQ_REMOVE(&webui_reaps, wr, wr_link);
+    pthread_mutex_unlock(&webui_reap_mutex);
+    wr->wr_cb(wr->wr_aux);
+    free(wr);
+    pthread_mutex_lock(&webui_reap_mutex);
+  }
+  pthread_mutex_unlock(&webui_reap_mutex);
+  return NULL;
+}
+
+/**
+ * Queue a callback to the reaper thread, it can join threads and
+ * take global_lock itself
+ */
+void
+webui_reap(void (*cb)(void *aux), void *aux)
+{
+  webui_reap_t *wr = malloc(sizeof(*wr));
+
+  wr->wr_cb  = cb;
+  wr->wr_aux = aux;
+  pthread_mutex_lock(&webui_reap_mutex);
+  TAILQ_INSERT_TAIL(&webui_reaps, wr, wr_link);
+  pthread_cond_signal(&webui_reap_cond);
+  pthread_mutex_unlock(&webui_reap_mutex);
+}
+
+/**
+ * Check if the profile output can be joined in the middle of the stream
+ */
+int
+webui_share_allowed(profile_t *pro)
+{
+  muxer_container_type_t mc;
+
+  if (pro == NULL || !pro->pro_http_share)
+    return 0;
+  mc = profile_get_mc(pro);
+  return mc == MC_PASS || mc == MC_MPEGTS;
+}
+
+/**
+ * Muxer thread - feed the shared muxer from the streaming queue
+ */
+static void *
+webui_share_mux_thread(void *aux)
+{
+  webui_share_t *ws = aux;
+  streaming_queue_t *sq = &ws->ws_prch.prch_sq;
+  muxer_t *mux = ws->ws_prch.prch_muxer;
+  streaming_message_t *sm;
+  struct timespec ts;
+  struct timeval tp;
+  int run = 1, started = 0, timeouts = 0, grace = 20;
+
+  if (muxer_open_stream(mux, ws->ws_pipe.wr))
+    run = 0;
+
+  while (run && tvheadend_running) {
+    pthread_mutex_lock(&sq->sq_mutex);
+    if (!ws->ws_running) {
+      pthread_mutex_unlock(&sq->sq_mutex);
+      break;
+    }
+    sm = TAILQ_FIRST(&sq->sq_queue);
+    if (sm == NULL) {
+      gettimeofday(&tp, NULL);
+      ts.tv_sec  = tp.tv_sec + 1;
+      ts.tv_nsec = tp.tv_usec * 1000;
+      if (pthread_cond_timedwait(&sq->sq_cond, &sq->sq_mutex, &ts) == ETIMEDOUT) {
+        if (++timeouts >= grace) {
+          tvhlog(LOG_WARNING, "webui", "Stop shared streaming %s, timeout waiting for packets",
+                 ws->ws_name);
+          run = 0;
+        }
+      }
+      pthread_mutex_unlock(&sq->sq_mutex);
+      continue;
+    }
+
+    timeouts = 0;
+    TAILQ_REMOVE(&sq->sq_queue, sm, sm_link);
+    pthread_mutex_unlock(&sq->sq_mutex);
+
+    switch (sm->sm_type) {
+    case SMT_MPEGTS:
+    case SMT_PACKET:
+      if (started) {
+        muxer_write_pkt(mux, sm->sm_type, sm->sm_data);
+        sm->sm_data = NULL;
+      }
+      break;
+
+    case SMT_GRACE:
+      grace = sm->sm_code < 5 ? 5 : grace;
+      break;
+
+    case SMT_START:
+      grace = 10;
+      if (!started) {
+        tvhlog(LOG_DEBUG, "webui", "Start shared streaming %s", ws->ws_name);
+        if (muxer_init(mux, sm->sm_data, ws->ws_name) < 0) {
+          run = 0;
+          break;
+        }
+        pthread_mutex_lock(&ws->ws_mutex);
+        ws->ws_mime = strdup(muxer_mime(mux, sm->sm_data));
+        pthread_cond_broadcast(&ws->ws_cond);
+        pthread_mutex_unlock(&ws->ws_mutex);
+        started = 1;
+      } else if (muxer_reconfigure(mux, sm->sm_data) < 0) {
+        tvhlog(LOG_WARNING, "webui", "Unable to reconfigure shared stream %s", ws->ws_name);
+      }
+      break;
+
+    case SMT_STOP:
+      if (sm->sm_code != SM_CODE_SOURCE_RECONFIGURED) {
+        tvhlog(LOG_WARNING, "webui", "Stop shared streaming %s, %s", ws->ws_name,
+               streaming_code2txt(sm->sm_code));
+        run = 0;
+      }
+      break;
+
+    case SMT_NOSTART:
+      tvhlog(LOG_WARNING, "webui", "Couldn't start shared streaming %s, %s",
+             ws->ws_name, streaming_code2txt(sm->sm_code));
+      run = 0;
+      break;
+
+    case SMT_EXIT:
+      tvhlog(LOG_WARNING, "webui", "Stop shared streaming %s, %s", ws->ws_name,
+             streaming_code2txt(sm->sm_code));
+      run = 0;
+      break;
+
+    case SMT_SERVICE_STATUS:
+    case SMT_SKIP:
+    case SMT_SPEED:
+    case SMT_SIGNAL_STATUS:
+    case SMT_TIMESHIFT_STATUS:
+      break;
+    }
+
+    streaming_msg_free(sm);
+
+    if (mux->m_errors) {
+      tvhlog(LOG_WARNING, "webui", "Stop shared streaming %s, muxer reported errors",
+             ws->ws_name);
+      run = 0;
+    }
+  }
+
+  if (started)
+    muxer_close(mux);
+
+  /* wake up the reader */
+  close(ws->ws_pipe.wr);
+  ws->ws_pipe.wr = -1;
+  return NULL;
+}
+
+/**
+ * Reader thread - slice the muxer output into the ring
+ */
+static void *
+webui_share_read_thread(void *aux)
+{
+  webui_share_t *ws = aux;
+  uint8_t *buf = malloc(WEBUI_SHARE_CHUNK);
+  size_t len = 0, n;
+  ssize_t r;
+  pktbuf_t *pb, **slot;
+
+  while (1) {
+    r = read(ws->ws_pipe.rd, buf + len, WEBUI_SHARE_CHUNK - len);
+    if (r < 0) {
+      if (ERRNO_AGAIN(errno))
+        continue;
+      break;
+    }
+    if (r == 0)
+      break;
+    len += r;
+    /* keep the chunks TS aligned, clients may join at any chunk */
+    n = len - (len % 188);
+    if (n == 0)
+      continue;
+    pb = pktbuf_alloc(buf, n);
+    len -= n;
+    if (len)
+      memmove(buf, buf + n, len);
+
+    pthread_mutex_lock(&ws->ws_mutex);
+    ws->ws_ring[ws->ws_head % WEBUI_SHARE_RING] = pb;
+    ws->ws_size += n;
+    ws->ws_head++;
+    while (ws->ws_head - ws->ws_tail > 1 &&
+           (ws->ws_head - ws->ws_tail > WEBUI_SHARE_RING - 1 ||
+            ws->ws_size > ws->ws_maxsize)) {
+      slot = &ws->ws_ring[ws->ws_tail % WEBUI_SHARE_RING];
+      ws->ws_size -= pktbuf_len(*slot);
+      pktbuf_ref_dec(*slot);
+      *slot = NULL;
+      ws->ws_tail++;
+    }
+    pthread_cond_broadcast(&ws->ws_cond);
+    pthread_mutex_unlock(&ws->ws_mutex);
+  }
+
+  free(buf);
+
+  pthread_mutex_lock(&ws->ws_mutex);
+  ws->ws_eof = 1;
+  pthread_cond_broadcast(&ws->ws_cond);
+  pthread_mutex_unlock(&ws->ws_mutex);
+  return NULL;
+}
+
+/**
+ * Reaper callback - join the stream threads and free the share
+ */
+static void
+webui_share_reap(void *aux)
+{
+  webui_share_t *ws = aux;
+  uint64_t i;
+
+  pthread_join(ws->ws_mux_tid, NULL);
+  pthread_join(ws->ws_read_tid, NULL);
+  close(ws->ws_pipe.rd);
+
+  pthread_mutex_lock(&global_lock);
+  if (ws->ws_sub)
+    subscription_unsubscribe(ws->ws_sub, 0);
+  profile_chain_close(&ws->ws_prch);
+  profile_release(ws->ws_profile);
+  pthread_mutex_unlock(&global_lock);
+
+  for (i = ws->ws_tail; i < ws->ws_head; i++)
+    pktbuf_ref_dec(ws->ws_ring[i % WEBUI_SHARE_RING]);
+
+  pthread_cond_destroy(&ws->ws_cond);
+  pthread_mutex_destroy(&ws->ws_mutex);
+  free(ws->ws_mime);
+  free(ws->ws_name);
+  free(ws);
+}
+
+/**
+ * Stop the stream, the share must not be used by the caller any more
+ */
+static void
+webui_share_destroy(webui_share_t *ws)
+{
+  streaming_queue_t *sq = &ws->ws_prch.prch_sq;
+
+  lock_assert(&global_lock);
+
+  LIST_REMOVE(ws, ws_link);
+
+  pthread_mutex_lock(&sq->sq_mutex);
+  ws->ws_running = 0;
+  pthread_cond_signal(&sq->sq_cond);
+  pthread_mutex_unlock(&sq->sq_mutex);
+
+  webui_reap(webui_share_reap, ws);
+}
+
+/**
+ *
+ */
+static webui_share_t *
+webui_share_create(http_connection_t *hc, channel_t *ch, profile_t *pro,
+                   int weight, size_t qsize)
+{
+  webui_share_t *ws;
+
+  lock_assert(&global_lock);
+
+  ws = calloc(1, sizeof(*ws));
+  ws->ws_channel = ch;
+  ws->ws_profile = pro;
+  ws->ws_name    = strdup(channel_get_name(ch));
+  ws->ws_maxsize = qsize;
+  ws->ws_running = 1;
+  profile_grab(pro);
+  pthread_mutex_init(&ws->ws_mutex, NULL);
+  pthread_cond_init(&ws->ws_cond, NULL);
+
+  profile_chain_init(&ws->ws_prch, pro, ch);
+  if (profile_chain_open(&ws->ws_prch, NULL, 0, qsize))
+    goto fail;
+
+  ws->ws_sub = subscription_create_from_channel(&ws->ws_prch,
+                 NULL, weight, "HTTP",
+                 ws->ws_prch.prch_flags | SUBSCRIPTION_STREAMING,
+                 hc->hc_peer_ipstr, hc->hc_username,
+                 http_arg_get(&hc->hc_args, "User-Agent"),
+                 NULL);
+  if (ws->ws_sub == NULL)
+    goto fail;
+
+  if (tvh_pipe(0, &ws->ws_pipe))
+    goto fail;
+
+  LIST_INSERT_HEAD(&webui_shares, ws, ws_link);
+  tvhthread_create(&ws->ws_read_tid, NULL, webui_share_read_thread, ws);
+  tvhthread_create(&ws->ws_mux_tid, NULL, webui_share_mux_thread, ws);
+  return ws;
+
+fail:
+  if (ws->ws_sub)
+    subscription_unsubscribe(ws->ws_sub, 0);
+  profile_chain_close(&ws->ws_prch);
+  profile_release(pro);
+  pthread_cond_destroy(&ws->ws_cond);
+  pthread_mutex_destroy(&ws->ws_mutex);
+  free(ws->ws_name);
+  free(ws);
+  return NULL;
+}
+
+/**
+ * Update the subscription weight and status from the attached clients
+ */
+static void
+webui_share_clients_update(webui_share_t *ws)
+{
+  webui_share_client_t *wsc;
+  char peers[512], users[512];
+  size_t lp = 0, lu = 0;
+  int weight = 0, named = 0;
+
+  lock_assert(&global_lock);
+
+  peers[0] = users[0] = '\0';
+  LIST_FOREACH(wsc, &ws->ws_clients, wsc_link) {
+    if (wsc->wsc_weight > weight)
+      weight = wsc->wsc_weight;
+    tvh_strlcatf(peers, sizeof(peers), lp, "%s%s", lp ? ", " : "",
+                 wsc->wsc_peer ?: "-");
+    tvh_strlcatf(users, sizeof(users), lu, "%s%s", lu ? ", " : "",
+                 wsc->wsc_user ?: "-");
+    if (wsc->wsc_user)
+      named = 1;
+  }
+
+  if (ws->ws_sub == NULL)
+    return;
+  if (ws->ws_sub->ths_weight != weight)
+    tvhlog(LOG_DEBUG, "webui", "Shared streaming %s, weight %d", ws->ws_name, weight);
+  subscription_change_weight(ws->ws_sub, weight);
+  free(ws->ws_sub->ths_hostname);
+  ws->ws_sub->ths_hostname = strdup(peers);
+  free(ws->ws_sub->ths_username);
+  ws->ws_sub->ths_username = named ? strdup(users) : NULL;
+}
+
+/**
+ *
+ */
+static webui_share_t *
+webui_share_find(channel_t *ch, profile_t *pro)
+{
+  webui_share_t *ws;
+  int eof;
+
+  LIST_FOREACH(ws, &webui_shares, ws_link) {
+    if (ws->ws_channel != ch || ws->ws_profile != pro || ws->ws_closed)
+      continue;
+    pthread_mutex_lock(&ws->ws_mutex);
+    eof = ws->ws_eof;
+    pthread_mutex_unlock(&ws->ws_mutex);
+    if (eof) {
+      /* do not attach new clients to a finished stream */
+      ws->ws_closed = 1;
+      continue;
+    }
+    return ws;
+  }
+  return NULL;
+}
+
+/**
+ * Attach to a shared stream (create it when required)
+ */
+webui_share_t *
+webui_share_get(http_connection_t *hc, channel_t *ch, profile_t *pro,
+                int weight, size_t qsize, void *owner)
+{
+  webui_share_t *ws;
+  webui_share_client_t *wsc;
+  muxer_container_type_t mc;
+
+  lock_assert(&global_lock);
+
+  mc = profile_get_mc(pro);
+  if (mc != MC_PASS && mc != MC_MPEGTS)
+    return NULL;
+
+  ws = webui_share_find(ch, pro);
+  if (ws == NULL)
+    ws = webui_share_create(hc, ch, pro, weight, qsize);
+  if (ws == NULL)
+    return NULL;
+
+  wsc = calloc(1, sizeof(*wsc));
+  wsc->wsc_owner  = owner;
+  wsc->wsc_weight = weight;
+  wsc->wsc_peer   = hc->hc_peer_ipstr ? strdup(hc->hc_peer_ipstr) : NULL;
+  wsc->wsc_user   = hc->hc_username ? strdup(hc->hc_username) : NULL;
+  LIST_INSERT_HEAD(&ws->ws_clients, wsc, wsc_link);
+  webui_share_clients_update(ws);
+  return ws;
+}
+
+/**
+ * Detach the client registered by webui_share_get()
+ */
+void
+webui_share_put(webui_share_t *ws, void *owner)
+{
+  webui_share_client_t *wsc;
+
+  lock_assert(&global_lock);
+
+  LIST_FOREACH(wsc, &ws->ws_clients, wsc_link)
+    if (wsc->wsc_owner == owner)
+      break;
+  assert(wsc);
+  LIST_REMOVE(wsc, wsc_link);
+  free(wsc->wsc_peer);
+  free(wsc->wsc_user);
+  free(wsc);
+
+  if (LIST_EMPTY(&ws->ws_clients))
+    webui_share_destroy(ws);
+  else
+    webui_share_clients_update(ws);
+}
+
+/**
+ * Fetch the next chunk for the consumer cursor (wait max one second)
+ *
+ * The cursor must be initialized to WEBUI_SHARE_NOCURSOR, it's moved
+ * to the live position when the muxer is started. Returns 0 and a
+ * referenced chunk (NULL on timeout), -EPIPE at the end of stream or
+ * -ENOBUFS when the consumer was too slow.
+ */
+int
+webui_share_read(webui_share_t *ws, uint64_t *cursor, pktbuf_t **pb)
+{
+  struct timespec ts;
+  struct timeval tp;
+  int r = 0;
+
+  *pb = NULL;
+  pthread_mutex_lock(&ws->ws_mutex);
+  if (*cursor == WEBUI_SHARE_NOCURSOR && ws->ws_mime)
+    *cursor = ws->ws_head;
+  if (*cursor != WEBUI_SHARE_NOCURSOR && *cursor < ws->ws_tail) {
+    r = -ENOBUFS;
+  } else if (*cursor == WEBUI_SHARE_NOCURSOR || *cursor == ws->ws_head) {
+    if (ws->ws_eof) {
+      r = -EPIPE;
+    } else {
+      gettimeofday(&tp, NULL);
+      ts.tv_sec  = tp.tv_sec + 1;
+      ts.tv_nsec = tp.tv_usec * 1000;
+      pthread_cond_timedwait(&ws->ws_cond, &ws->ws_mutex, &ts);
+      if (*cursor == WEBUI_SHARE_NOCURSOR && ws->ws_mime)
+        *cursor = ws->ws_head;
+    }
+  } else {
+    *pb = pktbuf_ref_inc(ws->ws_ring[*cursor % WEBUI_SHARE_RING]);
+    (*cursor)++;
+  }
+  pthread_mutex_unlock(&ws->ws_mutex);
+  return r;
+}
+
+/**
+ * The stream MIME type, valid when the consumer cursor is set
+ */
+const char *
+webui_share_mime(webui_share_t *ws)
+{
+  return ws->ws_mime;
+}
+
+/**
+ * Client loop - send the ring chunks from the client cursor
+ */
+static void
+webui_share_stream(http_connection_t *hc, webui_share_t *ws)
+{
+  th_subscription_t *s = ws->ws_sub;
+  pktbuf_t *pb;
+  struct timeval tp;
+  uint64_t cursor = WEBUI_SHARE_NOCURSOR;
+  int r, run = 1, started = 0, timeouts = 0, err = 0;
+  socklen_t errlen = sizeof(err);
+
+  /* reduce timeout on write() for streaming */
+  tp.tv_sec  = 5;
+  tp.tv_usec = 0;
+  setsockopt(hc->hc_fd, SOL_SOCKET, SO_SNDTIMEO, &tp, sizeof(tp));
+
+  while (!hc->hc_shutdown && run && tvheadend_running) {
+
+    r = webui_share_read(ws, &cursor, &pb);
+
+    if (r == -ENOBUFS) {
+      tvhlog(LOG_WARNING, "webui", "Stop streaming %s, client too slow",
+             hc->hc_url_orig);
+      break;
+    } else if (r < 0) {
+      break;
+    }
+
+    if (!started && cursor != WEBUI_SHARE_NOCURSOR) {
+      tvhlog(LOG_DEBUG, "webui", "Start streaming %s (shared)", hc->hc_url_orig);
+      http_output_content(hc, webui_share_mime(ws));
+      started = 1;
+    }
+
+    if (pb == NULL) {
+      timeouts++;
+      if (getsockopt(hc->hc_fd, SOL_SOCKET, SO_ERROR, (char *)&err, &errlen) || err) {
+        tvhlog(LOG_DEBUG, "webui", "Stop streaming %s, client hung up", hc->hc_url_orig);
+        run = 0;
+      } else if (timeouts >= 20) {
+        tvhlog(LOG_WARNING, "webui", "Stop streaming %s, timeout waiting for packets",
+               hc->hc_url_orig);
+        run = 0;
+      }
+      continue;
+    }
+
+    timeouts = 0;
+    if (tvh_write(hc->hc_fd, pktbuf_ptr(pb), pktbuf_len(pb))) {
+      tvhlog(LOG_DEBUG, "webui", "Stop streaming %s, client hung up", hc->hc_url_orig);
+      run = 0;
+    } else {
+      atomic_add(&s->ths_bytes_out, pktbuf_len(pb));
+    }
+    pktbuf_ref_dec(pb);
+  }
+}
+
+/**
+ * Stream the channel to the HTTP client using a shared muxer
+ */
+int
+webui_share_run(http_connection_t *hc, channel_t *ch, profile_t *pro,
+                int weight, size_t qsize)
+{
+  webui_share_t *ws;
+
+  ws = webui_share_get(hc, ch, pro, weight, qsize, hc);
+  if (ws == NULL)
+    return HTTP_STATUS_SERVICE;
+
+  pthread_mutex_unlock(&global_lock);
+  webui_share_stream(hc, ws);
+  pthread_mutex_lock(&global_lock);
+  webui_share_put(ws, hc);
+  return 0;
+}
+
+/**
+ *
+ */
+void
+webui_share_init(void)
+{
+  TAILQ_INIT(&webui_reaps);
+  pthread_mutex_init(&webui_reap_mutex, NULL);
+  pthread_cond_init(&webui_reap_cond, NULL);
+  webui_reap_running = 1;
+  tvhthread_create(&webui_reap_tid, NULL, webui_reap_thread, NULL);
+}
+
+/**
+ * Called after the HTTP connection threads are gone (tcp_server_done),
+ * runs the remaining callbacks
+ */
+void
+webui_share_done(void)
+{
+  pthread_mutex_lock(&webui_reap_mutex);
+  webui_reap_running = 0;
+  pthread_cond_signal(&webui_reap_cond);
+  pthread_mutex_unlock(&webui_reap_mutex);
+  pthread_join(webui_reap_tid, NULL);
+}
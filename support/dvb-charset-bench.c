@@ -0,0 +1,554 @@
+/*
+ *  Tvheadend - DVB text conversion check and benchmark
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Compares dvb_get_string() and the service name cache of
+ * dvb_get_name_with_len() with the character by character conversion
+ * they replaced (kept below) on random input and times both. Build from
+ * the top directory after ./configure:
+ *
+ *   cc -O2 -fms-extensions -funsigned-char -I src -I build.linux \
+ *      -o dvb-charset-bench support/dvb-charset-bench.c \
+ *      src/input/mpegts/dvb_support.c src/htsmsg.c src/htsmsg_json.c \
+ *      src/htsbuf.c src/misc/json.c src/misc/dbl.c -lpthread -lm
+ *   ./dvb-charset-bench
+ *
+ * GB2312 goes through iconv in tvheadend, both sides copy it here.
+ * Exits with 1 on the first difference.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/types.h>
+
+#include "tvheadend.h"
+#include "settings.h"
+#include "input/mpegts/dvb_charset_tables.h"
+
+#define ITERATIONS 3000000
+
+int dvb_get_string
+  (char *dst, size_t dstlen, const uint8_t *src, const size_t srclen,
+   const char *dvb_charset, void *conv);
+int dvb_get_name_with_len
+  (char *dst, size_t dstlen, const uint8_t *buf, size_t buflen,
+   const char *dvb_charset);
+void dvb_init ( void );
+
+/* Linked tvheadend code, not used here */
+void *mpegts_psi_table_state_skel;
+
+htsmsg_t *hts_settings_load ( const char *pathfmt, ... )
+{
+  return NULL;
+}
+
+void hexdump ( const char *pfx, const uint8_t *data, int len )
+{
+}
+
+int put_utf8 ( char *out, int c )
+{
+  if (c < 0x80) { *out = c; return 1; }
+  if (c < 0x800) {
+    out[0] = 0xc0 | (c >> 6);
+    out[1] = 0x80 | (c & 0x3f);
+    return 2;
+  }
+  out[0] = 0xe0 | (c >> 12);
+  out[1] = 0x80 | ((c >> 6) & 0x3f);
+  out[2] = 0x80 | (c & 0x3f);
+  return 3;
+}
+
+ssize_t
+intlconv_to_utf8 ( char *dst, size_t dst_size,
+                   const char *src_charset,
+                   const char *src_utf8, size_t src_size )
+{
+  if (src_size > dst_size)
+    return -1;
+  memcpy(dst, src_utf8, src_size);
+  return src_size;
+}
+
+static double
+now ( void )
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ * Previous conversion, one character at a time
+ */
+static int convert_iso_8859[16] = {
+  -1, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, -1, 11, 12, 13
+};
+#define convert_utf8   14
+#define convert_iso6937 15
+#define convert_ucs2 16
+#define convert_gb   17
+
+static inline size_t conv_gb(const uint8_t *src, size_t srclen,
+                             char *dst, size_t *dstlen)
+{
+    ssize_t len;
+    len = intlconv_to_utf8(dst, *dstlen, "gb2312", (char *)src, srclen);
+    if (len < 0 || len > *dstlen)
+      return -1;
+    *dstlen -= len;
+    return 0;
+}
+
+static inline int encode_utf8(unsigned int c, char *outb, int outleft)
+{
+  if (c <= 0x7F && outleft >= 1) {
+    *outb = c;
+    return 1;
+  } else if (c <= 0x7FF && outleft >=2) {
+    *outb++ = ((c >>  6) & 0x1F) | 0xC0;
+    *outb++ = ( c        & 0x3F) | 0x80;
+    return 2;
+  } else if (c <= 0xFFFF && outleft >= 3) {
+    *outb++ = ((c >> 12) & 0x0F) | 0xE0;
+    *outb++ = ((c >>  6) & 0x3F) | 0x80;
+    *outb++ = ( c        & 0x3F) | 0x80;
+    return 3;
+  } else if (c <= 0x10FFFF && outleft >= 4) {
+    *outb++ = ((c >> 18) & 0x07) | 0xF0;
+    *outb++ = ((c >> 12) & 0x3F) | 0x80;
+    *outb++ = ((c >>  6) & 0x3F) | 0x80;
+    *outb++ = ( c        & 0x3F) | 0x80;
+    return 4;
+  } else {
+    return -1;
+  }
+}
+
+static inline size_t conv_UCS2(const uint8_t *src, size_t srclen,char *dst, size_t *dstlen)
+{
+  while (srclen>0 && (*dstlen)>0){
+    uint16_t uc = *src<<8|*(src+1);
+    int len = encode_utf8(uc, dst, *dstlen);
+    if (len == -1) {
+      errno = E2BIG;
+      return -1;
+    } else {
+      (*dstlen) -= len;
+      dst += len;
+    }
+    srclen-=2;
+    src+=2;
+  }
+  if (srclen>0) {
+    errno = E2BIG;
+    return -1;
+  }
+  return 0;
+}
+
+static inline size_t conv_utf8(const uint8_t *src, size_t srclen,
+                               char *dst, size_t *dstlen)
+{
+  while (srclen>0 && (*dstlen)>0) {
+    *dst = (char) *src;
+    srclen--; (*dstlen)--;
+    src++; dst++;
+  }
+  if (srclen>0) {
+    errno = E2BIG;
+    return -1;
+  }
+  return 0;
+}
+
+static inline size_t conv_8859(int conv,
+                              const uint8_t *src, size_t srclen,
+                              char *dst, size_t *dstlen)
+{
+  uint16_t *table = conv_8859_table[conv];
+
+  while (srclen>0 && (*dstlen)>0) {
+    uint8_t c = *src;
+    if (c <= 0x7f) {
+      // lower half of iso-8859-* is identical to utf-8
+      *dst = (char) *src;
+      (*dstlen)--;
+      dst++;
+    } else if (c <= 0x9f) {
+      // codes 0x80 - 0x9f (control codes) are ignored
+    } else {
+      // map according to character table, skipping
+      // unmapped chars (value 0 in the table)
+      uint16_t uc = table[c-0xa0];
+      if (uc != 0) {
+        int len = encode_utf8(uc, dst, *dstlen);
+        if (len == -1) {
+          errno = E2BIG;
+          return -1;
+        } else {
+          (*dstlen) -= len;
+          dst += len;
+        }
+      }
+    }
+    srclen--;
+    src++;
+  }
+  if (srclen>0) {
+    errno = E2BIG;
+    return -1;
+  }
+  return 0;
+}
+
+static inline size_t conv_6937(const uint8_t *src, size_t srclen,
+                              char *dst, size_t *dstlen)
+{
+  while (srclen>0 && (*dstlen)>0) {
+    uint8_t c = *src;
+    if (c <= 0x7f) {
+      // lower half of iso6937 is identical to utf-8
+      *dst = (char) *src;
+      (*dstlen)--;
+      dst++;
+    } else if (c <= 0x9f) {
+      // codes 0x80 - 0x9f (control codes) are ignored
+    } else {
+      uint16_t uc;
+      if (c >= 0xc0 && c <= 0xcf) {
+        // map two-byte sequence, skipping illegal combinations.
+        if (srclen<2) {
+          errno = EINVAL;
+          return -1;
+        }
+        srclen--;
+        src++;
+        uint8_t c2 = *src;
+        if (c2 == 0x20) {
+          uc = iso6937_lone_accents[c-0xc0];
+        } else if (c2 >= 0x41 && c2 <= 0x5a) {
+          uc = iso6937_multi_byte[c-0xc0][c2-0x41];
+        } else if (c2 >= 0x61 && c2 <= 0x7a) {
+          uc = iso6937_multi_byte[c-0xc0][c2-0x61+26];
+        } else {
+          uc = 0;
+        }
+      } else {
+        // map according to single character table, skipping
+        // unmapped chars (value 0 in the table)
+        uc = iso6937_single_byte[c-0xa0];
+      }
+      if (uc != 0) {
+        int len = encode_utf8(uc, dst, *dstlen);
+        if (len == -1) {
+          errno = E2BIG;
+          return -1;
+        } else {
+          (*dstlen) -= len;
+          dst += len;
+        }
+      }
+    }
+    srclen--;
+    src++;
+  }
+  if (srclen>0) {
+    errno = E2BIG;
+    return -1;
+  }
+  return 0;
+}
+
+static inline size_t ref_convert(int conv,
+                          const uint8_t *src, size_t srclen,
+                          char *dst, size_t *dstlen)
+{
+  switch (conv) {
+    case convert_utf8: return conv_utf8(src, srclen, dst, dstlen);
+    case convert_iso6937: return conv_6937(src, srclen, dst, dstlen);
+    case convert_gb: return conv_gb(src,srclen,dst,dstlen);
+    case convert_ucs2:return conv_UCS2(src,srclen,dst,dstlen);
+    default: return conv_8859(conv, src, srclen, dst, dstlen);
+  }
+}
+
+/*
+ * DVB String conversion according to EN 300 468, Annex A
+ */
+
+static int
+ref_get_string
+  (char *dst, size_t dstlen, const uint8_t *src, size_t srclen,
+   const char *dvb_charset)
+{
+  int ic = -1;
+  size_t len, outlen;
+  int i, auto_pl_charset = 0;
+
+  if(srclen < 1) {
+    *dst = 0;
+    return 0;
+  }
+
+  // check for automatic polish charset detection
+  if (dvb_charset && strcmp("AUTO_POLISH", dvb_charset) == 0) {
+    auto_pl_charset = 1;
+    dvb_charset = NULL;
+  }
+
+  // automatic charset detection
+  switch(src[0]) {
+  case 0:
+    return -1;
+
+  case 0x01 ... 0x0b:
+    if (auto_pl_charset && (src[0] + 4) == 5)
+      ic = convert_iso6937;
+    else
+      ic = convert_iso_8859[src[0] + 4];
+    src++; srclen--;
+    break;
+
+  case 0x0c ... 0x0f:
+    src++; srclen--;
+    break;
+
+  case 0x10: /* Table A.4 */
+    if(srclen < 3 || src[1] != 0 || src[2] == 0 || src[2] > 0x0f)
+      return -1;
+
+    ic = convert_iso_8859[src[2]];
+    src+=3; srclen-=3;
+    break;
+    
+  case 0x11:
+    ic = convert_ucs2;
+    src++; srclen--;
+    break;
+
+  case 0x13:
+    ic = convert_gb;
+    src++; srclen--;
+    break;
+
+  case 0x12:
+    src++; srclen--;
+    break;
+
+  case 0x14:
+    ic = convert_ucs2;
+    src++; srclen--;
+    break;
+
+  case 0x15:
+    ic = convert_utf8;
+    src++; srclen--;
+    break;
+
+  case 0x16 ... 0x1f:
+    src++; srclen--;
+    break;
+
+  default:
+    if (auto_pl_charset)
+      ic = convert_iso_8859[2];
+    else
+      ic = convert_iso6937;
+    break;
+  }
+
+  // manual charset override
+  if (dvb_charset != NULL && dvb_charset[0] != 0) {
+    if (!strcmp(dvb_charset, "AUTO")) {
+      // ignore
+    } else if (sscanf(dvb_charset, "ISO-8859-%d", &i) > 0 && i > 0 && i < 16) {
+      ic = convert_iso_8859[i];
+    } else if (!strcmp(dvb_charset, "ISO-6937")) {
+      ic = convert_iso6937;
+    } else if (!strcmp(dvb_charset, "UTF-8")) {
+      ic = convert_utf8;
+    } else if (!strcmp(dvb_charset, "GB2312")) {
+      ic = convert_gb;
+    } else if (!strcmp(dvb_charset, "UCS2")) {
+      ic = convert_ucs2;
+    }
+  }
+
+  if(srclen < 1) {
+    *dst = 0;
+    return 0;
+  }
+
+  if(ic == -1)
+    return -1;
+
+  outlen = dstlen - 1;
+
+  if (ref_convert(ic, src, srclen, dst, &outlen) == -1) {
+    return -1;
+  }
+
+  len = dstlen - outlen - 1;
+  dst[len] = 0;
+  return 0;
+}
+
+/*
+ * Random strings, mostly printable, all charset prefixes and overrides,
+ * small output buffers
+ */
+static const char *charsets[] = {
+  NULL, "AUTO", "ISO-8859-2", "ISO-6937", "UTF-8", "UCS2", "GB2312",
+  "AUTO_POLISH", "ISO-8859-15"
+};
+
+static int
+random_string ( uint8_t *in, int it )
+{
+  int i, r, len = rand() % ((it % 3) ? 40 : 260);
+
+  for (i = 0; i < len; i++) {
+    r = rand();
+    in[i] = (r & 3) ? 0x20 + r % 0x5f : (uint8_t)(r >> 8);
+  }
+  if (len && (it % 4) == 0)
+    in[0] = rand() % 0x20;
+  if (len > 2 && (it % 16) == 0) {
+    in[0] = 0x10;
+    in[1] = 0;
+    in[2] = rand() % 16;
+  }
+  return len;
+}
+
+static int
+string_check ( void )
+{
+  uint8_t in[300];
+  char o1[800], o2[800];
+  const char *cs;
+  size_t dl;
+  int it, len, r1, r2;
+
+  srand(7);
+  for (it = 0; it < ITERATIONS; it++) {
+    len = random_string(in, it);
+    dl = (it % 5) == 0 ? 1 + rand() % 60 : sizeof(o1);
+    cs = charsets[rand() % ARRAY_SIZE(charsets)];
+    memset(o1, 'x', sizeof(o1));
+    memset(o2, 'x', sizeof(o2));
+    r1 = ref_get_string(o1, dl, in, len, cs);
+    r2 = dvb_get_string(o2, dl, in, len, cs, NULL);
+    if (r1 != r2 || (r1 == 0 && strcmp(o1, o2))) {
+      printf("string: difference, len %d charset %s dstlen %zu (%d/%d)\n"
+             " '%s'\n '%s'\n", len, cs ?: "-", dl, r1, r2, o1, o2);
+      return 1;
+    }
+  }
+  printf("string: %d inputs equal\n", ITERATIONS);
+  return 0;
+}
+
+/* Names repeat, so most lookups hit the cache */
+static int
+name_check ( void )
+{
+  static uint8_t names[64][257];
+  char o1[800], o2[800];
+  const char *cs;
+  size_t dl;
+  int it, k, len, r1, r2;
+
+  srand(11);
+  for (k = 0; k < 64; k++) {
+    len = random_string(names[k] + 1, k) % 256;
+    names[k][0] = len;
+  }
+  for (it = 0; it < ITERATIONS; it++) {
+    k  = rand() % 64;
+    dl = (it % 5) == 0 ? 1 + rand() % 60 : sizeof(o1);
+    cs = charsets[rand() % 3];
+    len = names[k][0];
+    r1 = ref_get_string(o1, dl, names[k] + 1, len, cs);
+    r1 = r1 ? -1 : len + 1;
+    r2 = dvb_get_name_with_len(o2, dl, names[k], len + 1, cs);
+    if (r1 != r2 || (r1 > 0 && strcmp(o1, o2))) {
+      printf("name: difference, len %d charset %s dstlen %zu (%d/%d)\n"
+             " '%s'\n '%s'\n", len, cs ?: "-", dl, r1, r2, o1, o2);
+      return 1;
+    }
+  }
+  printf("name: %d lookups equal\n", ITERATIONS);
+  return 0;
+}
+
+/*
+ * EIT like text, ISO 6937 by default, pct % accented characters
+ */
+static void
+bench ( int pct )
+{
+  static uint8_t txt[2000][200];
+  static int tl[2000];
+  char o[800];
+  long total = 0;
+  int k, i, r;
+  double t0, t1, t2;
+
+  srand(1);
+  for (k = 0; k < 2000; k++) {
+    tl[k] = 20 + rand() % 180;
+    total += tl[k];
+    for (i = 0; i < tl[k]; i++) {
+      r = rand() % 1000;
+      txt[k][i] = r >= pct * 10 ? 'a' + r % 26 : 0xe9;
+    }
+    if (k & 1)
+      txt[k][0] = 0x05;
+  }
+  t0 = now();
+  for (r = 0; r < 500; r++)
+    for (k = 0; k < 2000; k++)
+      ref_get_string(o, sizeof(o), txt[k], tl[k], NULL);
+  t1 = now();
+  for (r = 0; r < 500; r++)
+    for (k = 0; k < 2000; k++)
+      dvb_get_string(o, sizeof(o), txt[k], tl[k], NULL, NULL);
+  t2 = now();
+  printf("%2d%% accented: previous %.2f ns/B current %.2f ns/B (%.1fx)\n",
+         pct, (t1 - t0) / total / 500 * 1e9, (t2 - t1) / total / 500 * 1e9,
+         (t1 - t0) / (t2 - t1));
+}
+
+int
+main ( void )
+{
+  dvb_init();
+  if (string_check() || name_check())
+    return 1;
+  bench(0);
+  bench(5);
+  bench(20);
+  return 0;
+}
@@ -0,0 +1,349 @@
+/*
+ *  Tvheadend - htsmsg name lookup check and benchmark
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Runs random add / delete / copy / lookup sequences on maps (heap and
+ * arena, small and large) and compares every htsmsg_field_find() with
+ * the linear scan of the field queue it replaced, then times lookups in
+ * a large map and the load of a config tree with 50k services, shaped
+ * as hts_settings_load_r() builds it. Build from the top directory after
+ * ./configure (add -fsanitize=address to check the index memory handling
+ * too):
+ *
+ *   cc -O2 -fms-extensions -funsigned-char -I src -I build.linux \
+ *      -o htsmsg-bench support/htsmsg-bench.c \
+ *      src/htsmsg.c src/htsmsg_json.c src/htsbuf.c \
+ *      src/misc/json.c src/misc/dbl.c -lm
+ *   ./htsmsg-bench
+ *
+ * Exits with 1 on the first difference.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "htsmsg.h"
+#include "htsmsg_json.h"
+
+/* Linked tvheadend code, not used here */
+void hexdump ( const char *pfx, const uint8_t *data, int len )
+{
+}
+
+int put_utf8 ( char *out, int c )
+{
+  if (c < 0x80) { *out = c; return 1; }
+  if (c < 0x800) {
+    out[0] = 0xc0 | (c >> 6);
+    out[1] = 0x80 | (c & 0x3f);
+    return 2;
+  }
+  out[0] = 0xe0 | (c >> 12);
+  out[1] = 0x80 | ((c >> 6) & 0x3f);
+  out[2] = 0x80 | (c & 0x3f);
+  return 3;
+}
+
+static double
+now ( void )
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* The lookup before the index: first field of that name */
+static htsmsg_field_t *
+find_ref ( htsmsg_t *m, const char *name )
+{
+  htsmsg_field_t *f;
+
+  HTSMSG_FOREACH(f, m)
+    if (f->hmf_name && !strcmp(f->hmf_name, name))
+      return f;
+  return NULL;
+}
+
+static int
+check_all ( htsmsg_t *m, int names, const char *what, int step )
+{
+  char k[32];
+  int i;
+
+  for (i = 0; i < names; i++) {
+    snprintf(k, sizeof(k), "k%d", i);
+    if (htsmsg_field_find(m, k) != find_ref(m, k)) {
+      printf("%s: step %d, difference for %s\n", what, step, k);
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static int
+fuzz ( int seed, int names, int steps, int arena )
+{
+  htsmsg_arena_t *ha = arena ? htsmsg_arena_create() : NULL;
+  htsmsg_t *m = ha ? htsmsg_create_map_arena(ha) : htsmsg_create_map();
+  htsmsg_t *c;
+  htsmsg_field_t *f;
+  char k[32], what[64];
+  int step, op, n, i;
+
+  snprintf(what, sizeof(what), "%s map, %d names, seed %d",
+           arena ? "arena" : "heap", names, seed);
+  srand(seed);
+  for (step = 0; step < steps; step++) {
+    snprintf(k, sizeof(k), "k%d", rand() % names);
+    op = rand() % 100;
+    if (op < 45) {
+      htsmsg_add_s64(m, k, step);
+    } else if (op < 60) {
+      htsmsg_delete_field(m, k);
+    } else if (op < 70) {
+      /* remove a random field, not only the first of its name */
+      n = rand() % 64;
+      i = 0;
+      HTSMSG_FOREACH(f, m)
+        if (i++ == n)
+          break;
+      if (f)
+        htsmsg_field_destroy(m, f);
+    } else if (op < 71 && step % 10 == 0) {
+      c = htsmsg_copy(m);
+      if (check_all(c, names, what, step)) {
+        printf("  (copy)\n");
+        return 1;
+      }
+      htsmsg_destroy(c);
+    } else {
+      if (htsmsg_field_find(m, k) != find_ref(m, k)) {
+        printf("%s: step %d, difference for %s\n", what, step, k);
+        return 1;
+      }
+    }
+  }
+  if (check_all(m, names, what, step))
+    return 1;
+  htsmsg_destroy(m);
+  if (ha)
+    htsmsg_arena_destroy(ha);
+  return 0;
+}
+
+/* Large JSON maps are parsed into arenas */
+static int
+json_check ( void )
+{
+  htsmsg_t *m = htsmsg_create_map(), *j;
+  htsmsg_arena_t *ha = htsmsg_arena_create();
+  char k[32], *s;
+  int i;
+
+  for (i = 0; i < 5000; i++) {
+    snprintf(k, sizeof(k), "k%d", i);
+    htsmsg_add_s64(m, k, i);
+  }
+  htsmsg_add_s64(m, "k7", -1);
+  s = htsmsg_json_serialize_to_str(m, 0);
+  j = htsmsg_json_deserialize_arena(ha, s);
+  if (check_all(j, 5001, "json", 0))
+    return 1;
+  free(s);
+  htsmsg_destroy(m);
+  htsmsg_arena_destroy(ha);
+  return 0;
+}
+
+static void
+bench ( int size )
+{
+  htsmsg_t *m = htsmsg_create_map();
+  char k[32];
+  int i, lookups = 200000;
+  int64_t v, sum = 0;
+  double t0, t1, t2;
+
+  for (i = 0; i < size; i++) {
+    snprintf(k, sizeof(k), "n%d", i);
+    htsmsg_add_s64(m, k, i);
+  }
+  t0 = now();
+  for (i = 0; i < lookups / 100; i++) {
+    snprintf(k, sizeof(k), "n%d", (i * 7919) % size);
+    sum += find_ref(m, k) != NULL;
+  }
+  t1 = now();
+  for (i = 0; i < lookups; i++) {
+    snprintf(k, sizeof(k), "n%d", (i * 7919) % size);
+    if (!htsmsg_get_s64(m, k, &v))
+      sum += v;
+  }
+  t2 = now();
+  printf("%6d fields: linear %8.1f us/lookup, indexed %.3f us/lookup\n",
+         size, (t1 - t0) / (lookups / 100) * 1e6, (t2 - t1) / lookups * 1e6);
+  htsmsg_destroy(m);
+}
+
+/*
+ * Startup with a large service config: the service files are parsed into
+ * the directory maps (500 muxes of 100 services, or one IPTV network with
+ * a mux per service), walked, and the properties read as idnode_load()
+ * does. The service maps stay below the index threshold and the loaders
+ * only iterate the directory maps, so the index is not used here; the
+ * lookups by uuid in the flat directory show what it saves when a
+ * directory is searched by name.
+ */
+static const char *service_props[] = {
+  "sid", "lcn", "lcn_minor", "lcn2", "svcname", "provider", "cridauth",
+  "dvb_servicetype", "dvb_ignore_eit", "charset", "prefcapid",
+  "prefcapid_lock", "force_caid", "created", "last_seen", "enabled",
+  "auto", "priority", "encrypted", "pcr", "pmt", "stream", NULL
+};
+
+static char *
+service_json ( int i )
+{
+  htsmsg_t *c = htsmsg_create_map(), *l, *e;
+  char buf[64], *s;
+  int j;
+
+  htsmsg_add_u32(c, "sid", i + 1);
+  htsmsg_add_u32(c, "lcn", i % 1000);
+  htsmsg_add_u32(c, "lcn_minor", 0);
+  htsmsg_add_u32(c, "lcn2", 0);
+  snprintf(buf, sizeof(buf), "Service %d", i);
+  htsmsg_add_str(c, "svcname", buf);
+  htsmsg_add_str(c, "provider", "Provider");
+  htsmsg_add_u32(c, "dvb_servicetype", 1);
+  htsmsg_add_bool(c, "dvb_ignore_eit", 0);
+  htsmsg_add_u32(c, "prefcapid", 0);
+  htsmsg_add_u32(c, "prefcapid_lock", 0);
+  htsmsg_add_u32(c, "force_caid", 0);
+  htsmsg_add_s64(c, "created", 1400000000 + i);
+  htsmsg_add_s64(c, "last_seen", 1450000000 + i);
+  htsmsg_add_bool(c, "enabled", 1);
+  htsmsg_add_bool(c, "auto", 0);
+  htsmsg_add_u32(c, "priority", 0);
+  htsmsg_add_u32(c, "pcr", 256);
+  htsmsg_add_u32(c, "pmt", 4096 + i % 100);
+  l = htsmsg_create_list();
+  for (j = 0; j < 3; j++) {
+    e = htsmsg_create_map();
+    htsmsg_add_u32(e, "pid", 256 + j);
+    htsmsg_add_str(e, "type", j ? "MPEG2AUDIO" : "H264");
+    if (j)
+      htsmsg_add_str(e, "language", "eng");
+    htsmsg_add_msg(l, NULL, e);
+  }
+  htsmsg_add_msg(c, "stream", l);
+  s = htsmsg_json_serialize_to_str(c, 1);
+  htsmsg_destroy(c);
+  return s;
+}
+
+static void
+startup ( int services, int per_dir )
+{
+  htsmsg_t *tree = htsmsg_create_map(), *dir = NULL, *c;
+  htsmsg_field_t *f, *g;
+  char **files = malloc(services * sizeof(char *));
+  char k[40];
+  const char **p;
+  int i, lookups, found = 0;
+  int64_t v, sum = 0;
+  double t0, t1, t2, t3, t4;
+
+  for (i = 0; i < services; i++)
+    files[i] = service_json(i);
+
+  /* hts_settings_load_r: one map per directory, named by the file name */
+  t0 = now();
+  for (i = 0; i < services; i++) {
+    if (i % per_dir == 0) {
+      dir = htsmsg_create_map();
+      snprintf(k, sizeof(k), "%032x", i / per_dir);
+      htsmsg_add_msg(tree, k, dir);
+      dir = htsmsg_get_map(tree, k);
+    }
+    snprintf(k, sizeof(k), "%08x%024x", i / per_dir, i);
+    htsmsg_add_msg(dir, k, htsmsg_json_deserialize(files[i]));
+  }
+
+  /* The loaders walk the directories and read the properties */
+  t1 = now();
+  HTSMSG_FOREACH(f, tree) {
+    dir = htsmsg_get_map_by_field(f);
+    HTSMSG_FOREACH(g, dir) {
+      c = htsmsg_get_map_by_field(g);
+      for (p = service_props; *p; p++)
+        if (!htsmsg_get_s64(c, *p, &v))
+          sum += v;
+        else
+          sum += htsmsg_get_str(c, *p) != NULL;
+    }
+  }
+
+  /* Lookups by name in the largest directory */
+  t2 = now();
+  dir = htsmsg_get_map_by_field(TAILQ_FIRST(&tree->hm_fields));
+  lookups = per_dir < 20000 ? per_dir : 20000;
+  for (i = 0; i < lookups; i++) {
+    snprintf(k, sizeof(k), "%08x%024x", 0, (i * 7919) % per_dir);
+    found += htsmsg_get_map(dir, k) != NULL;
+  }
+  t3 = now();
+  for (i = 0; i < lookups / 100; i++) {
+    snprintf(k, sizeof(k), "%08x%024x", 0, (i * 7919) % per_dir);
+    found += find_ref(dir, k) != NULL;
+  }
+  t4 = now();
+
+  printf("%d services, %d per directory: load %.0f ms, walk %.0f ms, "
+         "%d lookups %.1f ms (linear scan ~%.1f ms)\n",
+         services, per_dir, (t1 - t0) * 1e3, (t2 - t1) * 1e3, lookups,
+         (t3 - t2) * 1e3, (t4 - t3) * 100 * 1e3);
+  if (found != lookups + lookups / 100)
+    printf("  %d lookups failed\n", lookups + lookups / 100 - found);
+  htsmsg_destroy(tree);
+  for (i = 0; i < services; i++)
+    free(files[i]);
+  free(files);
+}
+
+int
+main ( void )
+{
+  static const int names[] = { 8, 40, 300, 5000 };
+  int i, seed;
+
+  for (i = 0; i < 4; i++)
+    for (seed = 1; seed <= (names[i] > 1000 ? 4 : 20); seed++)
+      if (fuzz(seed, names[i], 20000, 0) || fuzz(seed, names[i], 20000, 1))
+        return 1;
+  if (json_check())
+    return 1;
+  printf("lookups equal\n");
+  bench(100);
+  bench(1000);
+  bench(20000);
+  startup(50000, 100);
+  startup(50000, 50000);
+  return 0;
+}
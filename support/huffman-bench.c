@@ -0,0 +1,335 @@
+/*
+ *  Tvheadend - Huffman decoder check and benchmark
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Compares the table driven OpenTV and Freesat decoders with the bit by
+ * bit decoders they replaced (kept below) on random input and times
+ * both. Build from the top directory after ./configure:
+ *
+ *   cc -O2 -fms-extensions -funsigned-char -I src -I build.linux \
+ *      -o huffman-bench support/huffman-bench.c \
+ *      src/huffman.c src/epggrab/support/freesat_huffman.c \
+ *      src/htsmsg.c src/htsmsg_json.c src/htsbuf.c \
+ *      src/misc/json.c src/misc/dbl.c -lpthread -lm
+ *   ./huffman-bench data/conf/epggrab/opentv/dict/skyeng
+ *
+ * Exits with 1 on the first difference.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "htsmsg_json.h"
+#include "huffman.h"
+
+#define ITERATIONS 200000
+
+/* Linked tvheadend code, not used here */
+htsmsg_t *hts_settings_load ( const char *pathfmt, ... )
+{
+  return NULL;
+}
+
+void hexdump ( const char *pfx, const uint8_t *data, int len )
+{
+}
+
+int put_utf8 ( char *out, int c )
+{
+  if (c < 0x80) { *out = c; return 1; }
+  if (c < 0x800) {
+    out[0] = 0xc0 | (c >> 6);
+    out[1] = 0x80 | (c & 0x3f);
+    return 2;
+  }
+  out[0] = 0xe0 | (c >> 12);
+  out[1] = 0x80 | ((c >> 6) & 0x3f);
+  out[2] = 0x80 | (c & 0x3f);
+  return 3;
+}
+
+static double
+now ( void )
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ * OpenTV, walk the tree bit by bit
+ */
+static char *
+opentv_decode_ref
+  ( huffman_node_t *tree, const uint8_t *data, size_t len, uint8_t mask,
+    char *outb, int outl )
+{
+  char *ret = outb;
+  huffman_node_t *node = tree;
+  if (!len) return NULL;
+
+  outl--; // leave space for NULL
+  while (len) {
+    len--;
+    while (mask) {
+      if (*data & mask) {
+        node = node->b1;
+      } else {
+        node = node->b0;
+      }
+      mask >>= 1;
+      if (!node) goto end;
+      if (node->data) {
+        char *t = node->data;
+        while (*t && outl) {
+          *outb = *t;
+          outb++; t++; outl--;
+        }
+        if (!outl) goto end;
+        node = tree;
+      }
+    }
+    mask = 0x80;
+    data++;
+  }
+end:
+  *outb = '\0';
+  return ret;
+}
+
+static int
+opentv_check ( const char *path )
+{
+  FILE *f;
+  static char buf[1 << 22];
+  size_t n;
+  htsmsg_t *m;
+  huffman_node_t *tree;
+  uint8_t in[300], mask;
+  char o1[700], o2[700];
+  int it, i, len, outl;
+  double t0, t1, t2;
+
+  if ((f = fopen(path, "r")) == NULL) {
+    perror(path);
+    return 1;
+  }
+  n = fread(buf, 1, sizeof(buf) - 1, f);
+  buf[n] = '\0';
+  fclose(f);
+  if ((m = htsmsg_json_deserialize(buf)) == NULL ||
+      (tree = huffman_tree_build(m)) == NULL) {
+    fprintf(stderr, "%s: invalid dictionary\n", path);
+    return 1;
+  }
+
+  srand(1);
+  for (it = 0; it < ITERATIONS; it++) {
+    len = 1 + rand() % 250;
+    for (i = 0; i < len; i++)
+      in[i] = rand();
+    outl = (it % 7) == 0 ? 1 + rand() % 40 : 2 * len;
+    mask = (it % 3) == 0 ? 0x20 : ((it % 5) == 0 ? 0 : 0x80 >> (rand() % 8));
+    opentv_decode_ref(tree, in, len, mask, o1, outl);
+    huffman_decode(tree, in, len, mask, o2, outl);
+    if (strcmp(o1, o2)) {
+      printf("%s: difference, len %d mask %02x outl %d\n '%s'\n '%s'\n",
+             path, len, mask, outl, o1, o2);
+      return 1;
+    }
+  }
+
+  t0 = now();
+  for (it = 0; it < ITERATIONS; it++) {
+    for (i = 0; i < 100; i++)
+      in[i] = rand();
+    opentv_decode_ref(tree, in, 100, 0x20, o1, 200);
+  }
+  t1 = now();
+  for (it = 0; it < ITERATIONS; it++) {
+    for (i = 0; i < 100; i++)
+      in[i] = rand();
+    huffman_decode(tree, in, 100, 0x20, o2, 200);
+  }
+  t2 = now();
+  printf("opentv %s: %d inputs equal, bitwise %.3fs table %.3fs (%.1fx)\n",
+         path, ITERATIONS, t1 - t0, t2 - t1, (t1 - t0) / (t2 - t1));
+  huffman_tree_destroy(tree);
+  htsmsg_destroy(m);
+  return 0;
+}
+
+/*
+ * Freesat, shift the window bit by bit and search the tables
+ */
+struct fsattab {
+  unsigned int value;
+  short bits;
+  char next;
+};
+
+extern struct fsattab fsat_table_1[], fsat_table_2[];
+extern unsigned fsat_index_1[], fsat_index_2[];
+size_t freesat_huffman_decode
+  (char *dst, size_t* dstlen, const uint8_t *src, size_t srclen);
+
+#define START   '\0'
+#define STOP    '\0'
+#define ESCAPE  '\1'
+
+static size_t
+freesat_decode_ref
+  ( char *dst, size_t* dstlen, const uint8_t *src, size_t srclen )
+{
+  struct fsattab *fsat_table;
+  unsigned int *fsat_index;
+  size_t p = 0;
+  unsigned int value = 0, byte = 2, bit = 0, bitShift, indx, j, mask, b;
+  char lastch, nextCh;
+  int found;
+
+  if (src[0] != 0x1f || (src[1] != 1 && src[1] != 2))
+    return -1;
+  if (src[1] == 1) {
+    fsat_table = fsat_table_1;
+    fsat_index = fsat_index_1;
+  } else {
+    fsat_table = fsat_table_2;
+    fsat_index = fsat_index_2;
+  }
+  while (byte < 6 && byte < srclen) {
+    value |= src[byte] << ((5 - byte) * 8);
+    byte++;
+  }
+  lastch = START;
+
+  do {
+    found = 0;
+    bitShift = 0;
+    nextCh = STOP;
+    if (lastch == ESCAPE) {
+      found = 1;
+      nextCh = (value >> 24) & 0xff;
+      bitShift = 8;
+      if ((nextCh & 0x80) == 0) {
+        if (nextCh < ' ')
+          nextCh = STOP;
+        lastch = nextCh;
+      }
+    } else {
+      indx = (unsigned int) lastch;
+      for (j = fsat_index[indx]; j < fsat_index[indx + 1]; j++) {
+        mask = 0;
+        for (b = 0; b < (unsigned)fsat_table[j].bits; b++)
+          mask |= 0x80000000U >> b;
+        if ((value & mask) == fsat_table[j].value) {
+          nextCh = fsat_table[j].next;
+          bitShift = fsat_table[j].bits;
+          found = 1;
+          lastch = nextCh;
+          break;
+        }
+      }
+    }
+    if (!found)
+      return -1;
+    if (nextCh != STOP && nextCh != ESCAPE) {
+      if (p >= *dstlen) return 0;
+      dst[p++] = nextCh;
+    }
+    for (b = 0; b < bitShift; b++) {
+      value = (value << 1) & 0xfffffffe;
+      if (byte < srclen)
+        value |= (src[byte] >> (7 - bit)) & 1;
+      if (bit == 7) {
+        bit = 0;
+        byte++;
+      } else
+        bit++;
+    }
+  } while (lastch != STOP && byte < srclen + 4);
+
+  dst[p] = '\0';
+  *dstlen = p;
+  return 0;
+}
+
+static int
+freesat_check ( void )
+{
+  static uint8_t bufs[1000][120];
+  uint8_t in[300];
+  char o1[600], o2[600];
+  size_t l1, l2, r1, r2;
+  int it, i, k, len;
+  double t0, t1, t2;
+
+  srand(3);
+  for (it = 0; it < 10 * ITERATIONS; it++) {
+    len = 2 + rand() % ((it & 1) ? 30 : 250);
+    for (i = 0; i < len; i++)
+      in[i] = rand();
+    in[0] = 0x1f;
+    in[1] = 1 + (rand() & 1);
+    l1 = l2 = (it % 5) == 0 ? rand() % 40 : 500;
+    memset(o1, 'x', sizeof(o1));
+    memset(o2, 'x', sizeof(o2));
+    r1 = freesat_decode_ref(o1, &l1, in, len);
+    r2 = freesat_huffman_decode(o2, &l2, in, len);
+    if (r1 != r2 || l1 != l2 || memcmp(o1, o2, sizeof(o1))) {
+      printf("freesat: difference, len %d\n '%s'\n '%s'\n", len, o1, o2);
+      return 1;
+    }
+  }
+
+  for (k = 0; k < 1000; k++) {
+    bufs[k][0] = 0x1f;
+    bufs[k][1] = 1 + (k & 1);
+    for (i = 2; i < 120; i++)
+      bufs[k][i] = rand();
+  }
+  t0 = now();
+  for (it = 0; it < 1000; it++)
+    for (k = 0; k < 1000; k++) {
+      l1 = 500;
+      freesat_decode_ref(o1, &l1, bufs[k], 120);
+    }
+  t1 = now();
+  for (it = 0; it < 1000; it++)
+    for (k = 0; k < 1000; k++) {
+      l2 = 500;
+      freesat_huffman_decode(o2, &l2, bufs[k], 120);
+    }
+  t2 = now();
+  printf("freesat: %d inputs equal, bitwise %.3fs table %.3fs (%.1fx)\n",
+         10 * ITERATIONS, t1 - t0, t2 - t1, (t1 - t0) / (t2 - t1));
+  return 0;
+}
+
+int
+main ( int argc, char **argv )
+{
+  int i;
+
+  for (i = 1; i < argc; i++)
+    if (opentv_check(argv[i]))
+      return 1;
+  return freesat_check();
+}
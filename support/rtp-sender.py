@@ -0,0 +1,147 @@
+#!/usr/bin/env python
+#
+# Looped RTP sender for testing the IPTV reorder window and the
+# SMPTE 2022-1 FEC recovery, it can drop, duplicate and reorder the
+# media datagrams. The FEC is computed before the damage.
+#
+# Setup: IPTV network with "RTP Reorder Window" > 0 (and "RTP FEC"),
+# mux URL rtp://127.0.0.1:5000, then for example:
+#
+#   ./support/rtp-sender.py --loss 1 --reorder 2 --dup 1 --fec 5x5 test.ts
+#
+# The lost, reordered, duplicate and recovered datagrams are in the
+# api/status/inputs counters (rtp_loss, rtp_reorder, rtp_dup, rtp_fec).
+#
+
+import sys, time, random, socket, struct
+from optparse import OptionParser
+
+# Cmd line
+optp = OptionParser(usage='%prog [options] file.ts')
+optp.add_option('-i', '--ipaddr', default='127.0.0.1')
+optp.add_option('--port', default=5000, type='int',
+                help='media port, the FEC columns go to +2, rows to +4')
+optp.add_option('--rate', default=4.0, type='float',
+                help='bitrate in Mbit/s')
+optp.add_option('--loss', default=0.0, type='float',
+                help='percent of datagrams dropped')
+optp.add_option('--reorder', default=0.0, type='float',
+                help='percent of datagrams sent late')
+optp.add_option('--late', default=3, type='int',
+                help='how many datagrams later the late ones go out')
+optp.add_option('--dup', default=0.0, type='float',
+                help='percent of datagrams sent twice')
+optp.add_option('--fec', default=None,
+                help='LxD columns x rows matrix, e.g. 5x5')
+optp.add_option('--seed', default=None, type='int')
+optp.add_option('--loops', default=0, type='int',
+                help='file passes, 0 = forever')
+(opts, args) = optp.parse_args()
+if len(args) != 1:
+  optp.error('no input file')
+
+random.seed(opts.seed)
+fec_l = fec_d = 0
+if opts.fec:
+  fec_l, fec_d = map(int, opts.fec.split('x'))
+  if fec_l < 1 or fec_d < 1 or fec_l * fec_d > 100:
+    optp.error('invalid FEC matrix')
+
+sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+sock.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_TTL, 4)
+
+stats = { 'sent' : 0, 'lost' : 0, 'late' : 0, 'dup' : 0, 'fec' : 0 }
+
+def rtp_header ( pt, seq, ts ):
+  return struct.pack('>BBHII', 0x80, pt, seq & 0xffff, ts & 0xffffffff,
+                     0x12345678)
+
+def xor ( a, b ):
+  if len(a) < len(b):
+    a = a + bytearray(len(b) - len(a))
+  for i in range(len(b)):
+    a[i] ^= b[i]
+  return a
+
+# FEC packet over (seq, ts, payload) media, header as in SMPTE 2022-1
+fec_seq = [ 0, 0 ]
+def fec_packet ( media, offset, row ):
+  snbase = media[0][0]
+  lrec = tsrec = 0
+  prec = bytearray()
+  for (seq, ts, payload) in media:
+    lrec  ^= len(payload)
+    tsrec ^= ts
+    prec   = xor(prec, payload)
+  hdr = struct.pack('>HHBBHIBBBB', snbase & 0xffff, lrec, 0x80 | 33, 0, 0,
+                    tsrec, 0x40 if row else 0, offset, len(media), 0)
+  fec_seq[row] += 1
+  return rtp_header(96, fec_seq[row], 0) + hdr + bytes(prec)
+
+def send ( data, port ):
+  sock.sendto(data, (opts.ipaddr, port))
+
+# Pacing
+start = time.time()
+sent_bytes = 0
+def pace ( size ):
+  global sent_bytes
+  sent_bytes += size
+  delay = start + sent_bytes * 8 / (opts.rate * 1e6) - time.time()
+  if delay > 0:
+    time.sleep(delay)
+
+seq = random.randint(0, 0xffff)
+late = []
+matrix = []
+passes = 0
+try:
+  while opts.loops <= 0 or passes < opts.loops:
+    fp = open(args[0], 'rb')
+    while True:
+      payload = bytearray(fp.read(7 * 188))
+      if len(payload) < 188:
+        break
+      payload = payload[:len(payload) - (len(payload) % 188)]
+      ts  = int((time.time() - start) * 90000)
+      pkt = rtp_header(33, seq, ts) + bytes(payload)
+
+      # Damage
+      r = random.uniform(0, 100)
+      if r < opts.loss:
+        stats['lost'] += 1
+      elif r < opts.loss + opts.reorder:
+        late.append([opts.late, pkt])
+        stats['late'] += 1
+      else:
+        send(pkt, opts.port)
+        if r < opts.loss + opts.reorder + opts.dup:
+          send(pkt, opts.port)
+          stats['dup'] += 1
+      for l in late[:]:
+        l[0] -= 1
+        if l[0] <= 0:
+          send(l[1], opts.port)
+          late.remove(l)
+
+      # FEC over the undamaged stream, after the media it covers
+      if fec_l:
+        matrix.append((seq, ts, payload))
+        if len(matrix) % fec_l == 0:
+          send(fec_packet(matrix[-fec_l:], 1, 1), opts.port + 4)
+          stats['fec'] += 1
+        if len(matrix) == fec_l * fec_d:
+          for c in range(fec_l):
+            send(fec_packet(matrix[c::fec_l], fec_l, 0), opts.port + 2)
+            stats['fec'] += 1
+          matrix = []
+      seq = (seq + 1) & 0xffff
+      stats['sent'] += 1
+      pace(len(pkt))
+    fp.close()
+    passes += 1
+except KeyboardInterrupt:
+  pass
+
+print('%(sent)d datagrams, %(lost)d lost, %(late)d late, %(dup)d duplicated,'
+      ' %(fec)d FEC' % stats)